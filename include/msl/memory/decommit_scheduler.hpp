@@ -0,0 +1,290 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_DECOMMIT_SCHEDULER_HPP
+#define MSL_MEMORY_DECOMMIT_SCHEDULER_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <chrono>  // std::chrono::steady_clock
+#include <cstddef> // std::size_t
+#include <map>     // std::map
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A scheduler that defers and batches the decommitting of pages in
+  ///        a virtual memory reservation
+  ///
+  /// Eagerly decommitting pages as soon as they are unused causes thrashing
+  /// when usage oscillates around a page boundary, since every oscillation
+  /// costs a pair of system calls. Instead, pages may be `schedule`d for
+  /// decommitting along with the time they became unused; pages that are
+  /// reused before they decay may have their decommit `cancel`led for free.
+  ///
+  /// Calling `purge` decommits every scheduled page that has been unused for
+  /// at least the configured decay interval. Adjacent pages are coalesced so
+  /// that each contiguous run costs a single decommit. If the number of
+  /// scheduled pages crosses the configured pressure threshold, every
+  /// scheduled page is decommitted immediately instead.
+  ///
+  /// \note This type is not thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class decommit_scheduler
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+    using clock = std::chrono::steady_clock;
+
+    /// \brief The options that control when scheduled pages are decommitted
+    struct options
+    {
+      /// The time that a scheduled page must remain unused before it is
+      /// decommitted
+      clock::duration decay = std::chrono::seconds{10};
+
+      /// The number of bytes that may be scheduled before all scheduled pages
+      /// are decommitted immediately
+      bytes pressure_threshold = mebibytes{64u};
+
+      /// The policy used for decommitting pages
+      virtual_memory::decommit_policy policy = virtual_memory::decommit_policy::lazy;
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a scheduler for pages of \p memory, using the
+    ///        default options
+    ///
+    /// \param memory the memory to decommit pages from
+    explicit decommit_scheduler(virtual_memory& memory);
+
+    /// \brief Constructs a scheduler for pages of \p memory
+    ///
+    /// \param memory the memory to decommit pages from
+    /// \param scheduler_options the options controlling the scheduler
+    decommit_scheduler(virtual_memory& memory, options scheduler_options);
+
+    decommit_scheduler(const decommit_scheduler&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const decommit_scheduler&) -> decommit_scheduler& = delete;
+
+    //-------------------------------------------------------------------------
+    // Scheduling
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Schedules \p count pages, starting at the \p first page, to be
+    ///        decommitted
+    ///
+    /// Pages that are already scheduled are rescheduled at \p now. If this
+    /// crosses the pressure threshold, all scheduled pages are decommitted.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre `first + count` must be less than or equal to `memory.pages()`
+    /// \pre the pages must be committed
+    /// \param first the first page to schedule
+    /// \param count the number of pages to schedule
+    /// \param now the time at which the pages became unused
+    auto schedule(std::size_t first,
+                  uquantity<page> count,
+                  clock::time_point now = clock::now()) -> void;
+
+    /// \brief Schedules all pages spanned by \p block to be decommitted
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p block must start on a page boundary of the virtual memory,
+    ///      and its size must be a multiple of its page size
+    /// \param block the block of pages to schedule
+    /// \param now the time at which the pages became unused
+    auto schedule(memory_block block,
+                  clock::time_point now = clock::now()) -> void;
+
+    /// \brief Cancels the scheduled decommit of \p count pages, starting at
+    ///        the \p first page
+    ///
+    /// This should be called when pages are reused; the pages remain
+    /// committed. Pages that are not scheduled are ignored.
+    ///
+    /// \param first the first page to cancel
+    /// \param count the number of pages to cancel
+    auto cancel(std::size_t first, uquantity<page> count) -> void;
+
+    /// \brief Cancels the scheduled decommit of all pages spanned by \p block
+    ///
+    /// \param block the block of pages to cancel
+    auto cancel(memory_block block) -> void;
+
+    //-------------------------------------------------------------------------
+    // Purging
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Decommits all scheduled pages that have decayed by \p now
+    ///
+    /// If decommitting fails, the pages that were not decommitted remain
+    /// scheduled.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \param now the current time
+    /// \return the number of pages decommitted
+    auto purge(clock::time_point now = clock::now()) -> uquantity<page>;
+
+    /// \brief Decommits all scheduled pages, irrespective of decay
+    ///
+    /// If decommitting fails, the pages that were not decommitted remain
+    /// scheduled.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \return the number of pages decommitted
+    auto purge_all() -> uquantity<page>;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of pages scheduled to be decommitted
+    ///
+    /// \return the number of pages
+    auto scheduled_pages() const noexcept -> uquantity<page>;
+
+    /// \brief Queries whether the \p n'th page is scheduled to be decommitted
+    ///
+    /// \param n the page number
+    /// \return `true` if the page is scheduled
+    auto is_scheduled(std::size_t n) const noexcept -> bool;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    struct entry
+    {
+      std::size_t count;
+      clock::time_point scheduled;
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    virtual_memory* m_memory;
+    options m_options;
+
+    // Non-overlapping runs of scheduled pages, keyed on the first page
+    std::map<std::size_t, entry> m_scheduled;
+    std::size_t m_scheduled_pages;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Removes the pages `[first, last)` from the scheduled runs,
+    ///        splitting any run that partially overlaps them
+    ///
+    /// \param first the first page
+    /// \param last one past the last page
+    auto unschedule(std::size_t first, std::size_t last) -> void;
+
+    /// \brief Decommits all scheduled runs that satisfy \p predicate,
+    ///        coalescing adjacent runs into single decommits
+    ///
+    /// \param predicate the predicate determining if a run is decommitted
+    /// \return the number of pages decommitted
+    template <typename Predicate>
+    auto purge_if(Predicate predicate) -> uquantity<page>;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Scheduling
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::decommit_scheduler::schedule(memory_block block,
+                                       clock::time_point now)
+  -> void
+{
+  const auto offset = block.start_address().get() - m_memory->data();
+  const auto page_size = m_memory->page_size();
+
+  MSL_ASSERT((static_cast<std::size_t>(offset) % page_size.count()) == 0u);
+  MSL_ASSERT((block.size() % page_size) == bytes::zero());
+
+  schedule(
+    static_cast<std::size_t>(offset) / page_size.count(),
+    uquantity<page>{block.size() / page_size},
+    now
+  );
+}
+
+inline
+auto msl::decommit_scheduler::cancel(memory_block block)
+  -> void
+{
+  const auto offset = block.start_address().get() - m_memory->data();
+  const auto page_size = m_memory->page_size();
+
+  cancel(
+    static_cast<std::size_t>(offset) / page_size.count(),
+    uquantity<page>{block.size() / page_size}
+  );
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::decommit_scheduler::scheduled_pages()
+  const noexcept -> uquantity<page>
+{
+  return uquantity<page>{m_scheduled_pages};
+}
+
+#endif /* MSL_MEMORY_DECOMMIT_SCHEDULER_HPP */
@@ -0,0 +1,354 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_MAPPED_FILE_HPP
+#define MSL_MEMORY_MAPPED_FILE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::intptr_t
+#include <filesystem> // std::filesystem::path
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief An RAII wrapper around a file that is mapped into virtual memory
+  ///
+  /// The file is mapped at the start of a reservation of `capacity()` pages,
+  /// which allows the file to be resized without ever moving it in memory.
+  /// This makes it suitable for persistent arenas whose contents refer to
+  /// themselves by address.
+  ///
+  /// Only the pages spanned by the file are accessible; the remainder of the
+  /// reservation is inaccessible until the file is grown into it.
+  /////////////////////////////////////////////////////////////////////////////
+  class mapped_file
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    /// \brief How writes to the mapping are shared
+    enum class sharing_mode {
+      shared,       ///< Writes are carried through to the file, and are
+                    ///< visible to every other mapping of it (MAP_SHARED)
+      private_copy, ///< Writes are copied-on-write, and are never carried
+                    ///< through to the file (MAP_PRIVATE)
+      read_only,    ///< Pages can only be read, and the file is never
+                    ///< written (PROT_READ)
+    };
+
+    /// \brief The expected pattern of access to the mapping, used to tune
+    ///        read-ahead from the file
+    enum class access_pattern {
+      normal,     ///< No particular pattern
+      sequential, ///< Pages are accessed in ascending order, and can be
+                  ///< read ahead aggressively (MADV_SEQUENTIAL)
+      random,     ///< Pages are accessed in no order, and should not be
+                  ///< read ahead (MADV_RANDOM)
+    };
+
+    /// \brief Whether synchronizing waits for the writes to complete
+    enum class sync_mode {
+      synchronous,  ///< Wait for the writes to complete (MS_SYNC)
+      asynchronous, ///< Only schedule the writes (MS_ASYNC)
+    };
+
+    //-------------------------------------------------------------------------
+    // Static Functions
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Opens the file at \p path and maps it into a reservation of
+    ///        \p capacity pages
+    ///
+    /// The file is created if it does not already exist, unless \p mode is
+    /// `sharing_mode::read_only`. Only `sharing_mode::shared` opens the file
+    /// for writing, so files that may only be read can still be mapped with
+    /// `sharing_mode::private_copy`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    /// \throw std::length_error if the file is larger than \p capacity
+    ///
+    /// \param path the path to the file
+    /// \param capacity the largest number of pages the file may grow to
+    /// \param mode how writes to the mapping are shared
+    /// \return the mapped file, on success
+    static auto open(const std::filesystem::path& path,
+                     uquantity<page> capacity,
+                     sharing_mode mode = sharing_mode::shared) -> mapped_file;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    mapped_file(mapped_file&& other) noexcept;
+
+    mapped_file(const mapped_file&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    ~mapped_file();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(mapped_file&& other) noexcept -> mapped_file&;
+
+    auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+    //-------------------------------------------------------------------------
+    // Element Access
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the underlying data pointer
+    ///
+    /// \return the pointer
+    auto data() const noexcept -> std::byte*;
+
+    /// \brief Accesses the page at offset \p n
+    ///
+    /// \pre n must be less than `pages()`
+    /// \return the page at the offset
+    auto operator[](std::size_t n) const noexcept -> page;
+
+    //-------------------------------------------------------------------------
+    // Capacity
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the size of a page of this mapping, in bytes
+    ///
+    /// \return the size of a page in bytes
+    auto page_size() const noexcept -> bytes;
+
+    /// \brief Gets the size of the file, in bytes
+    ///
+    /// \return the size of the file
+    auto size() const noexcept -> bytes;
+
+    /// \brief Gets the number of pages spanned by the file
+    ///
+    /// The final page may extend past the end of the file; the bytes past the
+    /// end are never written to the file. They read as zero, unless the
+    /// mapping was shrunk without resizing the file (see `resize`).
+    ///
+    /// \return the number of pages
+    auto pages() const noexcept -> uquantity<page>;
+
+    /// \brief Gets the largest number of pages the file may grow to
+    ///
+    /// \return the number of pages
+    auto capacity() const noexcept -> uquantity<page>;
+
+    /// \brief Gets how writes to this mapping are shared
+    ///
+    /// \return the sharing mode
+    auto mode() const noexcept -> sharing_mode;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Resizes the mapping to \p size bytes
+    ///
+    /// Pages are mapped or unmapped to match, and the mapping never moves.
+    ///
+    /// Only a `sharing_mode::shared` mapping truncates or extends the file on
+    /// disk. Any other mapping leaves the file untouched: pages that lie past
+    /// the end of the file are backed by anonymous memory that reads as zero,
+    /// and shrinking only unmaps pages. The bytes of the final page past
+    /// \p size are zeroed for `sharing_mode::private_copy`, and left as they
+    /// were for `sharing_mode::read_only`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::length_error if \p size exceeds the capacity
+    ///
+    /// \param size the new size of the file
+    auto resize(bytes size) -> void;
+
+    /// \brief Writes all modified pages of the mapping back to the file
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \param sync whether to wait for the writes to complete
+    auto sync(sync_mode sync = sync_mode::synchronous) -> void;
+
+    /// \brief Writes the modified pages spanned by \p block back to the file
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p block must start on a page boundary of this mapping, and lie
+    ///      within `pages()`
+    /// \param block the block of pages to write back
+    /// \param sync whether to wait for the writes to complete
+    auto sync(memory_block block,
+              sync_mode sync = sync_mode::synchronous) -> void;
+
+    /// \brief Advises the system of the expected \p pattern of access to
+    ///        the mapping
+    ///
+    /// This is only a hint, and has no effect on the contents of the mapping.
+    ///
+    /// \param pattern the expected access pattern
+    auto advise(access_pattern pattern) noexcept -> void;
+
+    /// \brief Advises the system of the expected \p pattern of access to the
+    ///        pages spanned by \p block
+    ///
+    /// \pre \p block must start on a page boundary of this mapping
+    /// \param block the block of pages being advised on
+    /// \param pattern the expected access pattern
+    auto advise(memory_block block, access_pattern pattern) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    using native_handle_type = std::intptr_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    virtual_memory m_memory;
+    native_handle_type m_file;
+    bytes m_size;
+    sharing_mode m_mode;
+
+    /// \brief Constructs the mapped file from a reservation and the handle of
+    ///        an open file, with no pages mapped
+    ///
+    /// \param memory the reservation to map the file into
+    /// \param file the handle of the open file
+    /// \param mode how writes to the mapping are shared
+    mapped_file(virtual_memory memory,
+                native_handle_type file,
+                sharing_mode mode) noexcept;
+
+    /// \brief Maps the pages from \p first up to \p last, which lie past the
+    ///        pages that are currently mapped, without resizing the file
+    ///
+    /// \param first the first page to map
+    /// \param last the page past the last page to map
+    auto map_without_resizing(std::size_t first, std::size_t last) -> void;
+
+    /// \brief Computes the number of pages required to span \p size bytes
+    ///
+    /// \param size the number of bytes
+    /// \return the number of pages
+    auto pages_for(bytes size) const noexcept -> std::size_t;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Element Access
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::data()
+  const noexcept -> std::byte*
+{
+  return m_memory.data();
+}
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::operator[](std::size_t n)
+  const noexcept -> page
+{
+  MSL_ASSERT(n < pages().count(), "Indexing a page past the end of the file");
+
+  return m_memory[n];
+}
+
+//-----------------------------------------------------------------------------
+// Capacity
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::page_size()
+  const noexcept -> bytes
+{
+  return m_memory.page_size();
+}
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::size()
+  const noexcept -> bytes
+{
+  return m_size;
+}
+
+inline
+auto msl::mapped_file::pages()
+  const noexcept -> uquantity<page>
+{
+  return uquantity<page>{pages_for(m_size)};
+}
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::capacity()
+  const noexcept -> uquantity<page>
+{
+  return m_memory.pages();
+}
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::mode()
+  const noexcept -> sharing_mode
+{
+  return m_mode;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::mapped_file::pages_for(bytes size)
+  const noexcept -> std::size_t
+{
+  const auto page_bytes = page_size().count();
+
+  return (size.count() + page_bytes - 1u) / page_bytes;
+}
+
+#endif /* MSL_MEMORY_MAPPED_FILE_HPP */
@@ -0,0 +1,215 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_MEMORY_PRESSURE_MONITOR_HPP
+#define MSL_MEMORY_MEMORY_PRESSURE_MONITOR_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/quantities/digital_quantity.hpp"
+
+#include <cstddef>    // std::size_t
+#include <filesystem> // std::filesystem::path
+#include <functional> // std::function
+#include <map>        // std::map
+#include <mutex>      // std::mutex
+#include <optional>   // std::optional
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A monitor of the memory pressure on a cgroup (v2), which notifies
+  ///        callbacks as thresholds are crossed
+  ///
+  /// Containers are killed once they exceed `memory.max`, and throttled once
+  /// they exceed `memory.high`. Reservations and caches can register
+  /// callbacks that shrink them -- such as by decommitting idle pages or
+  /// trimming pools -- before either happens.
+  ///
+  /// The monitor does not start any threads; it only reads the cgroup when
+  /// `poll` is called, which should be done periodically.
+  ///
+  /// The usage and limits are read from `memory.current`, `memory.high` and
+  /// `memory.max` of the cgroup, and the pressure stall information (PSI) is
+  /// read from `/proc/pressure/memory` by default. Any of these that cannot
+  /// be read are reported as unknown, and never cross a threshold.
+  ///
+  /// \note This type is thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class memory_pressure_monitor
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief A snapshot of the memory usage and pressure of the cgroup
+    struct snapshot
+    {
+      std::optional<bytes> current; ///< The memory used by the cgroup
+      std::optional<bytes> high;    ///< The throttling limit, if any
+      std::optional<bytes> max;     ///< The hard limit, if any
+
+      /// The percentage of the last 10 seconds in which some tasks were
+      /// stalled waiting on memory
+      std::optional<double> some_avg10;
+
+      /// The percentage of the last 10 seconds in which all tasks were
+      /// stalled waiting on memory
+      std::optional<double> full_avg10;
+
+      /// \brief Gets the lowest limit of the cgroup, if any
+      ///
+      /// \return the lower of `high` and `max`
+      auto limit() const noexcept -> std::optional<bytes>;
+
+      /// \brief Gets the fraction of the lowest limit that is in use
+      ///
+      /// \return the ratio of `current` to `limit()`, if both are known
+      auto usage_ratio() const noexcept -> std::optional<double>;
+    };
+
+    /// \brief The conditions under which a callback is notified
+    ///
+    /// A threshold is crossed when any of its conditions is met. Conditions
+    /// that are not set are ignored.
+    struct threshold
+    {
+      /// The fraction of the lowest limit that may be in use
+      std::optional<double> usage_ratio = std::nullopt;
+
+      /// The `some_avg10` stall percentage that may be reached
+      std::optional<double> some_avg10 = std::nullopt;
+
+      /// The `full_avg10` stall percentage that may be reached
+      std::optional<double> full_avg10 = std::nullopt;
+    };
+
+    using callback_type = std::function<void(const snapshot&)>;
+    using callback_id = std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Static Functions
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Determines the cgroup directory of the calling process
+    ///
+    /// This is read from the unified hierarchy entry of `/proc/self/cgroup`,
+    /// relative to `/sys/fs/cgroup`.
+    ///
+    /// \return the path to the cgroup directory
+    static auto current_cgroup() -> std::filesystem::path;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a monitor of the cgroup of the calling process
+    memory_pressure_monitor();
+
+    /// \brief Constructs a monitor of the cgroup at \p cgroup
+    ///
+    /// \param cgroup the path to the cgroup directory
+    /// \param psi the path to the pressure stall information, or an empty
+    ///        path to not read it
+    explicit memory_pressure_monitor(std::filesystem::path cgroup,
+                                     std::filesystem::path psi = "/proc/pressure/memory");
+
+    memory_pressure_monitor(const memory_pressure_monitor&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const memory_pressure_monitor&) -> memory_pressure_monitor& = delete;
+
+    //-------------------------------------------------------------------------
+    // Callbacks
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Adds a callback that is notified when \p limit is crossed
+    ///
+    /// Callbacks are notified once each time the threshold is crossed, and
+    /// are not notified again until the pressure has first fallen back below
+    /// it.
+    ///
+    /// \param limit the threshold to notify at
+    /// \param callback the callback to notify
+    /// \return an identifier for removing the callback
+    auto add_callback(threshold limit, callback_type callback) -> callback_id;
+
+    /// \brief Removes the callback identified by \p id
+    ///
+    /// \param id the identifier returned from `add_callback`
+    auto remove_callback(callback_id id) -> void;
+
+    //-------------------------------------------------------------------------
+    // Monitoring
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Reads the current memory pressure, without notifying any
+    ///        callbacks
+    ///
+    /// \return the snapshot of the memory pressure
+    auto read() const -> snapshot;
+
+    /// \brief Reads the current memory pressure, and notifies each callback
+    ///        whose threshold has been crossed since the last poll
+    ///
+    /// Callbacks are notified on the calling thread, without any locks held.
+    ///
+    /// \return the snapshot of the memory pressure
+    auto poll() -> snapshot;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    struct registration
+    {
+      threshold limit;
+      callback_type callback;
+      bool crossed;
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    std::filesystem::path m_cgroup;
+    std::filesystem::path m_psi;
+
+    mutable std::mutex m_mutex;
+    std::map<callback_id, registration> m_callbacks;
+    callback_id m_next_id;
+  };
+
+} // namespace msl
+
+#endif /* MSL_MEMORY_MEMORY_PRESSURE_MONITOR_HPP */
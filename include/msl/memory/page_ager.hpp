@@ -0,0 +1,299 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_PAGE_AGER_HPP
+#define MSL_MEMORY_PAGE_AGER_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <chrono>  // std::chrono::steady_clock
+#include <cstddef> // std::size_t
+#include <vector>  // std::vector
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief An ager that cools the least recently used pages of a virtual
+  ///        memory reservation
+  ///
+  /// The system cannot tell which pages of a large cache are rarely used until
+  /// it is already under memory pressure, at which point it may evict hot
+  /// pages as readily as cold ones. Instead, accesses to pages may be
+  /// recorded with `touch`, and calling `age` marks every committed page that
+  /// has gone unused for long enough as `cold` -- and eventually as
+  /// `paged_out` -- so that it leaves physical memory before any hotter page.
+  ///
+  /// Adjacent pages that cool at the same time are coalesced, so that each
+  /// contiguous run costs a single hint. Pages that are accessed again may be
+  /// `warm`ed ahead of time, rather than waiting for each page to be read back
+  /// when it is first accessed.
+  ///
+  /// \note This type is not thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class page_ager
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+    using page_temperature = virtual_memory::page_temperature;
+    using clock = std::chrono::steady_clock;
+
+    /// \brief The options that control when pages are cooled
+    struct options
+    {
+      /// The time that a page must remain unused before it is marked cold
+      clock::duration cold_after = std::chrono::seconds{30};
+
+      /// The time that a page must remain unused before it is paged out
+      clock::duration page_out_after = std::chrono::minutes{5};
+    };
+
+    /// \brief The number of pages cooled by a call to `age`
+    struct report
+    {
+      uquantity<page> cooled;    ///< The pages newly marked cold
+      uquantity<page> paged_out; ///< The pages newly paged out
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs an ager for pages of \p memory, using the default
+    ///        options
+    ///
+    /// Every page is considered to have last been accessed at \p now.
+    ///
+    /// \param memory the memory to age pages of
+    /// \param now the current time
+    explicit page_ager(virtual_memory& memory,
+                       clock::time_point now = clock::now());
+
+    /// \brief Constructs an ager for pages of \p memory
+    ///
+    /// Every page is considered to have last been accessed at \p now.
+    ///
+    /// \param memory the memory to age pages of
+    /// \param ager_options the options controlling the ager
+    /// \param now the current time
+    page_ager(virtual_memory& memory,
+              options ager_options,
+              clock::time_point now = clock::now());
+
+    page_ager(const page_ager&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const page_ager&) -> page_ager& = delete;
+
+    //-------------------------------------------------------------------------
+    // Access Tracking
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Records an access to \p count pages, starting at the \p first
+    ///        page
+    ///
+    /// Pages that were cooled are considered warm again, since accessing them
+    /// brings them back into physical memory.
+    ///
+    /// \pre `first + count` must be less than or equal to `memory.pages()`
+    /// \param first the first page accessed
+    /// \param count the number of pages accessed
+    /// \param now the time of the access
+    auto touch(std::size_t first,
+               uquantity<page> count,
+               clock::time_point now = clock::now()) -> void;
+
+    /// \brief Records an access to all pages spanned by \p block
+    ///
+    /// \pre \p block must start on a page boundary of the virtual memory,
+    ///      and its size must be a multiple of its page size
+    /// \param block the block of pages accessed
+    /// \param now the time of the access
+    auto touch(memory_block block, clock::time_point now = clock::now()) -> void;
+
+    /// \brief Records an access to \p count pages, starting at the \p first
+    ///        page, and brings any of them that were cooled back into
+    ///        physical memory ahead of the access
+    ///
+    /// \pre `first + count` must be less than or equal to `memory.pages()`
+    /// \pre the pages must be committed
+    /// \param first the first page to warm
+    /// \param count the number of pages to warm
+    /// \param now the time of the access
+    auto warm(std::size_t first,
+              uquantity<page> count,
+              clock::time_point now = clock::now()) -> void;
+
+    /// \brief Records an access to all pages spanned by \p block, and brings
+    ///        any of them that were cooled back into physical memory ahead of
+    ///        the access
+    ///
+    /// \pre \p block must start on a page boundary of the virtual memory,
+    ///      and its size must be a multiple of its page size
+    /// \pre the pages must be committed
+    /// \param block the block of pages to warm
+    /// \param now the time of the access
+    auto warm(memory_block block, clock::time_point now = clock::now()) -> void;
+
+    //-------------------------------------------------------------------------
+    // Aging
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Cools every committed page that has gone unused for long
+    ///        enough by \p now
+    ///
+    /// Pages that were decommitted are considered warm, since committing them
+    /// again provides fresh pages. Pages whose hint the system rejects -- such
+    /// as locked pages, or where the hint is unsupported -- keep their
+    /// temperature, and are tried again by the next call.
+    ///
+    /// \param now the current time
+    /// \return the number of pages cooled
+    auto age(clock::time_point now = clock::now()) -> report;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the temperature that the \p n'th page was last marked as
+    ///
+    /// \pre \p n must be less than `memory.pages()`
+    /// \param n the page number
+    /// \return the temperature of the page
+    auto temperature(std::size_t n) const noexcept -> page_temperature;
+
+    /// \brief Gets the time that the \p n'th page was last accessed
+    ///
+    /// \pre \p n must be less than `memory.pages()`
+    /// \param n the page number
+    /// \return the time of the last access
+    auto last_access(std::size_t n) const noexcept -> clock::time_point;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    virtual_memory* m_memory;
+    options m_options;
+
+    // The time of the last access, and the temperature, of each page
+    std::vector<clock::time_point> m_last_access;
+    std::vector<page_temperature> m_temperatures;
+
+    // The time that pages added by growing the memory were last accounted for
+    clock::time_point m_last_sync;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Extends the bookkeeping to cover any pages that the memory has
+    ///        grown by since it was last updated
+    ///
+    /// \param now the time to consider the new pages last accessed at
+    auto sync(clock::time_point now) -> void;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Access Tracking
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::page_ager::touch(memory_block block, clock::time_point now)
+  -> void
+{
+  const auto offset = block.start_address().get() - m_memory->data();
+  const auto page_size = m_memory->page_size();
+
+  MSL_ASSERT((static_cast<std::size_t>(offset) % page_size.count()) == 0u);
+  MSL_ASSERT((block.size() % page_size) == bytes::zero());
+
+  touch(
+    static_cast<std::size_t>(offset) / page_size.count(),
+    uquantity<page>{block.size() / page_size},
+    now
+  );
+}
+
+inline
+auto msl::page_ager::warm(memory_block block, clock::time_point now)
+  -> void
+{
+  const auto offset = block.start_address().get() - m_memory->data();
+  const auto page_size = m_memory->page_size();
+
+  MSL_ASSERT((static_cast<std::size_t>(offset) % page_size.count()) == 0u);
+  MSL_ASSERT((block.size() % page_size) == bytes::zero());
+
+  warm(
+    static_cast<std::size_t>(offset) / page_size.count(),
+    uquantity<page>{block.size() / page_size},
+    now
+  );
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::page_ager::temperature(std::size_t n)
+  const noexcept -> page_temperature
+{
+  // Pages that the memory has grown by since the last update are still warm
+  if (n >= m_temperatures.size()) {
+    return page_temperature::warm;
+  }
+  return m_temperatures[n];
+}
+
+inline
+auto msl::page_ager::last_access(std::size_t n)
+  const noexcept -> clock::time_point
+{
+  if (n >= m_last_access.size()) {
+    return m_last_sync;
+  }
+  return m_last_access[n];
+}
+
+#endif /* MSL_MEMORY_PAGE_AGER_HPP */
@@ -0,0 +1,294 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_RING_BUFFER_HPP
+#define MSL_MEMORY_RING_BUFFER_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/utilities/assert.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <atomic>  // std::atomic
+#include <cstddef> // std::size_t
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A byte ring buffer whose storage is mapped twice, back to back,
+  ///        in a single reservation
+  ///
+  /// Since the second mapping mirrors the first, any range of up to
+  /// `capacity()` bytes starting inside of the buffer is contiguous in memory
+  /// -- even if it wraps around the end. Reads and writes are exposed as
+  /// zero-copy `memory_block` views, which never need to be split in two.
+  ///
+  /// Producers `acquire_write` a view, fill it, and `release_write` the bytes
+  /// that were written; consumers `acquire_read` a view, process it, and
+  /// `release_read` the bytes that were consumed.
+  ///
+  /// \note This type is safe for a single producer thread and a single
+  ///       consumer thread to use concurrently.
+  /////////////////////////////////////////////////////////////////////////////
+  class ring_buffer
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a ring buffer with a capacity of \p pages pages
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages of storage; must not be zero
+    explicit ring_buffer(uquantity<page> pages);
+
+    ring_buffer(const ring_buffer&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const ring_buffer&) -> ring_buffer& = delete;
+
+    //-------------------------------------------------------------------------
+    // Capacity
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of bytes that this buffer can hold
+    ///
+    /// \return the capacity in bytes
+    auto capacity() const noexcept -> bytes;
+
+    /// \brief Gets the number of bytes that may currently be read
+    ///
+    /// \return the number of readable bytes
+    auto readable() const noexcept -> bytes;
+
+    /// \brief Gets the number of bytes that may currently be written
+    ///
+    /// \return the number of writable bytes
+    auto writable() const noexcept -> bytes;
+
+    //-------------------------------------------------------------------------
+    // Cursors
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the total number of bytes that have been written
+    ///
+    /// \return the producer cursor
+    auto write_cursor() const noexcept -> std::size_t;
+
+    /// \brief Gets the total number of bytes that have been read
+    ///
+    /// \return the consumer cursor
+    auto read_cursor() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Producer
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Acquires a contiguous view of \p n bytes to write to
+    ///
+    /// The bytes are not visible to the consumer until `release_write` is
+    /// called.
+    ///
+    /// \pre \p n must be less than or equal to `writable()`
+    /// \param n the number of bytes to acquire
+    /// \return the view to write to
+    auto acquire_write(bytes n) const noexcept -> memory_block;
+
+    /// \brief Publishes \p n written bytes to the consumer
+    ///
+    /// \pre \p n must be less than or equal to `writable()`
+    /// \param n the number of bytes to publish
+    auto release_write(bytes n) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Consumer
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Acquires a contiguous view of \p n bytes to read from
+    ///
+    /// \pre \p n must be less than or equal to `readable()`
+    /// \param n the number of bytes to acquire
+    /// \return the view to read from
+    auto acquire_read(bytes n) const noexcept -> memory_block;
+
+    /// \brief Returns \p n read bytes to the producer
+    ///
+    /// \pre \p n must be less than or equal to `readable()`
+    /// \param n the number of bytes to return
+    auto release_read(bytes n) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    virtual_memory m_memory;
+    std::size_t m_capacity;
+
+    // The cursors only ever increase; their offsets into the buffer are taken
+    // modulo the capacity. Each is written by only one side, and is kept on
+    // its own cache line to avoid false sharing between the two.
+    alignas(64) std::atomic<std::size_t> m_write;
+    alignas(64) std::atomic<std::size_t> m_read;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Gets a view of \p n bytes at the offset of \p cursor
+    ///
+    /// \param cursor the cursor to view from
+    /// \param n the number of bytes to view
+    /// \return the view
+    auto view(std::size_t cursor, bytes n) const noexcept -> memory_block;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Capacity
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::ring_buffer::capacity()
+  const noexcept -> bytes
+{
+  return bytes{m_capacity};
+}
+
+inline
+auto msl::ring_buffer::readable()
+  const noexcept -> bytes
+{
+  const auto write = m_write.load(std::memory_order_acquire);
+  const auto read = m_read.load(std::memory_order_acquire);
+
+  return bytes{write - read};
+}
+
+inline
+auto msl::ring_buffer::writable()
+  const noexcept -> bytes
+{
+  return capacity() - readable();
+}
+
+//-----------------------------------------------------------------------------
+// Cursors
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::ring_buffer::write_cursor()
+  const noexcept -> std::size_t
+{
+  return m_write.load(std::memory_order_acquire);
+}
+
+inline
+auto msl::ring_buffer::read_cursor()
+  const noexcept -> std::size_t
+{
+  return m_read.load(std::memory_order_acquire);
+}
+
+//-----------------------------------------------------------------------------
+// Producer
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::ring_buffer::acquire_write(bytes n)
+  const noexcept -> memory_block
+{
+  MSL_ASSERT(n <= writable(), "Acquiring more bytes than are writable");
+
+  return view(m_write.load(std::memory_order_relaxed), n);
+}
+
+inline
+auto msl::ring_buffer::release_write(bytes n)
+  noexcept -> void
+{
+  MSL_ASSERT(n <= writable(), "Releasing more bytes than are writable");
+
+  m_write.fetch_add(n.count(), std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Consumer
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::ring_buffer::acquire_read(bytes n)
+  const noexcept -> memory_block
+{
+  MSL_ASSERT(n <= readable(), "Acquiring more bytes than are readable");
+
+  return view(m_read.load(std::memory_order_relaxed), n);
+}
+
+inline
+auto msl::ring_buffer::release_read(bytes n)
+  noexcept -> void
+{
+  MSL_ASSERT(n <= readable(), "Releasing more bytes than are readable");
+
+  m_read.fetch_add(n.count(), std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::ring_buffer::view(std::size_t cursor, bytes n)
+  const noexcept -> memory_block
+{
+  const auto offset = cursor % m_capacity;
+  const auto p = assume_not_null(m_memory.data()) + offset;
+
+  return memory_block::from_pointer_and_length(p, n);
+}
+
+#endif /* MSL_MEMORY_RING_BUFFER_HPP */
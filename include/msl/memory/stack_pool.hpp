@@ -0,0 +1,256 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_STACK_POOL_HPP
+#define MSL_MEMORY_STACK_POOL_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/decommit_scheduler.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <cstddef> // std::size_t
+#include <map>     // std::map
+#include <memory>  // std::unique_ptr
+#include <vector>  // std::vector
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A pool of guard-paged stacks for fibers and stackful coroutines
+  ///
+  /// Stacks are carved out of large slabs of virtual memory, so that a single
+  /// reservation serves many stacks. Each stack sits directly above its own
+  /// inaccessible guard pages, so overflowing a stack faults immediately
+  /// rather than silently corrupting its neighbor.
+  ///
+  /// Stacks are committed lazily the first time that they are acquired. On
+  /// most systems committing does not consume physical memory until each page
+  /// is first touched, so stacks only ever cost as much memory as they use.
+  ///
+  /// Released stacks are kept for reuse, and are scheduled to be decommitted
+  /// once they have been idle for the decay interval of the configured
+  /// `decommit_scheduler::options`. Reacquiring a stack before then is free.
+  /// Idle stacks are decommitted only when `purge` is called.
+  ///
+  /// \note This type is not thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class stack_pool
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+    using clock = decommit_scheduler::clock;
+
+    /// \brief The options that control the layout and reuse of stacks
+    struct options
+    {
+      /// The number of usable pages in each stack
+      uquantity<page> stack_pages = uquantity<page>{16u};
+
+      /// The number of guard pages below each stack
+      uquantity<page> guard_pages = uquantity<page>{1u};
+
+      /// The number of stacks in each slab of virtual memory
+      std::size_t stacks_per_slab = 64u;
+
+      /// The options for decommitting idle stacks
+      decommit_scheduler::options decommit = {};
+
+      /// The hooks that back each slab, or null to reserve slabs directly
+      /// from the system. The hooks must outlive the pool.
+      virtual_memory_hooks* hooks = nullptr;
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a stack pool with the default options
+    stack_pool();
+
+    /// \brief Constructs a stack pool with the specified \p pool_options
+    ///
+    /// \param pool_options the options controlling the pool
+    explicit stack_pool(options pool_options);
+
+    stack_pool(const stack_pool&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const stack_pool&) -> stack_pool& = delete;
+
+    //-------------------------------------------------------------------------
+    // Stacks
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Acquires a committed stack
+    ///
+    /// Stacks grow downwards, so the top of the returned stack is its
+    /// `end_address()`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \return the usable memory of the stack
+    auto acquire() -> memory_block;
+
+    /// \brief Releases the \p stack back to this pool, to be decommitted once
+    ///        it has been idle for long enough
+    ///
+    /// Scheduling the stack may decommit idle stacks early if too many are
+    /// scheduled. If that fails, the stack is still released, and the idle
+    /// stacks remain scheduled to be decommitted by the next purge.
+    ///
+    /// \throw std::bad_alloc if the stack cannot be cached; the stack is then
+    ///        still acquired
+    ///
+    /// \pre \p stack must have been acquired from this pool
+    /// \param stack the stack to release
+    /// \param now the time at which the stack became idle
+    auto release(memory_block stack,
+                 clock::time_point now = clock::now()) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Decommits all released stacks that have been idle for the decay
+    ///        interval by \p now
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \param now the current time
+    /// \return the number of pages decommitted
+    auto purge(clock::time_point now = clock::now()) -> uquantity<page>;
+
+    /// \brief Decommits all released stacks, irrespective of how long they
+    ///        have been idle
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \return the number of pages decommitted
+    auto purge_all() -> uquantity<page>;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the usable size of each stack
+    ///
+    /// \return the size of each stack in bytes
+    auto stack_size() const noexcept -> bytes;
+
+    /// \brief Gets the number of stacks that are currently acquired
+    ///
+    /// \return the number of stacks
+    auto acquired_stacks() const noexcept -> std::size_t;
+
+    /// \brief Gets the number of released stacks kept for reuse
+    ///
+    /// \return the number of stacks
+    auto cached_stacks() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    struct slab
+    {
+      slab(virtual_memory slab_memory,
+           decommit_scheduler::options decommit_options);
+
+      virtual_memory memory;
+      decommit_scheduler scheduler;
+    };
+
+    struct stack_location
+    {
+      slab* owner;
+      std::size_t first_page;
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    options m_options;
+
+    // Slabs are keyed on their base address, so that the owner of a stack can
+    // be found from its address. They are never released before the pool,
+    // since the scheduler of each refers to its memory.
+    std::map<std::byte*, std::unique_ptr<slab>> m_slabs;
+
+    // The released stacks; these are tracked outside of the stacks themselves
+    // since decommitted memory cannot be relied upon to hold its contents.
+    std::vector<stack_location> m_free;
+    std::size_t m_acquired;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Reserves a new slab, and adds each of its stacks to the free
+    ///        list
+    auto add_slab() -> void;
+
+    /// \brief Finds the location of the stack starting at \p p
+    ///
+    /// \param p the start of the usable memory of the stack
+    /// \return the location of the stack
+    auto locate(std::byte* p) const noexcept -> stack_location;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::stack_pool::acquired_stacks()
+  const noexcept -> std::size_t
+{
+  return m_acquired;
+}
+
+inline
+auto msl::stack_pool::cached_stacks()
+  const noexcept -> std::size_t
+{
+  return m_free.size();
+}
+
+#endif /* MSL_MEMORY_STACK_POOL_HPP */
@@ -0,0 +1,412 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_SWAP_PAGER_HPP
+#define MSL_MEMORY_SWAP_PAGER_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <cstddef>    // std::size_t
+#include <filesystem> // std::filesystem::path
+#include <memory>     // std::unique_ptr
+
+namespace msl {
+  namespace detail {
+    class swap_space;
+  } // namespace detail
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A reservation of virtual memory whose pages are swapped out to a
+  ///        backing file whenever more of them are resident than a budget
+  ///        allows
+  ///
+  /// This allows data sets that are larger than the physical memory that a
+  /// process may use -- such as the memory limit of a container -- to remain
+  /// usable, degrading gracefully into disk accesses rather than having the
+  /// process killed.
+  ///
+  /// Committed pages are either resident or swapped out. Whenever committing
+  /// or accessing a page would exceed the resident budget, the least recently
+  /// used resident pages are written to the backing file and decommitted.
+  /// Accessing a page that is swapped out faults, and the fault is resolved
+  /// by reading the page back in before the access is retried; so, aside from
+  /// the latency, swapping is invisible to the code that accesses the pages.
+  ///
+  /// Pages are ordered by when they were committed, swapped in, or last
+  /// `touch`ed; the system provides no portable way to observe other accesses
+  /// to resident pages, so callers with their own notion of access should
+  /// `touch` the pages they use.
+  ///
+  /// \note Faults are resolved in a signal handler, so swapped out pages must
+  ///       not be accessed from other signal handlers, and pages must not be
+  ///       passed to system calls (such as `read` or `write`) without first
+  ///       being `fetch`ed.
+  /////////////////////////////////////////////////////////////////////////////
+  class swap_pager
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    /// \brief The options that control how pages are swapped
+    struct options
+    {
+      /// The number of bytes that may be resident before pages are swapped
+      /// out; this is never less than 4 pages, so that a single instruction
+      /// that accesses several swapped out pages can always complete
+      bytes resident_budget = mebibytes{256u};
+
+      /// The directory to create the backing file in. If empty, the system's
+      /// temporary directory is used, or `/var/tmp` if the former is backed
+      /// by memory (as a tmpfs often is). Directories backed by memory are
+      /// rejected, since swapping to them would save no memory at all. The
+      /// file is removed as soon as it is created.
+      std::filesystem::path directory = {};
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Reserves \p pages pages of memory that are swapped using the
+    ///        default options
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages to reserve
+    explicit swap_pager(uquantity<page> pages);
+
+    /// \brief Reserves \p pages pages of memory that are swapped according to
+    ///        \p pager_options
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages to reserve
+    /// \param pager_options the options controlling the pager
+    swap_pager(uquantity<page> pages, options pager_options);
+
+    swap_pager(swap_pager&& other) noexcept;
+
+    swap_pager(const swap_pager&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    ~swap_pager();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(swap_pager&& other) noexcept -> swap_pager&;
+
+    auto operator=(const swap_pager&) -> swap_pager& = delete;
+
+    //-------------------------------------------------------------------------
+    // Element Access
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets a pointer to the start of the reserved memory
+    ///
+    /// \return the reserved memory
+    auto data() const noexcept -> std::byte*;
+
+    /// \brief Gets the \p n'th page
+    ///
+    /// \pre \p n must be less than `pages()`
+    /// \param n the page number
+    /// \return the page
+    auto operator[](std::size_t n) const noexcept -> page;
+
+    //-------------------------------------------------------------------------
+    // Capacity
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the size of each page
+    ///
+    /// \return the page size
+    auto page_size() const noexcept -> bytes;
+
+    /// \brief Gets the number of reserved pages
+    ///
+    /// \return the number of pages
+    auto pages() const noexcept -> uquantity<page>;
+
+    //-------------------------------------------------------------------------
+    // Residency
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of bytes that may be resident before pages are
+    ///        swapped out
+    ///
+    /// \return the resident budget
+    auto resident_budget() const noexcept -> bytes;
+
+    /// \brief Sets the number of bytes that may be resident before pages are
+    ///        swapped out, swapping out pages immediately if more are resident
+    ///
+    /// The budget is never less than 4 pages.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \param budget the resident budget
+    auto set_resident_budget(bytes budget) -> void;
+
+    /// \brief Gets the number of committed pages that are resident
+    ///
+    /// \return the number of resident pages
+    auto resident_pages() const noexcept -> uquantity<page>;
+
+    /// \brief Gets the number of committed pages that are swapped out
+    ///
+    /// \return the number of swapped out pages
+    auto swapped_pages() const noexcept -> uquantity<page>;
+
+    /// \brief Queries whether the \p n'th page is committed
+    ///
+    /// \pre \p n must be less than `pages()`
+    /// \param n the page number
+    /// \return `true` if the page is committed
+    auto is_committed(std::size_t n) const noexcept -> bool;
+
+    /// \brief Queries whether the \p n'th page is committed and resident
+    ///
+    /// \pre \p n must be less than `pages()`
+    /// \param n the page number
+    /// \return `true` if the page is resident
+    auto is_resident(std::size_t n) const noexcept -> bool;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Commits \p count pages, starting at the \p first page
+    ///
+    /// Newly committed pages are resident and zeroed, and may swap out other
+    /// pages to stay within the resident budget. Pages that are already
+    /// committed are `touch`ed instead.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page to commit
+    /// \param count the number of pages to commit
+    /// \return the committed block spanning all \p count pages
+    auto commit(std::size_t first, uquantity<page> count) -> memory_block;
+
+    /// \brief Decommits \p count pages, starting at the \p first page,
+    ///        discarding their contents whether resident or swapped out
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page to decommit
+    /// \param count the number of pages to decommit
+    auto decommit(std::size_t first, uquantity<page> count) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Marks \p count committed pages, starting at the \p first page,
+    ///        as the most recently used
+    ///
+    /// Pages that are swapped out are left swapped out.
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page
+    /// \param count the number of pages
+    auto touch(std::size_t first, uquantity<page> count) noexcept -> void;
+
+    /// \brief Marks all committed pages spanned by \p block as the most
+    ///        recently used
+    ///
+    /// \pre \p block must start on a page boundary of this pager, and its size
+    ///      must be a multiple of `page_size()`
+    /// \param block the block of pages
+    auto touch(memory_block block) noexcept -> void;
+
+    /// \brief Swaps in \p count committed pages, starting at the \p first
+    ///        page, ahead of accessing them
+    ///
+    /// The pages become the most recently used. If more pages are fetched
+    /// than the resident budget allows, the earliest of them are swapped out
+    /// again.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page
+    /// \param count the number of pages
+    auto fetch(std::size_t first, uquantity<page> count) -> void;
+
+    /// \brief Swaps in all committed pages spanned by \p block ahead of
+    ///        accessing them
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p block must start on a page boundary of this pager, and its size
+    ///      must be a multiple of `page_size()`
+    /// \param block the block of pages
+    auto fetch(memory_block block) -> void;
+
+    /// \brief Swaps out \p count committed pages, starting at the \p first
+    ///        page, irrespective of the resident budget
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page
+    /// \param count the number of pages
+    auto evict(std::size_t first, uquantity<page> count) -> void;
+
+    /// \brief Swaps out all committed pages spanned by \p block, irrespective
+    ///        of the resident budget
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p block must start on a page boundary of this pager, and its size
+    ///      must be a multiple of `page_size()`
+    /// \param block the block of pages
+    auto evict(memory_block block) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Swaps this pager with \p other
+    ///
+    /// \param other the other pager to swap with
+    auto swap(swap_pager& other) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    // The swap space must be destroyed before the memory it manages
+    virtual_memory m_memory;
+    std::unique_ptr<detail::swap_space> m_swap_space;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Gets the page number of the first page of \p block
+    ///
+    /// \param block the block of pages
+    /// \return the page number
+    auto block_to_index(const memory_block& block) const noexcept -> std::size_t;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Element Access
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::swap_pager::data()
+  const noexcept -> std::byte*
+{
+  return m_memory.data();
+}
+
+inline
+auto msl::swap_pager::operator[](std::size_t n)
+  const noexcept -> page
+{
+  return m_memory[n];
+}
+
+//-----------------------------------------------------------------------------
+// Capacity
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::swap_pager::page_size()
+  const noexcept -> bytes
+{
+  return m_memory.page_size();
+}
+
+inline
+auto msl::swap_pager::pages()
+  const noexcept -> uquantity<page>
+{
+  return m_memory.pages();
+}
+
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::swap_pager::touch(memory_block block)
+  noexcept -> void
+{
+  touch(block_to_index(block), uquantity<page>{block.size() / page_size()});
+}
+
+inline
+auto msl::swap_pager::fetch(memory_block block)
+  -> void
+{
+  fetch(block_to_index(block), uquantity<page>{block.size() / page_size()});
+}
+
+inline
+auto msl::swap_pager::evict(memory_block block)
+  -> void
+{
+  evict(block_to_index(block), uquantity<page>{block.size() / page_size()});
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::swap_pager::block_to_index(const memory_block& block)
+  const noexcept -> std::size_t
+{
+  const auto offset = block.start_address().get() - data();
+
+  MSL_ASSERT((static_cast<std::size_t>(offset) % page_size().count()) == 0u);
+  MSL_ASSERT((block.size() % page_size()) == bytes::zero());
+
+  return static_cast<std::size_t>(offset) / page_size().count();
+}
+
+#endif /* MSL_MEMORY_SWAP_PAGER_HPP */
@@ -28,12 +28,36 @@
 # pragma once
 #endif
 
+#include "msl/config.hpp"
 #include "msl/blocks/memory_block.hpp"
+#include "msl/quantities/alignment.hpp"
 #include "msl/quantities/digital_quantity.hpp"
 #include "msl/quantities/quantity.hpp"
 #include "msl/utilities/intrinsics.hpp"
 
+#include <bit>     // std::countr_zero, std::has_single_bit
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <memory>  // std::unique_ptr
+#include <utility> // std::exchange, std::move
+#include <vector>  // std::vector
+
 namespace msl {
+  namespace detail {
+    class cow_mapping;
+    class dirty_page_tracker;
+
+    /// \brief Moves the \p size bytes of mappings at \p from to \p to, as
+    ///        Linux's `mremap` does with the given \p flags
+    ///
+    /// Relocating a reservation moves each of its mappings through this, so
+    /// that a move can be made to fail partway through. This only exists on
+    /// Linux, and must not be replaced while any reservation may be moving.
+    extern auto (*remap_pages)(void* from, std::size_t size, void* to, int flags)
+      noexcept -> void*;
+  } // namespace detail
+
+  class virtual_memory_hooks;
 
   /////////////////////////////////////////////////////////////////////////////
   /// \brief An RAII wrapper around virtual memory access
@@ -51,21 +75,201 @@ namespace msl {
 
     using page = memory_block;
 
+    /// \brief The kind of pages that back a reservation
+    ///
+    /// Huge pages reduce the number of TLB entries required to address large
+    /// reservations, at the cost of a coarser commit granularity.
+    enum class page_mode {
+      standard,         ///< The default page size of the system
+      transparent_huge, ///< 2 MiB pages, aligned and advised for transparent
+                        ///< huge pages where supported
+      huge_2mib,        ///< Explicitly requested 2 MiB huge pages
+      huge_1gib,        ///< Explicitly requested 1 GiB huge pages
+    };
+
+    /// \brief The policy for how physical memory is provided to committed
+    ///        pages
+    enum class commit_policy {
+      on_demand, ///< Pages are backed lazily by the first access to them
+      prefault,  ///< Pages are backed eagerly while committing
+    };
+
+    /// \brief The policy for how physical memory is returned from decommitted
+    ///        pages
+    enum class decommit_policy {
+      lazy,      ///< The system may reclaim the memory whenever it chooses to,
+                 ///< such as under memory pressure (e.g. MADV_FREE)
+      immediate, ///< The memory is reclaimed immediately (e.g. MADV_DONTNEED)
+    };
+
+    /// \brief A hint for how soon committed pages will next be accessed
+    ///
+    /// Cooler pages are reclaimed before others under memory pressure. Their
+    /// contents are always preserved; a reclaimed page is swapped out, and is
+    /// brought back by the next access to it.
+    enum class page_temperature {
+      warm,      ///< The pages will be accessed soon, and are brought back into
+                 ///< physical memory ahead of time (e.g. MADV_POPULATE_READ)
+      cold,      ///< The pages are unlikely to be accessed soon, and are
+                 ///< reclaimed first under memory pressure (e.g. MADV_COLD)
+      paged_out, ///< The pages will not be accessed for a while, and are
+                 ///< reclaimed immediately (e.g. MADV_PAGEOUT)
+    };
+
+    /// \brief The access permitted to committed pages
+    enum class page_access {
+      none,       ///< The pages may not be accessed at all
+      read,       ///< The pages may only be read
+      read_write, ///< The pages may be both read and written
+    };
+
+    /// \brief The policy for how a reservation is inherited by child
+    ///        processes created with `fork`
+    enum class fork_policy {
+      inherit, ///< The child shares the pages copy-on-write
+      exclude, ///< The reservation does not exist in the child
+               ///< (e.g. MADV_DONTFORK)
+      wipe,    ///< The child sees the reservation, but every page reads as
+               ///< zero (e.g. MADV_WIPEONFORK)
+    };
+
+    /// \brief The policy for how a reservation may be grown
+    enum class growth_policy {
+      in_place, ///< The reservation may only be extended at its current address
+      may_move, ///< The reservation may be relocated to a new address if it
+                ///< cannot be extended in place
+    };
+
+    /// \brief The mechanism used to track which pages have been written
+    enum class dirty_tracking {
+      soft_dirty,    ///< The system records writes in the page tables
+                     ///< (e.g. the soft-dirty bits of /proc/self/pagemap)
+      write_protect, ///< Pages are write-protected, and the first write to
+                     ///< each is recorded by handling the resulting fault
+    };
+
+    /// \brief A report of the huge pages that back a reservation
+    struct huge_page_report
+    {
+      bytes resident;         ///< The bytes of the reservation that are resident
+      bytes transparent_huge; ///< The resident bytes that are backed by
+                              ///< transparent huge pages
+      bytes explicit_huge;    ///< The bytes that are backed by explicitly
+                              ///< requested huge pages
+      bool transparent_huge_eligible; ///< Whether the system may back any of
+                                      ///< the reservation with transparent
+                                      ///< huge pages
+    };
+
+    //-------------------------------------------------------------------------
+    // Public Constants
+    //-------------------------------------------------------------------------
+  public:
+
+    static_assert(
+      MSL_PAGE_SIZE == 0 || std::has_single_bit(std::size_t{MSL_PAGE_SIZE}),
+      "MSL_PAGE_SIZE must be a power-of-two."
+    );
+
+    /// \brief Whether the standard page size is fixed at compile time with
+    ///        `MSL_PAGE_SIZE`
+    ///
+    /// When the page size is fixed, it is verified against the system on
+    /// startup.
+    static constexpr bool is_page_size_fixed = (MSL_PAGE_SIZE != 0);
+
+    /// \brief The base-2 logarithm of the standard page size, if the page
+    ///        size is fixed at compile time with `MSL_PAGE_SIZE`; otherwise 0
+    ///
+    /// \warning A shift of 0 does not describe a page size of 1 byte; check
+    ///          `is_page_size_fixed` before shifting by this.
+    static constexpr std::size_t page_shift = (MSL_PAGE_SIZE == 0)
+      ? 0u
+      : static_cast<std::size_t>(std::countr_zero(std::size_t{MSL_PAGE_SIZE}));
+
     //-------------------------------------------------------------------------
     // Static Functions
     //-------------------------------------------------------------------------
   public:
 
-    /// \brief Gets the size of a page in bytes
+    /// \brief Gets the size of a page in bytes for the specified \p mode
     ///
+    /// \param mode the page mode to query
     /// \return the size of a page in bytes
-    static auto page_size() noexcept -> bytes;
+    static auto page_size(page_mode mode) noexcept -> bytes;
 
     /// \brief A factory function for producing virtual memory
     ///
+    /// Each page is `page_size(mode)` bytes large. Explicit huge pages must be
+    /// made available by the system ahead of time; if they are not, this
+    /// function throws.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages to request
+    /// \param mode the kind of pages backing the reservation
+    /// \return the virtual memory, on success
+    static auto reserve(uquantity<page> pages,
+                        page_mode mode = page_mode::standard) -> virtual_memory;
+
+    /// \brief A factory function for producing virtual memory whose base
+    ///        address is aligned to the \p align boundary
+    ///
+    /// Since the base address is aligned, any address inside of the returned
+    /// virtual memory can be mapped back to `data()` by masking off the low
+    /// bits of the address (see `pointer_utilities::align_low`). This allows
+    /// owning chunk headers to be found from interior pointers in O(1).
+    ///
+    /// If \p align is smaller than `page_size(mode)`, this behaves as if by
+    /// calling `reserve(pages, mode)`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
     /// \param pages the number of pages to request
+    /// \param align the boundary to align the base address to
+    /// \param mode the kind of pages backing the reservation
     /// \return the virtual memory, on success
-    static auto reserve(uquantity<page> pages) -> virtual_memory;
+    static auto reserve(uquantity<page> pages,
+                        alignment align,
+                        page_mode mode = page_mode::standard) -> virtual_memory;
+
+    /// \brief A factory function for producing virtual memory that is backed
+    ///        by \p hooks, rather than directly by the system
+    ///
+    /// Reserving, committing, decommitting and releasing the memory are all
+    /// requested from \p hooks (see `virtual_memory_hooks`).
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p hooks must outlive the returned virtual memory
+    /// \param pages the number of pages to request
+    /// \param hooks the hooks that back the reservation
+    /// \param mode the kind of pages backing the reservation
+    /// \return the virtual memory, on success
+    static auto reserve(uquantity<page> pages,
+                        virtual_memory_hooks& hooks,
+                        page_mode mode = page_mode::standard) -> virtual_memory;
+
+    /// \brief A factory function for producing virtual memory that is backed
+    ///        by \p hooks, and whose base address is aligned to the \p align
+    ///        boundary
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p hooks must outlive the returned virtual memory
+    /// \param pages the number of pages to request
+    /// \param align the boundary to align the base address to
+    /// \param hooks the hooks that back the reservation
+    /// \param mode the kind of pages backing the reservation
+    /// \return the virtual memory, on success
+    static auto reserve(uquantity<page> pages,
+                        alignment align,
+                        virtual_memory_hooks& hooks,
+                        page_mode mode = page_mode::standard) -> virtual_memory;
 
     //-------------------------------------------------------------------------
     // Constructors / Destructor / Assignment
@@ -118,6 +322,24 @@ namespace msl {
     //-------------------------------------------------------------------------
   public:
 
+    /// \brief Gets the size of a page of this virtual memory, in bytes
+    ///
+    /// This is the effective commit granularity of this reservation, which
+    /// depends on the `page_mode` that it was reserved with.
+    ///
+    /// \return the size of a page in bytes
+    auto page_size() const noexcept -> bytes;
+
+    /// \brief Gets the kind of pages that back this virtual memory
+    ///
+    /// \return the page mode
+    auto mode() const noexcept -> page_mode;
+
+    /// \brief Gets the hooks that back this virtual memory
+    ///
+    /// \return the hooks
+    auto hooks() const noexcept -> virtual_memory_hooks&;
+
     /// \brief Requests the size of this virtual memory in bytes
     ///
     /// \return the size of this in bytes
@@ -134,6 +356,54 @@ namespace msl {
     /// \return `true` does not contain storage for any pages
     auto empty() const noexcept -> bool;
 
+    //-------------------------------------------------------------------------
+    // Commit State
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of pages of this virtual memory that are
+    ///        committed
+    ///
+    /// \return the number of committed pages
+    auto committed_pages() const noexcept -> uquantity<page>;
+
+    /// \brief Queries whether the \p n'th page is committed
+    ///
+    /// \pre n must be less than `pages()`
+    /// \param n the page number
+    /// \return `true` if the page is committed
+    auto is_committed(std::size_t n) const noexcept -> bool;
+
+    /// \brief Gets the number of pages of this virtual memory that are
+    ///        resident in physical memory
+    ///
+    /// Committed pages are backed lazily, and decommitted pages may remain
+    /// resident until the system reclaims them -- so this may differ from
+    /// `committed_pages()` in either direction. A page counts as resident
+    /// if any part of it is resident.
+    ///
+    /// \note The result is a snapshot; it may be stale as soon as it returns.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \return the number of resident pages
+    auto resident_pages() const -> uquantity<page>;
+
+    /// \brief Reports how much of this virtual memory is backed by huge
+    ///        pages
+    ///
+    /// This is primarily useful for confirming that transparent huge pages
+    /// are in effect, since requesting them is only ever a hint.
+    ///
+    /// \note The result is a snapshot; it may be stale as soon as it returns.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \return the report
+    auto huge_pages() const -> huge_page_report;
+
     //-------------------------------------------------------------------------
     // Modifiers
     //-------------------------------------------------------------------------
@@ -145,17 +415,59 @@ namespace msl {
     /// \throw std::runtime_error if not implementable on the target system
     ///
     /// \param n the page number to commit
+    /// \param policy the policy for backing the committed page
     /// \return the committed page
-    auto commit(std::size_t n) -> page;
+    auto commit(std::size_t n,
+                commit_policy policy = commit_policy::on_demand) -> page;
+
+    /// \brief Commits \p count pages, starting at the \p first page
+    ///
+    /// The entire range is committed at once, rather than one page at a time,
+    /// so that committing large ranges costs a single system call.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page to commit
+    /// \param count the number of pages to commit
+    /// \param policy the policy for backing the committed pages
+    /// \return the committed block spanning all \p count pages
+    auto commit(std::size_t first,
+                uquantity<page> count,
+                commit_policy policy = commit_policy::on_demand) -> memory_block;
 
-    /// \brief Commits the specified page \p p
+    /// \brief Commits all pages spanned by the specified \p block
     ///
     /// \throw std::system_error containing the error code on failure
     /// \throw std::runtime_error if not implementable on the target system
     ///
-    /// \param p the page to commit
-    /// \return \p p
-    auto commit(page p) -> page;
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \param block the block of pages to commit
+    /// \param policy the policy for backing the committed pages
+    /// \return \p block
+    auto commit(memory_block block,
+                commit_policy policy = commit_policy::on_demand) -> memory_block;
+
+    /// \brief Eagerly backs all committed pages spanned by \p block with
+    ///        physical memory
+    ///
+    /// This removes the cost of first-touch page faults from later accesses.
+    /// Where the system can populate pages directly, this is done with a
+    /// single system call; otherwise each page is touched without modifying
+    /// its contents.
+    ///
+    /// Large ranges may be split across \p concurrency threads, each of which
+    /// prefaults a contiguous run of pages.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p block must be committed, start on a page boundary of this
+    ///      virtual memory, and have a size that is a multiple of `page_size()`
+    /// \param block the block of pages to prefault
+    /// \param concurrency the maximum number of threads to prefault with
+    auto prefault(memory_block block, std::size_t concurrency = 1u) -> void;
 
     //-------------------------------------------------------------------------
 
@@ -165,15 +477,236 @@ namespace msl {
     /// \throw std::runtime_error if not implementable on the target system
     ///
     /// \param n the page number to decommit
-    auto decommit(std::size_t n) -> void;
+    /// \param policy the policy for returning the physical memory
+    auto decommit(std::size_t n,
+                  decommit_policy policy = decommit_policy::lazy) -> void;
+
+    /// \brief Decommits \p count pages, starting at the \p first page
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first page to decommit
+    /// \param count the number of pages to decommit
+    /// \param policy the policy for returning the physical memory
+    auto decommit(std::size_t first,
+                  uquantity<page> count,
+                  decommit_policy policy = decommit_policy::lazy) -> void;
+
+    /// \brief Decommits all pages spanned by the specified \p block
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \param block the block of pages to decommit
+    /// \param policy the policy for returning the physical memory
+    auto decommit(memory_block block,
+                  decommit_policy policy = decommit_policy::lazy) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Changes the access permitted to \p count pages, starting at the
+    ///        \p first page
+    ///
+    /// This allows data to be frozen once it has been built, such that any
+    /// later attempt to modify it faults. Pages remain committed irrespective
+    /// of their access, and committing pages again restores `read_write`
+    /// access to them.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \pre the pages must be committed
+    /// \param first the page number of the first page to protect
+    /// \param count the number of pages to protect
+    /// \param access the access to permit
+    auto protect(std::size_t first,
+                 uquantity<page> count,
+                 page_access access) -> void;
+
+    /// \brief Changes the access permitted to all pages spanned by \p block
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \pre the pages must be committed
+    /// \param block the block of pages to protect
+    /// \param access the access to permit
+    auto protect(memory_block block, page_access access) -> void;
 
-    /// \brief Decommits the specified page \p p
+    /// \brief Turns \p count pages, starting at the \p first page, into
+    ///        guard pages
+    ///
+    /// Guard pages are decommitted and inaccessible, so any access to them
+    /// faults immediately. Placing them between regions of memory detects
+    /// overruns in hardware, at no cost to accesses that stay in bounds.
+    ///
+    /// \note Committing a guard page turns it back into a normal page
     ///
     /// \throw std::system_error containing the error code on failure
     /// \throw std::runtime_error if not implementable on the target system
     ///
-    /// \param p the page to decommit
-    auto decommit(page p) -> void;
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \param first the page number of the first guard page
+    /// \param count the number of guard pages
+    auto guard(std::size_t first,
+               uquantity<page> count = uquantity<page>{1u}) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Locks \p count committed pages, starting at the \p first page,
+    ///        into physical memory
+    ///
+    /// Locked pages are backed immediately, and are never paged out until
+    /// they are unlocked. Pages should be unlocked before being decommitted.
+    ///
+    /// \note The number of pages that may be locked is typically limited by
+    ///       the system (e.g. RLIMIT_MEMLOCK)
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \pre the pages must be committed
+    /// \param first the page number of the first page to lock
+    /// \param count the number of pages to lock
+    auto lock(std::size_t first, uquantity<page> count) -> void;
+
+    /// \brief Locks all committed pages spanned by \p block into physical
+    ///        memory
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \pre the pages must be committed
+    /// \param block the block of pages to lock
+    auto lock(memory_block block) -> void;
+
+    /// \brief Unlocks \p count pages, starting at the \p first page, allowing
+    ///        them to be paged out again
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \pre the pages must be locked
+    /// \param first the page number of the first page to unlock
+    /// \param count the number of pages to unlock
+    auto unlock(std::size_t first, uquantity<page> count) -> void;
+
+    /// \brief Unlocks all pages spanned by \p block, allowing them to be
+    ///        paged out again
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \pre the pages must be locked
+    /// \param block the block of pages to unlock
+    auto unlock(memory_block block) -> void;
+
+    /// \brief Unlocks every page of this virtual memory, whether or not it is
+    ///        locked
+    ///
+    /// Unlike `unlock`, this has no precondition on the pages, and so may be
+    /// used to restore a reservation whose locked pages are not known.
+    /// Failing to unlock pages that were never locked is ignored.
+    auto unlock_all() noexcept -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Hints how soon \p count committed pages, starting at the
+    ///        \p first page, will next be accessed
+    ///
+    /// Marking rarely accessed data `cold` lets it leave physical memory
+    /// before hotter data does, without discarding it. Marking it `warm`
+    /// again brings back any pages that were reclaimed, so that the next
+    /// access to them does not have to wait for the pages to be read back.
+    ///
+    /// \note This is only a hint; the system is free to ignore it
+    ///
+    /// \pre `first + count` must be less than or equal to `pages()`
+    /// \pre the pages must be committed
+    /// \param first the page number of the first page
+    /// \param count the number of pages
+    /// \param temperature how soon the pages will be accessed
+    /// \return `true` if the system accepted the hint
+    auto set_temperature(std::size_t first,
+                         uquantity<page> count,
+                         page_temperature temperature) noexcept -> bool;
+
+    /// \brief Hints how soon all committed pages spanned by \p block will
+    ///        next be accessed
+    ///
+    /// \note This is only a hint; the system is free to ignore it
+    ///
+    /// \pre \p block must start on a page boundary of this virtual memory,
+    ///      and its size must be a multiple of `page_size()`
+    /// \pre the pages must be committed
+    /// \param block the block of pages
+    /// \param temperature how soon the pages will be accessed
+    /// \return `true` if the system accepted the hint
+    auto set_temperature(memory_block block,
+                         page_temperature temperature) noexcept -> bool;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Gets the policy for how this reservation is inherited by child
+    ///        processes
+    ///
+    /// \return the fork policy
+    auto get_fork_policy() const noexcept -> fork_policy;
+
+    /// \brief Sets the policy for how this reservation is inherited by child
+    ///        processes
+    ///
+    /// Excluding large reservations from children avoids both the cost of
+    /// copying their page tables during `fork`, and copy-on-write faults in
+    /// the parent afterwards. The policy also applies to pages added by
+    /// `grow`.
+    ///
+    /// \note On systems without `fork`, this only records the policy
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \param policy the fork policy
+    auto set_fork_policy(fork_policy policy) -> void;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Grows this reservation by an additional \p pages pages
+    ///
+    /// The new pages are reserved, but not committed. This first attempts to
+    /// extend the reservation in place. If that is not possible and \p policy
+    /// is `growth_policy::may_move`, the reservation is relocated by moving
+    /// its page tables to a new address -- which preserves the contents of
+    /// committed pages without copying them.
+    ///
+    /// \note Reservations backed by hooks other than the system hooks cannot
+    ///       be grown, since the hooks did not reserve the new pages
+    ///
+    /// \note If this reservation is relocated, all pointers and blocks
+    ///       referring into it are invalidated, and the new alignment of
+    ///       `data()` is only guaranteed to be `page_size()`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages to grow by
+    /// \param policy whether the reservation may be relocated
+    /// \return `true` if the reservation was grown, `false` if it could not be
+    ///         grown under the requested \p policy
+    auto grow(uquantity<page> pages,
+              growth_policy policy = growth_policy::in_place) -> bool;
 
     //-------------------------------------------------------------------------
 
@@ -189,6 +722,121 @@ namespace msl {
     /// \param other the other memory object to swap with
     auto swap(virtual_memory& other) noexcept -> void;
 
+    //-------------------------------------------------------------------------
+    // Dirty Tracking
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Begins tracking which committed pages are written, using the
+    ///        best mechanism available
+    ///
+    /// This establishes the first checkpoint. Incremental snapshots may then
+    /// copy only the pages reported by `checkpoint`, rather than every
+    /// committed page.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \return the mechanism that is used
+    auto track_dirty_pages() -> dirty_tracking;
+
+    /// \brief Begins tracking which committed pages are written, using the
+    ///        specified \p mechanism
+    ///
+    /// Soft-dirty bits are cheaper, since writes never fault into user space,
+    /// but are not available on every system. Resetting them also resets them
+    /// for the whole process, which other reservations account for, but
+    /// other users of `/proc/self/clear_refs` do not.
+    ///
+    /// \throw std::system_error containing the error code on failure, or if
+    ///        \p mechanism is not supported
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param mechanism the mechanism to use
+    auto track_dirty_pages(dirty_tracking mechanism) -> void;
+
+    /// \brief Stops tracking which pages are written
+    ///
+    /// Any pages that were write-protected for tracking are made writable
+    /// again.
+    auto stop_tracking_dirty_pages() noexcept -> void;
+
+    /// \brief Queries whether written pages are being tracked
+    ///
+    /// \return `true` if written pages are being tracked
+    auto is_tracking_dirty_pages() const noexcept -> bool;
+
+    /// \brief Gets the committed pages that have been written since the last
+    ///        checkpoint, without establishing a new checkpoint
+    ///
+    /// Adjacent pages are coalesced into a single block. Pages that are
+    /// committed, decommitted or reprotected since the last checkpoint are
+    /// conservatively reported as written while they remain committed.
+    ///
+    /// \pre written pages must be tracked
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \return the blocks of written pages, in address order
+    auto dirty_pages() const -> std::vector<memory_block>;
+
+    /// \brief Gets the committed pages that have been written since the last
+    ///        checkpoint, and establishes a new checkpoint
+    ///
+    /// \note Writes that race with this call may be attributed to either
+    ///       checkpoint, or lost; writers should be paused while a snapshot
+    ///       is taken.
+    ///
+    /// \pre written pages must be tracked
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \return the blocks of written pages, in address order
+    auto checkpoint() -> std::vector<memory_block>;
+
+    //-------------------------------------------------------------------------
+    // Cloning
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Creates a private, copy-on-write clone of this reservation
+    ///
+    /// The clone initially has the same contents and committed pages as this
+    /// reservation, but shares its physical pages rather than copying them.
+    /// Afterwards, writes to either are not visible in the other; a page is
+    /// only duplicated once either side writes to it. This allows a
+    /// consistent snapshot of a large reservation to be taken in constant
+    /// time, while writers keep modifying it.
+    ///
+    /// The first clone moves the committed pages of this reservation into a
+    /// shared memory object (e.g. a memfd), copying them once. Every page of
+    /// this reservation is write-protected whenever a clone is made, and the
+    /// first write to each page faults so that the clones are given their
+    /// own copy of it first.
+    ///
+    /// \note Moving the pages into the shared memory object makes every
+    ///       committed page readable and writable, and unlocks it. Committed
+    ///       pages of the clone are readable and writable.
+    ///
+    /// \note This may not race with writes to this reservation, and cannot
+    ///       be combined with `dirty_tracking::write_protect`.
+    ///
+    /// \note At most 64 clones of a reservation may exist at once.
+    ///
+    /// \throw std::system_error containing the error code on failure, if
+    ///        this reservation uses explicit huge pages or is backed by hooks
+    ///        other than the system hooks, or with
+    ///        `std::errc::resource_unavailable_try_again` if it already has
+    ///        64 clones
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \return the clone
+    auto clone_cow() -> virtual_memory;
+
+    /// \brief Queries whether this reservation takes part in copy-on-write
+    ///        cloning, either as the source of clones or as a clone
+    ///
+    /// \return `true` if this reservation is a source or a clone
+    auto is_copy_on_write() const noexcept -> bool;
+
     //-------------------------------------------------------------------------
     // Private Members
     //-------------------------------------------------------------------------
@@ -196,13 +844,57 @@ namespace msl {
 
     std::byte* m_data;
     uquantity<page> m_pages;
+    std::size_t m_page_shift;
+    page_mode m_mode;
+    fork_policy m_fork_policy;
+    virtual_memory_hooks* m_hooks;
+
+    // A bitmap of the committed pages, with one bit per page
+    std::vector<std::uint64_t> m_committed;
+
+    // The tracker of written pages, while tracking is enabled
+    std::unique_ptr<detail::dirty_page_tracker> m_dirty_tracker;
+
+    // The copy-on-write state, if this is the source or a clone of another
+    // reservation
+    std::unique_ptr<detail::cow_mapping> m_cow_mapping;
 
     /// \brief Constructs the virtual memory from a data pointer and the number
     ///        of pages
     ///
     /// \param data the reserved pointer
     /// \param pages the number of pages
-    virtual_memory(std::byte* data, uquantity<page> pages) noexcept;
+    /// \param mode the kind of pages backing \p data
+    /// \param committed the (empty) commit bitmap for \p pages pages
+    /// \param hooks the hooks that reserved \p data
+    virtual_memory(std::byte* data,
+                   uquantity<page> pages,
+                   page_mode mode,
+                   std::vector<std::uint64_t> committed,
+                   virtual_memory_hooks& hooks) noexcept;
+
+    /// \brief Converts a number of pages into a number of bytes
+    ///
+    /// \param n the number of pages
+    /// \return the number of bytes spanned by \p n pages
+    auto pages_to_bytes(std::size_t n) const noexcept -> bytes;
+
+    /// \brief Computes the number of words required for the commit bitmap of
+    ///        \p pages pages
+    ///
+    /// \param pages the number of pages
+    /// \return the number of words
+    static auto bitmap_words(uquantity<page> pages) noexcept -> std::size_t;
+
+    /// \brief Marks \p count pages, starting at the \p first page, as being
+    ///        either committed or decommitted
+    ///
+    /// \param first the first page
+    /// \param count the number of pages
+    /// \param committed whether the pages are committed
+    auto mark_committed(std::size_t first,
+                        std::size_t count,
+                        bool committed) noexcept -> void;
 
     /// \brief Helper to convert pages to indexes
     ///
@@ -210,6 +902,20 @@ namespace msl {
     /// \param p the page
     /// \return the index
     auto page_to_index(const page& p) noexcept -> std::size_t;
+
+    /// \brief Helper to convert a block of pages into a page count
+    ///
+    /// \pre the size of \p b must be a multiple of `page_size()`
+    /// \param b the block of pages
+    /// \return the number of pages spanned by \p b
+    auto block_to_pages(const memory_block& b) noexcept -> uquantity<page>;
+
+    /// \brief Converts a bitmap of pages into blocks of adjacent pages
+    ///
+    /// \param bitmap the bitmap, with one bit per page
+    /// \return the blocks of pages, in address order
+    auto bitmap_to_blocks(const std::vector<std::uint64_t>& bitmap)
+      const -> std::vector<memory_block>;
   };
 
 } // namespace msl
@@ -229,11 +935,32 @@ auto msl::virtual_memory::data()
 // Capacity
 //-----------------------------------------------------------------------------
 
+MSL_FORCE_INLINE
+auto msl::virtual_memory::page_size()
+  const noexcept -> bytes
+{
+  return bytes{std::size_t{1u} << m_page_shift};
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::mode()
+  const noexcept -> page_mode
+{
+  return m_mode;
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::hooks()
+  const noexcept -> virtual_memory_hooks&
+{
+  return *m_hooks;
+}
+
 inline
 auto msl::virtual_memory::size_in_bytes()
   const noexcept -> bytes
 {
-  return page_size() * pages().count();
+  return pages_to_bytes(pages().count());
 }
 
 inline
@@ -250,27 +977,90 @@ auto msl::virtual_memory::empty()
   return pages() == 0u;
 }
 
+//-----------------------------------------------------------------------------
+// Commit State
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::virtual_memory::is_committed(std::size_t n)
+  const noexcept -> bool
+{
+  MSL_ASSERT(n < m_pages.count(), "Querying a page out of range");
+
+  return ((m_committed[n / 64u] >> (n % 64u)) & 1u) != 0u;
+}
+
 //-----------------------------------------------------------------------------
 // Modifiers
 //-----------------------------------------------------------------------------
 
 MSL_FORCE_INLINE
-auto msl::virtual_memory::commit(page p) -> page
+auto msl::virtual_memory::commit(std::size_t n, commit_policy policy) -> page
+{
+  return commit(n, uquantity<page>{1u}, policy);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::commit(memory_block block, commit_policy policy)
+  -> memory_block
+{
+  return commit(page_to_index(block), block_to_pages(block), policy);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::decommit(std::size_t n, decommit_policy policy) -> void
+{
+  decommit(n, uquantity<page>{1u}, policy);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::decommit(memory_block block, decommit_policy policy)
+  -> void
+{
+  decommit(page_to_index(block), block_to_pages(block), policy);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::protect(memory_block block, page_access access)
+  -> void
+{
+  protect(page_to_index(block), block_to_pages(block), access);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::guard(std::size_t first, uquantity<page> count)
+  -> void
+{
+  decommit(first, count, decommit_policy::immediate);
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::lock(memory_block block)
+  -> void
+{
+  lock(page_to_index(block), block_to_pages(block));
+}
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::unlock(memory_block block)
+  -> void
 {
-  return commit(page_to_index(p));
+  unlock(page_to_index(block), block_to_pages(block));
 }
 
 MSL_FORCE_INLINE
-auto msl::virtual_memory::decommit(page p) -> void
+auto msl::virtual_memory::set_temperature(memory_block block,
+                                          page_temperature temperature)
+  noexcept -> bool
 {
-  decommit(page_to_index(p));
+  return set_temperature(page_to_index(block), block_to_pages(block), temperature);
 }
 
 MSL_FORCE_INLINE
-auto msl::virtual_memory::release()
-  noexcept -> std::byte*
+auto msl::virtual_memory::get_fork_policy()
+  const noexcept -> fork_policy
 {
-  return std::exchange(m_data, nullptr);
+  return m_fork_policy;
 }
 
 inline
@@ -281,6 +1071,35 @@ auto msl::virtual_memory::swap(virtual_memory& other)
 
   swap(m_data, other.m_data);
   swap(m_pages, other.m_pages);
+  swap(m_page_shift, other.m_page_shift);
+  swap(m_mode, other.m_mode);
+  swap(m_fork_policy, other.m_fork_policy);
+  swap(m_hooks, other.m_hooks);
+  swap(m_committed, other.m_committed);
+  swap(m_dirty_tracker, other.m_dirty_tracker);
+  swap(m_cow_mapping, other.m_cow_mapping);
+}
+
+//-----------------------------------------------------------------------------
+// Dirty Tracking
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::is_tracking_dirty_pages()
+  const noexcept -> bool
+{
+  return m_dirty_tracker != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Cloning
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::virtual_memory::is_copy_on_write()
+  const noexcept -> bool
+{
+  return m_cow_mapping != nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -293,22 +1112,36 @@ auto msl::virtual_memory::page_to_index(const page& p)
 {
   const auto distance_in_bytes = p.start_address().get() - m_data;
 
-  MSL_ASSERT((distance_in_bytes % page_size().count()) == 0);
+  const auto distance = static_cast<std::size_t>(distance_in_bytes);
+
+  MSL_ASSERT((distance & (page_size().count() - 1u)) == 0u);
 
-  return static_cast<std::size_t>(distance_in_bytes / page_size().count());
+  return distance >> m_page_shift;
 }
 
-//-----------------------------------------------------------------------------
-// Private Constructors
-//-----------------------------------------------------------------------------
+inline
+auto msl::virtual_memory::block_to_pages(const memory_block& b)
+  noexcept -> uquantity<page>
+{
+  const auto size = b.size();
+
+  MSL_ASSERT((size.count() & (page_size().count() - 1u)) == 0u);
+
+  return uquantity<page>{size.count() >> m_page_shift};
+}
 
 MSL_FORCE_INLINE
-msl::virtual_memory::virtual_memory(std::byte* data, uquantity<page> pages)
-  noexcept
-  : m_data{data},
-    m_pages{pages}
+auto msl::virtual_memory::pages_to_bytes(std::size_t n)
+  const noexcept -> bytes
 {
+  return bytes{n << m_page_shift};
+}
 
+MSL_FORCE_INLINE
+auto msl::virtual_memory::bitmap_words(uquantity<page> pages)
+  noexcept -> std::size_t
+{
+  return (pages.count() + 63u) / 64u;
 }
 
 #endif /* MSL_MEMORY_VIRTUAL_MEMORY_HPP */
\ No newline at end of file
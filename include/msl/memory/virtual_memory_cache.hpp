@@ -0,0 +1,213 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_VIRTUAL_MEMORY_CACHE_HPP
+#define MSL_MEMORY_VIRTUAL_MEMORY_CACHE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <cstddef> // std::size_t
+#include <map>     // std::map
+#include <mutex>   // std::mutex
+#include <utility> // std::pair
+#include <vector>  // std::vector
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A cache of released reservations, to avoid the cost of reserving
+  ///        and releasing address space repeatedly
+  ///
+  /// Reserving and releasing address space both require the process-wide
+  /// mapping lock, and releasing may additionally require TLB shootdowns on
+  /// every core that the process runs on. Workloads that repeatedly create and
+  /// destroy short-lived reservations of the same size can instead `recycle`
+  /// them into this cache, and later `acquire` them again.
+  ///
+  /// Recycled reservations are fully decommitted, and their pages reclaimed
+  /// immediately, before they are cached -- so cached reservations do not
+  /// contribute to the resident memory of the process. Reservations are
+  /// keyed by both their page count and page mode.
+  ///
+  /// The cache is bounded by `limits`, past which recycled reservations are
+  /// released immediately instead of being cached.
+  ///
+  /// \note This type is thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class virtual_memory_cache
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+    using page_mode = virtual_memory::page_mode;
+
+    /// \brief The high-water marks of the cache
+    struct limits
+    {
+      /// The maximum number of cached reservations of any single size
+      uquantity<virtual_memory> reservations_per_size = uquantity<virtual_memory>{16u};
+
+      /// The maximum number of bytes of address space to keep cached
+      bytes total_size = gibibytes{1u};
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a cache with the default limits
+    virtual_memory_cache();
+
+    /// \brief Constructs a cache with the specified \p cache_limits
+    ///
+    /// \param cache_limits the high-water marks of the cache
+    explicit virtual_memory_cache(limits cache_limits);
+
+    virtual_memory_cache(const virtual_memory_cache&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const virtual_memory_cache&) -> virtual_memory_cache& = delete;
+
+    //-------------------------------------------------------------------------
+    // Cache
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Acquires a reservation of \p pages pages of \p mode
+    ///
+    /// If a matching reservation is cached, it is reused; otherwise a new
+    /// reservation is made.
+    ///
+    /// \note The pages of the returned reservation are always decommitted
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param pages the number of pages to acquire
+    /// \param mode the kind of pages backing the reservation
+    /// \return the reservation
+    auto acquire(uquantity<page> pages,
+                 page_mode mode = page_mode::standard) -> virtual_memory;
+
+    /// \brief Recycles the reservation \p memory into this cache
+    ///
+    /// The reservation is decommitted and cached, unless caching it would
+    /// exceed the limits of this cache -- in which case it is released.
+    ///
+    /// Cached reservations are restored to the state of a new reservation:
+    /// dirty pages stop being tracked, and the fork policy is reset to
+    /// `fork_policy::inherit`. Reservations that cannot be restored -- those
+    /// backed by hooks other than the system hooks, and those that take part
+    /// in copy-on-write cloning -- are always released.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \param memory the reservation to recycle
+    auto recycle(virtual_memory memory) -> void;
+
+    /// \brief Releases all cached reservations
+    auto trim() -> void;
+
+    /// \brief Releases cached reservations until at most \p size bytes of
+    ///        address space remain cached
+    ///
+    /// \param size the number of bytes to trim down to
+    auto trim(bytes size) -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the limits of this cache
+    ///
+    /// \return the limits
+    auto get_limits() const -> limits;
+
+    /// \brief Sets new limits for this cache
+    ///
+    /// Cached reservations that exceed the new limits are released.
+    ///
+    /// \param cache_limits the new limits
+    auto set_limits(limits cache_limits) -> void;
+
+    /// \brief Gets the number of bytes of address space cached
+    ///
+    /// \return the number of bytes
+    auto cached_size() const -> bytes;
+
+    /// \brief Gets the number of cached reservations
+    ///
+    /// \return the number of reservations
+    auto cached_reservations() const -> uquantity<virtual_memory>;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    using key_type = std::pair<std::size_t, page_mode>;
+    using bucket_type = std::vector<virtual_memory>;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    mutable std::mutex m_mutex;
+    std::map<key_type, bucket_type> m_buckets;
+    limits m_limits;
+    bytes m_cached_size;
+    uquantity<virtual_memory> m_cached_reservations;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Removes cached reservations until no more than \p size bytes
+    ///        and \p reservations_per_size reservations of each size remain
+    ///
+    /// \pre m_mutex must be held
+    /// \param size the number of bytes to trim down to
+    /// \param reservations_per_size the number of reservations per size
+    /// \return the removed reservations, to be released outside the lock
+    auto trim_locked(bytes size, uquantity<virtual_memory> reservations_per_size)
+      -> std::vector<virtual_memory>;
+  };
+
+} // namespace msl
+
+#endif /* MSL_MEMORY_VIRTUAL_MEMORY_CACHE_HPP */
@@ -0,0 +1,142 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_MEMORY_VIRTUAL_MEMORY_HOOKS_HPP
+#define MSL_MEMORY_VIRTUAL_MEMORY_HOOKS_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/pointers/not_null.hpp"
+
+#include <cstddef> // std::byte
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The hooks that provide, and take back, the memory of a
+  ///        `virtual_memory` reservation
+  ///
+  /// By default, reservations are backed directly by the system. Passing
+  /// different hooks to `virtual_memory::reserve` backs that reservation
+  /// instead by whatever the hooks provide -- such as pre-mapped shared
+  /// memory, a pool of huge pages, or a NUMA-aware provider -- or allows the
+  /// requests to be observed, such as by a test double.
+  ///
+  /// Every function defaults to the behavior of the system, so derived hooks
+  /// only need to override what they change, and may call the base function
+  /// to forward a request on.
+  ///
+  /// \note Operations other than these -- such as protecting, locking, or
+  ///       advising pages -- are applied to the memory directly, so the
+  ///       memory must be mapped into the process with page granularity.
+  ///       Reservations with custom hooks cannot be grown or cloned.
+  /////////////////////////////////////////////////////////////////////////////
+  class virtual_memory_hooks
+  {
+    //-------------------------------------------------------------------------
+    // Static Functions
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the hooks that are backed directly by the system
+    ///
+    /// These are the hooks used by reservations that are not given any.
+    ///
+    /// \return the system hooks
+    static auto system() noexcept -> virtual_memory_hooks&;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    virtual_memory_hooks() noexcept = default;
+
+    virtual_memory_hooks(const virtual_memory_hooks&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    virtual ~virtual_memory_hooks() = default;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const virtual_memory_hooks&) -> virtual_memory_hooks& = delete;
+
+    //-------------------------------------------------------------------------
+    // Hooks
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Reserves \p size bytes of inaccessible memory
+    ///
+    /// \throw std::system_error with the error code on failure
+    /// \throw std::runtime_error if not available for target system
+    ///
+    /// \param size the number of bytes to reserve; a multiple of the page size
+    ///        of \p mode
+    /// \param align the boundary to align the memory to; a power-of-two
+    ///        multiple of the page size of \p mode
+    /// \param mode the kind of pages that back the reservation
+    /// \return the reserved memory
+    virtual auto reserve(bytes size,
+                         bytes align,
+                         virtual_memory::page_mode mode) -> not_null<std::byte*>;
+
+    /// \brief Commits \p size bytes of reserved memory, making it readable
+    ///        and writable
+    ///
+    /// \throw std::system_error with the error code on failure
+    /// \throw std::runtime_error if not available for target system
+    ///
+    /// \param memory the first page to commit
+    /// \param size the number of bytes to commit; a multiple of the page size
+    virtual auto commit(not_null<std::byte*> memory, bytes size) -> void;
+
+    /// \brief Decommits \p size bytes of committed memory, making it
+    ///        inaccessible
+    ///
+    /// \throw std::system_error with the error code on failure
+    /// \throw std::runtime_error if not available for target system
+    ///
+    /// \param memory the first page to decommit
+    /// \param size the number of bytes to decommit; a multiple of the page
+    ///        size
+    /// \param policy the policy for returning the physical memory
+    virtual auto decommit(not_null<std::byte*> memory,
+                          bytes size,
+                          virtual_memory::decommit_policy policy) -> void;
+
+    /// \brief Releases \p size bytes of memory that was returned by `reserve`
+    ///
+    /// \param memory the memory returned by `reserve`
+    /// \param size the number of bytes that were reserved
+    virtual auto release(not_null<std::byte*> memory, bytes size) noexcept -> void;
+  };
+
+} // namespace msl
+
+#endif /* MSL_MEMORY_VIRTUAL_MEMORY_HOOKS_HPP */
@@ -87,6 +87,47 @@ namespace msl {
     ///        state
     constexpr auto reset() noexcept -> void;
 
+    /// \brief Moves every entry of \p other onto the top of this stack
+    ///
+    /// The entries are relinked rather than copied, so this only walks
+    /// \p other to find its last entry -- and is constant-time if this stack
+    /// is empty.
+    ///
+    /// \post `other.empty()`
+    /// \param other the stack to splice from
+    auto splice(intrusive_pointer_stack& other) noexcept -> void;
+
+    /// \brief Moves every entry of \p other, whose last entry is \p last,
+    ///        onto the top of this stack
+    ///
+    /// Unlike `splice(other)`, this never walks \p other, so it is always
+    /// constant-time.
+    ///
+    /// \pre \p last is the last entry of \p other
+    /// \post `other.empty()`
+    /// \param other the stack to splice from
+    /// \param last the last entry of \p other
+    auto splice(intrusive_pointer_stack& other, not_null<std::byte*> last) noexcept -> void;
+
+    /// \brief Detaches the top \p n entries of this stack into a new stack
+    ///
+    /// The order of the entries is preserved. If this stack has fewer than
+    /// \p n entries, all entries are detached.
+    ///
+    /// \param n the number of entries to detach
+    /// \return the detached entries
+    auto split(uquantity<std::byte*> n) noexcept -> intrusive_pointer_stack;
+
+    /// \brief Detaches the top \p n entries of this stack into a new stack,
+    ///        storing the last entry of the new stack in \p last
+    ///
+    /// This allows the result to be spliced in constant time.
+    ///
+    /// \param n the number of entries to detach
+    /// \param last set to the last detached entry, or null if none were
+    /// \return the detached entries
+    auto split(uquantity<std::byte*> n, std::byte*& last) noexcept -> intrusive_pointer_stack;
+
     //-------------------------------------------------------------------------
     // Observers
     //-------------------------------------------------------------------------
@@ -161,10 +202,10 @@ auto msl::intrusive_pointer_stack::pop()
 {
   MSL_ASSERT(m_head != nullptr);
 
-  auto result = static_cast<std::byte**>(nullptr);
-  std::memcpy(&result, m_head, sizeof(std::byte*));
+  auto next = static_cast<std::byte*>(nullptr);
+  std::memcpy(&next, m_head, sizeof(std::byte*));
 
-  m_head = (*result);
+  m_head = next;
 }
 
 MSL_FORCE_INLINE constexpr
@@ -294,7 +294,7 @@ auto msl::lifetime_utilities::destroy_range(Range&& range)
   noexcept(std::is_nothrow_destructible_v<std::ranges::range_value_t<std::decay_t<Range>>>) -> void
   requires(std::ranges::range<Range>)
 {
-  using value_type = std::ranges::range_value_t<std::decay_t<Range>>>;
+  using value_type = std::ranges::range_value_t<std::decay_t<Range>>;
 
   if constexpr (!std::is_trivially_destructible_v<value_type>) {
     destroy_range(
@@ -0,0 +1,516 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_CONCURRENT_POOL_MEMORY_RESOURCE_HPP
+#define MSL_RESOURCES_CONCURRENT_POOL_MEMORY_RESOURCE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/cells/cell.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/pointers/intrusive_pointer_stack.hpp"
+#include "msl/pointers/not_null.hpp"
+#include "msl/pointers/pointer_utilities.hpp"
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/resources/thread_registry.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <algorithm> // std::max
+#include <atomic>    // std::atomic
+#include <bit>       // std::has_single_bit
+#include <cstddef>   // std::size_t, std::byte, std::max_align_t
+#include <cstdint>   // std::uint64_t
+#include <memory>    // std::unique_ptr
+#include <mutex>     // std::mutex
+#include <thread>    // std::thread, std::this_thread
+#include <vector>    // std::vector
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The type-erased implementation of
+  ///        `concurrent_pool_memory_resource`
+  ///
+  /// Every thread allocates from its own heap, and each heap owns the slabs
+  /// that it carves blocks from. Slabs are aligned to their size, so the
+  /// header of the owning slab -- and from it, the owning heap -- is found
+  /// from any block by masking off the low bits of its address.
+  ///
+  /// Blocks freed by the owning thread are pushed onto the heap's free
+  /// stack without any synchronization. Blocks freed by any other thread are
+  /// pushed onto the lock-free remote-free list of the owning slab, which
+  /// the owner reclaims in bulk the next time that its free stack runs dry.
+  /// The first such block also queues its slab on a lock-free list of the
+  /// heap, so that reclaiming only visits slabs that have remote frees,
+  /// rather than every slab of the heap.
+  ///
+  /// When a thread exits, its heap is kept -- with all of its slabs and free
+  /// blocks -- to be adopted by the next thread that needs a heap.
+  /////////////////////////////////////////////////////////////////////////////
+  class owned_slab_pool : private thread_state_owner
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a pool of blocks
+    ///
+    /// \pre \p block_size must be a non-zero multiple of \p block_align, and
+    ///      at least the size of a pointer
+    /// \param block_size the size of each block
+    /// \param block_align the alignment of each block
+    /// \param slab_pages the minimum number of pages in each slab
+    owned_slab_pool(std::size_t block_size,
+                    alignment block_align,
+                    uquantity<virtual_memory::page> slab_pages);
+
+    owned_slab_pool(const owned_slab_pool&) = delete;
+
+    ~owned_slab_pool();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const owned_slab_pool&) -> owned_slab_pool& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates a single block from the heap of the current thread
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \return the block
+    auto allocate_block() -> not_null<std::byte*>;
+
+    /// \brief Deallocates the block at \p p, from any thread
+    ///
+    /// \pre \p p must have been allocated from this pool
+    /// \param p the block to deallocate
+    auto deallocate_block(not_null<std::byte*> p) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of slabs reserved by this pool
+    ///
+    /// \return the number of slabs
+    auto slabs() const -> std::size_t;
+
+    /// \brief Gets the number of blocks carved from each slab
+    ///
+    /// \return the number of blocks
+    auto blocks_per_slab() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    struct heap;
+
+    /// The header at the base of each slab
+    struct slab_header
+    {
+      // Blocks freed by threads other than the owner. Any thread may push,
+      // but only the owner takes, and it always takes the whole list -- so
+      // this is not subject to ABA.
+      std::atomic<std::byte*> remote_free;
+
+      // Whether this slab is on the pending list of its owner, and the next
+      // slab on that list. The thread that queues the slab writes 'next', and
+      // the owner reads it before clearing 'queued'.
+      std::atomic<bool> queued;
+      slab_header* next;
+
+      heap* owner;
+    };
+
+    struct heap
+    {
+      // The thread that currently owns this heap, or the default id if it is
+      // waiting to be adopted
+      std::atomic<std::thread::id> thread;
+
+      // The slabs of this heap that have blocks on their remote-free lists.
+      // Any thread may push, but only the owner takes, and it always takes
+      // the whole list -- so this is not subject to ABA.
+      std::atomic<slab_header*> pending;
+
+      intrusive_pointer_stack free;
+
+      // The uncarved region of the most recent slab
+      std::byte* cursor;
+      std::byte* end;
+    };
+
+    struct current_entry
+    {
+      std::uint64_t id;
+      heap* owner;
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    static thread_local current_entry s_current;
+
+    std::uint64_t m_id;
+    std::size_t m_block_size;
+    alignment m_block_align;
+    uquantity<virtual_memory::page> m_slab_pages;
+    alignment m_slab_align;
+
+    // The offset of the first block of each slab, past its header
+    std::size_t m_first_block;
+
+    // Guards the heaps and slabs
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<heap>> m_heaps;
+    std::vector<heap*> m_idle_heaps;
+    std::vector<virtual_memory> m_slabs;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Gets the heap of the current thread
+    auto local() -> heap&;
+
+    /// \brief Finds, adopts, or creates the heap of the current thread
+    auto find_local() -> heap&;
+
+    /// \brief Gets the header of the slab that contains \p p
+    auto slab_of(std::byte* p) const noexcept -> slab_header*;
+
+    /// \brief Allocates a block when the free stack of \p h is empty
+    auto allocate_slow(heap& h) -> not_null<std::byte*>;
+
+    /// \brief Pushes \p p onto the remote-free list of its owning \p slab
+    auto deallocate_remote(slab_header* slab, std::byte* p) noexcept -> void;
+
+    /// \brief Moves the remote-free lists of every pending slab of \p h
+    ///        onto its free stack
+    auto reclaim(heap& h) noexcept -> void;
+
+    /// \brief Reserves a new slab for \p h to carve blocks from
+    auto add_slab(heap& h) -> void;
+
+    /// \brief Puts the heap \p state of the exiting thread up for adoption
+    auto retire(void* state) noexcept -> void override;
+  };
+
+} // namespace msl::detail
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A thread-safe memory resource that distributes fixed-size blocks
+  ///        from slabs owned by each thread
+  ///
+  /// This behaves like `pool_memory_resource`, except that each thread
+  /// allocates from slabs that it owns. Freeing a block on the thread that
+  /// allocated it requires no synchronization. Freeing it on any other
+  /// thread pushes it onto a lock-free list on its slab, which is reclaimed
+  /// in bulk by the owning thread -- so producer/consumer patterns, where
+  /// blocks are allocated on one thread and freed on another, never contend
+  /// on a shared lock.
+  ///
+  /// A shared lock is only taken to reserve new slabs, or the first time
+  /// that a thread allocates.
+  ///
+  /// ### Example
+  ///
+  /// Basic Use:
+  /// ```cpp
+  /// auto pool = concurrent_pool_memory_resource<sizeof(message)>{};
+  ///
+  /// // producer thread
+  /// auto c = pool.allocate<message>();
+  /// ...
+  /// // consumer thread
+  /// pool.deallocate(c);
+  /// ```
+  ///
+  /// \tparam BlockSize the size of each block
+  /// \tparam Align the alignment of each block
+  /////////////////////////////////////////////////////////////////////////////
+  template <std::size_t BlockSize, std::size_t Align = alignof(std::max_align_t)>
+  class concurrent_pool_memory_resource
+  {
+    static_assert(
+      BlockSize > 0u,
+      "Block size must be non-zero."
+    );
+
+    static_assert(
+      std::has_single_bit(Align),
+      "Alignment must be a power-of-two."
+    );
+
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    /// \brief The options that control the slabs of the pool
+    struct options
+    {
+      /// The minimum number of pages in each slab. This is rounded up to a
+      /// power of two, since slabs are aligned to their size.
+      uquantity<page> slab_pages = uquantity<page>{16u};
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a pool with the default options
+    concurrent_pool_memory_resource();
+
+    /// \brief Constructs a pool with the specified \p pool_options
+    ///
+    /// \param pool_options the options controlling the pool
+    explicit concurrent_pool_memory_resource(options pool_options);
+
+    concurrent_pool_memory_resource(const concurrent_pool_memory_resource&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const concurrent_pool_memory_resource&)
+      -> concurrent_pool_memory_resource& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates a block to hold a single \p T
+    ///
+    /// The object in the returned cell has not yet begun its lifetime.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \return the allocated storage
+    template <typename T>
+    [[nodiscard]]
+    auto allocate() -> cell<T,Align>
+      requires(sizeof(T) <= BlockSize && alignof(T) <= Align);
+
+    /// \brief Deallocates the block of \p c
+    ///
+    /// \p c may be deallocated from any thread.
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to deallocate
+    template <typename T>
+    auto deallocate(const cell<T,Align>& c) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the size of each block, including any padding for
+    ///        alignment
+    ///
+    /// \return the size of each block in bytes
+    static constexpr auto block_size() noexcept -> bytes;
+
+    /// \brief Gets the number of slabs reserved by this pool
+    ///
+    /// \return the number of slabs
+    auto slabs() const -> std::size_t;
+
+    /// \brief Gets the number of blocks carved from each slab
+    ///
+    /// \return the number of blocks
+    auto blocks_per_slab() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    // Free blocks store the link to the next free block within themselves
+    static constexpr auto s_block_size = (
+      (std::max(BlockSize, sizeof(std::byte*)) + Align - 1u) & ~(Align - 1u)
+    );
+
+    detail::owned_slab_pool m_pool;
+  };
+
+} // namespace msl
+
+//=============================================================================
+// class : detail::owned_slab_pool
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::detail::owned_slab_pool::allocate_block()
+  -> not_null<std::byte*>
+{
+  auto& h = local();
+  if (!h.free.empty()) MSL_LIKELY {
+    const auto p = h.free.peek();
+    h.free.pop();
+    return assume_not_null(p);
+  }
+  return allocate_slow(h);
+}
+
+MSL_FORCE_INLINE
+auto msl::detail::owned_slab_pool::deallocate_block(not_null<std::byte*> p)
+  noexcept -> void
+{
+  const auto slab = slab_of(p.get());
+  const auto owner = slab->owner;
+
+  // Only the owning thread can observe its own id here
+  if (owner->thread.load(std::memory_order_relaxed) == std::this_thread::get_id()) MSL_LIKELY {
+    owner->free.push(p);
+    return;
+  }
+  deallocate_remote(slab, p.get());
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::detail::owned_slab_pool::local()
+  -> heap&
+{
+  if (s_current.id == m_id) MSL_LIKELY {
+    return *s_current.owner;
+  }
+  return find_local();
+}
+
+MSL_FORCE_INLINE
+auto msl::detail::owned_slab_pool::slab_of(std::byte* p)
+  const noexcept -> slab_header*
+{
+  const auto base = pointer_utilities::align_low(assume_not_null(p), m_slab_align);
+
+  return reinterpret_cast<slab_header*>(base.get());
+}
+
+//=============================================================================
+// class : concurrent_pool_memory_resource
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+msl::concurrent_pool_memory_resource<BlockSize,Align>::concurrent_pool_memory_resource()
+  : concurrent_pool_memory_resource{options{}}
+{
+
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+msl::concurrent_pool_memory_resource<BlockSize,Align>::concurrent_pool_memory_resource(options pool_options)
+  : m_pool{s_block_size, alignment::at_boundary<Align>(), pool_options.slab_pages}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+template <typename T>
+MSL_FORCE_INLINE
+auto msl::concurrent_pool_memory_resource<BlockSize,Align>::allocate()
+  -> cell<T,Align>
+  requires(sizeof(T) <= BlockSize && alignof(T) <= Align)
+{
+  return cell<T,Align>{
+    assume_not_null(reinterpret_cast<T*>(m_pool.allocate_block().get()))
+  };
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+template <typename T>
+MSL_FORCE_INLINE
+auto msl::concurrent_pool_memory_resource<BlockSize,Align>::deallocate(const cell<T,Align>& c)
+  noexcept -> void
+{
+  m_pool.deallocate_block(assume_not_null(reinterpret_cast<std::byte*>(c.data().get())));
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+inline constexpr
+auto msl::concurrent_pool_memory_resource<BlockSize,Align>::block_size()
+  noexcept -> bytes
+{
+  return bytes{s_block_size};
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+auto msl::concurrent_pool_memory_resource<BlockSize,Align>::slabs()
+  const -> std::size_t
+{
+  return m_pool.slabs();
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+auto msl::concurrent_pool_memory_resource<BlockSize,Align>::blocks_per_slab()
+  const noexcept -> std::size_t
+{
+  return m_pool.blocks_per_slab();
+}
+
+#endif /* MSL_RESOURCES_CONCURRENT_POOL_MEMORY_RESOURCE_HPP */
@@ -0,0 +1,302 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_MONOTONIC_MEMORY_RESOURCE_HPP
+#define MSL_RESOURCES_MONOTONIC_MEMORY_RESOURCE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/blocks/memory_block.hpp"
+#include "msl/cells/cell.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/pointers/not_null.hpp"
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+
+#include <cstddef>  // std::size_t, std::byte
+#include <limits>   // std::numeric_limits
+#include <new>      // std::bad_alloc
+#include <optional> // std::optional
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A memory resource that distributes memory by bumping a pointer
+  ///        through a single region, and releases it all at once
+  ///
+  /// Allocating is a matter of aligning and advancing a pointer, and
+  /// deallocating individual cells is a no-op -- with the exception of the
+  /// most recent allocation, which may be rolled back, shrunk, or extended
+  /// in place with `resize_allocation`. This allows a growing container that
+  /// is the sole user of the resource to expand without ever reallocating.
+  ///
+  /// The region is either a caller-owned `memory_block`, which must be
+  /// accessible in its entirety, or an owned `virtual_memory` reservation.
+  /// Reservations are committed lazily as the bump pointer advances, so
+  /// reserving generously costs only address space. Committing grows
+  /// geometrically, so that a region of `n` pages is committed with
+  /// `O(log n)` system calls.
+  ///
+  /// Calling `release` makes all memory available again in constant time.
+  /// Committed pages are retained, so reusing the resource is free.
+  ///
+  /// \note This type is not thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class monotonic_memory_resource
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a resource that distributes memory from \p block
+    ///
+    /// \pre \p block must be accessible, and must outlive this resource
+    /// \param block the block of memory to distribute
+    explicit monotonic_memory_resource(memory_block block) noexcept;
+
+    /// \brief Constructs a resource that distributes memory from \p memory,
+    ///        committing its pages as they are needed
+    ///
+    /// Pages of \p memory that are already committed are used as-is.
+    ///
+    /// \pre \p memory must not be empty
+    /// \param memory the virtual memory to take ownership of
+    explicit monotonic_memory_resource(virtual_memory memory) noexcept;
+
+    monotonic_memory_resource(const monotonic_memory_resource&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const monotonic_memory_resource&) -> monotonic_memory_resource& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates storage for \p n objects of type \p T, aligned to an
+    ///        \p Align boundary
+    ///
+    /// The objects in the returned cell have not yet begun their lifetime.
+    ///
+    /// \throw std::bad_alloc if the resource is exhausted
+    /// \throw std::system_error if committing the memory fails
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \tparam Align the alignment of the storage
+    /// \param n the number of objects
+    /// \return the allocated storage
+    template <typename T, std::size_t Align = alignof(T)>
+    [[nodiscard]]
+    auto allocate(uquantity<T> n) -> cell<T[],Align>;
+
+    /// \brief Attempts to resize the storage of \p c in place to hold \p n
+    ///        objects
+    ///
+    /// Shrinking always succeeds. Growing only succeeds if \p c is the most
+    /// recent allocation, and the resource has enough memory remaining. The
+    /// address of the storage never changes.
+    ///
+    /// \throw std::system_error if committing the memory fails
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to resize
+    /// \param n the new number of objects
+    /// \return the resized cell on success, or `std::nullopt` otherwise
+    template <typename T, std::size_t Align>
+    [[nodiscard]]
+    auto resize_allocation(const cell<T[],Align>& c, uquantity<T> n)
+      -> std::optional<cell<T[],Align>>;
+
+    /// \brief Deallocates the storage of \p c
+    ///
+    /// This only reclaims the storage if \p c is the most recent allocation;
+    /// otherwise it is reclaimed by `release`.
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to deallocate
+    template <typename T, std::size_t Align>
+    auto deallocate(const cell<T[],Align>& c) noexcept -> void;
+
+    /// \brief Releases all memory distributed by this resource in constant
+    ///        time
+    ///
+    /// \note This does not decommit any pages, and invalidates every cell
+    ///       allocated by this resource.
+    auto release() noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of bytes distributed since the last release,
+    ///        including alignment padding
+    ///
+    /// \return the number of used bytes
+    auto used() const noexcept -> bytes;
+
+    /// \brief Gets the total number of bytes that this resource may
+    ///        distribute
+    ///
+    /// \return the capacity in bytes
+    auto capacity() const noexcept -> bytes;
+
+    /// \brief Gets the number of bytes that are currently committed
+    ///
+    /// \return the committed bytes
+    auto committed() const noexcept -> bytes;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    std::optional<virtual_memory> m_memory;
+    std::byte* m_begin;
+    std::byte* m_end;
+    std::byte* m_current;
+
+    // The start of the most recent allocation, or null if it is unknown
+    std::byte* m_last;
+
+    // The end of the committed region; this is always on a page boundary for
+    // owned virtual memory.
+    std::byte* m_committed;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Allocates \p size bytes aligned to the \p align boundary
+    ///
+    /// \return the allocated bytes, or null if the resource is exhausted
+    auto allocate_bytes(std::size_t size, alignment align) -> std::byte*;
+
+    /// \brief Resizes the allocation of \p old_size bytes at \p p in place
+    ///
+    /// \return true if the allocation was resized
+    auto resize_bytes(std::byte* p,
+                      std::size_t old_size,
+                      std::size_t new_size) -> bool;
+
+    /// \brief Deallocates the allocation of \p size bytes at \p p
+    auto deallocate_bytes(std::byte* p, std::size_t size) noexcept -> void;
+
+    /// \brief Ensures that all bytes up to \p end are committed
+    auto ensure_committed(std::byte* end) -> void;
+
+    /// \brief Gets the number of bytes needed for \p n objects of type \p T,
+    ///        or the max size if this overflows
+    template <typename T>
+    static auto bytes_for(uquantity<T> n) noexcept -> std::size_t;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+template <typename T, std::size_t Align>
+inline
+auto msl::monotonic_memory_resource::allocate(uquantity<T> n)
+  -> cell<T[],Align>
+{
+  const auto p = allocate_bytes(bytes_for(n), alignment::at_boundary<Align>());
+  if (p == nullptr) MSL_UNLIKELY {
+    throw std::bad_alloc{};
+  }
+  return cell<T[],Align>{assume_not_null(reinterpret_cast<T*>(p)), n};
+}
+
+template <typename T, std::size_t Align>
+inline
+auto msl::monotonic_memory_resource::resize_allocation(const cell<T[],Align>& c,
+                                                       uquantity<T> n)
+  -> std::optional<cell<T[],Align>>
+{
+  const auto p = reinterpret_cast<std::byte*>(c.data().get());
+  if (!resize_bytes(p, bytes_for(c.size()), bytes_for(n))) {
+    return std::nullopt;
+  }
+  return cell<T[],Align>{c.data(), n};
+}
+
+template <typename T, std::size_t Align>
+inline
+auto msl::monotonic_memory_resource::deallocate(const cell<T[],Align>& c)
+  noexcept -> void
+{
+  const auto p = reinterpret_cast<std::byte*>(c.data().get());
+  deallocate_bytes(p, bytes_for(c.size()));
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::monotonic_memory_resource::used()
+  const noexcept -> bytes
+{
+  return bytes{static_cast<std::size_t>(m_current - m_begin)};
+}
+
+inline
+auto msl::monotonic_memory_resource::capacity()
+  const noexcept -> bytes
+{
+  return bytes{static_cast<std::size_t>(m_end - m_begin)};
+}
+
+inline
+auto msl::monotonic_memory_resource::committed()
+  const noexcept -> bytes
+{
+  return bytes{static_cast<std::size_t>(m_committed - m_begin)};
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+template <typename T>
+inline
+auto msl::monotonic_memory_resource::bytes_for(uquantity<T> n)
+  noexcept -> std::size_t
+{
+  constexpr auto max = std::numeric_limits<std::size_t>::max();
+
+  if (n.count() > max / sizeof(T)) MSL_UNLIKELY {
+    return max;
+  }
+  return n.count() * sizeof(T);
+}
+
+#endif /* MSL_RESOURCES_MONOTONIC_MEMORY_RESOURCE_HPP */
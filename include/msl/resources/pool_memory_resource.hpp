@@ -0,0 +1,512 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_POOL_MEMORY_RESOURCE_HPP
+#define MSL_RESOURCES_POOL_MEMORY_RESOURCE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/cells/cell.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/pointers/intrusive_pointer_stack.hpp"
+#include "msl/pointers/not_null.hpp"
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <algorithm> // std::max
+#include <bit>       // std::has_single_bit
+#include <cstddef>   // std::size_t, std::byte, std::max_align_t
+#include <utility>   // std::exchange
+#include <vector>    // std::vector
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The type-erased implementation of `pool_memory_resource`
+  ///
+  /// Blocks are carved out of slabs of virtual memory on demand, so that a
+  /// slab is never touched beyond the blocks that have been distributed.
+  /// Freed blocks are kept in an intrusive stack, and are always reused
+  /// before carving new blocks.
+  /////////////////////////////////////////////////////////////////////////////
+  class pool_resource_base
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a pool of blocks
+    ///
+    /// \pre \p block_size must be a non-zero multiple of \p block_align, and
+    ///      at least the size of a pointer
+    /// \param block_size the size of each block
+    /// \param block_align the alignment of each block
+    /// \param slab_pages the minimum number of pages in each slab
+    pool_resource_base(std::size_t block_size,
+                       alignment block_align,
+                       uquantity<virtual_memory::page> slab_pages) noexcept;
+
+    /// \brief Moves the blocks and slabs of \p other into this pool
+    ///
+    /// \param other the other pool to move
+    pool_resource_base(pool_resource_base&& other) noexcept;
+
+    pool_resource_base(const pool_resource_base&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(pool_resource_base&&) -> pool_resource_base& = delete;
+    auto operator=(const pool_resource_base&) -> pool_resource_base& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates a single block
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \return the block
+    auto allocate_block() -> not_null<std::byte*>;
+
+    /// \brief Deallocates the block at \p p
+    ///
+    /// \pre \p p must have been allocated from this pool
+    /// \param p the block to deallocate
+    auto deallocate_block(not_null<std::byte*> p) noexcept -> void;
+
+    /// \brief Makes every block of every slab available again
+    auto release() noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of slabs reserved by this pool
+    ///
+    /// \return the number of slabs
+    auto slabs() const noexcept -> std::size_t;
+
+    /// \brief Gets the number of blocks carved from each slab
+    ///
+    /// \return the number of blocks
+    auto blocks_per_slab() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    intrusive_pointer_stack m_free;
+
+    // The uncarved region of the current slab
+    std::byte* m_cursor;
+    std::byte* m_end;
+
+    std::vector<virtual_memory> m_slabs;
+
+    // The index of the next slab to carve from; this only trails the slab
+    // count after a release.
+    std::size_t m_next_slab;
+
+    std::size_t m_block_size;
+    alignment m_block_align;
+    uquantity<virtual_memory::page> m_slab_pages;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Carves a block from the next slab, reserving it if necessary
+    ///
+    /// \return the block
+    auto carve_from_next_slab() -> not_null<std::byte*>;
+  };
+
+} // namespace msl::detail
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A memory resource that distributes fixed-size blocks from slabs
+  ///        of virtual memory
+  ///
+  /// Since every block has the same size and alignment, which are both known
+  /// at compile-time, allocating and deallocating require no size or
+  /// alignment arithmetic: each is a push or pop of an intrusive free stack.
+  /// Freed blocks are reused in LIFO order, so recently freed -- and likely
+  /// cached -- blocks are distributed first.
+  ///
+  /// Slabs are reserved and committed as they are needed, and are only
+  /// released when the resource is destroyed.
+  ///
+  /// ### Example
+  ///
+  /// Basic Use:
+  /// ```cpp
+  /// auto pool = pool_memory_resource<sizeof(order), alignof(order)>{};
+  ///
+  /// auto c = pool.allocate<order>();
+  /// ...
+  /// pool.deallocate(c);
+  /// ```
+  ///
+  /// \note This type is not thread-safe.
+  ///
+  /// \tparam BlockSize the size of each block
+  /// \tparam Align the alignment of each block
+  /////////////////////////////////////////////////////////////////////////////
+  template <std::size_t BlockSize, std::size_t Align = alignof(std::max_align_t)>
+  class pool_memory_resource
+  {
+    static_assert(
+      BlockSize > 0u,
+      "Block size must be non-zero."
+    );
+
+    static_assert(
+      std::has_single_bit(Align),
+      "Alignment must be a power-of-two."
+    );
+
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    /// \brief The options that control the slabs of the pool
+    struct options
+    {
+      /// The minimum number of pages in each slab
+      uquantity<page> slab_pages = uquantity<page>{16u};
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a pool with the default options
+    pool_memory_resource() noexcept;
+
+    /// \brief Constructs a pool with the specified \p pool_options
+    ///
+    /// \param pool_options the options controlling the pool
+    explicit pool_memory_resource(options pool_options) noexcept;
+
+    pool_memory_resource(const pool_memory_resource&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const pool_memory_resource&) -> pool_memory_resource& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates a block to hold a single \p T
+    ///
+    /// The object in the returned cell has not yet begun its lifetime.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \return the allocated storage
+    template <typename T>
+    [[nodiscard]]
+    auto allocate() -> cell<T,Align>
+      requires(sizeof(T) <= BlockSize && alignof(T) <= Align);
+
+    /// \brief Deallocates the block of \p c
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to deallocate
+    template <typename T>
+    auto deallocate(const cell<T,Align>& c) noexcept -> void;
+
+    /// \brief Makes every block available again, without releasing any
+    ///        slabs
+    ///
+    /// \note This invalidates every cell allocated by this resource.
+    auto release() noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Size Classes
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of size classes of this resource
+    ///
+    /// A pool has a single size class, which every block belongs to.
+    ///
+    /// \return the number of size classes
+    static constexpr auto size_class_count() noexcept -> std::size_t;
+
+    /// \brief Gets the size class that a \p T aligned to \p UAlign is
+    ///        allocated from
+    ///
+    /// \tparam T the type of object
+    /// \tparam UAlign the alignment of the object
+    /// \return the size class, or `size_class_count()` if a block cannot
+    ///         hold the object
+    template <typename T, std::size_t UAlign = alignof(T)>
+    static constexpr auto size_class_of() noexcept -> std::size_t;
+
+    /// \brief Allocates a single untyped block of the \p size_class
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p size_class must be less than `size_class_count()`
+    /// \param size_class the size class of the block
+    /// \return the block
+    auto allocate_block(std::size_t size_class) -> not_null<std::byte*>;
+
+    /// \brief Deallocates the untyped block \p p of the \p size_class
+    ///
+    /// \pre \p p must have been allocated from \p size_class of this
+    ///      resource
+    /// \param size_class the size class of the block
+    /// \param p the block to deallocate
+    auto deallocate_block(std::size_t size_class, not_null<std::byte*> p)
+      noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the size of each block, including any padding for
+    ///        alignment
+    ///
+    /// \return the size of each block in bytes
+    static constexpr auto block_size() noexcept -> bytes;
+
+    /// \brief Gets the number of slabs reserved by this pool
+    ///
+    /// \return the number of slabs
+    auto slabs() const noexcept -> std::size_t;
+
+    /// \brief Gets the number of blocks carved from each slab
+    ///
+    /// \return the number of blocks
+    auto blocks_per_slab() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    // Free blocks store the link to the next free block within themselves
+    static constexpr auto s_block_size = (
+      (std::max(BlockSize, sizeof(std::byte*)) + Align - 1u) & ~(Align - 1u)
+    );
+
+    detail::pool_resource_base m_base;
+  };
+
+} // namespace msl
+
+//=============================================================================
+// class : detail::pool_resource_base
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::detail::pool_resource_base::allocate_block()
+  -> not_null<std::byte*>
+{
+  if (!m_free.empty()) MSL_LIKELY {
+    const auto p = m_free.peek();
+    m_free.pop();
+    return assume_not_null(p);
+  }
+  if (m_cursor != m_end) MSL_LIKELY {
+    return assume_not_null(std::exchange(m_cursor, m_cursor + m_block_size));
+  }
+  return carve_from_next_slab();
+}
+
+MSL_FORCE_INLINE
+auto msl::detail::pool_resource_base::deallocate_block(not_null<std::byte*> p)
+  noexcept -> void
+{
+  m_free.push(p);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::detail::pool_resource_base::slabs()
+  const noexcept -> std::size_t
+{
+  return m_slabs.size();
+}
+
+//=============================================================================
+// class : pool_memory_resource
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+msl::pool_memory_resource<BlockSize,Align>::pool_memory_resource()
+  noexcept
+  : pool_memory_resource{options{}}
+{
+
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+msl::pool_memory_resource<BlockSize,Align>::pool_memory_resource(options pool_options)
+  noexcept
+  : m_base{s_block_size, alignment::at_boundary<Align>(), pool_options.slab_pages}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+template <typename T>
+MSL_FORCE_INLINE
+auto msl::pool_memory_resource<BlockSize,Align>::allocate()
+  -> cell<T,Align>
+  requires(sizeof(T) <= BlockSize && alignof(T) <= Align)
+{
+  return cell<T,Align>{
+    assume_not_null(reinterpret_cast<T*>(m_base.allocate_block().get()))
+  };
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+template <typename T>
+MSL_FORCE_INLINE
+auto msl::pool_memory_resource<BlockSize,Align>::deallocate(const cell<T,Align>& c)
+  noexcept -> void
+{
+  m_base.deallocate_block(assume_not_null(reinterpret_cast<std::byte*>(c.data().get())));
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+auto msl::pool_memory_resource<BlockSize,Align>::release()
+  noexcept -> void
+{
+  m_base.release();
+}
+
+//-----------------------------------------------------------------------------
+// Size Classes
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+inline constexpr
+auto msl::pool_memory_resource<BlockSize,Align>::size_class_count()
+  noexcept -> std::size_t
+{
+  return 1u;
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+template <typename T, std::size_t UAlign>
+inline constexpr
+auto msl::pool_memory_resource<BlockSize,Align>::size_class_of()
+  noexcept -> std::size_t
+{
+  return (sizeof(T) <= BlockSize && UAlign <= Align) ? 0u : 1u;
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::pool_memory_resource<BlockSize,Align>::allocate_block(std::size_t size_class)
+  -> not_null<std::byte*>
+{
+  MSL_ASSERT(size_class == 0u);
+  intrinsics::suppress_unused(size_class);
+
+  return m_base.allocate_block();
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::pool_memory_resource<BlockSize,Align>::deallocate_block(std::size_t size_class,
+                                                                  not_null<std::byte*> p)
+  noexcept -> void
+{
+  MSL_ASSERT(size_class == 0u);
+  intrinsics::suppress_unused(size_class);
+
+  m_base.deallocate_block(p);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+template <std::size_t BlockSize, std::size_t Align>
+inline constexpr
+auto msl::pool_memory_resource<BlockSize,Align>::block_size()
+  noexcept -> bytes
+{
+  return bytes{s_block_size};
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+auto msl::pool_memory_resource<BlockSize,Align>::slabs()
+  const noexcept -> std::size_t
+{
+  return m_base.slabs();
+}
+
+template <std::size_t BlockSize, std::size_t Align>
+inline
+auto msl::pool_memory_resource<BlockSize,Align>::blocks_per_slab()
+  const noexcept -> std::size_t
+{
+  return m_base.blocks_per_slab();
+}
+
+#endif /* MSL_RESOURCES_POOL_MEMORY_RESOURCE_HPP */
@@ -0,0 +1,266 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_SIZE_CLASS_TABLE_HPP
+#define MSL_RESOURCES_SIZE_CLASS_TABLE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/utilities/assert.hpp"
+
+#include <array>   // std::array
+#include <bit>     // std::has_single_bit
+#include <cstddef> // std::size_t
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A table of segregated size classes, computable at compile-time
+  ///
+  /// Sizes up to `2 * steps * granularity` are spaced by the granularity.
+  /// Above this, each doubling of size is divided into `steps` evenly spaced
+  /// classes -- which bounds the internal fragmentation of any request to
+  /// `1 / steps` of its size, while keeping the number of classes
+  /// logarithmic in the maximum size.
+  ///
+  /// For example, a granularity of 16 bytes with 4 steps produces the
+  /// classes 16, 32, 48, ..., 128, 160, 192, 224, 256, 320, ...
+  ///
+  /// ### Example
+  ///
+  /// Basic Use:
+  /// ```cpp
+  /// constexpr auto table = size_class_table{bytes{16u}, kibibytes{16u}};
+  ///
+  /// static_assert(table[table.index_of(bytes{100u})] == bytes{112u});
+  /// ```
+  /////////////////////////////////////////////////////////////////////////////
+  class size_class_table
+  {
+    //-------------------------------------------------------------------------
+    // Public Static Members
+    //-------------------------------------------------------------------------
+  public:
+
+    /// The maximum number of size classes that a table may hold
+    static constexpr auto max_classes = std::size_t{96u};
+
+    //-------------------------------------------------------------------------
+    // Constructors / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Computes the size classes from \p granularity up to
+    ///        \p max_size
+    ///
+    /// \pre \p granularity must be a power of two
+    /// \pre \p max_size must be a power of two, and no smaller than
+    ///      \p granularity
+    /// \pre \p steps must be a non-zero power of two
+    /// \param granularity the size of the smallest class, and the spacing of
+    ///        the small classes
+    /// \param max_size the size of the largest class
+    /// \param steps the number of classes per doubling of size
+    constexpr size_class_table(bytes granularity,
+                               bytes max_size,
+                               std::size_t steps = 4u) noexcept;
+
+    constexpr size_class_table(const size_class_table&) noexcept = default;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const size_class_table&) noexcept -> size_class_table& = default;
+
+    //-------------------------------------------------------------------------
+    // Element Access
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the size of the \p n'th size class
+    ///
+    /// \pre \p n must be less than `size()`
+    /// \param n the index of the size class
+    /// \return the size of the class
+    constexpr auto operator[](std::size_t n) const noexcept -> bytes;
+
+    /// \brief Gets the natural alignment of the \p n'th size class
+    ///
+    /// This is the largest power of two that divides the class size, which
+    /// is the alignment of every block of the class within an aligned slab.
+    ///
+    /// \pre \p n must be less than `size()`
+    /// \param n the index of the size class
+    /// \return the alignment of the class
+    constexpr auto alignment_of(std::size_t n) const noexcept -> alignment;
+
+    //-------------------------------------------------------------------------
+    // Lookup
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Finds the smallest size class that can hold \p size bytes
+    ///        aligned to the \p align boundary
+    ///
+    /// \param size the size of the request
+    /// \param align the alignment of the request
+    /// \return the index of the size class, or `size()` if no class can hold
+    ///         the request
+    constexpr auto index_of(bytes size,
+                            alignment align = alignment::min_default())
+      const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Capacity
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of size classes
+    ///
+    /// \return the number of classes
+    constexpr auto size() const noexcept -> std::size_t;
+
+    /// \brief Gets the size of the largest size class
+    ///
+    /// \return the largest size
+    constexpr auto max_size() const noexcept -> bytes;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    std::array<std::size_t, max_classes> m_sizes;
+    std::size_t m_count;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Constructors / Assignment
+//-----------------------------------------------------------------------------
+
+inline constexpr
+msl::size_class_table::size_class_table(bytes granularity,
+                                        bytes max_size,
+                                        std::size_t steps)
+  noexcept
+  : m_sizes{},
+    m_count{0u}
+{
+  MSL_ASSERT(std::has_single_bit(granularity.count()));
+  MSL_ASSERT(std::has_single_bit(max_size.count()));
+  MSL_ASSERT(granularity <= max_size);
+  MSL_ASSERT(std::has_single_bit(steps));
+
+  auto size = granularity.count();
+  auto delta = granularity.count();
+
+  while (size <= max_size.count()) {
+    MSL_ASSERT(m_count < max_classes, "Too many size classes");
+
+    m_sizes[m_count++] = size;
+    size += delta;
+
+    // Each doubling is split into 'steps' classes
+    if (size == delta * steps * 2u) {
+      delta *= 2u;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Element Access
+//-----------------------------------------------------------------------------
+
+inline constexpr
+auto msl::size_class_table::operator[](std::size_t n)
+  const noexcept -> bytes
+{
+  MSL_ASSERT(n < m_count);
+
+  return bytes{m_sizes[n]};
+}
+
+inline constexpr
+auto msl::size_class_table::alignment_of(std::size_t n)
+  const noexcept -> alignment
+{
+  MSL_ASSERT(n < m_count);
+
+  const auto size = m_sizes[n];
+
+  return alignment::assume_at_boundary(size & (~size + 1u));
+}
+
+//-----------------------------------------------------------------------------
+// Lookup
+//-----------------------------------------------------------------------------
+
+inline constexpr
+auto msl::size_class_table::index_of(bytes size, alignment align)
+  const noexcept -> std::size_t
+{
+  // Binary search for the first class that is large enough
+  auto first = std::size_t{0u};
+  auto last = m_count;
+  while (first < last) {
+    const auto mid = first + (last - first) / 2u;
+    if (m_sizes[mid] < size.count()) {
+      first = mid + 1u;
+    } else {
+      last = mid;
+    }
+  }
+
+  // Over-aligned requests are rare; settle for the next class that is a
+  // multiple of the alignment.
+  const auto mask = align.value().count() - 1u;
+  while (first < m_count && (m_sizes[first] & mask) != 0u) {
+    ++first;
+  }
+  return first;
+}
+
+//-----------------------------------------------------------------------------
+// Capacity
+//-----------------------------------------------------------------------------
+
+inline constexpr
+auto msl::size_class_table::size()
+  const noexcept -> std::size_t
+{
+  return m_count;
+}
+
+inline constexpr
+auto msl::size_class_table::max_size()
+  const noexcept -> bytes
+{
+  return bytes{m_sizes[m_count - 1u]};
+}
+
+#endif /* MSL_RESOURCES_SIZE_CLASS_TABLE_HPP */
@@ -0,0 +1,396 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_SLAB_MEMORY_RESOURCE_HPP
+#define MSL_RESOURCES_SLAB_MEMORY_RESOURCE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/cells/cell.hpp"
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/pointers/not_null.hpp"
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/resources/pool_memory_resource.hpp"
+#include "msl/resources/size_class_table.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <cstddef>     // std::size_t, std::byte
+#include <limits>      // std::numeric_limits
+#include <map>         // std::map
+#include <new>         // std::bad_alloc
+#include <type_traits> // std::remove_extent_t
+#include <vector>      // std::vector
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A general-purpose memory resource that segregates small
+  ///        allocations into size classes
+  ///
+  /// Every request is rounded up to a class from `size_classes`, and each
+  /// class distributes fixed-size blocks from its own page-aligned slabs of
+  /// virtual memory (see `pool_memory_resource`). Requests that no class can
+  /// hold, either from their size or their alignment, are given their own
+  /// virtual memory reservation.
+  ///
+  /// When the size of a request is known statically -- such as when
+  /// allocating a `cell<T>` or a `cell<T[N]>` -- the size class is resolved
+  /// at compile-time, so allocating and deallocating are a push or pop of
+  /// the free stack of the class. Requests sized at runtime resolve the class
+  /// with a binary search of the table.
+  ///
+  /// \note This type is not thread-safe.
+  /////////////////////////////////////////////////////////////////////////////
+  class slab_memory_resource
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using page = virtual_memory::page;
+
+    /// \brief The options that control the slabs of each size class
+    struct options
+    {
+      /// The minimum number of pages in each slab
+      uquantity<page> slab_pages = uquantity<page>{16u};
+    };
+
+    //-------------------------------------------------------------------------
+    // Public Static Members
+    //-------------------------------------------------------------------------
+  public:
+
+    /// The size classes that requests are rounded up to
+    static constexpr auto size_classes = size_class_table{
+      bytes{16u}, kibibytes{16u}
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a resource with the default options
+    slab_memory_resource();
+
+    /// \brief Constructs a resource with the specified \p resource_options
+    ///
+    /// \param resource_options the options controlling the resource
+    explicit slab_memory_resource(options resource_options);
+
+    slab_memory_resource(const slab_memory_resource&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const slab_memory_resource&) -> slab_memory_resource& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates storage for a single \p T, aligned to an \p Align
+    ///        boundary
+    ///
+    /// The size class is resolved at compile-time. \p T may be an array of
+    /// known bound, such as `U[N]`.
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \tparam Align the alignment of the storage
+    /// \return the allocated storage
+    template <typename T, std::size_t Align = alignof(T)>
+    [[nodiscard]]
+    auto allocate() -> cell<T,Align>;
+
+    /// \brief Allocates storage for \p n objects of type \p T, aligned to an
+    ///        \p Align boundary
+    ///
+    /// \throw std::bad_alloc if the size of the request overflows
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \tparam Align the alignment of the storage
+    /// \param n the number of objects
+    /// \return the allocated storage
+    template <typename T, std::size_t Align = alignof(T)>
+    [[nodiscard]]
+    auto allocate(uquantity<T> n) -> cell<T[],Align>;
+
+    /// \{
+    /// \brief Deallocates the storage of \p c
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to deallocate
+    template <typename T, std::size_t Align>
+    auto deallocate(const cell<T,Align>& c) noexcept -> void;
+    template <typename T, std::size_t Align>
+    auto deallocate(const cell<T[],Align>& c) noexcept -> void;
+    /// \}
+
+    //-------------------------------------------------------------------------
+    // Size Classes
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of size classes of this resource
+    ///
+    /// \return the number of size classes
+    static constexpr auto size_class_count() noexcept -> std::size_t;
+
+    /// \brief Gets the size class that a \p T aligned to \p Align is
+    ///        allocated from
+    ///
+    /// \tparam T the type of object
+    /// \tparam Align the alignment of the object
+    /// \return the size class, or `size_class_count()` if no class can hold
+    ///         the object
+    template <typename T, std::size_t Align = alignof(T)>
+    static constexpr auto size_class_of() noexcept -> std::size_t;
+
+    /// \brief Gets the size class that a request of \p size bytes aligned
+    ///        to \p align is allocated from
+    ///
+    /// \param size the size of the request
+    /// \param align the alignment of the request
+    /// \return the size class, or `size_class_count()` if no class can hold
+    ///         the request
+    static constexpr auto size_class_of(bytes size, alignment align)
+      noexcept -> std::size_t;
+
+    /// \brief Allocates a single untyped block of the \p size_class
+    ///
+    /// \throw std::system_error containing the error code on failure
+    ///
+    /// \pre \p size_class must be less than `size_class_count()`
+    /// \param size_class the size class of the block
+    /// \return the block
+    auto allocate_block(std::size_t size_class) -> not_null<std::byte*>;
+
+    /// \brief Deallocates the untyped block \p p of the \p size_class
+    ///
+    /// \pre \p p must have been allocated from \p size_class of this
+    ///      resource
+    /// \param size_class the size class of the block
+    /// \param p the block to deallocate
+    auto deallocate_block(std::size_t size_class, not_null<std::byte*> p)
+      noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of slabs reserved across all size classes
+    ///
+    /// \return the number of slabs
+    auto slabs() const noexcept -> std::size_t;
+
+    /// \brief Gets the number of live allocations that were too large for
+    ///        any size class
+    ///
+    /// \return the number of allocations
+    auto large_allocations() const noexcept -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    // One pool per entry of 'size_classes', in the same order
+    std::vector<detail::pool_resource_base> m_classes;
+
+    // Requests too large for any size class, keyed on their address
+    std::map<std::byte*, virtual_memory> m_large;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Allocates \p size bytes from the size class at \p index
+    auto allocate_bytes(std::size_t index, bytes size, alignment align)
+      -> not_null<std::byte*>;
+
+    /// \brief Deallocates \p p from the size class at \p index
+    auto deallocate_bytes(std::size_t index, not_null<std::byte*> p) noexcept
+      -> void;
+
+    /// \brief Reserves dedicated virtual memory for a request that is too
+    ///        large for any size class
+    auto allocate_large(bytes size, alignment align) -> not_null<std::byte*>;
+
+    /// \brief Releases the dedicated virtual memory at \p p
+    auto deallocate_large(std::byte* p) noexcept -> void;
+  };
+
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+template <typename T, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::allocate()
+  -> cell<T,Align>
+{
+  constexpr auto index = size_class_of<T,Align>();
+
+  const auto p = allocate_bytes(index, size_of<T>(), alignment::at_boundary<Align>());
+
+  return cell<T,Align>{
+    assume_not_null(reinterpret_cast<std::remove_extent_t<T>*>(p.get()))
+  };
+}
+
+template <typename T, std::size_t Align>
+inline
+auto msl::slab_memory_resource::allocate(uquantity<T> n)
+  -> cell<T[],Align>
+{
+  if (n.count() > std::numeric_limits<std::size_t>::max() / sizeof(T)) MSL_UNLIKELY {
+    throw std::bad_alloc{};
+  }
+  const auto size = size_of<T>() * n.count();
+  const auto align = alignment::at_boundary<Align>();
+  const auto p = allocate_bytes(size_class_of(size, align), size, align);
+
+  return cell<T[],Align>{assume_not_null(reinterpret_cast<T*>(p.get())), n};
+}
+
+template <typename T, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::deallocate(const cell<T,Align>& c)
+  noexcept -> void
+{
+  constexpr auto index = size_class_of<T,Align>();
+
+  deallocate_bytes(index, assume_not_null(reinterpret_cast<std::byte*>(c.data().get())));
+}
+
+template <typename T, std::size_t Align>
+inline
+auto msl::slab_memory_resource::deallocate(const cell<T[],Align>& c)
+  noexcept -> void
+{
+  const auto size = size_of<T>() * c.size().count();
+  const auto index = size_class_of(size, alignment::at_boundary<Align>());
+
+  deallocate_bytes(index, assume_not_null(reinterpret_cast<std::byte*>(c.data().get())));
+}
+
+//-----------------------------------------------------------------------------
+// Size Classes
+//-----------------------------------------------------------------------------
+
+inline constexpr
+auto msl::slab_memory_resource::size_class_count()
+  noexcept -> std::size_t
+{
+  return size_classes.size();
+}
+
+template <typename T, std::size_t Align>
+inline constexpr
+auto msl::slab_memory_resource::size_class_of()
+  noexcept -> std::size_t
+{
+  return size_classes.index_of(size_of<T>(), alignment::at_boundary<Align>());
+}
+
+inline constexpr
+auto msl::slab_memory_resource::size_class_of(bytes size, alignment align)
+  noexcept -> std::size_t
+{
+  return size_classes.index_of(size, align);
+}
+
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::allocate_block(std::size_t size_class)
+  -> not_null<std::byte*>
+{
+  MSL_ASSERT(size_class < m_classes.size());
+
+  return m_classes[size_class].allocate_block();
+}
+
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::deallocate_block(std::size_t size_class,
+                                                 not_null<std::byte*> p)
+  noexcept -> void
+{
+  MSL_ASSERT(size_class < m_classes.size());
+
+  m_classes[size_class].deallocate_block(p);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::slab_memory_resource::large_allocations()
+  const noexcept -> std::size_t
+{
+  return m_large.size();
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::allocate_bytes(std::size_t index,
+                                               bytes size,
+                                               alignment align)
+  -> not_null<std::byte*>
+{
+  if (index < m_classes.size()) MSL_LIKELY {
+    return m_classes[index].allocate_block();
+  }
+  return allocate_large(size, align);
+}
+
+MSL_FORCE_INLINE
+auto msl::slab_memory_resource::deallocate_bytes(std::size_t index,
+                                                 not_null<std::byte*> p)
+  noexcept -> void
+{
+  if (index < m_classes.size()) MSL_LIKELY {
+    m_classes[index].deallocate_block(p);
+    return;
+  }
+  deallocate_large(p.get());
+}
+
+#endif /* MSL_RESOURCES_SLAB_MEMORY_RESOURCE_HPP */
@@ -0,0 +1,589 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_THREAD_CACHING_RESOURCE_HPP
+#define MSL_RESOURCES_THREAD_CACHING_RESOURCE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/cells/cell.hpp"
+#include "msl/pointers/intrusive_pointer_stack.hpp"
+#include "msl/pointers/not_null.hpp"
+#include "msl/quantities/alignment.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/resources/thread_registry.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <cstddef>     // std::size_t, std::byte
+#include <cstdint>     // std::uint64_t
+#include <limits>      // std::numeric_limits
+#include <memory>      // std::unique_ptr
+#include <mutex>       // std::mutex, std::lock_guard
+#include <new>         // std::bad_alloc
+#include <type_traits> // std::remove_extent_t
+#include <utility>     // std::forward
+#include <vector>      // std::vector
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The source of blocks for a `thread_cache`
+  /////////////////////////////////////////////////////////////////////////////
+  class block_source
+  {
+  public:
+
+    virtual ~block_source() = default;
+
+    /// \brief Allocates a single block of the \p size_class
+    ///
+    /// This is only ever called with the source lock of the cache held.
+    ///
+    /// \param size_class the size class of the block
+    /// \return the block
+    virtual auto allocate_block(std::size_t size_class) -> not_null<std::byte*> = 0;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The type-erased implementation of `thread_caching_resource`
+  ///
+  /// Each thread that uses the cache is given its own free stack per size
+  /// class, which it allocates from and deallocates to without any
+  /// synchronization. When a thread's stack runs dry, a batch of blocks is
+  /// taken from the shared central stack of the size class -- or from the
+  /// block source if that is also empty. When a thread's stack overflows, a
+  /// batch is returned to the central stack.
+  ///
+  /// Blocks held by a thread are returned to the central stacks when the
+  /// thread exits.
+  /////////////////////////////////////////////////////////////////////////////
+  class thread_cache : private thread_state_owner
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a cache of blocks from \p source
+    ///
+    /// \pre \p batch_size must be non-zero
+    /// \param source the source of new blocks
+    /// \param size_classes the number of size classes
+    /// \param batch_size the number of blocks moved between a thread and the
+    ///        central stacks at a time
+    thread_cache(block_source& source,
+                 std::size_t size_classes,
+                 std::size_t batch_size);
+
+    thread_cache(const thread_cache&) = delete;
+
+    ~thread_cache();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const thread_cache&) -> thread_cache& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates a single block of the \p size_class
+    ///
+    /// \param size_class the size class of the block
+    /// \return the block
+    auto allocate_block(std::size_t size_class) -> not_null<std::byte*>;
+
+    /// \brief Deallocates the block \p p of the \p size_class
+    ///
+    /// Threads that have never allocated from this cache have no local cache
+    /// to return the block to, and creating one could fail; their blocks are
+    /// returned directly to the central stack instead.
+    ///
+    /// \param size_class the size class of the block
+    /// \param p the block to deallocate
+    auto deallocate_block(std::size_t size_class, not_null<std::byte*> p)
+      noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the mutex that serializes access to the block source
+    ///
+    /// \return the mutex
+    auto source_mutex() noexcept -> std::mutex&;
+
+    /// \brief Gets the number of blocks in the central stack of the
+    ///        \p size_class
+    ///
+    /// \param size_class the size class
+    /// \return the number of blocks
+    auto central_blocks(std::size_t size_class) const -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Member Types
+    //-------------------------------------------------------------------------
+  private:
+
+    struct local_bin
+    {
+      intrusive_pointer_stack blocks;
+      std::size_t count = 0u;
+    };
+
+    struct central_bin
+    {
+      mutable std::mutex mutex;
+      intrusive_pointer_stack blocks;
+      std::size_t count = 0u;
+    };
+
+    struct local_cache
+    {
+      explicit local_cache(std::size_t size_classes);
+
+      std::unique_ptr<local_bin[]> bins;
+    };
+
+    // The most recently used cache of the current thread. Caches are
+    // identified by a unique id rather than their address, since addresses
+    // may be reused after a cache is destroyed.
+    struct current_entry
+    {
+      std::uint64_t id;
+      local_cache* cache;
+    };
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    static thread_local current_entry s_current;
+
+    block_source* m_source;
+    std::uint64_t m_id;
+    std::size_t m_size_classes;
+    std::size_t m_batch_size;
+    std::unique_ptr<central_bin[]> m_central;
+    std::mutex m_source_mutex;
+
+    // The caches of every thread that has used this cache
+    std::mutex m_locals_mutex;
+    std::vector<std::unique_ptr<local_cache>> m_locals;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Gets the cache of the current thread
+    auto local() -> local_cache&;
+
+    /// \brief Finds or creates the cache of the current thread
+    auto find_local() -> local_cache&;
+
+    /// \brief Finds the cache of the current thread, if it has one
+    ///
+    /// \return the cache, or null if the current thread has none
+    auto find_existing_local() noexcept -> local_cache*;
+
+    /// \brief Refills the empty \p bin from the central stack or the source
+    auto refill(std::size_t size_class, local_bin& bin) -> void;
+
+    /// \brief Returns a batch of the overflowing \p bin to the central stack
+    auto flush(std::size_t size_class, local_bin& bin) noexcept -> void;
+
+    /// \brief Returns the single block \p p to the central stack
+    auto release(std::size_t size_class, not_null<std::byte*> p) noexcept -> void;
+
+    /// \brief Returns every block of the local cache \p state to the
+    ///        central stacks, and destroys it
+    ///
+    /// This is called when the thread that owns \p state exits.
+    auto retire(void* state) noexcept -> void override;
+  };
+
+} // namespace msl::detail
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A thread-safe memory resource that caches the blocks of a size
+  ///        class resource per thread
+  ///
+  /// The underlying `Resource` distributes blocks by size class -- such as a
+  /// `pool_memory_resource` or a `slab_memory_resource`. Each thread
+  /// allocates from, and deallocates to, its own uncontended free stack per
+  /// size class. Blocks only move between threads in batches, through a
+  /// central stack per size class, when a thread's stack runs dry or
+  /// overflows. This amortizes all synchronization over the batch size.
+  ///
+  /// Requests that the resource cannot serve from a size class are forwarded
+  /// to the resource directly, serialized by a lock.
+  ///
+  /// Blocks freed on a thread other than the one that allocated them are
+  /// simply cached by the freeing thread -- unless that thread has never
+  /// allocated from this resource, in which case they are returned to the
+  /// central stack directly, since deallocation may not fail.
+  ///
+  /// \tparam Resource the underlying size class resource
+  /////////////////////////////////////////////////////////////////////////////
+  template <typename Resource>
+  class thread_caching_resource : private detail::block_source
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using resource_type = Resource;
+
+    /// \brief The options that control the thread caches
+    struct options
+    {
+      /// The number of blocks moved between a thread and the central stacks
+      /// at a time. Each thread caches at most twice this many blocks per
+      /// size class.
+      std::size_t batch_size = 32u;
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a resource with the default options
+    thread_caching_resource();
+
+    /// \brief Constructs a resource with the specified \p cache_options,
+    ///        constructing the underlying resource from \p args
+    ///
+    /// \param cache_options the options controlling the thread caches
+    /// \param args the arguments to forward to the underlying resource
+    template <typename...Args>
+    explicit thread_caching_resource(options cache_options, Args&&...args);
+
+    thread_caching_resource(const thread_caching_resource&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const thread_caching_resource&) -> thread_caching_resource& = delete;
+
+    //-------------------------------------------------------------------------
+    // Allocation
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Allocates storage for a single \p T, aligned to an \p Align
+    ///        boundary
+    ///
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \tparam Align the alignment of the storage
+    /// \return the allocated storage
+    template <typename T, std::size_t Align = alignof(T)>
+    [[nodiscard]]
+    auto allocate() -> cell<T,Align>;
+
+    /// \brief Allocates storage for \p n objects of type \p T, aligned to an
+    ///        \p Align boundary
+    ///
+    /// This is only available if the resource can find size classes at
+    /// runtime.
+    ///
+    /// \throw std::bad_alloc if the size of the request overflows
+    /// \throw std::system_error containing the error code on failure
+    /// \throw std::runtime_error if not implementable on the target system
+    ///
+    /// \tparam T the type of object to allocate storage for
+    /// \tparam Align the alignment of the storage
+    /// \param n the number of objects
+    /// \return the allocated storage
+    template <typename T, std::size_t Align = alignof(T)>
+    [[nodiscard]]
+    auto allocate(uquantity<T> n) -> cell<T[],Align>
+      requires(requires(bytes b, alignment a) { Resource::size_class_of(b, a); });
+
+    /// \{
+    /// \brief Deallocates the storage of \p c
+    ///
+    /// \p c may be deallocated from any thread.
+    ///
+    /// \pre \p c must have been allocated from this resource
+    /// \param c the cell to deallocate
+    template <typename T, std::size_t Align>
+    auto deallocate(const cell<T,Align>& c) noexcept -> void;
+    template <typename T, std::size_t Align>
+    auto deallocate(const cell<T[],Align>& c) noexcept -> void
+      requires(requires(bytes b, alignment a) { Resource::size_class_of(b, a); });
+    /// \}
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of blocks in the central stack of the
+    ///        \p size_class
+    ///
+    /// \note The result is a snapshot; it may be stale as soon as it returns.
+    ///
+    /// \param size_class the size class
+    /// \return the number of blocks
+    auto central_blocks(std::size_t size_class) const -> std::size_t;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    Resource m_resource;
+    detail::thread_cache m_cache;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    auto allocate_block(std::size_t size_class) -> not_null<std::byte*> override;
+  };
+
+} // namespace msl
+
+//=============================================================================
+// class : detail::thread_cache
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::detail::thread_cache::allocate_block(std::size_t size_class)
+  -> not_null<std::byte*>
+{
+  MSL_ASSERT(size_class < m_size_classes);
+
+  auto& bin = local().bins[size_class];
+  if (bin.blocks.empty()) MSL_UNLIKELY {
+    refill(size_class, bin);
+  }
+  const auto p = bin.blocks.peek();
+  bin.blocks.pop();
+  --bin.count;
+
+  return assume_not_null(p);
+}
+
+MSL_FORCE_INLINE
+auto msl::detail::thread_cache::deallocate_block(std::size_t size_class,
+                                                 not_null<std::byte*> p)
+  noexcept -> void
+{
+  MSL_ASSERT(size_class < m_size_classes);
+
+  auto* const cache = (s_current.id == m_id) ? s_current.cache : find_existing_local();
+  if (cache == nullptr) MSL_UNLIKELY {
+    release(size_class, p);
+    return;
+  }
+  auto& bin = cache->bins[size_class];
+  bin.blocks.push(p);
+  if (++bin.count > m_batch_size * 2u) MSL_UNLIKELY {
+    flush(size_class, bin);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+inline
+auto msl::detail::thread_cache::source_mutex()
+  noexcept -> std::mutex&
+{
+  return m_source_mutex;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+MSL_FORCE_INLINE
+auto msl::detail::thread_cache::local()
+  -> local_cache&
+{
+  if (s_current.id == m_id) MSL_LIKELY {
+    return *s_current.cache;
+  }
+  return find_local();
+}
+
+//=============================================================================
+// class : thread_caching_resource
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+template <typename Resource>
+inline
+msl::thread_caching_resource<Resource>::thread_caching_resource()
+  : thread_caching_resource{options{}}
+{
+
+}
+
+template <typename Resource>
+template <typename...Args>
+inline
+msl::thread_caching_resource<Resource>::thread_caching_resource(options cache_options,
+                                                                Args&&...args)
+  : m_resource(std::forward<Args>(args)...),
+    m_cache{*this, Resource::size_class_count(), cache_options.batch_size}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+template <typename Resource>
+template <typename T, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::thread_caching_resource<Resource>::allocate()
+  -> cell<T,Align>
+{
+  constexpr auto size_class = Resource::template size_class_of<T,Align>();
+
+  if constexpr (size_class < Resource::size_class_count()) {
+    const auto p = m_cache.allocate_block(size_class);
+
+    return cell<T,Align>{
+      assume_not_null(reinterpret_cast<std::remove_extent_t<T>*>(p.get()))
+    };
+  } else {
+    auto lock = std::lock_guard{m_cache.source_mutex()};
+
+    return m_resource.template allocate<T,Align>();
+  }
+}
+
+template <typename Resource>
+template <typename T, std::size_t Align>
+inline
+auto msl::thread_caching_resource<Resource>::allocate(uquantity<T> n)
+  -> cell<T[],Align>
+  requires(requires(bytes b, alignment a) { Resource::size_class_of(b, a); })
+{
+  if (n.count() > std::numeric_limits<std::size_t>::max() / sizeof(T)) MSL_UNLIKELY {
+    throw std::bad_alloc{};
+  }
+  const auto size = size_of<T>() * n.count();
+  const auto size_class = Resource::size_class_of(size, alignment::at_boundary<Align>());
+
+  if (size_class < Resource::size_class_count()) MSL_LIKELY {
+    const auto p = m_cache.allocate_block(size_class);
+
+    return cell<T[],Align>{assume_not_null(reinterpret_cast<T*>(p.get())), n};
+  }
+  auto lock = std::lock_guard{m_cache.source_mutex()};
+
+  return m_resource.template allocate<T,Align>(n);
+}
+
+template <typename Resource>
+template <typename T, std::size_t Align>
+MSL_FORCE_INLINE
+auto msl::thread_caching_resource<Resource>::deallocate(const cell<T,Align>& c)
+  noexcept -> void
+{
+  constexpr auto size_class = Resource::template size_class_of<T,Align>();
+
+  if constexpr (size_class < Resource::size_class_count()) {
+    const auto p = reinterpret_cast<std::byte*>(c.data().get());
+
+    m_cache.deallocate_block(size_class, assume_not_null(p));
+  } else {
+    auto lock = std::lock_guard{m_cache.source_mutex()};
+
+    m_resource.deallocate(c);
+  }
+}
+
+template <typename Resource>
+template <typename T, std::size_t Align>
+inline
+auto msl::thread_caching_resource<Resource>::deallocate(const cell<T[],Align>& c)
+  noexcept -> void
+  requires(requires(bytes b, alignment a) { Resource::size_class_of(b, a); })
+{
+  const auto size = size_of<T>() * c.size().count();
+  const auto size_class = Resource::size_class_of(size, alignment::at_boundary<Align>());
+
+  if (size_class < Resource::size_class_count()) MSL_LIKELY {
+    const auto p = reinterpret_cast<std::byte*>(c.data().get());
+
+    m_cache.deallocate_block(size_class, assume_not_null(p));
+    return;
+  }
+  auto lock = std::lock_guard{m_cache.source_mutex()};
+
+  m_resource.deallocate(c);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+template <typename Resource>
+inline
+auto msl::thread_caching_resource<Resource>::central_blocks(std::size_t size_class)
+  const -> std::size_t
+{
+  return m_cache.central_blocks(size_class);
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+template <typename Resource>
+inline
+auto msl::thread_caching_resource<Resource>::allocate_block(std::size_t size_class)
+  -> not_null<std::byte*>
+{
+  return m_resource.allocate_block(size_class);
+}
+
+#endif /* MSL_RESOURCES_THREAD_CACHING_RESOURCE_HPP */
@@ -0,0 +1,124 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef MSL_RESOURCES_THREAD_REGISTRY_HPP
+#define MSL_RESOURCES_THREAD_REGISTRY_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include <cstdint> // std::uint64_t
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief An object that keeps state per thread, which must be retired
+  ///        when each thread exits
+  /////////////////////////////////////////////////////////////////////////////
+  class thread_state_owner
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    thread_state_owner() noexcept = default;
+
+    thread_state_owner(const thread_state_owner&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    virtual ~thread_state_owner() = default;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const thread_state_owner&) -> thread_state_owner& = delete;
+
+    //-------------------------------------------------------------------------
+    // Retirement
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Retires the \p state of the current thread, which is exiting
+    ///
+    /// This is called on the exiting thread, while the owner is guaranteed
+    /// not to be unregistered.
+    ///
+    /// \param state the state that was added for the current thread
+    virtual auto retire(void* state) noexcept -> void = 0;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief A registry of the per-thread state of `thread_state_owner`s
+  ///
+  /// Owners are identified by a unique id, rather than their address, since
+  /// addresses may be reused after an owner is destroyed.
+  /////////////////////////////////////////////////////////////////////////////
+  class thread_registry final
+  {
+    thread_registry() = delete;
+    ~thread_registry() = delete;
+
+    //-------------------------------------------------------------------------
+    // Owners
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Registers a new live owner
+    ///
+    /// \return the unique id of the owner
+    static auto register_owner() -> std::uint64_t;
+
+    /// \brief Unregisters the owner with the specified \p id
+    ///
+    /// After this returns, no state of the owner will be retired.
+    ///
+    /// \param id the id of the owner
+    static auto unregister_owner(std::uint64_t id) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Thread State
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Finds the state of the owner with the specified \p id for the
+    ///        current thread
+    ///
+    /// \param id the id of the owner
+    /// \return the state, or null if none was added
+    static auto find(std::uint64_t id) noexcept -> void*;
+
+    /// \brief Adds the \p state of \p owner for the current thread, to be
+    ///        retired when the thread exits
+    ///
+    /// \param id the id of the owner
+    /// \param owner the owner of the state
+    /// \param state the state
+    static auto add(std::uint64_t id, thread_state_owner& owner, void* state)
+      -> void;
+  };
+
+} // namespace msl::detail
+
+#endif /* MSL_RESOURCES_THREAD_REGISTRY_HPP */
@@ -0,0 +1,171 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_COW_MAPPING_HPP
+#define SRC_MSL_MEMORY_COW_MAPPING_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/pointers/not_null.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The base of the platform-specific state of a reservation that
+  ///        takes part in copy-on-write cloning
+  ///
+  /// A reservation is either the source of clones, whose pages are backed by
+  /// a shared memory object, or a clone, whose pages are private views of the
+  /// source's object. Writes to the source are intercepted so that every
+  /// clone takes a private copy of a page before the source modifies it.
+  ///
+  /// Since this changes how pages are backed, the owning `virtual_memory`
+  /// delegates committing, decommitting and protecting pages to this object.
+  /////////////////////////////////////////////////////////////////////////////
+  class cow_mapping
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using bitmap = std::vector<std::uint64_t>;
+
+    /// \brief The result of cloning a source
+    struct clone_result
+    {
+      not_null<std::byte*> data;             ///< The start of the clone
+      std::unique_ptr<cow_mapping> mapping; ///< The state of the clone
+    };
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    cow_mapping() noexcept = default;
+
+    cow_mapping(const cow_mapping&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    virtual ~cow_mapping() = default;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const cow_mapping&) -> cow_mapping& = delete;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Queries whether this is the source of clones
+    ///
+    /// \return `true` if this is a source, `false` if this is a clone
+    virtual auto is_source() const noexcept -> bool = 0;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Creates a clone of the \p committed pages of this source
+    ///
+    /// \pre `is_source()` must be `true`
+    /// \throw std::system_error with the error code on failure
+    ///
+    /// \param committed the bitmap of committed pages
+    /// \return the clone
+    virtual auto clone(const bitmap& committed) -> clone_result = 0;
+
+    /// \brief Takes a private copy of every page that is still shared with
+    ///        the source
+    ///
+    /// This is a no-op for a source.
+    virtual auto privatize() noexcept -> void = 0;
+
+    /// \brief Commits \p count pages starting at \p first
+    ///
+    /// Pages that are already committed may be shared with clones, so they
+    /// must not become writable before the clones take a copy of them.
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto commit(std::size_t first, std::size_t count) -> void = 0;
+
+    /// \brief Decommits \p count pages starting at \p first
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto decommit(std::size_t first, std::size_t count) -> void = 0;
+
+    /// \brief Changes the access to \p count pages starting at \p first
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto protect(std::size_t first,
+                         std::size_t count,
+                         virtual_memory::page_access access) -> void = 0;
+
+    /// \brief Notifies that the reservation now spans \p pages pages at
+    ///        \p memory
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto on_resize(not_null<std::byte*> memory, std::size_t pages) -> void = 0;
+  };
+
+  //---------------------------------------------------------------------------
+  // Platform Functions
+  //---------------------------------------------------------------------------
+
+  /// \brief Moves the \p committed pages of the \p pages pages of
+  ///        \p page_size bytes at \p memory into a shared memory object,
+  ///        making the reservation a source of clones
+  ///
+  /// Committed pages are copied into the object once; every clone after that
+  /// shares them.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory the start of the reservation
+  /// \param pages the number of pages in the reservation
+  /// \param page_size the size of each page
+  /// \param committed the bitmap of committed pages
+  /// \return the state of the source
+  auto make_cow_source(not_null<std::byte*> memory,
+                       std::size_t pages,
+                       bytes page_size,
+                       const std::vector<std::uint64_t>& committed)
+    -> std::unique_ptr<cow_mapping>;
+
+} // namespace msl::detail
+
+#endif /* SRC_MSL_MEMORY_COW_MAPPING_HPP */
@@ -0,0 +1,201 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/decommit_scheduler.hpp"
+
+#include <iterator> // std::prev
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::decommit_scheduler::decommit_scheduler(virtual_memory& memory)
+  : decommit_scheduler{memory, options{}}
+{
+
+}
+
+msl::decommit_scheduler::decommit_scheduler(virtual_memory& memory,
+                                            options scheduler_options)
+  : m_memory{&memory},
+    m_options{scheduler_options},
+    m_scheduled{},
+    m_scheduled_pages{0u}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Scheduling
+//-----------------------------------------------------------------------------
+
+auto msl::decommit_scheduler::schedule(std::size_t first,
+                                       uquantity<page> count,
+                                       clock::time_point now)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_memory->pages().count());
+
+  if (count == 0u) MSL_UNLIKELY {
+    return;
+  }
+
+  const auto last = first + count.count();
+  unschedule(first, last);
+
+  m_scheduled.emplace(first, entry{count.count(), now});
+  m_scheduled_pages += count.count();
+
+  const auto pressure = m_memory->page_size() * m_scheduled_pages;
+  if (pressure > m_options.pressure_threshold) {
+    purge_all();
+  }
+}
+
+auto msl::decommit_scheduler::cancel(std::size_t first, uquantity<page> count)
+  -> void
+{
+  unschedule(first, first + count.count());
+}
+
+//-----------------------------------------------------------------------------
+// Purging
+//-----------------------------------------------------------------------------
+
+auto msl::decommit_scheduler::purge(clock::time_point now)
+  -> uquantity<page>
+{
+  const auto decay = m_options.decay;
+
+  return purge_if([&](const entry& e) {
+    return (now - e.scheduled) >= decay;
+  });
+}
+
+auto msl::decommit_scheduler::purge_all()
+  -> uquantity<page>
+{
+  return purge_if([](const entry&) {
+    return true;
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::decommit_scheduler::is_scheduled(std::size_t n)
+  const noexcept -> bool
+{
+  auto it = m_scheduled.upper_bound(n);
+  if (it == m_scheduled.begin()) {
+    return false;
+  }
+  it = std::prev(it);
+
+  return n < (it->first + it->second.count);
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::decommit_scheduler::unschedule(std::size_t first, std::size_t last)
+  -> void
+{
+  auto it = m_scheduled.lower_bound(first);
+
+  // The run before 'first' may extend into the range
+  if (it != m_scheduled.begin()) {
+    const auto previous = std::prev(it);
+    if (previous->first + previous->second.count > first) {
+      it = previous;
+    }
+  }
+
+  while (it != m_scheduled.end() && it->first < last) {
+    const auto start = it->first;
+    const auto end = start + it->second.count;
+    const auto scheduled = it->second.scheduled;
+
+    it = m_scheduled.erase(it);
+    m_scheduled_pages -= (end - start);
+
+    if (start < first) {
+      m_scheduled.emplace(start, entry{first - start, scheduled});
+      m_scheduled_pages += (first - start);
+    }
+    if (end > last) {
+      // Runs never overlap, so this must be the final run in the range
+      m_scheduled.emplace(last, entry{end - last, scheduled});
+      m_scheduled_pages += (end - last);
+      break;
+    }
+  }
+}
+
+template <typename Predicate>
+auto msl::decommit_scheduler::purge_if(Predicate predicate)
+  -> uquantity<page>
+{
+  const auto policy = m_options.policy;
+  auto purged = std::size_t{0u};
+
+  // The entries of the current run of pages to be decommitted, as
+  // [run, end), which cover the pages [run->first, last). Adjacent runs are
+  // always adjacent entries, since runs never overlap.
+  auto run = m_scheduled.end();
+  auto last = std::size_t{0u};
+
+  // Entries are only erased once their pages have been decommitted, so that
+  // the runs remain scheduled if decommitting fails
+  const auto flush = [&](std::map<std::size_t, entry>::iterator end) {
+    if (run == m_scheduled.end()) {
+      return;
+    }
+    const auto first = run->first;
+    m_memory->decommit(first, uquantity<page>{last - first}, policy);
+    purged += (last - first);
+    m_scheduled_pages -= (last - first);
+    m_scheduled.erase(run, end);
+    run = m_scheduled.end();
+  };
+
+  for (auto it = m_scheduled.begin(); it != m_scheduled.end(); ++it) {
+    if (!predicate(it->second)) {
+      flush(it);
+      continue;
+    }
+    if (it->first != last) {
+      flush(it);
+    }
+    if (run == m_scheduled.end()) {
+      run = it;
+    }
+    last = it->first + it->second.count;
+  }
+  flush(m_scheduled.end());
+
+  return uquantity<page>{purged};
+}
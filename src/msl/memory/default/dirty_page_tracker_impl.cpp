@@ -0,0 +1,60 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/dirty_page_tracker.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <stdexcept>
+
+namespace msl {
+  namespace {
+    class not_implemented : public std::runtime_error
+    {
+    public:
+      using runtime_error::runtime_error;
+    };
+  } // namespace <anonymous>
+} // namespace msl
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::detail::dirty_tracking_supported(virtual_memory::dirty_tracking mechanism)
+  noexcept -> bool
+{
+  intrinsics::suppress_unused(mechanism);
+
+  return false;
+}
+
+auto msl::detail::make_dirty_page_tracker(not_null<std::byte*> memory,
+                                          std::size_t pages,
+                                          bytes page_size,
+                                          virtual_memory::dirty_tracking mechanism)
+  -> std::unique_ptr<dirty_page_tracker>
+{
+  intrinsics::suppress_unused(memory, pages, page_size, mechanism);
+
+  throw not_implemented{"make_dirty_page_tracker not implemented for target system"};
+}
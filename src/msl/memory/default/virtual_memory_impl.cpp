@@ -46,40 +46,166 @@ auto msl::virtual_memory_page_size()
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_reserve(std::size_t n)
+auto msl::virtual_memory_reserve(bytes size,
+                                 bytes align,
+                                 virtual_memory::page_mode mode)
   -> not_null<std::byte*>
 {
-  intrinsics::suppress_unused(n);
+  intrinsics::suppress_unused(size, align, mode);
 
   throw not_implemented{"virtual_memory_reserve not implemented for target system"};
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_commit(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_commit(not_null<std::byte*> memory, bytes size)
   -> not_null<std::byte*>
 {
-  intrinsics::suppress_unused(memory, n);
+  intrinsics::suppress_unused(memory, size);
 
   throw not_implemented{"virtual_memory_commit not implemented for target system"};
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_decommit(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_populate(not_null<std::byte*> memory, bytes size)
+  -> bool
+{
+  intrinsics::suppress_unused(memory, size);
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_decommit(not_null<std::byte*> memory,
+                                  bytes size,
+                                  virtual_memory::decommit_policy policy)
   -> void
 {
-  intrinsics::suppress_unused(memory, n);
+  intrinsics::suppress_unused(memory, size, policy);
 
   throw not_implemented{"virtual_memory_decommit not implemented for target system"};
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_release(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_protect(not_null<std::byte*> memory,
+                                 bytes size,
+                                 virtual_memory::page_access access)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size, access);
+
+  throw not_implemented{"virtual_memory_protect not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_lock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size);
+
+  throw not_implemented{"virtual_memory_lock not implemented for target system"};
+}
+
+auto msl::virtual_memory_unlock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size);
+
+  throw not_implemented{"virtual_memory_unlock not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_advise(not_null<std::byte*> memory,
+                                bytes size,
+                                virtual_memory::page_temperature temperature)
+  noexcept -> bool
+{
+  intrinsics::suppress_unused(memory, size, temperature);
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_set_fork_policy(not_null<std::byte*> memory,
+                                         bytes size,
+                                         virtual_memory::fork_policy policy)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size, policy);
+
+  throw not_implemented{"virtual_memory_set_fork_policy not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_extend(not_null<std::byte*> memory,
+                                bytes old_size,
+                                bytes new_size,
+                                virtual_memory::page_mode mode)
+  -> bool
+{
+  intrinsics::suppress_unused(memory, old_size, new_size, mode);
+
+  throw not_implemented{"virtual_memory_extend not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_relocate(not_null<std::byte*> memory,
+                                  bytes old_size,
+                                  bytes new_size,
+                                  virtual_memory::page_mode mode)
+  -> std::byte*
+{
+  intrinsics::suppress_unused(memory, old_size, new_size, mode);
+
+  throw not_implemented{"virtual_memory_relocate not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_map_mirrored(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size);
+
+  throw not_implemented{"virtual_memory_map_mirrored not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_resident(not_null<std::byte*> memory,
+                                  bytes size,
+                                  bytes page_size)
+  -> std::size_t
+{
+  intrinsics::suppress_unused(memory, size, page_size);
+
+  throw not_implemented{"virtual_memory_resident not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_huge_pages(not_null<std::byte*> memory, bytes size)
+  -> virtual_memory::huge_page_report
+{
+  intrinsics::suppress_unused(memory, size);
+
+  throw not_implemented{"virtual_memory_huge_pages not implemented for target system"};
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_release(not_null<std::byte*> memory, bytes size)
   -> void
 {
-  intrinsics::suppress_unused(memory, n);
+  intrinsics::suppress_unused(memory, size);
 
   throw not_implemented{"virtual_memory_release not implemented for target system"};
 }
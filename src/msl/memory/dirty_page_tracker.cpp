@@ -0,0 +1,154 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "src/msl/memory/dirty_page_tracker.hpp"
+
+#include <algorithm> // std::min, std::fill
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::detail::dirty_page_tracker::dirty_page_tracker()
+  noexcept
+  : m_pending{},
+    m_tracked{}
+{
+
+}
+
+msl::detail::dirty_page_tracker::~dirty_page_tracker() = default;
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::detail::dirty_page_tracker::dirty_pages()
+  -> bitmap
+{
+  auto result = m_pending;
+  collect(m_tracked, result);
+
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+auto msl::detail::dirty_page_tracker::start(const bitmap& committed)
+  -> void
+{
+  m_pending.assign(committed.size(), 0u);
+  m_tracked = committed;
+
+  rearm(m_tracked);
+}
+
+auto msl::detail::dirty_page_tracker::checkpoint()
+  -> bitmap
+{
+  auto result = dirty_pages();
+
+  rearm(m_tracked);
+  std::fill(m_pending.begin(), m_pending.end(), 0u);
+
+  return result;
+}
+
+auto msl::detail::dirty_page_tracker::on_commit(std::size_t first,
+                                                std::size_t count)
+  noexcept -> void
+{
+  untrack(first, count);
+
+  // Newly committed pages are zero-filled, which is a change to any snapshot
+  // that recorded their prior contents.
+  set_bits(m_pending, first, count, true);
+  set_bits(m_tracked, first, count, true);
+}
+
+auto msl::detail::dirty_page_tracker::on_decommit(std::size_t first,
+                                                  std::size_t count)
+  noexcept -> void
+{
+  untrack(first, count);
+
+  set_bits(m_pending, first, count, false);
+  set_bits(m_tracked, first, count, false);
+}
+
+auto msl::detail::dirty_page_tracker::on_protect(std::size_t first,
+                                                 std::size_t count,
+                                                 virtual_memory::page_access access)
+  noexcept -> void
+{
+  // Writes made before the protection changed can no longer be detected, so
+  // the pages are treated as written. Only writable pages may be written
+  // again, and so only those remain tracked at the next checkpoint.
+  untrack(first, count);
+
+  set_bits(m_pending, first, count, true);
+  set_bits(m_tracked, first, count, access == virtual_memory::page_access::read_write);
+}
+
+auto msl::detail::dirty_page_tracker::on_resize(not_null<std::byte*> memory,
+                                                std::size_t pages)
+  -> void
+{
+  const auto words = (pages + 63u) / 64u;
+  m_pending.resize(words, 0u);
+  m_tracked.resize(words, 0u);
+
+  relocate(memory, pages);
+}
+
+//-----------------------------------------------------------------------------
+// Bitmap Utilities
+//-----------------------------------------------------------------------------
+
+auto msl::detail::set_bits(std::vector<std::uint64_t>& bitmap,
+                           std::size_t first,
+                           std::size_t count,
+                           bool value)
+  noexcept -> void
+{
+  const auto last = first + count;
+
+  for (auto n = first; n < last;) {
+    const auto word = n / 64u;
+    const auto offset = n % 64u;
+    const auto bits = std::min<std::size_t>(64u - offset, last - n);
+    const auto mask = (bits == 64u)
+      ? ~std::uint64_t{0u}
+      : (((std::uint64_t{1u} << bits) - 1u) << offset);
+
+    if (value) {
+      bitmap[word] |= mask;
+    } else {
+      bitmap[word] &= ~mask;
+    }
+    n += bits;
+  }
+}
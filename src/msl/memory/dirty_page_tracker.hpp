@@ -0,0 +1,244 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_DIRTY_PAGE_TRACKER_HPP
+#define SRC_MSL_MEMORY_DIRTY_PAGE_TRACKER_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/memory/virtual_memory.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/quantities/quantity.hpp"
+#include "msl/pointers/not_null.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The base of the platform-specific trackers of the pages of a
+  ///        reservation that have been written since the last checkpoint
+  ///
+  /// The owning `virtual_memory` notifies the tracker whenever it commits,
+  /// decommits or reprotects pages, since each of these interferes with how
+  /// writes are detected. Such pages are conservatively treated as written.
+  /////////////////////////////////////////////////////////////////////////////
+  class dirty_page_tracker
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    using bitmap = std::vector<std::uint64_t>;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    dirty_page_tracker() noexcept;
+
+    dirty_page_tracker(const dirty_page_tracker&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    virtual ~dirty_page_tracker();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const dirty_page_tracker&) -> dirty_page_tracker& = delete;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the mechanism used by this tracker
+    ///
+    /// \return the mechanism
+    virtual auto mechanism() const noexcept -> virtual_memory::dirty_tracking = 0;
+
+    /// \brief Gets the pages written since the last checkpoint
+    ///
+    /// \return a bitmap of the written pages
+    auto dirty_pages() -> bitmap;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Establishes the first checkpoint, tracking writes to the
+    ///        \p committed pages
+    ///
+    /// \param committed the bitmap of committed pages
+    auto start(const bitmap& committed) -> void;
+
+    /// \brief Gets the pages written since the last checkpoint, and
+    ///        establishes a new checkpoint
+    ///
+    /// \return a bitmap of the written pages
+    auto checkpoint() -> bitmap;
+
+    /// \brief Notifies the tracker that \p count pages starting at \p first
+    ///        have been committed and are writable
+    auto on_commit(std::size_t first, std::size_t count) noexcept -> void;
+
+    /// \brief Notifies the tracker that \p count pages starting at \p first
+    ///        have been decommitted
+    auto on_decommit(std::size_t first, std::size_t count) noexcept -> void;
+
+    /// \brief Notifies the tracker that \p count pages starting at \p first
+    ///        have been given the \p access access
+    auto on_protect(std::size_t first,
+                    std::size_t count,
+                    virtual_memory::page_access access) noexcept -> void;
+
+    /// \brief Notifies the tracker that the reservation now spans \p pages
+    ///        pages at \p memory
+    ///
+    /// \param memory the start of the reservation
+    /// \param pages the number of pages in the reservation
+    auto on_resize(not_null<std::byte*> memory, std::size_t pages) -> void;
+
+    //-------------------------------------------------------------------------
+    // Protected Hooks
+    //-------------------------------------------------------------------------
+  protected:
+
+    /// \brief Adds the \p tracked pages that the system reports as written
+    ///        since the last call to `rearm` to \p dirty
+    ///
+    /// \param tracked the bitmap of pages whose writes are tracked
+    /// \param dirty the bitmap of written pages to add to
+    virtual auto collect(const bitmap& tracked, bitmap& dirty) -> void = 0;
+
+    /// \brief Begins a new interval of tracking writes to the \p tracked pages
+    ///
+    /// \param tracked the bitmap of pages whose writes are tracked
+    virtual auto rearm(const bitmap& tracked) -> void = 0;
+
+    /// \brief Stops tracking writes to \p count pages starting at \p first,
+    ///        whose protection has been changed by the owner
+    virtual auto untrack(std::size_t first, std::size_t count) noexcept -> void = 0;
+
+    /// \brief Moves the tracking to a reservation of \p pages pages at
+    ///        \p memory
+    virtual auto relocate(not_null<std::byte*> memory, std::size_t pages) -> void = 0;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    // The pages known to be written without asking the system
+    bitmap m_pending;
+
+    // The committed, writable pages whose writes the system tracks
+    bitmap m_tracked;
+  };
+
+  //---------------------------------------------------------------------------
+  // Bitmap Utilities
+  //---------------------------------------------------------------------------
+
+  /// \brief Sets \p count bits starting at \p first in \p bitmap to \p value
+  ///
+  /// \param bitmap the bitmap to modify
+  /// \param first the first bit
+  /// \param count the number of bits
+  /// \param value the value to set the bits to
+  auto set_bits(std::vector<std::uint64_t>& bitmap,
+                std::size_t first,
+                std::size_t count,
+                bool value) noexcept -> void;
+
+  /// \brief Invokes \p fn with the first bit and length of each run of set
+  ///        bits in \p bitmap
+  ///
+  /// \param bitmap the bitmap to scan
+  /// \param fn the function to invoke, as `fn(first, count)`
+  template <typename Fn>
+  auto for_each_run(const std::vector<std::uint64_t>& bitmap, Fn&& fn) -> void;
+
+  //---------------------------------------------------------------------------
+  // Platform Functions
+  //---------------------------------------------------------------------------
+
+  /// \brief Queries whether \p mechanism is supported on this system
+  ///
+  /// \param mechanism the mechanism to query
+  /// \return `true` if \p mechanism may be used
+  auto dirty_tracking_supported(virtual_memory::dirty_tracking mechanism) noexcept -> bool;
+
+  /// \brief Makes a tracker of the \p pages pages of \p page_size bytes at
+  ///        \p memory, using the \p mechanism mechanism
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory the start of the reservation
+  /// \param pages the number of pages in the reservation
+  /// \param page_size the size of each page
+  /// \param mechanism the mechanism to use
+  /// \return the tracker
+  auto make_dirty_page_tracker(not_null<std::byte*> memory,
+                               std::size_t pages,
+                               bytes page_size,
+                               virtual_memory::dirty_tracking mechanism)
+    -> std::unique_ptr<dirty_page_tracker>;
+
+} // namespace msl::detail
+
+template <typename Fn>
+auto msl::detail::for_each_run(const std::vector<std::uint64_t>& bitmap, Fn&& fn)
+  -> void
+{
+  const auto bits = bitmap.size() * 64u;
+
+  auto n = std::size_t{0u};
+  while (n < bits) {
+    // Skip whole words of unset bits at once
+    if ((n % 64u) == 0u && bitmap[n / 64u] == 0u) {
+      n += 64u;
+      continue;
+    }
+    if (((bitmap[n / 64u] >> (n % 64u)) & 1u) == 0u) {
+      ++n;
+      continue;
+    }
+    const auto first = n;
+    while (n < bits && ((bitmap[n / 64u] >> (n % 64u)) & 1u) != 0u) {
+      ++n;
+    }
+    fn(first, n - first);
+  }
+}
+
+#endif /* SRC_MSL_MEMORY_DIRTY_PAGE_TRACKER_HPP */
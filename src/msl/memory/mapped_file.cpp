@@ -0,0 +1,238 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/mapped_file.hpp"
+
+#include "src/msl/memory/mapped_file_impl.hpp"
+
+#include <algorithm> // std::clamp
+#include <cstring>   // std::memset
+#include <stdexcept> // std::length_error
+#include <utility>   // std::move, std::exchange
+
+//-----------------------------------------------------------------------------
+// Static Functions
+//-----------------------------------------------------------------------------
+
+auto msl::mapped_file::open(const std::filesystem::path& path,
+                            uquantity<page> capacity,
+                            sharing_mode mode)
+  -> mapped_file
+{
+  auto memory = virtual_memory::reserve(capacity);
+  auto result = mapped_file{
+    std::move(memory),
+    mapped_file_open(path, mode),
+    mode
+  };
+
+  // Mapping the existing contents is the same as growing from an empty file,
+  // except that the file itself is already the correct size.
+  const auto size = mapped_file_size(result.m_file);
+  if (size > result.m_memory.size_in_bytes()) MSL_UNLIKELY {
+    throw std::length_error{
+      "mapped_file::open: file is larger than the requested capacity"
+    };
+  }
+  const auto pages = result.pages_for(size);
+  if (pages != 0u) {
+    const auto p = assume_not_null(result.data());
+
+    mapped_file_map(p, result.page_size() * pages, result.m_file, bytes::zero(), mode);
+  }
+  result.m_size = size;
+
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::mapped_file::mapped_file(mapped_file&& other)
+  noexcept
+  : m_memory{std::move(other.m_memory)},
+    m_file{std::exchange(other.m_file, -1)},
+    m_size{std::exchange(other.m_size, bytes::zero())},
+    m_mode{other.m_mode}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+
+msl::mapped_file::~mapped_file()
+{
+  // The reservation unmaps the file when it is released
+  if (m_file != -1) {
+    mapped_file_close(m_file);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::mapped_file::operator=(mapped_file&& other)
+  noexcept -> mapped_file&
+{
+  auto copy = std::move(other);
+
+  using std::swap;
+  swap(m_memory, copy.m_memory);
+  swap(m_file, copy.m_file);
+  swap(m_size, copy.m_size);
+  swap(m_mode, copy.m_mode);
+
+  return (*this);
+}
+
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+auto msl::mapped_file::resize(bytes size)
+  -> void
+{
+  if (size > m_memory.size_in_bytes()) MSL_UNLIKELY {
+    throw std::length_error{
+      "mapped_file::resize: size exceeds the capacity of the mapping"
+    };
+  }
+
+  const auto old_pages = pages_for(m_size);
+  const auto new_pages = pages_for(size);
+  const auto page_bytes = page_size();
+
+  // Only a shared mapping may change the file; a private copy would otherwise
+  // destroy data on disk that the caller chose not to modify
+  if (m_mode != sharing_mode::shared) {
+    if (new_pages > old_pages) {
+      map_without_resizing(old_pages, new_pages);
+    } else if (new_pages < old_pages) {
+      const auto p = assume_not_null(data()) + (page_bytes * new_pages).count();
+
+      mapped_file_unmap(p, page_bytes * (old_pages - new_pages));
+    }
+    // Bytes past the end must read as zero if the mapping is grown again
+    if (m_mode == sharing_mode::private_copy && size < m_size) {
+      const auto end = page_bytes * new_pages;
+      std::memset(data() + size.count(), 0, (end - size).count());
+    }
+    m_size = size;
+    return;
+  }
+
+  if (new_pages > old_pages) {
+    const auto offset = page_bytes * old_pages;
+    const auto p = assume_not_null(data()) + offset.count();
+
+    // The file must be extended before the new pages are mapped, otherwise
+    // accessing them would fault.
+    mapped_file_resize(m_file, size);
+    mapped_file_map(p, page_bytes * (new_pages - old_pages), m_file, offset, m_mode);
+  } else {
+    if (new_pages < old_pages) {
+      const auto p = assume_not_null(data()) + (page_bytes * new_pages).count();
+
+      mapped_file_unmap(p, page_bytes * (old_pages - new_pages));
+    }
+    mapped_file_resize(m_file, size);
+  }
+  m_size = size;
+}
+
+auto msl::mapped_file::sync(sync_mode sync)
+  -> void
+{
+  if (m_size == bytes::zero()) {
+    return;
+  }
+  mapped_file_sync(assume_not_null(data()), page_size() * pages().count(), sync);
+}
+
+auto msl::mapped_file::sync(memory_block block, sync_mode sync)
+  -> void
+{
+  MSL_ASSERT((block.start_address().get() - data()) % page_size().count() == 0);
+  MSL_ASSERT(block.end_address().get() <= data() + (page_size() * pages().count()).count());
+
+  mapped_file_sync(block.start_address(), block.size(), sync);
+}
+
+auto msl::mapped_file::advise(access_pattern pattern)
+  noexcept -> void
+{
+  if (m_size == bytes::zero()) {
+    return;
+  }
+  mapped_file_advise(assume_not_null(data()), page_size() * pages().count(), pattern);
+}
+
+auto msl::mapped_file::advise(memory_block block, access_pattern pattern)
+  noexcept -> void
+{
+  MSL_ASSERT((block.start_address().get() - data()) % page_size().count() == 0);
+
+  mapped_file_advise(block.start_address(), block.size(), pattern);
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::mapped_file::map_without_resizing(std::size_t first, std::size_t last)
+  -> void
+{
+  const auto page_bytes = page_size();
+
+  // Pages past the end of the file would fault when accessed, so only the
+  // pages that the file spans are mapped from it
+  const auto file_pages = std::clamp(pages_for(mapped_file_size(m_file)), first, last);
+  if (file_pages > first) {
+    const auto offset = page_bytes * first;
+    const auto p = assume_not_null(data()) + offset.count();
+
+    mapped_file_map(p, page_bytes * (file_pages - first), m_file, offset, m_mode);
+  }
+  if (last > file_pages) {
+    const auto p = assume_not_null(data()) + (page_bytes * file_pages).count();
+
+    mapped_file_map_anonymous(p, page_bytes * (last - file_pages), m_mode);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Private Constructors
+//-----------------------------------------------------------------------------
+
+msl::mapped_file::mapped_file(virtual_memory memory,
+                              native_handle_type file,
+                              sharing_mode mode)
+  noexcept
+  : m_memory{std::move(memory)},
+    m_file{file},
+    m_size{bytes::zero()},
+    m_mode{mode}
+{
+
+}
@@ -0,0 +1,149 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_MAPPED_FILE_IMPL_HPP
+#define SRC_MSL_MEMORY_MAPPED_FILE_IMPL_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/memory/mapped_file.hpp"
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/pointers/not_null.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace msl {
+
+  /// \brief Opens the file at \p path to be mapped with the sharing \p mode
+  ///
+  /// The file is only opened for writing if \p mode is
+  /// `sharing_mode::shared`, and is created if it does not exist unless
+  /// \p mode is `sharing_mode::read_only`.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param path the path to the file
+  /// \param mode how the file will be mapped
+  /// \return the native handle of the file
+  auto mapped_file_open(const std::filesystem::path& path,
+                        mapped_file::sharing_mode mode) -> std::intptr_t;
+
+  /// \brief Closes the file with the native handle \p file
+  ///
+  /// \param file the native handle of the file
+  auto mapped_file_close(std::intptr_t file) noexcept -> void;
+
+  /// \brief Gets the size of the file with the native handle \p file
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param file the native handle of the file
+  /// \return the size of the file
+  auto mapped_file_size(std::intptr_t file) -> bytes;
+
+  /// \brief Truncates or extends the file with the native handle \p file to
+  ///        \p size bytes
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param file the native handle of the file
+  /// \param size the new size of the file
+  auto mapped_file_resize(std::intptr_t file, bytes size) -> void;
+
+  //--------------------------------------------------------------------------
+
+  /// \brief Maps \p size bytes of \p file, starting at \p offset, over the
+  ///        reservation at \p memory
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a reserved page
+  /// \param size The number of bytes to map; a multiple of the page size
+  /// \param file the native handle of the file
+  /// \param offset the offset into the file; a multiple of the page size
+  /// \param mode how writes to the mapping are shared
+  auto mapped_file_map(not_null<std::byte*> memory,
+                       bytes size,
+                       std::intptr_t file,
+                       bytes offset,
+                       mapped_file::sharing_mode mode) -> void;
+
+  /// \brief Maps \p size bytes of zeroed anonymous memory over the
+  ///        reservation at \p memory, with the access of the sharing \p mode
+  ///
+  /// This backs pages of a mapping that lie past the end of its file.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a reserved page
+  /// \param size The number of bytes to map; a multiple of the page size
+  /// \param mode how writes to the mapping are shared
+  auto mapped_file_map_anonymous(not_null<std::byte*> memory,
+                                 bytes size,
+                                 mapped_file::sharing_mode mode) -> void;
+
+  /// \brief Unmaps \p size bytes of a file mapped at \p memory, returning
+  ///        them to the reservation
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a mapped page
+  /// \param size The number of bytes to unmap; a multiple of the page size
+  auto mapped_file_unmap(not_null<std::byte*> memory, bytes size) -> void;
+
+  /// \brief Writes the modified pages in \p size bytes at \p memory back to
+  ///        the file that they map
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a mapped page
+  /// \param size The number of bytes to write back
+  /// \param mode whether to wait for the writes to complete
+  auto mapped_file_sync(not_null<std::byte*> memory,
+                        bytes size,
+                        mapped_file::sync_mode mode) -> void;
+
+  /// \brief Advises the system of the expected access \p pattern of \p size
+  ///        bytes at \p memory
+  ///
+  /// \param memory Memory pointing to a mapped page
+  /// \param size The number of bytes being advised on
+  /// \param pattern the expected access pattern
+  auto mapped_file_advise(not_null<std::byte*> memory,
+                          bytes size,
+                          mapped_file::access_pattern pattern) noexcept -> void;
+
+} // namespace msl
+
+#endif /* SRC_MSL_MEMORY_MAPPED_FILE_IMPL_HPP */
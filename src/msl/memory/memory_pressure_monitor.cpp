@@ -0,0 +1,252 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/memory_pressure_monitor.hpp"
+
+#include <algorithm>   // std::min
+#include <charconv>    // std::from_chars
+#include <fstream>     // std::ifstream
+#include <string>      // std::string, std::getline
+#include <string_view> // std::string_view
+#include <utility>     // std::move
+#include <vector>      // std::vector
+
+namespace msl {
+namespace {
+
+  /// \brief Reads a cgroup memory value from the file at \p path
+  ///
+  /// \param path the path to the file to read
+  /// \return the value in bytes, or nullopt if the file could not be read or
+  ///         holds "max", meaning no limit
+  auto read_memory_value(const std::filesystem::path& path)
+    -> std::optional<bytes>
+  {
+    auto file = std::ifstream{path};
+    auto value = std::string{};
+    if (!(file >> value)) {
+      return std::nullopt;
+    }
+
+    auto result = std::size_t{};
+    const auto* const end = value.data() + value.size();
+    const auto [p, ec] = std::from_chars(value.data(), end, result);
+    if (ec != std::errc{} || p != end) {
+      return std::nullopt;
+    }
+    return bytes{result};
+  }
+
+  /// \brief Reads the `avg10` field of the \p kind line of the pressure stall
+  ///        information at \p path
+  ///
+  /// The lines of the file have the form
+  /// `some avg10=0.00 avg60=0.00 avg300=0.00 total=0`.
+  ///
+  /// \param path the path to the pressure stall information
+  /// \param kind the kind of stall, either "some" or "full"
+  /// \return the stall percentage, or nullopt if it could not be read
+  auto read_pressure_avg10(const std::filesystem::path& path,
+                           std::string_view kind)
+    -> std::optional<double>
+  {
+    if (path.empty()) {
+      return std::nullopt;
+    }
+    auto file = std::ifstream{path};
+    auto name = std::string{};
+    auto field = std::string{};
+    while (file >> name) {
+      std::getline(file, field);
+      if (name != kind) {
+        continue;
+      }
+      constexpr auto key = std::string_view{"avg10="};
+      const auto start = field.find(key);
+      if (start == std::string::npos) {
+        return std::nullopt;
+      }
+      auto result = 0.0;
+      const auto* const first = field.data() + start + key.size();
+      const auto* const last = field.data() + field.size();
+      if (std::from_chars(first, last, result).ec != std::errc{}) {
+        return std::nullopt;
+      }
+      return result;
+    }
+    return std::nullopt;
+  }
+
+  /// \brief Checks whether \p value has reached \p limit
+  ///
+  /// \param value the value to check, if known
+  /// \param limit the limit to check against, if any
+  /// \return true if both are known and \p value has reached \p limit
+  auto reaches(std::optional<double> value, std::optional<double> limit)
+    noexcept -> bool
+  {
+    return value.has_value() && limit.has_value() && *value >= *limit;
+  }
+
+  /// \brief Checks whether \p snapshot crosses any condition of \p limit
+  auto crosses(const memory_pressure_monitor::snapshot& snapshot,
+               const memory_pressure_monitor::threshold& limit)
+    noexcept -> bool
+  {
+    return reaches(snapshot.usage_ratio(), limit.usage_ratio)
+      || reaches(snapshot.some_avg10, limit.some_avg10)
+      || reaches(snapshot.full_avg10, limit.full_avg10);
+  }
+
+} // namespace
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Snapshot
+//-----------------------------------------------------------------------------
+
+auto msl::memory_pressure_monitor::snapshot::limit()
+  const noexcept -> std::optional<bytes>
+{
+  if (high.has_value() && max.has_value()) {
+    return std::min(*high, *max);
+  }
+  return high.has_value() ? high : max;
+}
+
+auto msl::memory_pressure_monitor::snapshot::usage_ratio()
+  const noexcept -> std::optional<double>
+{
+  const auto lowest = limit();
+  if (!current.has_value() || !lowest.has_value() || lowest->count() == 0u) {
+    return std::nullopt;
+  }
+  return static_cast<double>(current->count())
+    / static_cast<double>(lowest->count());
+}
+
+//-----------------------------------------------------------------------------
+// Static Functions
+//-----------------------------------------------------------------------------
+
+auto msl::memory_pressure_monitor::current_cgroup()
+  -> std::filesystem::path
+{
+  const auto root = std::filesystem::path{"/sys/fs/cgroup"};
+
+  // The unified (v2) hierarchy is the entry with hierarchy ID 0 and no
+  // controllers, e.g. "0::/user.slice/app.scope".
+  constexpr auto prefix = std::string_view{"0::/"};
+  auto file = std::ifstream{"/proc/self/cgroup"};
+  auto line = std::string{};
+  while (std::getline(file, line)) {
+    if (line.starts_with(prefix)) {
+      return root / line.substr(prefix.size());
+    }
+  }
+  return root;
+}
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::memory_pressure_monitor::memory_pressure_monitor()
+  : memory_pressure_monitor{current_cgroup()}
+{
+
+}
+
+msl::memory_pressure_monitor::memory_pressure_monitor(std::filesystem::path cgroup,
+                                                      std::filesystem::path psi)
+  : m_cgroup{std::move(cgroup)},
+    m_psi{std::move(psi)},
+    m_mutex{},
+    m_callbacks{},
+    m_next_id{0u}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Callbacks
+//-----------------------------------------------------------------------------
+
+auto msl::memory_pressure_monitor::add_callback(threshold limit,
+                                                callback_type callback)
+  -> callback_id
+{
+  auto lock = std::lock_guard{m_mutex};
+  const auto id = m_next_id++;
+  m_callbacks.emplace(id, registration{limit, std::move(callback), false});
+  return id;
+}
+
+auto msl::memory_pressure_monitor::remove_callback(callback_id id)
+  -> void
+{
+  auto lock = std::lock_guard{m_mutex};
+  m_callbacks.erase(id);
+}
+
+//-----------------------------------------------------------------------------
+// Monitoring
+//-----------------------------------------------------------------------------
+
+auto msl::memory_pressure_monitor::read()
+  const -> snapshot
+{
+  auto result = snapshot{};
+  result.current = read_memory_value(m_cgroup / "memory.current");
+  result.high = read_memory_value(m_cgroup / "memory.high");
+  result.max = read_memory_value(m_cgroup / "memory.max");
+  result.some_avg10 = read_pressure_avg10(m_psi, "some");
+  result.full_avg10 = read_pressure_avg10(m_psi, "full");
+  return result;
+}
+
+auto msl::memory_pressure_monitor::poll()
+  -> snapshot
+{
+  const auto result = read();
+
+  // Callbacks are copied out so that they may be invoked without the lock
+  // held, which allows them to add or remove callbacks themselves.
+  auto triggered = std::vector<callback_type>{};
+  {
+    auto lock = std::lock_guard{m_mutex};
+    for (auto& [id, entry] : m_callbacks) {
+      const auto crossed = crosses(result, entry.limit);
+      if (crossed && !entry.crossed) {
+        triggered.push_back(entry.callback);
+      }
+      entry.crossed = crossed;
+    }
+  }
+
+  for (const auto& callback : triggered) {
+    callback(result);
+  }
+  return result;
+}
@@ -0,0 +1,182 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/page_ager.hpp"
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::page_ager::page_ager(virtual_memory& memory, clock::time_point now)
+  : page_ager{memory, options{}, now}
+{
+
+}
+
+msl::page_ager::page_ager(virtual_memory& memory,
+                          options ager_options,
+                          clock::time_point now)
+  : m_memory{&memory},
+    m_options{ager_options},
+    m_last_access(memory.pages().count(), now),
+    m_temperatures(memory.pages().count(), page_temperature::warm),
+    m_last_sync{now}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Access Tracking
+//-----------------------------------------------------------------------------
+
+auto msl::page_ager::touch(std::size_t first,
+                           uquantity<page> count,
+                           clock::time_point now)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_memory->pages().count());
+
+  sync(now);
+
+  const auto last = first + count.count();
+  for (auto n = first; n < last; ++n) {
+    m_last_access[n] = now;
+    m_temperatures[n] = page_temperature::warm;
+  }
+}
+
+auto msl::page_ager::warm(std::size_t first,
+                          uquantity<page> count,
+                          clock::time_point now)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_memory->pages().count());
+
+  sync(now);
+
+  // Only runs of cooled pages need to be brought back
+  auto run = first;
+  const auto last = first + count.count();
+  const auto flush = [&](std::size_t end) {
+    if (run != end) {
+      m_memory->set_temperature(run, uquantity<page>{end - run}, page_temperature::warm);
+    }
+  };
+
+  for (auto n = first; n < last; ++n) {
+    if (m_temperatures[n] == page_temperature::warm) {
+      flush(n);
+      run = n + 1u;
+    }
+  }
+  flush(last);
+
+  touch(first, count, now);
+}
+
+//-----------------------------------------------------------------------------
+// Aging
+//-----------------------------------------------------------------------------
+
+auto msl::page_ager::age(clock::time_point now)
+  -> report
+{
+  sync(now);
+
+  auto result = report{uquantity<page>{0u}, uquantity<page>{0u}};
+
+  const auto target = [&](std::size_t n) {
+    const auto idle = now - m_last_access[n];
+    if (idle >= m_options.page_out_after) {
+      return page_temperature::paged_out;
+    }
+    if (idle >= m_options.cold_after) {
+      return page_temperature::cold;
+    }
+    return page_temperature::warm;
+  };
+
+  // The current run of pages to be cooled, as [first, last)
+  auto first = std::size_t{0u};
+  auto last = std::size_t{0u};
+  auto temperature = page_temperature::warm;
+
+  // Pages are only recorded as cooled once the system accepts the hint, so
+  // that rejected pages are retried by the next call
+  const auto flush = [&] {
+    if (first == last) {
+      return;
+    }
+    const auto count = uquantity<page>{last - first};
+    if (!m_memory->set_temperature(first, count, temperature)) {
+      return;
+    }
+    for (auto n = first; n < last; ++n) {
+      m_temperatures[n] = temperature;
+    }
+    if (temperature == page_temperature::paged_out) {
+      result.paged_out += count;
+    } else {
+      result.cooled += count;
+    }
+  };
+
+  const auto pages = m_temperatures.size();
+  for (auto n = std::size_t{0u}; n < pages; ++n) {
+    if (!m_memory->is_committed(n)) {
+      m_temperatures[n] = page_temperature::warm;
+      continue;
+    }
+    const auto t = target(n);
+
+    // Pages only ever cool here; they are warmed again by accesses
+    if (t <= m_temperatures[n]) {
+      continue;
+    }
+    if (n != last || t != temperature) {
+      flush();
+      first = n;
+      temperature = t;
+    }
+    last = n + 1u;
+  }
+  flush();
+
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::page_ager::sync(clock::time_point now)
+  -> void
+{
+  const auto pages = m_memory->pages().count();
+  if (pages > m_last_access.size()) {
+    m_last_access.resize(pages, now);
+    m_temperatures.resize(pages, page_temperature::warm);
+  }
+  m_last_sync = now;
+}
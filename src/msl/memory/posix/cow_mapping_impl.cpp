@@ -0,0 +1,611 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/cow_mapping.hpp"
+#include "src/msl/memory/posix/shared_memory.hpp"
+#include "src/msl/memory/posix/write_barrier.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/mman.h> // ::mmap, ::mprotect
+#include <algorithm>  // std::min
+#include <array>      // std::array
+#include <atomic>     // std::atomic, std::atomic_ref
+#include <cerrno>     // errno
+#include <cstring>    // std::memset
+#include <memory>     // std::shared_ptr, std::unique_ptr
+#include <system_error> // std::system_error
+#include <thread>     // std::this_thread::yield
+#include <fcntl.h>    // ::fallocate
+#include <unistd.h>   // ::pwrite, ::ftruncate, ::close
+
+namespace msl::detail {
+  namespace {
+
+    [[noreturn]]
+    auto throw_system_error(int error = errno) -> void
+    {
+      throw std::system_error{error, std::system_category()};
+    }
+
+    using atomic_bitmap = std::unique_ptr<std::atomic<std::uint64_t>[]>;
+
+    /// \brief Allocates a bitmap of \p pages pages, copying the bits of
+    ///        \p bits
+    auto make_atomic_bitmap(std::size_t pages, const std::vector<std::uint64_t>& bits)
+      -> atomic_bitmap
+    {
+      const auto words = (pages + 63u) / 64u;
+      auto result = std::make_unique<std::atomic<std::uint64_t>[]>(words);
+      for (auto i = std::size_t{0u}; i < std::min(words, bits.size()); ++i) {
+        result[i].store(bits[i], std::memory_order_relaxed);
+      }
+      return result;
+    }
+
+    /// \brief Invokes \p fn with the first page and length of each run of set
+    ///        bits in \p bits
+    template <typename Fn>
+    auto for_each_run(const std::vector<std::uint64_t>& bits, Fn&& fn) -> void
+    {
+      const auto end = bits.size() * 64u;
+      for (auto page = std::size_t{0u}; page < end;) {
+        if (((bits[page / 64u] >> (page % 64u)) & 1u) == 0u) {
+          ++page;
+          continue;
+        }
+        const auto first = page;
+        while (page < end && ((bits[page / 64u] >> (page % 64u)) & 1u) != 0u) {
+          ++page;
+        }
+        fn(first, page - first);
+      }
+    }
+
+    /// \brief Maps \p size bytes of \p fd at \p offset over \p memory
+    auto map_fixed(std::byte* memory,
+                   std::size_t size,
+                   int protection,
+                   int flags,
+                   int fd,
+                   std::size_t offset) -> void
+    {
+      const auto p = ::mmap(memory, size, protection, flags | MAP_FIXED, fd,
+                            static_cast<::off_t>(offset));
+      if (p == MAP_FAILED) MSL_UNLIKELY {
+        throw_system_error();
+      }
+    }
+
+    /// \brief Forces the kernel to give the calling process a private copy of
+    ///        the page containing \p p, without altering its contents
+    ///
+    /// An atomic no-op write neither clobbers, nor races with, concurrent
+    /// writes to the page.
+    auto touch_page(std::byte* p)
+      noexcept -> void
+    {
+      auto& b = reinterpret_cast<unsigned char&>(*p);
+      std::atomic_ref<unsigned char>{b}.fetch_add(0u, std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------
+    // Clone Registry
+    //-------------------------------------------------------------------------
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief The clones of a source
+    ///
+    /// This is shared between a source and its clones, so that either may
+    /// outlive the other. Slots are read from a signal handler, so every
+    /// field is atomic. A slot's mapping may only be changed while its
+    /// `data` is null and no handler is `busy` with it.
+    /////////////////////////////////////////////////////////////////////////
+    struct clone_registry
+    {
+      struct slot
+      {
+        std::atomic<bool> used;
+        std::atomic<std::byte*> data;
+        std::atomic<std::size_t> pages;
+        std::atomic<std::atomic<std::uint64_t>*> shared;
+        std::atomic<int> busy;
+      };
+
+      static constexpr auto max_clones = std::size_t{64u};
+
+      explicit clone_registry(std::size_t size) noexcept
+        : page_size{size},
+          slots{}
+      {
+
+      }
+
+      /// \brief Gives every clone that still shares \p page with the source
+      ///        a private copy of it
+      auto preserve(std::size_t page) noexcept -> void
+      {
+        const auto word = page / 64u;
+        const auto bit = std::uint64_t{1u} << (page % 64u);
+
+        for (auto& slot : slots) {
+          if (!slot.used.load(std::memory_order_acquire)) {
+            continue;
+          }
+          slot.busy.fetch_add(1);
+          const auto data = slot.data.load();
+          if (data != nullptr && page < slot.pages.load()) {
+            const auto shared = slot.shared.load();
+            if ((shared[word].fetch_and(~bit) & bit) != 0u) {
+              touch_page(data + page * page_size);
+            }
+          }
+          slot.busy.fetch_sub(1);
+        }
+      }
+
+      /// \brief Detaches the mapping of \p slot, waiting for any handler that
+      ///        is using it
+      auto detach(slot& s) noexcept -> void
+      {
+        s.data.store(nullptr);
+        while (s.busy.load() != 0) {
+          std::this_thread::yield();
+        }
+      }
+
+      /// \brief Attaches \p data, of \p pages pages, to the slot \p s
+      auto attach(slot& s,
+                  std::byte* data,
+                  std::size_t pages,
+                  std::atomic<std::uint64_t>* shared) noexcept -> void
+      {
+        s.pages.store(pages);
+        s.shared.store(shared);
+        s.data.store(data);
+      }
+
+      /// \brief Claims an unused slot
+      ///
+      /// \throw std::system_error if every slot is used
+      auto claim() -> slot&
+      {
+        for (auto& slot : slots) {
+          auto expected = false;
+          if (slot.used.compare_exchange_strong(expected, true)) {
+            return slot;
+          }
+        }
+        throw_system_error(EAGAIN);
+      }
+
+      std::size_t page_size;
+      std::array<slot, max_clones> slots;
+    };
+
+    //-------------------------------------------------------------------------
+    // Clone
+    //-------------------------------------------------------------------------
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief A clone, whose committed pages are private mappings of the
+    ///        source's shared memory object
+    /////////////////////////////////////////////////////////////////////////
+    class cow_clone final : public cow_mapping
+    {
+    public:
+
+      cow_clone(std::shared_ptr<clone_registry> registry,
+                std::byte* data,
+                std::size_t pages,
+                const bitmap& shared)
+        : m_registry{std::move(registry)},
+          m_slot{nullptr},
+          m_data{data},
+          m_pages{pages},
+          m_shared{make_atomic_bitmap(pages, shared)}
+      {
+        m_slot = &m_registry->claim();
+        m_registry->attach(*m_slot, m_data, m_pages, m_shared.get());
+      }
+
+      ~cow_clone() override
+      {
+        m_registry->detach(*m_slot);
+        m_slot->used.store(false, std::memory_order_release);
+      }
+
+      auto is_source()
+        const noexcept -> bool override
+      {
+        return false;
+      }
+
+      auto clone(const bitmap& committed)
+        -> clone_result override
+      {
+        // Only sources are ever cloned; a clone is made a source first
+        intrinsics::suppress_unused(committed);
+        intrinsics::unreachable();
+      }
+
+      auto privatize()
+        noexcept -> void override
+      {
+        detach(0u, m_pages, true);
+      }
+
+      auto commit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        // Shared pages are private mappings, so writing to them only ever
+        // copies them away from the source
+        const auto page_size = m_registry->page_size;
+        const auto p = m_data + first * page_size;
+        if (::mprotect(p, count * page_size, PROT_READ | PROT_WRITE) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+      }
+
+      auto decommit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        detach(first, count, false);
+
+        // Discarding a private page of a file mapping would reveal the
+        // source's current contents, so the pages are replaced with fresh
+        // anonymous memory instead
+        const auto page_size = m_registry->page_size;
+        map_fixed(m_data + first * page_size, count * page_size, PROT_NONE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0u);
+      }
+
+      auto protect(std::size_t first,
+                   std::size_t count,
+                   virtual_memory::page_access access)
+        -> void override
+      {
+        // Pages that cannot be written cannot be copied when the source is
+        // written later, so they are copied now
+        if (access != virtual_memory::page_access::read_write) {
+          detach(first, count, true);
+        }
+        const auto page_size = m_registry->page_size;
+        const auto protection = [&] {
+          switch (access) {
+            case virtual_memory::page_access::none: return PROT_NONE;
+            case virtual_memory::page_access::read: return PROT_READ;
+            case virtual_memory::page_access::read_write: return PROT_READ | PROT_WRITE;
+          }
+          intrinsics::unreachable();
+        }();
+        if (::mprotect(m_data + first * page_size, count * page_size, protection) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+      }
+
+      auto on_resize(not_null<std::byte*> memory, std::size_t pages)
+        -> void override
+      {
+        auto shared = std::make_unique<std::atomic<std::uint64_t>[]>((pages + 63u) / 64u);
+
+        m_registry->detach(*m_slot);
+        for (auto i = std::size_t{0u}; i < (m_pages + 63u) / 64u; ++i) {
+          shared[i].store(m_shared[i].load());
+        }
+        m_data = memory.get();
+        m_pages = pages;
+        m_shared = std::move(shared);
+        m_registry->attach(*m_slot, m_data, m_pages, m_shared.get());
+      }
+
+    private:
+
+      /// \brief Stops sharing \p count pages starting at \p first with the
+      ///        source, optionally taking a private copy of each first
+      auto detach(std::size_t first, std::size_t count, bool copy)
+        noexcept -> void
+      {
+        const auto last = std::min(first + count, m_pages);
+        for (auto page = first; page < last; ++page) {
+          const auto bit = std::uint64_t{1u} << (page % 64u);
+          const auto previous = m_shared[page / 64u].fetch_and(~bit);
+          if (copy && (previous & bit) != 0u) {
+            touch_page(m_data + page * m_registry->page_size);
+          }
+        }
+
+        // A handler may still be copying one of the pages
+        while (m_slot->busy.load() != 0) {
+          std::this_thread::yield();
+        }
+      }
+
+      std::shared_ptr<clone_registry> m_registry;
+      clone_registry::slot* m_slot;
+      std::byte* m_data;
+      std::size_t m_pages;
+
+      // The pages that are still shared with the source
+      atomic_bitmap m_shared;
+    };
+
+    //-------------------------------------------------------------------------
+    // Source
+    //-------------------------------------------------------------------------
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief A source, whose pages are shared mappings of a shared memory
+    ///        object
+    ///
+    /// Pages are write-protected whenever a clone is made, so that the first
+    /// write to each page gives every clone a private copy of it first.
+    /////////////////////////////////////////////////////////////////////////
+    class cow_source final : public cow_mapping
+    {
+    public:
+
+      cow_source(not_null<std::byte*> memory,
+                 std::size_t pages,
+                 bytes page_size,
+                 const bitmap& committed)
+        : m_data{memory.get()},
+          m_pages{pages},
+          m_page_size{page_size.count()},
+          m_fd{create_shared_memory(page_size * pages)},
+          m_writable{committed},
+          m_registry{std::make_shared<clone_registry>(m_page_size)},
+          m_barrier{m_data, pages, m_page_size, &on_write, this}
+      {
+        try {
+          for_each_run(committed, [&](std::size_t first, std::size_t count) {
+            write_pages(first, count);
+          });
+          map_fixed(m_data, m_pages * m_page_size, PROT_NONE, MAP_SHARED, m_fd, 0u);
+          for_each_run(committed, [&](std::size_t first, std::size_t count) {
+            const auto p = m_data + first * m_page_size;
+            if (::mprotect(p, count * m_page_size, PROT_READ | PROT_WRITE) != 0) MSL_UNLIKELY {
+              throw_system_error();
+            }
+          });
+        } catch (...) {
+          ::close(m_fd);
+          throw;
+        }
+      }
+
+      ~cow_source() override
+      {
+        ::close(m_fd);
+      }
+
+      auto is_source()
+        const noexcept -> bool override
+      {
+        return true;
+      }
+
+      auto clone(const bitmap& committed)
+        -> clone_result override
+      {
+        const auto size = m_pages * m_page_size;
+        const auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+        void* const p = ::mmap(nullptr, size, PROT_NONE, flags, -1, 0);
+        if (p == MAP_FAILED) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        const auto data = static_cast<std::byte*>(p);
+
+        auto mapping = std::unique_ptr<cow_mapping>{};
+        try {
+          for_each_run(committed, [&](std::size_t first, std::size_t count) {
+            const auto offset = first * m_page_size;
+            map_fixed(data + offset, count * m_page_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, m_fd, offset);
+          });
+          mapping = std::make_unique<cow_clone>(m_registry, data, m_pages, committed);
+
+          // Only writable pages are armed; other pages are copied to clones
+          // when their protection changes
+          auto armed = committed;
+          for (auto i = std::size_t{0u}; i < armed.size(); ++i) {
+            armed[i] &= m_writable[i];
+          }
+          m_barrier.arm(armed);
+        } catch (...) {
+          mapping.reset();
+          ::munmap(p, size);
+          throw;
+        }
+        return clone_result{assume_not_null(data), std::move(mapping)};
+      }
+
+      auto privatize()
+        noexcept -> void override
+      {
+
+      }
+
+      auto commit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        // Pages that are already committed may still be armed, and making
+        // them writable would let the source change them under its clones
+        preserve(first, count);
+
+        const auto p = m_data + first * m_page_size;
+        if (::mprotect(p, count * m_page_size, PROT_READ | PROT_WRITE) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        set_writable(first, count, true);
+      }
+
+      auto decommit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        preserve(first, count);
+
+        const auto offset = first * m_page_size;
+        const auto length = count * m_page_size;
+#if defined(__linux__)
+        const auto mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+        if (::fallocate(m_fd, mode, static_cast<::off_t>(offset), static_cast<::off_t>(length)) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+#else
+        // Without hole punching, the pages are zeroed so that they read as
+        // zero when they are committed again
+        if (::mprotect(m_data + offset, length, PROT_READ | PROT_WRITE) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        std::memset(m_data + offset, 0, length);
+#endif
+        if (::mprotect(m_data + offset, length, PROT_NONE) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        set_writable(first, count, false);
+      }
+
+      auto protect(std::size_t first,
+                   std::size_t count,
+                   virtual_memory::page_access access)
+        -> void override
+      {
+        preserve(first, count);
+
+        const auto protection = [&] {
+          switch (access) {
+            case virtual_memory::page_access::none: return PROT_NONE;
+            case virtual_memory::page_access::read: return PROT_READ;
+            case virtual_memory::page_access::read_write: return PROT_READ | PROT_WRITE;
+          }
+          intrinsics::unreachable();
+        }();
+        const auto p = m_data + first * m_page_size;
+        if (::mprotect(p, count * m_page_size, protection) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        set_writable(first, count, access == virtual_memory::page_access::read_write);
+      }
+
+      auto on_resize(not_null<std::byte*> memory, std::size_t pages)
+        -> void override
+      {
+        const auto old_size = m_pages * m_page_size;
+        const auto new_size = pages * m_page_size;
+
+        // The new pages are backed by the object as well, so that they may be
+        // shared with later clones
+        if (::ftruncate(m_fd, static_cast<::off_t>(new_size)) != 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        map_fixed(memory.get() + old_size, new_size - old_size, PROT_NONE,
+                  MAP_SHARED, m_fd, old_size);
+
+        m_barrier.relocate(memory.get(), pages);
+        m_writable.resize((pages + 63u) / 64u, 0u);
+        m_data = memory.get();
+        m_pages = pages;
+      }
+
+    private:
+
+      /// \brief Copies \p count pages starting at \p first into the object
+      auto write_pages(std::size_t first, std::size_t count) -> void
+      {
+        auto offset = first * m_page_size;
+        auto remaining = count * m_page_size;
+        while (remaining > 0u) {
+          const auto written = ::pwrite(m_fd, m_data + offset, remaining,
+                                        static_cast<::off_t>(offset));
+          if (written < 0) MSL_UNLIKELY {
+            if (errno == EINTR) {
+              continue;
+            }
+            throw_system_error();
+          }
+          offset += static_cast<std::size_t>(written);
+          remaining -= static_cast<std::size_t>(written);
+        }
+      }
+
+      /// \brief Gives every clone a private copy of \p count pages starting at
+      ///        \p first, before the source changes them
+      auto preserve(std::size_t first, std::size_t count) noexcept -> void
+      {
+        m_barrier.disarm(first, count, false);
+
+        const auto last = std::min(first + count, m_pages);
+        for (auto page = first; page < last; ++page) {
+          m_registry->preserve(page);
+        }
+      }
+
+      auto set_writable(std::size_t first, std::size_t count, bool writable)
+        noexcept -> void
+      {
+        const auto last = first + count;
+        for (auto page = first; page < last; ++page) {
+          const auto bit = std::uint64_t{1u} << (page % 64u);
+          if (writable) {
+            m_writable[page / 64u] |= bit;
+          } else {
+            m_writable[page / 64u] &= ~bit;
+          }
+        }
+      }
+
+      /// \brief Gives every clone a private copy of \p page before the first
+      ///        write to it
+      static auto on_write(void* context, std::size_t page)
+        noexcept -> void
+      {
+        static_cast<cow_source*>(context)->m_registry->preserve(page);
+      }
+
+      std::byte* m_data;
+      std::size_t m_pages;
+      std::size_t m_page_size;
+      int m_fd;
+
+      // The committed pages that are writable, which are armed when cloning
+      bitmap m_writable;
+
+      std::shared_ptr<clone_registry> m_registry;
+      write_barrier m_barrier;
+    };
+
+  } // namespace <anonymous>
+} // namespace msl::detail
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::detail::make_cow_source(not_null<std::byte*> memory,
+                                  std::size_t pages,
+                                  bytes page_size,
+                                  const std::vector<std::uint64_t>& committed)
+  -> std::unique_ptr<cow_mapping>
+{
+  return std::make_unique<cow_source>(memory, pages, page_size, committed);
+}
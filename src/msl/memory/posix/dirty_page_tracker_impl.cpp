@@ -0,0 +1,404 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/dirty_page_tracker.hpp"
+#include "src/msl/memory/posix/write_barrier.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/mman.h> // ::mmap, ::munmap
+#include <algorithm>  // std::min
+#include <atomic>     // std::atomic
+#include <cerrno>     // errno
+#include <cstdint>    // std::uint64_t, std::uintptr_t
+#include <memory>     // std::unique_ptr, std::make_unique
+#include <mutex>      // std::mutex, std::lock_guard
+#include <system_error>
+#include <vector>     // std::vector
+#include <fcntl.h>    // ::open, O_RDONLY, O_WRONLY
+#include <unistd.h>   // ::pread, ::write, ::close, ::sysconf
+
+namespace msl::detail {
+  namespace {
+
+    [[noreturn]]
+    auto throw_system_error(int error = errno) -> void
+    {
+      throw std::system_error{error, std::system_category()};
+    }
+
+    /// \brief Gets the size of the pages in `/proc/self/pagemap`, which are
+    ///        always the base page size even for huge pages
+    auto base_page_size()
+      noexcept -> std::size_t
+    {
+      static const auto s_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+      return s_size;
+    }
+
+    /// \brief An owned file descriptor
+    class file_descriptor
+    {
+    public:
+      explicit file_descriptor(int fd) noexcept : m_fd{fd}{}
+      file_descriptor(const file_descriptor&) = delete;
+      ~file_descriptor() { if (m_fd >= 0) { ::close(m_fd); } }
+      auto operator=(const file_descriptor&) -> file_descriptor& = delete;
+
+      auto get() const noexcept -> int { return m_fd; }
+
+    private:
+      int m_fd;
+    };
+
+    //-------------------------------------------------------------------------
+    // Soft-Dirty
+    //-------------------------------------------------------------------------
+
+#if defined(__linux__)
+    // The soft-dirty bit of an entry in /proc/self/pagemap
+    constexpr auto soft_dirty_bit = std::uint64_t{1u} << 55u;
+
+    /// \brief Probes whether the kernel supports soft-dirty bits
+    ///
+    /// New mappings are always soft-dirty on kernels that support it, so a
+    /// freshly written page is checked for the bit.
+    auto probe_soft_dirty()
+      noexcept -> bool
+    {
+      if (::access("/proc/self/clear_refs", W_OK) != 0) {
+        return false;
+      }
+      const auto fd = file_descriptor{::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)};
+      if (fd.get() < 0) {
+        return false;
+      }
+
+      const auto size = base_page_size();
+      const auto protection = PROT_READ | PROT_WRITE;
+      void* const p = ::mmap(nullptr, size, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+        return false;
+      }
+      *static_cast<volatile unsigned char*>(p) = 1u;
+
+      auto entry = std::uint64_t{0u};
+      const auto offset = static_cast<off_t>(
+        (reinterpret_cast<std::uintptr_t>(p) / size) * sizeof(entry)
+      );
+      const auto read = ::pread(fd.get(), &entry, sizeof(entry), offset);
+      ::munmap(p, size);
+
+      return read == static_cast<::ssize_t>(sizeof(entry))
+        && (entry & soft_dirty_bit) != 0u;
+    }
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief A tracker that reads the soft-dirty bits of the page tables
+    ///
+    /// Clearing the soft-dirty bits applies to the whole process, so every
+    /// soft-dirty tracker is registered globally. Before clearing, the bits
+    /// of every other tracker are saved so that no writes are lost to them.
+    /////////////////////////////////////////////////////////////////////////
+    class soft_dirty_tracker final : public dirty_page_tracker
+    {
+    public:
+
+      soft_dirty_tracker(not_null<std::byte*> memory,
+                         std::size_t pages,
+                         bytes page_size)
+        : m_data{memory.get()},
+          m_page_size{page_size.count()},
+          m_pagemap{::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)},
+          m_saved((pages + 63u) / 64u, 0u),
+          m_scanned((pages + 63u) / 64u, 0u)
+      {
+        if (m_pagemap.get() < 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        auto lock = std::lock_guard{s_mutex};
+        s_trackers.push_back(this);
+      }
+
+      ~soft_dirty_tracker() override
+      {
+        auto lock = std::lock_guard{s_mutex};
+        std::erase(s_trackers, this);
+      }
+
+      auto mechanism()
+        const noexcept -> virtual_memory::dirty_tracking override
+      {
+        return virtual_memory::dirty_tracking::soft_dirty;
+      }
+
+    protected:
+
+      auto collect(const bitmap& tracked, bitmap& dirty)
+        -> void override
+      {
+        auto lock = std::lock_guard{s_mutex};
+
+        for (auto i = std::size_t{0u}; i < dirty.size(); ++i) {
+          dirty[i] |= m_saved[i];
+        }
+        read_soft_dirty(tracked, dirty);
+      }
+
+      auto rearm(const bitmap& tracked)
+        -> void override
+      {
+        auto lock = std::lock_guard{s_mutex};
+
+        for (auto* tracker : s_trackers) {
+          if (tracker != this) {
+            tracker->read_soft_dirty(tracker->m_scanned, tracker->m_saved);
+          }
+        }
+
+        const auto fd = file_descriptor{::open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC)};
+        if (fd.get() < 0) MSL_UNLIKELY {
+          throw_system_error();
+        }
+        // "4" clears only the soft-dirty bits, leaving the referenced bits
+        // that page reclaim relies on intact.
+        if (::write(fd.get(), "4", 1u) != 1) MSL_UNLIKELY {
+          throw_system_error();
+        }
+
+        std::fill(m_saved.begin(), m_saved.end(), 0u);
+        m_scanned = tracked;
+      }
+
+      auto untrack(std::size_t first, std::size_t count)
+        noexcept -> void override
+      {
+        auto lock = std::lock_guard{s_mutex};
+
+        set_bits(m_scanned, first, count, false);
+        set_bits(m_saved, first, count, false);
+      }
+
+      auto relocate(not_null<std::byte*> memory, std::size_t pages)
+        -> void override
+      {
+        auto lock = std::lock_guard{s_mutex};
+
+        m_data = memory.get();
+        m_saved.resize((pages + 63u) / 64u, 0u);
+        m_scanned.resize((pages + 63u) / 64u, 0u);
+      }
+
+    private:
+
+      /// \brief Adds the \p pages that are soft-dirty to \p dirty
+      ///
+      /// \pre `s_mutex` must be held
+      auto read_soft_dirty(const bitmap& pages, bitmap& dirty) -> void
+      {
+        const auto base = base_page_size();
+        const auto ratio = m_page_size / base;
+        const auto first_entry = reinterpret_cast<std::uintptr_t>(m_data) / base;
+
+        // Entries are read in chunks to bound the size of the buffer
+        constexpr auto chunk_entries = std::size_t{512u};
+        auto entries = std::vector<std::uint64_t>(chunk_entries);
+
+        for_each_run(pages, [&](std::size_t first, std::size_t count) {
+          auto entry = first * ratio;
+          const auto end = (first + count) * ratio;
+
+          while (entry < end) {
+            const auto n = std::min(chunk_entries, end - entry);
+            const auto offset = static_cast<off_t>((first_entry + entry) * sizeof(std::uint64_t));
+            const auto length = n * sizeof(std::uint64_t);
+            const auto read = ::pread(m_pagemap.get(), entries.data(), length, offset);
+            if (read != static_cast<::ssize_t>(length)) MSL_UNLIKELY {
+              throw_system_error((read < 0) ? errno : EIO);
+            }
+            for (auto i = std::size_t{0u}; i < n; ++i) {
+              if ((entries[i] & soft_dirty_bit) != 0u) {
+                const auto page = (entry + i) / ratio;
+                dirty[page / 64u] |= std::uint64_t{1u} << (page % 64u);
+              }
+            }
+            entry += n;
+          }
+        });
+      }
+
+      std::byte* m_data;
+      std::size_t m_page_size;
+      file_descriptor m_pagemap;
+
+      // Soft-dirty bits saved before another tracker cleared them
+      bitmap m_saved;
+
+      // The pages tracked at the last checkpoint, which are saved before
+      // another tracker clears the soft-dirty bits
+      bitmap m_scanned;
+
+      static inline std::mutex s_mutex{};
+      static inline std::vector<soft_dirty_tracker*> s_trackers{};
+    };
+#endif
+
+    //-------------------------------------------------------------------------
+    // Write-Protect
+    //-------------------------------------------------------------------------
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief A tracker that write-protects pages, and records the first
+    ///        write to each from the resulting fault
+    /////////////////////////////////////////////////////////////////////////
+    class write_protect_tracker final : public dirty_page_tracker
+    {
+    public:
+
+      write_protect_tracker(not_null<std::byte*> memory,
+                            std::size_t pages,
+                            bytes page_size)
+        : m_pages{pages},
+          m_written{std::make_unique<std::atomic<std::uint64_t>[]>((pages + 63u) / 64u)},
+          m_barrier{memory.get(), pages, page_size.count(), &on_write, this}
+      {
+
+      }
+
+      auto mechanism()
+        const noexcept -> virtual_memory::dirty_tracking override
+      {
+        return virtual_memory::dirty_tracking::write_protect;
+      }
+
+    protected:
+
+      auto collect(const bitmap& tracked, bitmap& dirty)
+        -> void override
+      {
+        intrinsics::suppress_unused(tracked);
+
+        for (auto i = std::size_t{0u}; i < dirty.size(); ++i) {
+          dirty[i] |= m_written[i].load(std::memory_order_acquire);
+        }
+      }
+
+      auto rearm(const bitmap& tracked)
+        -> void override
+      {
+        const auto words = (m_pages + 63u) / 64u;
+        for (auto i = std::size_t{0u}; i < words; ++i) {
+          m_written[i].store(0u, std::memory_order_relaxed);
+        }
+        m_barrier.arm(tracked);
+      }
+
+      auto untrack(std::size_t first, std::size_t count)
+        noexcept -> void override
+      {
+        m_barrier.disarm(first, count, false);
+
+        const auto last = first + count;
+        for (auto page = first; page < last; ++page) {
+          const auto bit = std::uint64_t{1u} << (page % 64u);
+          m_written[page / 64u].fetch_and(~bit, std::memory_order_release);
+        }
+      }
+
+      auto relocate(not_null<std::byte*> memory, std::size_t pages)
+        -> void override
+      {
+        const auto old_words = (m_pages + 63u) / 64u;
+        auto written = std::make_unique<std::atomic<std::uint64_t>[]>((pages + 63u) / 64u);
+        for (auto i = std::size_t{0u}; i < old_words; ++i) {
+          written[i].store(m_written[i].load());
+        }
+        m_written = std::move(written);
+        m_pages = pages;
+
+        m_barrier.relocate(memory.get(), pages);
+      }
+
+    private:
+
+      /// \brief Records the first write to \p page
+      static auto on_write(void* context, std::size_t page)
+        noexcept -> void
+      {
+        auto* const self = static_cast<write_protect_tracker*>(context);
+        const auto bit = std::uint64_t{1u} << (page % 64u);
+
+        self->m_written[page / 64u].fetch_or(bit, std::memory_order_acq_rel);
+      }
+
+      std::size_t m_pages;
+
+      // The pages written since the last checkpoint
+      std::unique_ptr<std::atomic<std::uint64_t>[]> m_written;
+
+      write_barrier m_barrier;
+    };
+
+  } // namespace <anonymous>
+} // namespace msl::detail
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::detail::dirty_tracking_supported(virtual_memory::dirty_tracking mechanism)
+  noexcept -> bool
+{
+  switch (mechanism) {
+    case virtual_memory::dirty_tracking::soft_dirty: {
+#if defined(__linux__)
+      static const auto s_supported = probe_soft_dirty();
+
+      return s_supported;
+#else
+      return false;
+#endif
+    }
+    case virtual_memory::dirty_tracking::write_protect: {
+      return true;
+    }
+  }
+  intrinsics::unreachable();
+}
+
+auto msl::detail::make_dirty_page_tracker(not_null<std::byte*> memory,
+                                          std::size_t pages,
+                                          bytes page_size,
+                                          virtual_memory::dirty_tracking mechanism)
+  -> std::unique_ptr<dirty_page_tracker>
+{
+  if (!dirty_tracking_supported(mechanism)) MSL_UNLIKELY {
+    throw_system_error(ENOTSUP);
+  }
+#if defined(__linux__)
+  if (mechanism == virtual_memory::dirty_tracking::soft_dirty) {
+    return std::make_unique<soft_dirty_tracker>(memory, pages, page_size);
+  }
+#endif
+  return std::make_unique<write_protect_tracker>(memory, pages, page_size);
+}
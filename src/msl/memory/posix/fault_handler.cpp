@@ -0,0 +1,215 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/posix/fault_handler.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <signal.h>   // ::sigaction
+#include <atomic>     // std::atomic
+#include <array>      // std::array
+#include <cerrno>     // errno
+#include <mutex>      // std::mutex, std::lock_guard
+#include <system_error>
+
+namespace msl {
+  namespace {
+
+    /// \brief A range of addresses whose faults are resolved by a callback
+    ///
+    /// Every field is atomic, since they are read from the signal handler.
+    /// The range is only considered once `active` is set, which is done last.
+    struct fault_range
+    {
+      std::atomic<std::byte*> first;
+      std::atomic<std::byte*> last;
+      std::atomic<fault_callback> callback;
+      std::atomic<void*> context;
+      std::atomic<bool> active;
+    };
+
+    constexpr auto ranges_per_block = std::size_t{64u};
+
+    /// \brief A fixed block of ranges, linked to the next block
+    ///
+    /// Blocks are appended when every range is in use, and are never freed,
+    /// since the signal handler may be reading them at any time; so the
+    /// number of ranges is only limited by memory.
+    struct fault_range_block
+    {
+      std::array<fault_range, ranges_per_block> ranges;
+      std::atomic<fault_range_block*> next;
+    };
+
+    fault_range_block g_ranges{};
+
+    // Guards registration and the installation of the signal handlers
+    std::mutex g_mutex{};
+
+    // The handlers that were installed before the first registration, which
+    // unresolved faults are forwarded to
+    struct ::sigaction g_previous_segv{};
+    struct ::sigaction g_previous_bus{};
+    bool g_installed = false;
+
+    /// \brief Finds the active range that contains \p address
+    ///
+    /// \return the range, or null if there is none
+    auto find_range(const std::byte* address) noexcept -> fault_range*
+    {
+      for (auto* block = &g_ranges; block != nullptr; block = block->next.load(std::memory_order_acquire)) {
+        for (auto& range : block->ranges) {
+          if (!range.active.load(std::memory_order_acquire)) {
+            continue;
+          }
+          const auto first = range.first.load(std::memory_order_relaxed);
+          const auto last = range.last.load(std::memory_order_relaxed);
+          if (address >= first && address < last) {
+            return &range;
+          }
+        }
+      }
+      return nullptr;
+    }
+
+    /// \brief Forwards the \p signal to the handler in \p previous
+    auto forward_signal(const struct ::sigaction& previous,
+                        int signal,
+                        ::siginfo_t* info,
+                        void* context) noexcept -> void
+    {
+      if ((previous.sa_flags & SA_SIGINFO) != 0) {
+        previous.sa_sigaction(signal, info, context);
+        return;
+      }
+      if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN) {
+        // Restoring the default action and returning re-executes the
+        // faulting instruction, which then terminates the process as normal.
+        struct ::sigaction action{};
+        action.sa_handler = SIG_DFL;
+        ::sigemptyset(&action.sa_mask);
+        ::sigaction(signal, &action, nullptr);
+        return;
+      }
+      previous.sa_handler(signal);
+    }
+
+    /// \brief Handles SIGSEGV and SIGBUS by dispatching to the callback of
+    ///        the registered range that contains the faulting address
+    auto handle_fault(int signal, ::siginfo_t* info, void* context)
+      noexcept -> void
+    {
+      const auto address = static_cast<std::byte*>(info->si_addr);
+
+      if (auto* const range = find_range(address); range != nullptr) {
+        const auto callback = range->callback.load(std::memory_order_relaxed);
+        if (callback(range->context.load(std::memory_order_relaxed), address)) {
+          return;
+        }
+      }
+
+      const auto& previous = (signal == SIGBUS) ? g_previous_bus : g_previous_segv;
+      forward_signal(previous, signal, info, context);
+    }
+
+    /// \brief Installs `handle_fault` for \p signal, unless it is already
+    ///        installed
+    ///
+    /// Only the handler replaced by the first installation is kept as the
+    /// previous handler. A handler that replaced this one since may forward
+    /// to it in turn, so forwarding to that handler could recurse forever.
+    ///
+    /// \param signal the signal to handle
+    /// \param previous the previous handler, if this is the first
+    ///        installation; otherwise null
+    auto install_handler(int signal, struct ::sigaction* previous) -> void
+    {
+      struct ::sigaction current{};
+      if (::sigaction(signal, nullptr, &current) != 0) MSL_UNLIKELY {
+        throw std::system_error{errno, std::system_category()};
+      }
+      if ((current.sa_flags & SA_SIGINFO) != 0 && current.sa_sigaction == &handle_fault) {
+        return;
+      }
+
+      struct ::sigaction action{};
+      action.sa_sigaction = &handle_fault;
+      action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+      ::sigemptyset(&action.sa_mask);
+      if (::sigaction(signal, &action, previous) != 0) MSL_UNLIKELY {
+        throw std::system_error{errno, std::system_category()};
+      }
+    }
+
+  } // namespace <anonymous>
+} // namespace msl
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::register_fault_handler(std::byte* first,
+                                 std::byte* last,
+                                 fault_callback callback,
+                                 void* context)
+  -> std::size_t
+{
+  auto lock = std::lock_guard{g_mutex};
+
+  install_handler(SIGSEGV, g_installed ? nullptr : &g_previous_segv);
+  install_handler(SIGBUS, g_installed ? nullptr : &g_previous_bus);
+  g_installed = true;
+
+  auto id = std::size_t{0u};
+  auto* block = &g_ranges;
+  while (true) {
+    for (auto& range : block->ranges) {
+      if (!range.active.load(std::memory_order_relaxed)) {
+        range.first.store(first, std::memory_order_relaxed);
+        range.last.store(last, std::memory_order_relaxed);
+        range.callback.store(callback, std::memory_order_relaxed);
+        range.context.store(context, std::memory_order_relaxed);
+        range.active.store(true, std::memory_order_release);
+        return id;
+      }
+      ++id;
+    }
+    auto* next = block->next.load(std::memory_order_relaxed);
+    if (next == nullptr) {
+      next = new fault_range_block{};
+      block->next.store(next, std::memory_order_release);
+    }
+    block = next;
+  }
+}
+
+auto msl::unregister_fault_handler(std::size_t id)
+  noexcept -> void
+{
+  auto lock = std::lock_guard{g_mutex};
+
+  auto* block = &g_ranges;
+  for (auto i = std::size_t{0u}; i < id / ranges_per_block; ++i) {
+    block = block->next.load(std::memory_order_relaxed);
+  }
+  block->ranges[id % ranges_per_block].active.store(false, std::memory_order_release);
+}
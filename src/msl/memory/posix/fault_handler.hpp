@@ -0,0 +1,77 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_POSIX_FAULT_HANDLER_HPP
+#define SRC_MSL_MEMORY_POSIX_FAULT_HANDLER_HPP
+
+#include <cstddef>
+
+namespace msl {
+
+  /// \brief A function that resolves a fault at \p address
+  ///
+  /// This is invoked from a signal handler, and so may only perform
+  /// async-signal-safe operations.
+  ///
+  /// \param context the context registered with the handler
+  /// \param address the address that faulted
+  /// \return `true` if the fault was resolved, and the faulting instruction
+  ///         should be retried
+  using fault_callback = auto(*)(void* context, std::byte* address) noexcept -> bool;
+
+  /// \brief Registers \p callback to resolve memory access faults in the
+  ///        range `[first, last)`
+  ///
+  /// Faults outside of every registered range, or that no callback resolves,
+  /// are forwarded to the signal handler that was installed before the first
+  /// registration.
+  ///
+  /// The signal handler is reinstalled by every registration if something
+  /// else has replaced it since. The replacing handler is not forwarded to,
+  /// since it may itself forward to this one; it is simply bypassed.
+  ///
+  /// Any number of ranges may be registered; the table of ranges grows as
+  /// needed, and is never shrunk.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::bad_alloc if the table of ranges cannot grow
+  ///
+  /// \param first the first address of the range
+  /// \param last one past the last address of the range
+  /// \param callback the callback to resolve faults
+  /// \param context the context to pass to \p callback
+  /// \return an identifier for unregistering the range
+  auto register_fault_handler(std::byte* first,
+                              std::byte* last,
+                              fault_callback callback,
+                              void* context) -> std::size_t;
+
+  /// \brief Unregisters the range identified by \p id
+  ///
+  /// \pre no faults may occur in the range while this is called
+  /// \param id the identifier returned from `register_fault_handler`
+  auto unregister_fault_handler(std::size_t id) noexcept -> void;
+
+} // namespace msl
+
+#endif /* SRC_MSL_MEMORY_POSIX_FAULT_HANDLER_HPP */
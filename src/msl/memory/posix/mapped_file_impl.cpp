@@ -0,0 +1,221 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/mapped_file_impl.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/errno.h>
+#include <sys/mman.h> // ::mmap, ::msync, ::madvise
+#include <sys/stat.h> // ::fstat
+#include <fcntl.h>    // ::open
+#include <system_error>
+#include <unistd.h>   // ::close, ::ftruncate
+
+namespace msl {
+  namespace {
+
+    [[noreturn]]
+    auto throw_file_error() -> void {
+      const auto code = std::error_code{errno, std::system_category()};
+      throw std::system_error{code};
+    }
+
+    auto protection_of(mapped_file::sharing_mode mode)
+      noexcept -> int
+    {
+      return (mode == mapped_file::sharing_mode::read_only)
+        ? PROT_READ
+        : PROT_READ | PROT_WRITE;
+    }
+
+  } // namespace <anonymous>
+} // namespace msl
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::mapped_file_open(const std::filesystem::path& path,
+                           mapped_file::sharing_mode mode)
+  -> std::intptr_t
+{
+  const auto flags = [&] {
+    switch (mode) {
+      case mapped_file::sharing_mode::shared: {
+        return O_RDWR | O_CREAT;
+      }
+      case mapped_file::sharing_mode::private_copy: {
+        // Private writes are never carried through, so the file is only read
+        return O_RDONLY | O_CREAT;
+      }
+      case mapped_file::sharing_mode::read_only: {
+        return O_RDONLY;
+      }
+    }
+    intrinsics::unreachable();
+  }();
+  const auto fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+
+  if (fd == -1) MSL_UNLIKELY {
+    throw_file_error();
+  }
+  return static_cast<std::intptr_t>(fd);
+}
+
+auto msl::mapped_file_close(std::intptr_t file)
+  noexcept -> void
+{
+  ::close(static_cast<int>(file));
+}
+
+auto msl::mapped_file_size(std::intptr_t file)
+  -> bytes
+{
+  struct ::stat status{};
+
+  if (::fstat(static_cast<int>(file), &status) != 0) MSL_UNLIKELY {
+    throw_file_error();
+  }
+  return bytes{static_cast<std::size_t>(status.st_size)};
+}
+
+auto msl::mapped_file_resize(std::intptr_t file, bytes size)
+  -> void
+{
+  const auto length = static_cast<::off_t>(size.count());
+
+  if (::ftruncate(static_cast<int>(file), length) != 0) MSL_UNLIKELY {
+    throw_file_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::mapped_file_map(not_null<std::byte*> memory,
+                          bytes size,
+                          std::intptr_t file,
+                          bytes offset,
+                          mapped_file::sharing_mode mode)
+  -> void
+{
+  const auto protection = protection_of(mode);
+  const auto sharing = (mode == mapped_file::sharing_mode::private_copy)
+    ? MAP_PRIVATE
+    : MAP_SHARED;
+  const auto p = ::mmap(
+    memory.get(),
+    size.count(),
+    protection,
+    sharing | MAP_FIXED,
+    static_cast<int>(file),
+    static_cast<::off_t>(offset.count())
+  );
+
+  if (p == MAP_FAILED) MSL_UNLIKELY {
+    throw_file_error();
+  }
+}
+
+auto msl::mapped_file_map_anonymous(not_null<std::byte*> memory,
+                                    bytes size,
+                                    mapped_file::sharing_mode mode)
+  -> void
+{
+  const auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+  const auto p = ::mmap(memory.get(), size.count(), protection_of(mode), flags, -1, 0);
+
+  if (p == MAP_FAILED) MSL_UNLIKELY {
+    throw_file_error();
+  }
+}
+
+auto msl::mapped_file_unmap(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  // Replacing the mapping, rather than unmapping it, keeps the address space
+  // reserved so that nothing else may be mapped in its place.
+  const auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+  const auto p = ::mmap(memory.get(), size.count(), PROT_NONE, flags, -1, 0);
+
+  if (p == MAP_FAILED) MSL_UNLIKELY {
+    throw_file_error();
+  }
+}
+
+auto msl::mapped_file_sync(not_null<std::byte*> memory,
+                           bytes size,
+                           mapped_file::sync_mode mode)
+  -> void
+{
+  const auto flags = (mode == mapped_file::sync_mode::synchronous)
+    ? MS_SYNC
+    : MS_ASYNC;
+
+  if (::msync(memory.get(), size.count(), flags) != 0) MSL_UNLIKELY {
+    throw_file_error();
+  }
+}
+
+auto msl::mapped_file_advise(not_null<std::byte*> memory,
+                             bytes size,
+                             mapped_file::access_pattern pattern)
+  noexcept -> void
+{
+#if defined(MADV_NORMAL) && defined(MADV_SEQUENTIAL) && defined(MADV_RANDOM)
+  const auto advice = [&] {
+    switch (pattern) {
+      case mapped_file::access_pattern::normal: {
+        return MADV_NORMAL;
+      }
+      case mapped_file::access_pattern::sequential: {
+        return MADV_SEQUENTIAL;
+      }
+      case mapped_file::access_pattern::random: {
+        return MADV_RANDOM;
+      }
+    }
+    intrinsics::unreachable();
+  }();
+
+  ::madvise(memory.get(), size.count(), advice);
+#elif defined(POSIX_MADV_NORMAL)
+  const auto advice = [&] {
+    switch (pattern) {
+      case mapped_file::access_pattern::normal: {
+        return POSIX_MADV_NORMAL;
+      }
+      case mapped_file::access_pattern::sequential: {
+        return POSIX_MADV_SEQUENTIAL;
+      }
+      case mapped_file::access_pattern::random: {
+        return POSIX_MADV_RANDOM;
+      }
+    }
+    intrinsics::unreachable();
+  }();
+
+  ::posix_madvise(memory.get(), size.count(), advice);
+#else
+  intrinsics::suppress_unused(memory, size, pattern);
+#endif
+}
@@ -0,0 +1,66 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/posix/shared_memory.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/mman.h> // ::memfd_create, ::shm_open
+#if !defined(__linux__)
+# include <atomic>    // std::atomic
+# include <string>    // std::to_string
+#endif
+#include <cerrno>     // errno
+#include <system_error>
+#include <fcntl.h>    // O_RDWR, O_CREAT, O_EXCL
+#include <unistd.h>   // ::ftruncate, ::close
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::create_shared_memory(bytes size)
+  -> int
+{
+#if defined(__linux__)
+  const auto fd = ::memfd_create("msl.virtual_memory", MFD_CLOEXEC);
+#else
+  // Without memfd_create, a uniquely named object is created and unlinked
+  // immediately, which leaves it anonymous.
+  static auto s_counter = std::atomic<unsigned long>{0u};
+  const auto name = "/msl.virtual_memory." + std::to_string(::getpid()) +
+    "." + std::to_string(s_counter.fetch_add(1u, std::memory_order_relaxed));
+  const auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd != -1) {
+    ::shm_unlink(name.c_str());
+  }
+#endif
+  if (fd == -1) MSL_UNLIKELY {
+    throw std::system_error{errno, std::system_category()};
+  }
+  if (::ftruncate(fd, static_cast<::off_t>(size.count())) != 0) MSL_UNLIKELY {
+    const auto error = errno;
+    ::close(fd);
+    throw std::system_error{error, std::system_category()};
+  }
+  return fd;
+}
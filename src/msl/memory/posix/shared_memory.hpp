@@ -0,0 +1,44 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_POSIX_SHARED_MEMORY_HPP
+#define SRC_MSL_MEMORY_POSIX_SHARED_MEMORY_HPP
+
+#include "msl/quantities/digital_quantity.hpp"
+
+namespace msl {
+
+  /// \brief Creates an anonymous shared memory object of \p size bytes
+  ///
+  /// The object has no name in any filesystem, and is destroyed once its
+  /// descriptor and all of its mappings are closed.
+  ///
+  /// \throw std::system_error with the error code on failure
+  ///
+  /// \param size the size of the object
+  /// \return the file descriptor of the object
+  auto create_shared_memory(bytes size) -> int;
+
+} // namespace msl
+
+#endif /* SRC_MSL_MEMORY_POSIX_SHARED_MEMORY_HPP */
@@ -0,0 +1,683 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/swap_space.hpp"
+#include "src/msl/memory/posix/fault_handler.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/mman.h> // ::mmap
+#include <atomic>     // std::atomic_flag
+#include <cerrno>     // errno
+#include <cstdint>    // std::uint8_t
+#include <limits>     // std::numeric_limits
+#include <memory>     // std::unique_ptr
+#include <mutex>      // std::lock_guard
+#include <string>     // std::string
+#include <system_error>
+#include <thread>     // std::this_thread::yield
+#include <vector>     // std::vector
+#include <fcntl.h>    // ::open, ::fallocate, ::posix_fadvise, ::sync_file_range
+#include <stdlib.h>   // ::mkstemp
+#include <unistd.h>   // ::pread, ::pwrite, ::ftruncate, ::fdatasync, ::close, ::unlink
+
+#if defined(__linux__)
+# include <linux/magic.h> // TMPFS_MAGIC, RAMFS_MAGIC
+# include <sys/vfs.h>     // ::fstatfs
+#endif
+
+namespace msl::detail {
+  namespace {
+
+    [[noreturn]]
+    auto throw_system_error(int error = errno) -> void
+    {
+      throw std::system_error{error, std::system_category()};
+    }
+
+    /// \brief Opens a new file in \p directory that is removed as soon as it
+    ///        is closed
+    auto open_file_in(const std::filesystem::path& directory) -> int
+    {
+#if defined(O_TMPFILE)
+      // Not every file system supports unnamed files
+      const auto unnamed = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+      if (unnamed >= 0) {
+        return unnamed;
+      }
+#endif
+      auto path = (directory / "msl-swap-XXXXXX").string();
+      const auto fd = ::mkstemp(path.data());
+      if (fd < 0) MSL_UNLIKELY {
+        throw_system_error();
+      }
+      ::unlink(path.c_str());
+      return fd;
+    }
+
+    /// \brief Queries whether the file system of \p fd keeps its files in
+    ///        memory, so that swapping to it would save no memory at all
+    auto is_memory_backed(int fd) noexcept -> bool
+    {
+#if defined(__linux__)
+      struct ::statfs status{};
+      if (::fstatfs(fd, &status) != 0) {
+        return false;
+      }
+      return status.f_type == TMPFS_MAGIC || status.f_type == RAMFS_MAGIC;
+#else
+      intrinsics::suppress_unused(fd);
+      return false;
+#endif
+    }
+
+    /// \brief Opens the backing file in \p directory, or in a default
+    ///        directory that is not backed by memory if \p directory is
+    ///        empty
+    auto open_backing_file(const std::filesystem::path& directory) -> int
+    {
+      if (!directory.empty()) {
+        const auto fd = open_file_in(directory);
+        if (is_memory_backed(fd)) MSL_UNLIKELY {
+          ::close(fd);
+          throw_system_error(ENOTSUP);
+        }
+        return fd;
+      }
+      // The temporary directory is often a tmpfs, whereas /var/tmp is
+      // conventionally kept on disk
+      const std::filesystem::path candidates[] = {
+        std::filesystem::temp_directory_path(),
+        "/var/tmp",
+      };
+      for (const auto& candidate : candidates) {
+        const auto fd = open_file_in(candidate);
+        if (!is_memory_backed(fd)) {
+          return fd;
+        }
+        ::close(fd);
+      }
+      throw_system_error(ENOTSUP);
+    }
+
+    /// \brief A lock that may be acquired from a signal handler
+    ///
+    /// This must never be held while accessing a page that may fault.
+    class spin_lock
+    {
+    public:
+
+      auto lock() noexcept -> void
+      {
+        while (m_flag.test_and_set(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+      }
+
+      auto unlock() noexcept -> void
+      {
+        m_flag.clear(std::memory_order_release);
+      }
+
+    private:
+
+      std::atomic_flag m_flag;
+    };
+
+    /// \brief The residency of a page
+    enum class page_state : std::uint8_t {
+      decommitted,
+      resident,
+      swapped,
+    };
+
+    /////////////////////////////////////////////////////////////////////////
+    /// \brief A swap space that resolves faults with a SIGSEGV handler
+    ///
+    /// Each page is swapped out to the offset of the backing file that
+    /// corresponds to its offset in the reservation, so the file is sparse
+    /// and only ever as large as the reservation.
+    ///
+    /// Swapped out pages are inaccessible. A page is swapped back in by
+    /// reading it into a scratch anonymous page, which is then moved over it;
+    /// this places the contents atomically, so that no other thread may
+    /// observe the page before it has been read in, and leaves the page
+    /// charged to the process only once. The page cache of the backing file
+    /// is dropped after each read and each batch of writes, since it would
+    /// otherwise be charged to the process as well.
+    ///
+    /// All state is guarded by a spin lock, which the fault handler also
+    /// acquires; nothing is allocated after construction.
+    /////////////////////////////////////////////////////////////////////////
+    class posix_swap_space final : public swap_space
+    {
+    public:
+
+      posix_swap_space(std::byte* data,
+                       std::size_t pages,
+                       std::size_t page_size,
+                       std::size_t budget,
+                       const std::filesystem::path& directory)
+        : m_data{data},
+          m_pages{pages},
+          m_page_size{page_size},
+          m_budget{budget},
+          m_fd{open_backing_file(directory)},
+          m_states(pages, page_state::decommitted),
+          m_previous(pages, npos),
+          m_next(pages, npos),
+          m_head{npos},
+          m_tail{npos},
+          m_resident{0u},
+          m_swapped{0u},
+          m_unflushed{false},
+          m_lock{},
+          m_handler{}
+      {
+        try {
+          if (::ftruncate(m_fd, static_cast<::off_t>(pages * page_size)) != 0) MSL_UNLIKELY {
+            throw_system_error();
+          }
+          m_handler = register_fault_handler(data, data + pages * page_size, &on_fault, this);
+        } catch (...) {
+          ::close(m_fd);
+          throw;
+        }
+      }
+
+      ~posix_swap_space() override
+      {
+        unregister_fault_handler(m_handler);
+        ::close(m_fd);
+      }
+
+      //-----------------------------------------------------------------------
+
+      auto budget()
+        const noexcept -> std::size_t override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        return m_budget;
+      }
+
+      auto resident_pages()
+        const noexcept -> std::size_t override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        return m_resident;
+      }
+
+      auto swapped_pages()
+        const noexcept -> std::size_t override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        return m_swapped;
+      }
+
+      auto is_committed(std::size_t n)
+        const noexcept -> bool override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        return m_states[n] != page_state::decommitted;
+      }
+
+      auto is_resident(std::size_t n)
+        const noexcept -> bool override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        return m_states[n] == page_state::resident;
+      }
+
+      //-----------------------------------------------------------------------
+
+      auto set_budget(std::size_t pages)
+        -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        m_budget = pages;
+        if (const auto error = trim(); error != 0) MSL_UNLIKELY {
+          throw_system_error(error);
+        }
+      }
+
+      auto commit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        const auto last = first + count;
+        for (auto n = first; n < last; ++n) {
+          switch (m_states[n]) {
+            case page_state::decommitted: {
+              // Decommitted pages are fresh anonymous pages, which read as
+              // zero once they are accessible
+              if (::mprotect(address(n), m_page_size, PROT_READ | PROT_WRITE) != 0) MSL_UNLIKELY {
+                throw_system_error();
+              }
+              m_states[n] = page_state::resident;
+              link_front(n);
+              ++m_resident;
+              break;
+            }
+            case page_state::resident: {
+              unlink(n);
+              link_front(n);
+              break;
+            }
+            case page_state::swapped: {
+              break;
+            }
+          }
+        }
+        if (const auto error = trim(); error != 0) MSL_UNLIKELY {
+          throw_system_error(error);
+        }
+      }
+
+      auto decommit(std::size_t first, std::size_t count)
+        -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        const auto last = first + count;
+        for (auto n = first; n < last; ++n) {
+          if (m_states[n] == page_state::resident) {
+            unlink(n);
+            --m_resident;
+          } else if (m_states[n] == page_state::swapped) {
+            --m_swapped;
+          }
+          m_states[n] = page_state::decommitted;
+        }
+
+        if (const auto error = discard(first, count); error != 0) MSL_UNLIKELY {
+          throw_system_error(error);
+        }
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+        // Returning the space of the file is only an optimization
+        ::fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    static_cast<::off_t>(first * m_page_size),
+                    static_cast<::off_t>(count * m_page_size));
+#endif
+      }
+
+      auto touch(std::size_t first, std::size_t count)
+        noexcept -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        const auto last = first + count;
+        for (auto n = first; n < last; ++n) {
+          if (m_states[n] == page_state::resident) {
+            unlink(n);
+            link_front(n);
+          }
+        }
+      }
+
+      auto fetch(std::size_t first, std::size_t count)
+        -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        const auto last = first + count;
+        for (auto n = first; n < last; ++n) {
+          if (m_states[n] == page_state::resident) {
+            unlink(n);
+            link_front(n);
+          } else if (m_states[n] == page_state::swapped) {
+            if (const auto error = swap_in(n); error != 0) MSL_UNLIKELY {
+              throw_system_error(error);
+            }
+          }
+        }
+        if (const auto error = trim(); error != 0) MSL_UNLIKELY {
+          throw_system_error(error);
+        }
+      }
+
+      auto evict(std::size_t first, std::size_t count)
+        -> void override
+      {
+        auto lock = std::lock_guard{m_lock};
+
+        auto error = 0;
+        const auto last = first + count;
+        for (auto n = first; n < last && error == 0; ++n) {
+          if (m_states[n] == page_state::resident) {
+            error = swap_out(n);
+          }
+        }
+        if (const auto flushed = flush(); error == 0) {
+          error = flushed;
+        }
+        if (error != 0) MSL_UNLIKELY {
+          throw_system_error(error);
+        }
+      }
+
+    private:
+
+      static constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+      /// \brief Resolves a fault at \p address by swapping its page back in
+      static auto on_fault(void* context, std::byte* address)
+        noexcept -> bool
+      {
+        auto& self = *static_cast<posix_swap_space*>(context);
+        const auto n = static_cast<std::size_t>(address - self.m_data) / self.m_page_size;
+
+        auto lock = std::lock_guard{self.m_lock};
+
+        switch (self.m_states[n]) {
+          case page_state::decommitted: {
+            return false;
+          }
+          case page_state::resident: {
+            // Another thread swapped the page in, or finished failing to
+            // swap it out, while this one waited for the lock
+            return true;
+          }
+          case page_state::swapped: {
+            if (self.swap_in(n) != 0) MSL_UNLIKELY {
+              return false;
+            }
+            // Failing to swap out other pages only exceeds the budget until
+            // the next attempt, which is preferable to failing the access.
+            // The page is kept even if it alone exceeds the budget, since the
+            // access could otherwise never complete.
+            self.trim(n);
+            return true;
+          }
+        }
+        return false;
+      }
+
+      auto address(std::size_t n)
+        const noexcept -> std::byte*
+      {
+        return m_data + n * m_page_size;
+      }
+
+      auto offset(std::size_t n)
+        const noexcept -> ::off_t
+      {
+        return static_cast<::off_t>(n * m_page_size);
+      }
+
+      //-----------------------------------------------------------------------
+
+      /// \brief Makes the \p n'th page the most recently used
+      auto link_front(std::size_t n)
+        noexcept -> void
+      {
+        m_previous[n] = npos;
+        m_next[n] = m_head;
+        if (m_head != npos) {
+          m_previous[m_head] = n;
+        } else {
+          m_tail = n;
+        }
+        m_head = n;
+      }
+
+      /// \brief Removes the \p n'th page from the order of use
+      auto unlink(std::size_t n)
+        noexcept -> void
+      {
+        const auto previous = m_previous[n];
+        const auto next = m_next[n];
+        if (previous != npos) {
+          m_next[previous] = next;
+        } else {
+          m_head = next;
+        }
+        if (next != npos) {
+          m_previous[next] = previous;
+        } else {
+          m_tail = previous;
+        }
+        m_previous[n] = npos;
+        m_next[n] = npos;
+      }
+
+      //-----------------------------------------------------------------------
+
+      /// \brief Replaces \p count pages starting at \p first with fresh,
+      ///        inaccessible pages
+      ///
+      /// \return 0 on success, or the error
+      auto discard(std::size_t first, std::size_t count)
+        noexcept -> int
+      {
+        const auto p = ::mmap(address(first), count * m_page_size, PROT_NONE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE,
+                              -1, 0);
+        return (p == MAP_FAILED) ? errno : 0;
+      }
+
+      /// \brief Swaps the swapped out \p n'th page back in, making it the most
+      ///        recently used
+      ///
+      /// \return 0 on success, or the error
+      auto swap_in(std::size_t n)
+        noexcept -> int
+      {
+#if defined(MREMAP_FIXED)
+        const auto scratch = ::mmap(nullptr, m_page_size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (scratch == MAP_FAILED) MSL_UNLIKELY {
+          return errno;
+        }
+        auto error = read_page(n, static_cast<std::byte*>(scratch));
+        if (error == 0) {
+          const auto p = ::mremap(scratch, m_page_size, m_page_size,
+                                  MREMAP_MAYMOVE | MREMAP_FIXED, address(n));
+          if (p == MAP_FAILED) MSL_UNLIKELY {
+            error = errno;
+          }
+        }
+        if (error != 0) MSL_UNLIKELY {
+          ::munmap(scratch, m_page_size);
+          return error;
+        }
+#else
+        // Without a way to move a page into place, the file is mapped
+        // privately instead; the page cache is still dropped below, although
+        // the mapped page remains cached until it is first written
+        const auto p = ::mmap(address(n), m_page_size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_FIXED, m_fd, offset(n));
+        if (p == MAP_FAILED) MSL_UNLIKELY {
+          return errno;
+        }
+#endif
+#if defined(POSIX_FADV_DONTNEED)
+        ::posix_fadvise(m_fd, offset(n), static_cast<::off_t>(m_page_size), POSIX_FADV_DONTNEED);
+#endif
+        m_states[n] = page_state::resident;
+        link_front(n);
+        ++m_resident;
+        --m_swapped;
+        return 0;
+      }
+
+      /// \brief Swaps the resident \p n'th page out to the backing file
+      ///
+      /// \return 0 on success, or the error
+      auto swap_out(std::size_t n)
+        noexcept -> int
+      {
+        const auto p = address(n);
+
+        // Writes made while the page is copied would be lost, so writers are
+        // made to fault and wait for the lock until it has been swapped out
+        if (::mprotect(p, m_page_size, PROT_READ) != 0) MSL_UNLIKELY {
+          return errno;
+        }
+        auto error = 0;
+        for (auto written = std::size_t{0u}; written < m_page_size;) {
+          const auto result = ::pwrite(m_fd, p + written, m_page_size - written,
+                                       offset(n) + static_cast<::off_t>(written));
+          if (result < 0) {
+            if (errno == EINTR) {
+              continue;
+            }
+            error = errno;
+            break;
+          }
+          written += static_cast<std::size_t>(result);
+        }
+        if (error == 0) {
+          m_unflushed = true;
+          error = discard(n, 1u);
+        }
+        if (error != 0) MSL_UNLIKELY {
+          ::mprotect(p, m_page_size, PROT_READ | PROT_WRITE);
+          return error;
+        }
+        m_states[n] = page_state::swapped;
+        unlink(n);
+        --m_resident;
+        ++m_swapped;
+        return 0;
+      }
+
+      /// \brief Swaps out the least recently used pages until no more pages
+      ///        are resident than the budget allows, stopping early rather
+      ///        than swapping out the \p keep'th page
+      ///
+      /// \return 0 on success, or the error
+      auto trim(std::size_t keep = npos)
+        noexcept -> int
+      {
+        auto error = 0;
+        while (error == 0 && m_resident > m_budget && m_tail != keep) {
+          error = swap_out(m_tail);
+        }
+        const auto flushed = flush();
+        return (error != 0) ? error : flushed;
+      }
+
+      /// \brief Reads the \p n'th page of the backing file into \p p
+      ///
+      /// \return 0 on success, or the error
+      auto read_page(std::size_t n, std::byte* p)
+        noexcept -> int
+      {
+        for (auto read = std::size_t{0u}; read < m_page_size;) {
+          const auto result = ::pread(m_fd, p + read, m_page_size - read,
+                                      offset(n) + static_cast<::off_t>(read));
+          if (result < 0) {
+            if (errno == EINTR) {
+              continue;
+            }
+            return errno;
+          }
+          if (result == 0) MSL_UNLIKELY {
+            // The file is never shorter than the reservation, but the rest
+            // of the page is already zero if it were
+            break;
+          }
+          read += static_cast<std::size_t>(result);
+        }
+        return 0;
+      }
+
+      /// \brief Writes back the pages swapped out since the last flush, and
+      ///        drops them from the page cache
+      ///
+      /// Dirty page cache is charged to the process just like the pages it
+      /// replaced, so leaving it to be written back eventually would defeat
+      /// the budget.
+      ///
+      /// \return 0 on success, or the error
+      auto flush()
+        noexcept -> int
+      {
+        if (!m_unflushed) {
+          return 0;
+        }
+        m_unflushed = false;
+#if defined(SYNC_FILE_RANGE_WRITE)
+        const auto flags = SYNC_FILE_RANGE_WAIT_BEFORE
+                         | SYNC_FILE_RANGE_WRITE
+                         | SYNC_FILE_RANGE_WAIT_AFTER;
+        if (::sync_file_range(m_fd, 0, 0, flags) != 0) MSL_UNLIKELY {
+          return errno;
+        }
+#else
+        if (::fdatasync(m_fd) != 0) MSL_UNLIKELY {
+          return errno;
+        }
+#endif
+#if defined(POSIX_FADV_DONTNEED)
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+        return 0;
+      }
+
+      std::byte* m_data;
+      std::size_t m_pages;
+      std::size_t m_page_size;
+      std::size_t m_budget;
+      int m_fd;
+
+      // The residency of each page, and the order in which resident pages
+      // were used as a list from most to least recent
+      std::vector<page_state> m_states;
+      std::vector<std::size_t> m_previous;
+      std::vector<std::size_t> m_next;
+      std::size_t m_head;
+      std::size_t m_tail;
+
+      std::size_t m_resident;
+      std::size_t m_swapped;
+      bool m_unflushed;
+
+      mutable spin_lock m_lock;
+      std::size_t m_handler;
+    };
+
+  } // namespace <anonymous>
+} // namespace msl::detail
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::detail::make_swap_space(not_null<std::byte*> memory,
+                                  std::size_t pages,
+                                  bytes page_size,
+                                  std::size_t budget,
+                                  const std::filesystem::path& directory)
+  -> std::unique_ptr<swap_space>
+{
+  return std::make_unique<posix_swap_space>(
+    memory.get(), pages, page_size.count(), budget, directory
+  );
+}
@@ -22,13 +22,23 @@
  SOFTWARE.
 */
 #include "src/msl/memory/virtual_memory_impl.hpp"
+#include "src/msl/memory/posix/shared_memory.hpp"
+#include "msl/blocks/memory_block.hpp"
 #include "msl/utilities/assert.hpp"
 #include "msl/utilities/intrinsics.hpp"
 
 #include <sys/errno.h>
 #include <sys/mman.h> // ::mmap
+#include <algorithm>  // std::max
+#include <charconv>   // std::from_chars
+#include <cstdint>    // std::uintptr_t
+#include <fstream>    // std::ifstream
+#include <string>     // std::string, std::getline
+#include <string_view> // std::string_view
 #include <system_error>
-#include <unistd.h>   // ::sysconf
+#include <vector>     // std::vector
+#include <fcntl.h>    // O_RDWR, O_CREAT, O_EXCL
+#include <unistd.h>   // ::sysconf, ::ftruncate, ::close
 
 //--------------------------------------------------------------------------
 // Global Constants
@@ -38,6 +48,44 @@
 # error _SC_PAGESIZE must be defined to determine virtual page size
 #endif
 
+// MADV_POPULATE_WRITE was added in Linux 5.14; older C library headers may
+// not define it, even though the running kernel supports it. Kernels that do
+// not support it will reject the advice with EINVAL.
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+# define MADV_POPULATE_WRITE 23
+#endif
+
+// Likewise, MADV_COLD and MADV_PAGEOUT were added in Linux 5.4, and
+// MADV_POPULATE_READ in Linux 5.14.
+#if defined(__linux__) && !defined(MADV_COLD)
+# define MADV_COLD 20
+#endif
+#if defined(__linux__) && !defined(MADV_PAGEOUT)
+# define MADV_PAGEOUT 21
+#endif
+#if defined(__linux__) && !defined(MADV_POPULATE_READ)
+# define MADV_POPULATE_READ 22
+#endif
+
+// MREMAP_DONTUNMAP was added in Linux 5.7, for private anonymous mappings
+// only until Linux 5.13. Kernels that do not support it reject it with
+// EINVAL.
+#if defined(__linux__) && !defined(MREMAP_DONTUNMAP)
+# define MREMAP_DONTUNMAP 4
+#endif
+
+//--------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------
+
+#if defined(__linux__)
+auto (*msl::detail::remap_pages)(void* from, std::size_t size, void* to, int flags)
+  noexcept -> void*
+  = [](void* from, std::size_t size, void* to, int flags) noexcept -> void* {
+    return ::mremap(from, size, size, flags, to);
+  };
+#endif
+
 //--------------------------------------------------------------------------
 // Forward Declarations
 //--------------------------------------------------------------------------
@@ -52,6 +100,81 @@ namespace msl {
     {
       return bytes{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))};
     }
+
+    /// \brief Maps \p size bytes of inaccessible memory with the given \p flags
+    ///
+    /// \param size the number of bytes to map
+    /// \param flags additional flags to map with
+    /// \return the mapped memory
+    auto map_inaccessible(bytes size, int flags) -> not_null<std::byte*>;
+
+    /// \brief Maps \p size bytes of inaccessible memory with the given \p flags
+    ///        over the existing mapping at \p memory
+    ///
+    /// \param memory the existing mapping to replace
+    /// \param size the number of bytes to map
+    /// \param flags additional flags to map with
+    auto map_inaccessible_over(not_null<std::byte*> memory, bytes size, int flags) -> void;
+
+    /// \brief Maps \p size bytes of inaccessible memory, aligned to an
+    ///        \p align boundary
+    ///
+    /// This over-reserves the memory and trims the unaligned head and tail
+    /// from the mapping afterwards.
+    ///
+    /// \param size the number of bytes to map
+    /// \param align the boundary to align the mapping to
+    /// \return the aligned memory
+    auto map_inaccessible_aligned(bytes size, bytes align) -> not_null<std::byte*>;
+
+    /// \brief Computes the mmap flags to request explicit huge pages of the
+    ///        specified \p mode
+    ///
+    /// \param mode the page mode
+    /// \return the flags
+    auto huge_page_flags(virtual_memory::page_mode mode) -> int;
+
+    /// \brief Computes the mmap flags for the pages of \p mode
+    ///
+    /// \param mode the page mode
+    /// \return the flags
+    auto page_mode_flags(virtual_memory::page_mode mode) -> int;
+
+#if defined(__linux__)
+    /// \brief Determines the individual mappings that make up the memory in
+    ///        the range `[memory, memory + size)`
+    ///
+    /// Committing or protecting pages splits a reservation into several
+    /// mappings, which some system calls are unable to operate across.
+    ///
+    /// \param memory the start of the range
+    /// \param size the size of the range
+    /// \return the mappings, clipped to the range
+    auto mappings_in(not_null<std::byte*> memory, bytes size) -> std::vector<memory_block>;
+
+    /// \brief Parses the address range of a mapping from a line of
+    ///        `/proc/self/maps` or `/proc/self/smaps`
+    ///
+    /// \param line the line to parse
+    /// \param first the first address of the mapping, on success
+    /// \param last one past the last address of the mapping, on success
+    /// \return `true` if \p line describes a mapping
+    auto parse_mapping_range(const std::string& line,
+                             std::uintptr_t& first,
+                             std::uintptr_t& last) noexcept -> bool;
+
+    /// \brief Parses a field of `/proc/self/smaps`, in the form of
+    ///        'Name: value [kB]'
+    ///
+    /// \param line the line to parse
+    /// \param name the name of the field, on success
+    /// \param value the value of the field, converted to bytes if it has a
+    ///        unit, on success
+    /// \return `true` if \p line describes a field
+    auto parse_smaps_field(const std::string& line,
+                           std::string_view& name,
+                           std::size_t& value) noexcept -> bool;
+#endif
   }
 
   [[noreturn]]
@@ -78,26 +201,59 @@ auto msl::virtual_memory_page_size()
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_reserve(std::size_t n)
+auto msl::virtual_memory_reserve(bytes size,
+                                 bytes align,
+                                 virtual_memory::page_mode mode)
   -> not_null<std::byte*>
 {
-  const auto size = n * virtual_memory_page_size();
-  const auto protection = MAP_PRIVATE | MAP_ANONYMOUS;
-  const auto p = ::mmap(nullptr, size.count(), PROT_NONE, protection, -1, 0);
+  // mmap always returns memory aligned to the natural page size of the
+  // mapping, so only stricter alignments require over-reserving.
+  const auto natural = virtual_memory::page_size(mode);
 
-  if (p == MAP_FAILED) MSL_UNLIKELY {
-    throw_system_error();
-  }
+  switch (mode) {
+    case virtual_memory::page_mode::standard: {
+      if (align <= natural) {
+        return map_inaccessible(size, 0);
+      }
+      return map_inaccessible_aligned(size, align);
+    }
+    case virtual_memory::page_mode::transparent_huge: {
+      const auto p = map_inaccessible_aligned(size, std::max(align, natural));
+#if defined(MADV_HUGEPAGE)
+      // This is only a hint; kernels without transparent huge page support
+      // simply continue to use standard pages.
+      ::madvise(p.get(), size.count(), MADV_HUGEPAGE);
+#endif
+      return p;
+    }
+    case virtual_memory::page_mode::huge_2mib:
+    case virtual_memory::page_mode::huge_1gib: {
+      const auto flags = huge_page_flags(mode);
+      if (align <= natural) {
+        return map_inaccessible(size, flags);
+      }
 
-  return assume_not_null(static_cast<std::byte*>(p));
+      // Over-reserving huge pages would temporarily claim more of the huge
+      // page pool than is required, so the aligned region is reserved with
+      // standard pages first and replaced afterwards.
+      const auto p = map_inaccessible_aligned(size, align);
+      try {
+        map_inaccessible_over(p, size, flags);
+      } catch (...) {
+        ::munmap(p.get(), size.count());
+        throw;
+      }
+      return p;
+    }
+  }
+  intrinsics::unreachable();
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_commit(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_commit(not_null<std::byte*> memory, bytes size)
   -> not_null<std::byte*>
 {
-  const auto size = n * virtual_memory_page_size();
   const auto protection = PROT_WRITE | PROT_READ;
   const auto result = ::mprotect(memory.get(), size.count(), protection);
 
@@ -117,37 +273,646 @@ auto msl::virtual_memory_commit(not_null<std::byte*> memory, std::size_t n)
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_decommit(not_null<std::byte*> memory, std::size_t n)
-  -> void
+auto msl::virtual_memory_populate(not_null<std::byte*> memory, bytes size)
+  -> bool
 {
-  const auto size = n * virtual_memory_page_size();
+#if defined(MADV_POPULATE_WRITE)
+  while (::madvise(memory.get(), size.count(), MADV_POPULATE_WRITE) != 0) {
+    if (errno == EINTR) {
+      continue;
+    }
+    // Kernels before 5.14 do not know the advice, and some mappings do not
+    // support it; only then may the pages be touched instead
+    if (errno == EINVAL || errno == ENOSYS) {
+      return false;
+    }
+    throw_system_error();
+  }
+  return true;
+#else
+  intrinsics::suppress_unused(memory, size);
 
-#if defined(MADV_FREE)
+  return false;
+#endif
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_decommit(not_null<std::byte*> memory,
+                                  bytes size,
+                                  virtual_memory::decommit_policy policy)
+  -> void
+{
+  // MADV_FREE is not supported for every kind of mapping (such as explicit
+  // huge pages), in which case this falls back to MADV_DONTNEED.
+#if defined(MADV_FREE) && defined(MADV_DONTNEED)
+  const auto lazy = (policy == virtual_memory::decommit_policy::lazy);
+  if (!lazy || ::madvise(memory.get(), size.count(), MADV_FREE) != 0) {
+    ::madvise(memory.get(), size.count(), MADV_DONTNEED);
+  }
+#elif defined(MADV_FREE)
+  intrinsics::suppress_unused(policy);
   ::madvise(memory.get(), size.count(), MADV_FREE);
 #elif defined(MADV_DONTNEED)
+  intrinsics::suppress_unused(policy);
   ::madvise(memory.get(), size.count(), MADV_DONTNEED);
 #elif defined(POSIX_MADV_DONTNEED)
+  intrinsics::suppress_unused(policy);
   ::posix_madvise(memory.get(), size.count(), POSIX_MADV_DONTNEED);
+#else
+  intrinsics::suppress_unused(policy);
 #endif
 
   const auto result = ::mprotect(memory.get(), size.count(), PROT_NONE);
 
-  if (result == 0) MSL_UNLIKELY {
+  if (result != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_protect(not_null<std::byte*> memory,
+                                 bytes size,
+                                 virtual_memory::page_access access)
+  -> void
+{
+  const auto protection = [&] {
+    switch (access) {
+      case virtual_memory::page_access::none: {
+        return PROT_NONE;
+      }
+      case virtual_memory::page_access::read: {
+        return PROT_READ;
+      }
+      case virtual_memory::page_access::read_write: {
+        return PROT_READ | PROT_WRITE;
+      }
+    }
+    intrinsics::unreachable();
+  }();
+
+  const auto result = ::mprotect(memory.get(), size.count(), protection);
+
+  if (result != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_lock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  if (::mlock(memory.get(), size.count()) != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+auto msl::virtual_memory_unlock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  if (::munlock(memory.get(), size.count()) != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_advise(not_null<std::byte*> memory,
+                                bytes size,
+                                virtual_memory::page_temperature temperature)
+  noexcept -> bool
+{
+  switch (temperature) {
+    case virtual_memory::page_temperature::warm: {
+      // Populating for reading brings back swapped out pages without
+      // dirtying them, and works for read-only pages. Older kernels can only
+      // be asked to start reading them back asynchronously.
+#if defined(MADV_POPULATE_READ)
+      if (::madvise(memory.get(), size.count(), MADV_POPULATE_READ) == 0) {
+        return true;
+      }
+#endif
+#if defined(MADV_WILLNEED)
+      return ::madvise(memory.get(), size.count(), MADV_WILLNEED) == 0;
+#elif defined(POSIX_MADV_WILLNEED)
+      return ::posix_madvise(memory.get(), size.count(), POSIX_MADV_WILLNEED) == 0;
+#else
+      break;
+#endif
+    }
+    case virtual_memory::page_temperature::cold: {
+#if defined(MADV_COLD)
+      return ::madvise(memory.get(), size.count(), MADV_COLD) == 0;
+#else
+      break;
+#endif
+    }
+    case virtual_memory::page_temperature::paged_out: {
+#if defined(MADV_PAGEOUT)
+      return ::madvise(memory.get(), size.count(), MADV_PAGEOUT) == 0;
+#else
+      break;
+#endif
+    }
+  }
+  intrinsics::suppress_unused(memory, size);
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_set_fork_policy(not_null<std::byte*> memory,
+                                         bytes size,
+                                         virtual_memory::fork_policy policy)
+  -> void
+{
+#if defined(MADV_DOFORK) && defined(MADV_DONTFORK)
+  // A wiped reservation must also be forked, since MADV_DONTFORK takes
+  // precedence over MADV_WIPEONFORK.
+  const auto fork = (policy == virtual_memory::fork_policy::exclude)
+    ? MADV_DONTFORK
+    : MADV_DOFORK;
+
+  if (::madvise(memory.get(), size.count(), fork) != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+# if defined(MADV_WIPEONFORK) && defined(MADV_KEEPONFORK)
+  const auto wipe = (policy == virtual_memory::fork_policy::wipe)
+    ? MADV_WIPEONFORK
+    : MADV_KEEPONFORK;
+
+  if (::madvise(memory.get(), size.count(), wipe) != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+# else
+  if (policy == virtual_memory::fork_policy::wipe) {
+    errno = ENOTSUP;
+    throw_system_error();
+  }
+# endif
+#elif defined(INHERIT_SHARE) && defined(INHERIT_NONE)
+  // BSDs express the same policies through minherit
+  const auto inheritance = [&] {
+    switch (policy) {
+      case virtual_memory::fork_policy::inherit: {
+        return INHERIT_COPY;
+      }
+      case virtual_memory::fork_policy::exclude: {
+        return INHERIT_NONE;
+      }
+      case virtual_memory::fork_policy::wipe: {
+# if defined(INHERIT_ZERO)
+        return INHERIT_ZERO;
+# else
+        errno = ENOTSUP;
+        throw_system_error();
+# endif
+      }
+    }
+    intrinsics::unreachable();
+  }();
+
+  if (::minherit(memory.get(), size.count(), inheritance) != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+#else
+  if (policy != virtual_memory::fork_policy::inherit) {
+    intrinsics::suppress_unused(memory, size);
+
+    errno = ENOTSUP;
+    throw_system_error();
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_extend(not_null<std::byte*> memory,
+                                bytes old_size,
+                                bytes new_size,
+                                virtual_memory::page_mode mode)
+  -> bool
+{
+  const auto end = memory + old_size.count();
+  const auto extension = new_size - old_size;
+
+  auto flags = MAP_PRIVATE | MAP_ANONYMOUS | page_mode_flags(mode);
+#if defined(MAP_FIXED_NOREPLACE)
+  flags |= MAP_FIXED_NOREPLACE;
+#endif
+
+  // Without MAP_FIXED_NOREPLACE (or on kernels that predate it), the address
+  // is only a hint -- so the result must be checked either way.
+  const auto p = ::mmap(end.get(), extension.count(), PROT_NONE, flags, -1, 0);
+
+  if (p == MAP_FAILED) MSL_UNLIKELY {
+    if (errno == EEXIST) {
+      return false;
+    }
     throw_system_error();
   }
+  if (p != end.get()) {
+    ::munmap(p, extension.count());
+    return false;
+  }
+
+#if defined(MADV_HUGEPAGE)
+  if (mode == virtual_memory::page_mode::transparent_huge) {
+    ::madvise(p, extension.count(), MADV_HUGEPAGE);
+  }
+#endif
+  return true;
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_release(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_relocate(not_null<std::byte*> memory,
+                                  bytes old_size,
+                                  bytes new_size,
+                                  virtual_memory::page_mode mode)
+  -> std::byte*
+{
+#if defined(__linux__) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+  // mremap is unable to operate across mapping boundaries, so each mapping
+  // that makes up the reservation is moved into place individually.
+  const auto mappings = mappings_in(memory, old_size);
+  const auto natural = virtual_memory::page_size(mode);
+  const auto destination = virtual_memory_reserve(new_size, natural, mode);
+
+  const auto flags = MREMAP_MAYMOVE | MREMAP_FIXED;
+
+  // Each mapping is left in place, emptied, after it is moved, so that no
+  // other mapping can claim its address range before the move completes. If
+  // the kernel is unable to, the mapping is moved without it.
+  auto kept = std::vector<bool>(mappings.size(), false);
+
+  for (auto i = std::size_t{0u}; i < mappings.size(); ++i) {
+    const auto& mapping = mappings[i];
+    const auto offset = mapping.start_address() - memory;
+    const auto size = mapping.size().count();
+    const auto target = (destination + offset).get();
+
+    auto p = detail::remap_pages(mapping.data().get(), size, target, flags | MREMAP_DONTUNMAP);
+    kept[i] = (p != MAP_FAILED);
+    if (p == MAP_FAILED && errno == EINVAL) {
+      p = detail::remap_pages(mapping.data().get(), size, target, flags);
+    }
+    if (p == MAP_FAILED) MSL_UNLIKELY {
+      const auto error = errno;
+
+      // The mappings that were already moved hold committed pages, so they
+      // are moved back into place before the destination is released. If any
+      // cannot be moved back, the destination is leaked rather than
+      // destroying its contents.
+      auto restored = true;
+      for (auto j = i; j > 0u; --j) {
+        const auto& moved = mappings[j - 1u];
+        const auto source = (destination + (moved.start_address() - memory)).get();
+        const auto length = moved.size().count();
+
+        if (detail::remap_pages(source, length, moved.data().get(), flags) == MAP_FAILED) {
+          restored = false;
+        }
+      }
+      if (restored) {
+        ::munmap(destination.get(), new_size.count());
+      }
+      errno = error;
+      throw_system_error();
+    }
+  }
+  for (auto i = std::size_t{0u}; i < mappings.size(); ++i) {
+    if (kept[i]) {
+      ::munmap(mappings[i].data().get(), mappings[i].size().count());
+    }
+  }
+  return destination.get();
+#else
+  intrinsics::suppress_unused(memory, old_size, new_size, mode);
+
+  return nullptr;
+#endif
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_map_mirrored(not_null<std::byte*> memory, bytes size)
   -> void
 {
-  const auto size = n * virtual_memory_page_size();
+  const auto fd = create_shared_memory(size);
+  const auto protection = PROT_READ | PROT_WRITE;
+  const auto flags = MAP_SHARED | MAP_FIXED;
+
+  for (const auto offset : {std::size_t{0u}, size.count()}) {
+    const auto target = (memory + offset).get();
+
+    if (::mmap(target, size.count(), protection, flags, fd, 0) == MAP_FAILED) MSL_UNLIKELY {
+      const auto error = errno;
+      ::close(fd);
+      errno = error;
+      throw_system_error();
+    }
+  }
+
+  // The mappings keep the shared memory alive on their own
+  ::close(fd);
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_resident(not_null<std::byte*> memory,
+                                  bytes size,
+                                  bytes page_size)
+  -> std::size_t
+{
+  // mincore reports residency for each page of the system, which is finer
+  // than the pages of huge page reservations.
+#if defined(__linux__)
+  using residency = unsigned char;
+#else
+  using residency = char;
+#endif
+  const auto system_page_size = virtual_memory_page_size();
+  const auto system_pages = size / system_page_size;
+  const auto per_page = page_size / system_page_size;
+
+  auto pages = std::vector<residency>(system_pages);
+  const auto result = ::mincore(memory.get(), size.count(), pages.data());
+
+  if (result != 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+
+  auto resident = std::size_t{0u};
+  for (auto i = std::size_t{0u}; i < system_pages; i += per_page) {
+    const auto first = pages.begin() + static_cast<std::ptrdiff_t>(i);
+    const auto last = first + static_cast<std::ptrdiff_t>(per_page);
+    const auto is_resident = std::any_of(first, last, [](residency r) {
+      return (r & 1) != 0;
+    });
+
+    resident += is_resident ? 1u : 0u;
+  }
+  return resident;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_huge_pages(not_null<std::byte*> memory, bytes size)
+  -> virtual_memory::huge_page_report
+{
+  auto report = virtual_memory::huge_page_report{
+    .resident = bytes::zero(),
+    .transparent_huge = bytes::zero(),
+    .explicit_huge = bytes::zero(),
+    .transparent_huge_eligible = false,
+  };
+#if defined(__linux__)
+  const auto begin = reinterpret_cast<std::uintptr_t>(memory.get());
+  const auto end = begin + size.count();
+
+  auto smaps = std::ifstream{"/proc/self/smaps"};
+  if (!smaps) MSL_UNLIKELY {
+    errno = ENOENT;
+    throw_system_error();
+  }
+
+  // The fields of each mapping describe the entire mapping. Mappings that
+  // only partially overlap the reservation (such as neighboring mappings that
+  // the kernel merged with it) are counted in proportion to the overlap.
+  auto overlap = std::size_t{0u};
+  auto length = std::size_t{0u};
+  const auto scaled = [&](std::size_t value) {
+    if (overlap == length) {
+      return bytes{value};
+    }
+    const auto ratio = static_cast<double>(overlap) / static_cast<double>(length);
+    return bytes{static_cast<std::size_t>(static_cast<double>(value) * ratio)};
+  };
+
+  auto line = std::string{};
+  while (std::getline(smaps, line)) {
+    auto first = std::uintptr_t{};
+    auto last = std::uintptr_t{};
+
+    if (parse_mapping_range(line, first, last)) {
+      const auto clipped_first = std::max(first, begin);
+      const auto clipped_last = std::min(last, end);
+
+      overlap = (clipped_last > clipped_first) ? (clipped_last - clipped_first) : 0u;
+      length = last - first;
+      continue;
+    }
+    auto name = std::string_view{};
+    auto value = std::size_t{};
+    if (overlap == 0u || !parse_smaps_field(line, name, value)) {
+      continue;
+    }
+
+    if (name == "Rss") {
+      report.resident += scaled(value);
+    } else if (name == "AnonHugePages" || name == "ShmemPmdMapped" || name == "FilePmdMapped") {
+      report.transparent_huge += scaled(value);
+    } else if (name == "Private_Hugetlb" || name == "Shared_Hugetlb") {
+      report.explicit_huge += scaled(value);
+    } else if (name == "THPeligible") {
+      report.transparent_huge_eligible |= (value != 0u);
+    }
+  }
+  return report;
+#else
+  intrinsics::suppress_unused(memory, size, report);
+
+  // Only Linux reports the pages backing each mapping
+  errno = ENOTSUP;
+  throw_system_error();
+#endif
+}
 
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_release(not_null<std::byte*> memory, bytes size)
+  -> void
+{
   errno = 0;
   const auto result = ::munmap(memory.get(), size.count());
 
-  if (result == 0) MSL_UNLIKELY {
+  if (result != 0) MSL_UNLIKELY {
     throw_system_error();
   }
 }
+
+//--------------------------------------------------------------------------
+// Private Functions
+//--------------------------------------------------------------------------
+
+namespace msl {
+  namespace {
+
+    auto map_inaccessible(bytes size, int flags)
+      -> not_null<std::byte*>
+    {
+      const auto protection = MAP_PRIVATE | MAP_ANONYMOUS | flags;
+      const auto p = ::mmap(nullptr, size.count(), PROT_NONE, protection, -1, 0);
+
+      if (p == MAP_FAILED) MSL_UNLIKELY {
+        throw_system_error();
+      }
+
+      return assume_not_null(static_cast<std::byte*>(p));
+    }
+
+    auto map_inaccessible_over(not_null<std::byte*> memory, bytes size, int flags)
+      -> void
+    {
+      const auto protection = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | flags;
+      const auto p = ::mmap(memory.get(), size.count(), PROT_NONE, protection, -1, 0);
+
+      if (p == MAP_FAILED) MSL_UNLIKELY {
+        throw_system_error();
+      }
+    }
+
+    auto map_inaccessible_aligned(bytes size, bytes align)
+      -> not_null<std::byte*>
+    {
+      // Reserving 'align' extra bytes guarantees that an aligned address with
+      // 'size' bytes after it exists somewhere in the mapping.
+      const auto padded_size = size + align;
+      const auto p = map_inaccessible(padded_size, 0);
+
+      const auto address = reinterpret_cast<std::uintptr_t>(p.get());
+      const auto mask = static_cast<std::uintptr_t>(align.count() - 1u);
+      const auto aligned_address = (address + mask) & ~mask;
+
+      const auto head = bytes{aligned_address - address};
+      const auto tail = padded_size - head - size;
+      const auto aligned = p + head.count();
+
+      if (head != bytes::zero()) {
+        ::munmap(p.get(), head.count());
+      }
+      if (tail != bytes::zero()) {
+        ::munmap((aligned + size.count()).get(), tail.count());
+      }
+
+      return aligned;
+    }
+
+    auto page_mode_flags(virtual_memory::page_mode mode)
+      -> int
+    {
+      switch (mode) {
+        case virtual_memory::page_mode::standard:
+        case virtual_memory::page_mode::transparent_huge: {
+          return 0;
+        }
+        case virtual_memory::page_mode::huge_2mib:
+        case virtual_memory::page_mode::huge_1gib: {
+          return huge_page_flags(mode);
+        }
+      }
+      intrinsics::unreachable();
+    }
+
+#if defined(__linux__)
+    auto mappings_in(not_null<std::byte*> memory, bytes size)
+      -> std::vector<memory_block>
+    {
+      const auto begin = reinterpret_cast<std::uintptr_t>(memory.get());
+      const auto end = begin + size.count();
+
+      auto result = std::vector<memory_block>{};
+      auto maps = std::ifstream{"/proc/self/maps"};
+      auto line = std::string{};
+
+      while (std::getline(maps, line)) {
+        auto first = std::uintptr_t{};
+        auto last = std::uintptr_t{};
+
+        if (!parse_mapping_range(line, first, last)) {
+          continue;
+        }
+        if (last <= begin || first >= end) {
+          continue;
+        }
+
+        const auto clipped_first = std::max(first, begin);
+        const auto clipped_last = std::min(last, end);
+        const auto offset = static_cast<std::ptrdiff_t>(clipped_first - begin);
+
+        result.push_back(memory_block::from_pointer_and_length(
+          memory + offset,
+          bytes{clipped_last - clipped_first}
+        ));
+      }
+      if (result.empty()) MSL_UNLIKELY {
+        errno = EFAULT;
+        throw_system_error();
+      }
+      return result;
+    }
+
+    auto parse_mapping_range(const std::string& line,
+                             std::uintptr_t& first,
+                             std::uintptr_t& last)
+      noexcept -> bool
+    {
+      // Each mapping is in the form of 'start-end perms offset dev inode path',
+      // with the addresses written in hex
+      const auto* const line_end = line.data() + line.size();
+      const auto dash = std::from_chars(line.data(), line_end, first, 16);
+      if (dash.ec != std::errc{} || dash.ptr == line_end || *dash.ptr != '-') {
+        return false;
+      }
+      return std::from_chars(dash.ptr + 1, line_end, last, 16).ec == std::errc{};
+    }
+
+    auto parse_smaps_field(const std::string& line,
+                           std::string_view& name,
+                           std::size_t& value)
+      noexcept -> bool
+    {
+      const auto view = std::string_view{line};
+      const auto colon = view.find(':');
+      if (colon == std::string_view::npos || view.find(' ') < colon) {
+        return false;
+      }
+
+      auto rest = view.substr(colon + 1u);
+      rest.remove_prefix(std::min(rest.find_first_not_of(' '), rest.size()));
+
+      const auto result = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+      if (result.ec != std::errc{}) {
+        return false;
+      }
+      const auto unit = rest.substr(static_cast<std::size_t>(result.ptr - rest.data()));
+      if (unit == " kB") {
+        value *= 1024u;
+      }
+      name = view.substr(0u, colon);
+      return true;
+    }
+#endif
+
+    auto huge_page_flags(virtual_memory::page_mode mode)
+      -> int
+    {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+      const auto shift = (mode == virtual_memory::page_mode::huge_1gib) ? 30 : 21;
+
+      return MAP_HUGETLB | (shift << MAP_HUGE_SHIFT);
+#else
+      intrinsics::suppress_unused(mode);
+
+      // Explicit huge pages are not something that this system can request
+      errno = ENOTSUP;
+      throw_system_error();
+#endif
+    }
+
+  } // namespace <anonymous>
+} // namespace msl
@@ -0,0 +1,206 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/posix/write_barrier.hpp"
+#include "src/msl/memory/posix/fault_handler.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <sys/mman.h> // ::mprotect
+#include <algorithm>  // std::min
+#include <cerrno>     // errno
+#include <system_error>
+#include <utility>    // std::move
+
+namespace msl {
+  namespace {
+
+    /// \brief Computes the number of words in a bitmap of \p pages pages
+    auto bitmap_words(std::size_t pages)
+      noexcept -> std::size_t
+    {
+      return (pages + 63u) / 64u;
+    }
+
+    /// \brief Allocates a zeroed atomic bitmap of \p pages pages
+    auto make_bitmap(std::size_t pages)
+      -> std::unique_ptr<std::atomic<std::uint64_t>[]>
+    {
+      // Value-initialization zeroes the words
+      return std::make_unique<std::atomic<std::uint64_t>[]>(bitmap_words(pages));
+    }
+
+  } // namespace <anonymous>
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::write_barrier::write_barrier(std::byte* data,
+                                  std::size_t pages,
+                                  std::size_t page_size,
+                                  hook_type hook,
+                                  void* context)
+  : m_data{data},
+    m_pages{pages},
+    m_page_size{page_size},
+    m_hook{hook},
+    m_context{context},
+    m_armed{make_bitmap(pages)},
+    m_protected{make_bitmap(pages)},
+    m_id{register_fault_handler(data, data + pages * page_size, &on_fault, this)}
+{
+
+}
+
+msl::write_barrier::~write_barrier()
+{
+  // Adjacent pages are coalesced so that each run costs one call
+  auto first = m_pages;
+  for (auto page = std::size_t{0u}; page <= m_pages; ++page) {
+    const auto bit = std::uint64_t{1u} << (page % 64u);
+    const auto is_armed = page < m_pages
+      && (m_armed[page / 64u].fetch_and(~bit) & bit) != 0u;
+
+    if (is_armed && first == m_pages) {
+      first = page;
+    } else if (!is_armed && first != m_pages) {
+      const auto p = m_data + first * m_page_size;
+      ::mprotect(p, (page - first) * m_page_size, PROT_READ | PROT_WRITE);
+      first = m_pages;
+    }
+  }
+  unregister_fault_handler(m_id);
+}
+
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+auto msl::write_barrier::arm(const std::vector<std::uint64_t>& pages)
+  -> void
+{
+  const auto words = std::min(pages.size(), bitmap_words(m_pages));
+
+  for (auto word = std::size_t{0u}; word < words; ++word) {
+    // Pages are marked as armed before they are protected, so that a racing
+    // write is never mistaken for an unrelated fault
+    const auto bits = pages[word];
+    if (bits == 0u) {
+      continue;
+    }
+    m_armed[word].fetch_or(bits, std::memory_order_acq_rel);
+    m_protected[word].fetch_or(bits, std::memory_order_acq_rel);
+  }
+
+  const auto end = words * 64u;
+  for (auto page = std::size_t{0u}; page < end;) {
+    if (((pages[page / 64u] >> (page % 64u)) & 1u) == 0u) {
+      ++page;
+      continue;
+    }
+    const auto first = page;
+    while (page < end && ((pages[page / 64u] >> (page % 64u)) & 1u) != 0u) {
+      ++page;
+    }
+    const auto p = m_data + first * m_page_size;
+    if (::mprotect(p, (page - first) * m_page_size, PROT_READ) != 0) MSL_UNLIKELY {
+      throw std::system_error{errno, std::system_category()};
+    }
+  }
+}
+
+auto msl::write_barrier::disarm(std::size_t first, std::size_t count, bool notify)
+  noexcept -> void
+{
+  const auto last = std::min(first + count, m_pages);
+
+  for (auto page = first; page < last; ++page) {
+    const auto word = page / 64u;
+    const auto bit = std::uint64_t{1u} << (page % 64u);
+
+    if ((m_armed[word].load(std::memory_order_acquire) & bit) == 0u) {
+      continue;
+    }
+    const auto previous = m_protected[word].fetch_and(~bit, std::memory_order_acq_rel);
+    if (notify && (previous & bit) != 0u) {
+      m_hook(m_context, page);
+    }
+    m_armed[word].fetch_and(~bit, std::memory_order_release);
+  }
+}
+
+auto msl::write_barrier::relocate(std::byte* data, std::size_t pages)
+  -> void
+{
+  auto armed = make_bitmap(pages);
+  auto protected_pages = make_bitmap(pages);
+
+  const auto words = std::min(bitmap_words(m_pages), bitmap_words(pages));
+  for (auto word = std::size_t{0u}; word < words; ++word) {
+    armed[word].store(m_armed[word].load());
+    protected_pages[word].store(m_protected[word].load());
+  }
+
+  const auto id = register_fault_handler(data, data + pages * m_page_size, &on_fault, this);
+  unregister_fault_handler(m_id);
+
+  m_id = id;
+  m_data = data;
+  m_pages = pages;
+  m_armed = std::move(armed);
+  m_protected = std::move(protected_pages);
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::write_barrier::on_fault(void* context, std::byte* address)
+  noexcept -> bool
+{
+  auto* const self = static_cast<write_barrier*>(context);
+  const auto page = static_cast<std::size_t>(address - self->m_data) / self->m_page_size;
+  const auto word = page / 64u;
+  const auto bit = std::uint64_t{1u} << (page % 64u);
+
+  if ((self->m_armed[word].load(std::memory_order_acquire) & bit) == 0u) {
+    return false;
+  }
+
+  // Only the first thread to fault claims the page; any other thread simply
+  // retries its write until the page has become writable
+  const auto previous = self->m_protected[word].fetch_and(~bit, std::memory_order_acq_rel);
+  if ((previous & bit) == 0u) {
+    return true;
+  }
+  self->m_hook(self->m_context, page);
+
+  const auto p = self->m_data + page * self->m_page_size;
+  if (::mprotect(p, self->m_page_size, PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+  self->m_armed[word].fetch_and(~bit, std::memory_order_release);
+
+  return true;
+}
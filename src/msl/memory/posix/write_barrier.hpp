@@ -0,0 +1,157 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_POSIX_WRITE_BARRIER_HPP
+#define SRC_MSL_MEMORY_POSIX_WRITE_BARRIER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace msl {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief Write-protects pages of a reservation, and invokes a hook before
+  ///        the first write to each protected page
+  ///
+  /// Pages are "armed" by write-protecting them. The first write to an armed
+  /// page faults; the fault invokes the hook, makes the page writable, and
+  /// disarms it. A page stays armed until it is writable, so that another
+  /// thread faulting on the same page retries until the first has finished,
+  /// rather than mistaking the fault for an unrelated one.
+  ///
+  /// The hook is invoked from a signal handler, and so may only perform
+  /// async-signal-safe operations.
+  ///
+  /// \note Arming and disarming may not race with writes to the same pages
+  /////////////////////////////////////////////////////////////////////////////
+  class write_barrier
+  {
+    //-------------------------------------------------------------------------
+    // Public Member Types
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief The hook invoked before the first write to \p page
+    using hook_type = auto(*)(void* context, std::size_t page) noexcept -> void;
+
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Constructs a barrier over the \p pages pages of \p page_size
+    ///        bytes at \p data, with no pages armed
+    ///
+    /// \throw std::system_error with the error code on failure
+    ///
+    /// \param data the start of the reservation
+    /// \param pages the number of pages in the reservation
+    /// \param page_size the size of each page
+    /// \param hook the hook to invoke before the first write to a page
+    /// \param context the context to pass to \p hook
+    write_barrier(std::byte* data,
+                  std::size_t pages,
+                  std::size_t page_size,
+                  hook_type hook,
+                  void* context);
+
+    write_barrier(const write_barrier&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    /// \brief Makes every armed page writable again, without invoking the
+    ///        hook
+    ~write_barrier();
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const write_barrier&) -> write_barrier& = delete;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Arms every page in the bitmap \p pages
+    ///
+    /// \throw std::system_error with the error code on failure
+    ///
+    /// \pre the pages must be committed and writable
+    /// \param pages the bitmap of pages to arm, with one bit per page
+    auto arm(const std::vector<std::uint64_t>& pages) -> void;
+
+    /// \brief Disarms \p count pages starting at \p first, without changing
+    ///        their protection
+    ///
+    /// The owner is expected to change the protection of the pages itself.
+    ///
+    /// \param first the first page
+    /// \param count the number of pages
+    /// \param notify whether to invoke the hook for each page that was armed
+    auto disarm(std::size_t first, std::size_t count, bool notify) noexcept -> void;
+
+    /// \brief Moves the barrier to a reservation of \p pages pages at \p data
+    ///
+    /// Armed pages remain armed, since their protection is moved with them.
+    ///
+    /// \throw std::system_error with the error code on failure
+    ///
+    /// \param data the start of the reservation
+    /// \param pages the number of pages in the reservation
+    auto relocate(std::byte* data, std::size_t pages) -> void;
+
+    //-------------------------------------------------------------------------
+    // Private Functions
+    //-------------------------------------------------------------------------
+  private:
+
+    /// \brief Resolves a fault at \p address, if it is a write to an armed
+    ///        page
+    static auto on_fault(void* context, std::byte* address) noexcept -> bool;
+
+    //-------------------------------------------------------------------------
+    // Private Members
+    //-------------------------------------------------------------------------
+  private:
+
+    std::byte* m_data;
+    std::size_t m_pages;
+    std::size_t m_page_size;
+    hook_type m_hook;
+    void* m_context;
+
+    // The pages that are armed, which remain armed until they are writable
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_armed;
+
+    // The armed pages whose first write has not been claimed by a fault
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_protected;
+
+    std::size_t m_id;
+  };
+
+} // namespace msl
+
+#endif /* SRC_MSL_MEMORY_POSIX_WRITE_BARRIER_HPP */
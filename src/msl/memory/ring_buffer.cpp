@@ -0,0 +1,44 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/ring_buffer.hpp"
+
+#include "src/msl/memory/virtual_memory_impl.hpp"
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::ring_buffer::ring_buffer(uquantity<page> pages)
+  : m_memory{virtual_memory::reserve(pages * 2u)},
+    m_capacity{(m_memory.page_size() * pages.count()).count()},
+    m_write{0u},
+    m_read{0u}
+{
+  MSL_ASSERT(pages != 0u, "A ring buffer requires at least one page");
+
+  // The reservation is only used for the address space; the mirrored mappings
+  // replace it entirely, and it is released as a whole on destruction.
+  virtual_memory_map_mirrored(assume_not_null(m_memory.data()), capacity());
+}
@@ -0,0 +1,192 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/stack_pool.hpp"
+
+#include <iterator> // std::prev
+#include <utility>  // std::move
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::stack_pool::stack_pool()
+  : stack_pool{options{}}
+{
+
+}
+
+msl::stack_pool::stack_pool(options pool_options)
+  : m_options{pool_options},
+    m_slabs{},
+    m_free{},
+    m_acquired{0u}
+{
+  MSL_ASSERT(m_options.stack_pages != 0u, "Stacks require at least one page");
+  MSL_ASSERT(m_options.stacks_per_slab != 0u, "Slabs require at least one stack");
+}
+
+//-----------------------------------------------------------------------------
+// Stacks
+//-----------------------------------------------------------------------------
+
+auto msl::stack_pool::acquire()
+  -> memory_block
+{
+  if (m_free.empty()) {
+    add_slab();
+  }
+
+  const auto location = m_free.back();
+  auto& memory = location.owner->memory;
+  const auto pages = m_options.stack_pages;
+
+  location.owner->scheduler.cancel(location.first_page, pages);
+
+  // Stacks are committed and decommitted as a whole, so checking the first
+  // page is sufficient.
+  const auto stack = memory.is_committed(location.first_page)
+    ? memory_block::from_pointer_and_length(
+        memory[location.first_page].start_address(),
+        memory.page_size() * pages.count()
+      )
+    : memory.commit(location.first_page, pages);
+
+  m_free.pop_back();
+  ++m_acquired;
+
+  return stack;
+}
+
+auto msl::stack_pool::release(memory_block stack, clock::time_point now)
+  -> void
+{
+  MSL_ASSERT(stack.size() == stack_size(), "Releasing a stack of the wrong size");
+
+  const auto location = locate(stack.start_address().get());
+
+  // The stack is released before it is scheduled, since scheduling may
+  // purge under pressure and fail. The pages it failed to decommit remain
+  // scheduled, and are retried by the next purge.
+  m_free.push_back(location);
+  --m_acquired;
+  try {
+    location.owner->scheduler.schedule(location.first_page, m_options.stack_pages, now);
+  } catch (...) {
+    // Failing to schedule only leaves the stack committed until it is next
+    // released, which is preferable to losing track of it
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::stack_pool::purge(clock::time_point now)
+  -> uquantity<page>
+{
+  auto result = uquantity<page>{0u};
+  for (auto& [base, s] : m_slabs) {
+    result += s->scheduler.purge(now);
+  }
+  return result;
+}
+
+auto msl::stack_pool::purge_all()
+  -> uquantity<page>
+{
+  auto result = uquantity<page>{0u};
+  for (auto& [base, s] : m_slabs) {
+    result += s->scheduler.purge_all();
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::stack_pool::stack_size()
+  const noexcept -> bytes
+{
+  const auto size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+
+  return size * m_options.stack_pages.count();
+}
+
+//-----------------------------------------------------------------------------
+// Private Member Types
+//-----------------------------------------------------------------------------
+
+msl::stack_pool::slab::slab(virtual_memory slab_memory,
+                            decommit_scheduler::options decommit_options)
+  : memory{std::move(slab_memory)},
+    scheduler{memory, decommit_options}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::stack_pool::add_slab()
+  -> void
+{
+  const auto stride = (m_options.guard_pages + m_options.stack_pages).count();
+  const auto stacks = m_options.stacks_per_slab;
+
+  // Guard pages are never committed, so they remain inaccessible for as long
+  // as the slab exists.
+  const auto pages = uquantity<page>{stride * stacks};
+  auto s = std::make_unique<slab>(
+    (m_options.hooks != nullptr)
+      ? virtual_memory::reserve(pages, *m_options.hooks)
+      : virtual_memory::reserve(pages),
+    m_options.decommit
+  );
+  const auto base = s->memory.data();
+
+  m_free.reserve(m_free.size() + stacks);
+  const auto owner = m_slabs.emplace(base, std::move(s)).first->second.get();
+
+  // Stacks are pushed in reverse, so that they are handed out in ascending
+  // order of address.
+  for (auto i = stacks; i > 0u; --i) {
+    const auto first_page = (i - 1u) * stride + m_options.guard_pages.count();
+
+    m_free.push_back(stack_location{owner, first_page});
+  }
+}
+
+auto msl::stack_pool::locate(std::byte* p)
+  const noexcept -> stack_location
+{
+  const auto it = std::prev(m_slabs.upper_bound(p));
+  auto& owner = *it->second;
+  const auto offset = static_cast<std::size_t>(p - it->first);
+
+  return stack_location{
+    &owner,
+    offset / owner.memory.page_size().count()
+  };
+}
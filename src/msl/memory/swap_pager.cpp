@@ -0,0 +1,189 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/swap_pager.hpp"
+
+#include "src/msl/memory/swap_space.hpp"
+
+#include <algorithm>  // std::max
+
+namespace msl {
+namespace {
+
+  /// The fewest pages that may be resident. A single instruction may access
+  /// several pages -- such as a string move whose source and destination
+  /// both cross a page boundary -- and would fault forever if swapping in
+  /// any of them swapped out another.
+  constexpr auto min_budget_pages = std::size_t{4u};
+
+  /// \brief Converts \p budget into a number of pages of \p page_size bytes,
+  ///        of which there are always at least `min_budget_pages`
+  auto budget_to_pages(bytes budget, bytes page_size)
+    noexcept -> std::size_t
+  {
+    return std::max(budget.count() / page_size.count(), min_budget_pages);
+  }
+
+} // namespace <anonymous>
+} // namespace msl
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::swap_pager::swap_pager(uquantity<page> pages)
+  : swap_pager{pages, options{}}
+{
+
+}
+
+msl::swap_pager::swap_pager(uquantity<page> pages, options pager_options)
+  : m_memory{virtual_memory::reserve(pages)},
+    m_swap_space{}
+{
+  m_swap_space = detail::make_swap_space(
+    assume_not_null(m_memory.data()),
+    pages.count(),
+    m_memory.page_size(),
+    budget_to_pages(pager_options.resident_budget, m_memory.page_size()),
+    pager_options.directory
+  );
+}
+
+msl::swap_pager::swap_pager(swap_pager&& other) noexcept = default;
+
+msl::swap_pager::~swap_pager() = default;
+
+auto msl::swap_pager::operator=(swap_pager&& other)
+  noexcept -> swap_pager&
+{
+  swap(other);
+  return (*this);
+}
+
+//-----------------------------------------------------------------------------
+// Residency
+//-----------------------------------------------------------------------------
+
+auto msl::swap_pager::resident_budget()
+  const noexcept -> bytes
+{
+  return page_size() * m_swap_space->budget();
+}
+
+auto msl::swap_pager::set_resident_budget(bytes budget)
+  -> void
+{
+  m_swap_space->set_budget(budget_to_pages(budget, page_size()));
+}
+
+auto msl::swap_pager::resident_pages()
+  const noexcept -> uquantity<page>
+{
+  return uquantity<page>{m_swap_space->resident_pages()};
+}
+
+auto msl::swap_pager::swapped_pages()
+  const noexcept -> uquantity<page>
+{
+  return uquantity<page>{m_swap_space->swapped_pages()};
+}
+
+auto msl::swap_pager::is_committed(std::size_t n)
+  const noexcept -> bool
+{
+  MSL_ASSERT(n < pages().count(), "Page out of range");
+
+  return m_swap_space->is_committed(n);
+}
+
+auto msl::swap_pager::is_resident(std::size_t n)
+  const noexcept -> bool
+{
+  MSL_ASSERT(n < pages().count(), "Page out of range");
+
+  return m_swap_space->is_resident(n);
+}
+
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+auto msl::swap_pager::commit(std::size_t first, uquantity<page> count)
+  -> memory_block
+{
+  MSL_ASSERT(first + count.count() <= pages().count(), "Committing pages out of range");
+
+  m_swap_space->commit(first, count.count());
+
+  return memory_block::from_pointer_and_length(
+    assume_not_null(data() + (page_size() * first).count()),
+    page_size() * count.count()
+  );
+}
+
+auto msl::swap_pager::decommit(std::size_t first, uquantity<page> count)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= pages().count(), "Decommitting pages out of range");
+
+  m_swap_space->decommit(first, count.count());
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::swap_pager::touch(std::size_t first, uquantity<page> count)
+  noexcept -> void
+{
+  MSL_ASSERT(first + count.count() <= pages().count(), "Touching pages out of range");
+
+  m_swap_space->touch(first, count.count());
+}
+
+auto msl::swap_pager::fetch(std::size_t first, uquantity<page> count)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= pages().count(), "Fetching pages out of range");
+
+  m_swap_space->fetch(first, count.count());
+}
+
+auto msl::swap_pager::evict(std::size_t first, uquantity<page> count)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= pages().count(), "Evicting pages out of range");
+
+  m_swap_space->evict(first, count.count());
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::swap_pager::swap(swap_pager& other)
+  noexcept -> void
+{
+  using std::swap;
+
+  m_memory.swap(other.m_memory);
+  swap(m_swap_space, other.m_swap_space);
+}
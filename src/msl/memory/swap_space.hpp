@@ -0,0 +1,149 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#ifndef SRC_MSL_MEMORY_SWAP_SPACE_HPP
+#define SRC_MSL_MEMORY_SWAP_SPACE_HPP
+
+#if defined(_MSC_VER)
+# pragma once
+#endif
+
+#include "msl/quantities/digital_quantity.hpp"
+#include "msl/pointers/not_null.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+namespace msl::detail {
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The base of the platform-specific state of a `swap_pager`
+  ///
+  /// This owns the backing file, the residency of each page, and the order
+  /// in which pages were used, and resolves the faults of accesses to pages
+  /// that are swapped out. The reservation itself is owned by the pager.
+  /////////////////////////////////////////////////////////////////////////////
+  class swap_space
+  {
+    //-------------------------------------------------------------------------
+    // Constructors / Destructor / Assignment
+    //-------------------------------------------------------------------------
+  public:
+
+    swap_space() noexcept = default;
+
+    swap_space(const swap_space&) = delete;
+
+    //-------------------------------------------------------------------------
+
+    virtual ~swap_space() = default;
+
+    //-------------------------------------------------------------------------
+
+    auto operator=(const swap_space&) -> swap_space& = delete;
+
+    //-------------------------------------------------------------------------
+    // Observers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Gets the number of pages that may be resident
+    virtual auto budget() const noexcept -> std::size_t = 0;
+
+    /// \brief Gets the number of committed pages that are resident
+    virtual auto resident_pages() const noexcept -> std::size_t = 0;
+
+    /// \brief Gets the number of committed pages that are swapped out
+    virtual auto swapped_pages() const noexcept -> std::size_t = 0;
+
+    /// \brief Queries whether the \p n'th page is committed
+    virtual auto is_committed(std::size_t n) const noexcept -> bool = 0;
+
+    /// \brief Queries whether the \p n'th page is committed and resident
+    virtual auto is_resident(std::size_t n) const noexcept -> bool = 0;
+
+    //-------------------------------------------------------------------------
+    // Modifiers
+    //-------------------------------------------------------------------------
+  public:
+
+    /// \brief Sets the number of pages that may be resident to \p pages,
+    ///        swapping out pages if more are resident
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto set_budget(std::size_t pages) -> void = 0;
+
+    /// \brief Commits \p count pages starting at \p first, touching any that
+    ///        are already committed
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto commit(std::size_t first, std::size_t count) -> void = 0;
+
+    /// \brief Decommits \p count pages starting at \p first
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto decommit(std::size_t first, std::size_t count) -> void = 0;
+
+    /// \brief Marks \p count resident pages starting at \p first as the most
+    ///        recently used
+    virtual auto touch(std::size_t first, std::size_t count) noexcept -> void = 0;
+
+    /// \brief Swaps in \p count committed pages starting at \p first
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto fetch(std::size_t first, std::size_t count) -> void = 0;
+
+    /// \brief Swaps out \p count committed pages starting at \p first
+    ///
+    /// \throw std::system_error with the error code on failure
+    virtual auto evict(std::size_t first, std::size_t count) -> void = 0;
+  };
+
+  //---------------------------------------------------------------------------
+  // Free Functions
+  //---------------------------------------------------------------------------
+
+  /// \brief Creates the swap space for the \p pages pages reserved at
+  ///        \p memory, with a backing file in \p directory
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory the start of the reservation
+  /// \param pages the number of reserved pages
+  /// \param page_size the size of each page
+  /// \param budget the number of pages that may be resident
+  /// \param directory the directory to create the backing file in, or empty
+  ///        to use a default directory that is not backed by memory
+  /// \return the swap space
+  auto make_swap_space(not_null<std::byte*> memory,
+                       std::size_t pages,
+                       bytes page_size,
+                       std::size_t budget,
+                       const std::filesystem::path& directory)
+    -> std::unique_ptr<swap_space>;
+
+} // namespace msl::detail
+
+#endif /* SRC_MSL_MEMORY_SWAP_SPACE_HPP */
@@ -23,28 +23,142 @@
 */
 
 #include "msl/memory/virtual_memory.hpp"
+#include "msl/memory/virtual_memory_hooks.hpp"
 
 #include "msl/utilities/intrinsics.hpp"
+#include "src/msl/memory/cow_mapping.hpp"
+#include "src/msl/memory/dirty_page_tracker.hpp"
 #include "src/msl/memory/virtual_memory_impl.hpp"
+#include <algorithm> // std::min
+#include <atomic>    // std::atomic_ref
+#include <bit>       // std::popcount
+#include <cstdio>    // std::fprintf
+#include <cstdlib>   // std::abort
+#include <exception> // std::exception_ptr
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>    // std::jthread
+#include <vector>    // std::vector
+
+namespace msl {
+namespace {
+
+  /// \brief Backs every page in \p block with physical memory
+  ///
+  /// \param block the committed block to prefault
+  /// \param page_size the size of each page in the block
+  auto prefault_block(memory_block block, bytes page_size)
+    -> void
+  {
+    if (virtual_memory_populate(block.start_address(), block.size())) {
+      return;
+    }
+
+    // Touch each page with an atomic no-op write. This forces the page to be
+    // backed for writing without altering, or racing with, its contents.
+    const auto end = block.end_address();
+    for (auto p = block.start_address(); p < end; p += page_size.count()) {
+      auto& b = reinterpret_cast<unsigned char&>(*p);
+      std::atomic_ref<unsigned char>{b}.fetch_add(0u, std::memory_order_relaxed);
+    }
+  }
+
+#if MSL_PAGE_SIZE != 0
+  /// \brief Verifies that the page size fixed at compile time matches the
+  ///        page size of the system that is running
+  ///
+  /// All page arithmetic would silently be wrong otherwise, so a mismatch
+  /// aborts at startup rather than later.
+  [[maybe_unused]]
+  const auto g_verify_page_size = [] {
+    const auto actual = virtual_memory_page_size().count();
+    if (actual != MSL_PAGE_SIZE) MSL_UNLIKELY {
+      std::fprintf(stderr,
+        "MSL was configured with MSL_PAGE_SIZE=%zu, but the page size of "
+        "this system is %zu bytes.\n",
+        static_cast<std::size_t>(MSL_PAGE_SIZE),
+        actual
+      );
+      std::abort();
+    }
+    return true;
+  }();
+#endif
+
+} // namespace <anonymous>
+} // namespace msl
 
 //-----------------------------------------------------------------------------
 // Static Functions
 //-----------------------------------------------------------------------------
 
-auto msl::virtual_memory::page_size()
+auto msl::virtual_memory::page_size(page_mode mode)
   noexcept -> bytes
 {
-  return virtual_memory_page_size();
+  switch (mode) {
+    case page_mode::standard: {
+#if MSL_PAGE_SIZE != 0
+      return bytes{std::size_t{1u} << page_shift};
+#else
+      return virtual_memory_page_size();
+#endif
+    }
+    case page_mode::transparent_huge:
+    case page_mode::huge_2mib: {
+      return mebibytes{2u};
+    }
+    case page_mode::huge_1gib: {
+      return gibibytes{1u};
+    }
+  }
+  intrinsics::unreachable();
 }
 
-auto msl::virtual_memory::reserve(uquantity<page> pages)
+auto msl::virtual_memory::reserve(uquantity<page> pages, page_mode mode)
   -> virtual_memory
 {
-  auto p = virtual_memory_reserve(pages.count());
+  return reserve(pages, virtual_memory_hooks::system(), mode);
+}
 
-  return virtual_memory{p.get(), pages};
+auto msl::virtual_memory::reserve(uquantity<page> pages,
+                                  alignment align,
+                                  page_mode mode)
+  -> virtual_memory
+{
+  return reserve(pages, align, virtual_memory_hooks::system(), mode);
+}
+
+auto msl::virtual_memory::reserve(uquantity<page> pages,
+                                  virtual_memory_hooks& hooks,
+                                  page_mode mode)
+  -> virtual_memory
+{
+  const auto granularity = page_size(mode);
+  const auto size = granularity * pages.count();
+
+  // The bitmap is allocated first so that failing to allocate it cannot leak
+  // the reservation.
+  auto committed = std::vector<std::uint64_t>(bitmap_words(pages), 0u);
+  auto p = hooks.reserve(size, granularity, mode);
+
+  return virtual_memory{p.get(), pages, mode, std::move(committed), hooks};
+}
+
+auto msl::virtual_memory::reserve(uquantity<page> pages,
+                                  alignment align,
+                                  virtual_memory_hooks& hooks,
+                                  page_mode mode)
+  -> virtual_memory
+{
+  const auto granularity = page_size(mode);
+  const auto size = granularity * pages.count();
+  const auto boundary = std::max(bytes{align.value()}, granularity);
+
+  auto committed = std::vector<std::uint64_t>(bitmap_words(pages), 0u);
+  auto p = hooks.reserve(size, boundary, mode);
+
+  return virtual_memory{p.get(), pages, mode, std::move(committed), hooks};
 }
 
 //-----------------------------------------------------------------------------
@@ -53,8 +167,15 @@ auto msl::virtual_memory::reserve(uquantity<page> pages)
 
 msl::virtual_memory::virtual_memory(virtual_memory&& other)
   noexcept
-  : m_data{other.release()},
-    m_pages{other.m_pages}
+  : m_data{std::exchange(other.m_data, nullptr)},
+    m_pages{other.m_pages},
+    m_page_shift{other.m_page_shift},
+    m_mode{other.m_mode},
+    m_fork_policy{other.m_fork_policy},
+    m_hooks{other.m_hooks},
+    m_committed{std::move(other.m_committed)},
+    m_dirty_tracker{std::move(other.m_dirty_tracker)},
+    m_cow_mapping{std::move(other.m_cow_mapping)}
 {
 
 }
@@ -63,8 +184,13 @@ msl::virtual_memory::virtual_memory(virtual_memory&& other)
 
 msl::virtual_memory::~virtual_memory()
 {
+  // The tracker may restore access to pages, so it must be destroyed while
+  // they are still mapped
+  m_dirty_tracker.reset();
+  m_cow_mapping.reset();
+
   if (m_data != nullptr) {
-    virtual_memory_release(assume_not_null(m_data), m_pages.count());
+    m_hooks->release(assume_not_null(m_data), size_in_bytes());
   }
 }
 
@@ -87,7 +213,7 @@ auto msl::virtual_memory::operator[](std::size_t n)
   const noexcept -> page
 {
   MSL_ASSERT(m_data != nullptr, "Indexing a released virtual_memory object");
-  const auto p = assume_not_null(m_data) + (n * virtual_memory_page_size()).count();
+  const auto p = assume_not_null(m_data) + pages_to_bytes(n).count();
 
   return page::from_pointer_and_length(p, page_size());
 }
@@ -104,26 +230,487 @@ auto msl::virtual_memory::at(std::size_t n)
   return (*this)[n];
 }
 
+//-----------------------------------------------------------------------------
+// Commit State
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::committed_pages()
+  const noexcept -> uquantity<page>
+{
+  auto result = std::size_t{0u};
+  for (const auto word : m_committed) {
+    result += static_cast<std::size_t>(std::popcount(word));
+  }
+  return uquantity<page>{result};
+}
+
+auto msl::virtual_memory::resident_pages()
+  const -> uquantity<page>
+{
+  if (empty()) {
+    return uquantity<page>{0u};
+  }
+  const auto p = assume_not_null(m_data);
+
+  return uquantity<page>{virtual_memory_resident(p, size_in_bytes(), page_size())};
+}
+
+auto msl::virtual_memory::huge_pages()
+  const -> huge_page_report
+{
+  if (empty()) {
+    return huge_page_report{
+      .resident = bytes::zero(),
+      .transparent_huge = bytes::zero(),
+      .explicit_huge = bytes::zero(),
+      .transparent_huge_eligible = false,
+    };
+  }
+  return virtual_memory_huge_pages(assume_not_null(m_data), size_in_bytes());
+}
+
 //-----------------------------------------------------------------------------
 // Modifiers
 //-----------------------------------------------------------------------------
 
-auto msl::virtual_memory::commit(std::size_t n)
-  -> page
+auto msl::virtual_memory::commit(std::size_t first,
+                                 uquantity<page> count,
+                                 commit_policy policy)
+  -> memory_block
 {
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Committing pages out of range");
+
   const auto size = page_size();
-  const auto p = m_data + (n * size);
+  const auto p = m_data + pages_to_bytes(first);
 
-  return page::from_pointer_and_length(
-    virtual_memory_commit(assume_not_null(p), 1u),
-    size
-  );
+  const auto length = pages_to_bytes(count.count());
+
+  // Pages that are shared with clones must be copied to the clones before
+  // they become writable, and so are committed by the copy-on-write state
+  if (m_cow_mapping != nullptr) {
+    m_cow_mapping->commit(first, count.count());
+  } else {
+    m_hooks->commit(assume_not_null(p), length);
+  }
+
+  const auto block = memory_block::from_pointer_and_length(assume_not_null(p), length);
+
+  mark_committed(first, count.count(), true);
+  if (m_dirty_tracker != nullptr) {
+    m_dirty_tracker->on_commit(first, count.count());
+  }
+
+  if (policy == commit_policy::prefault) {
+    prefault_block(block, size);
+  }
+  return block;
+}
+
+auto msl::virtual_memory::prefault(memory_block block, std::size_t concurrency)
+  -> void
+{
+  const auto size = page_size();
+  const auto pages = block_to_pages(block).count();
+  const auto threads = std::min(concurrency, pages);
+
+  if (threads <= 1u) {
+    prefault_block(block, size);
+    return;
+  }
+
+  // Each thread prefaults a contiguous run of pages; the first 'remainder'
+  // threads take one extra page so that the whole block is covered.
+  const auto pages_per_thread = pages / threads;
+  const auto remainder = pages % threads;
+
+  auto workers = std::vector<std::jthread>{};
+  auto errors = std::vector<std::exception_ptr>(threads - 1u);
+  workers.reserve(threads - 1u);
+
+  auto start = block.start_address();
+  for (auto i = 0u; i < threads; ++i) {
+    const auto count = pages_per_thread + ((i < remainder) ? 1u : 0u);
+    const auto chunk = memory_block::from_pointer_and_length(start, size * count);
+    start = chunk.end_address();
+
+    // The calling thread takes the final chunk rather than idling
+    if (i + 1u == threads) {
+      prefault_block(chunk, size);
+    } else {
+      workers.emplace_back([chunk, size, &error = errors[i]]{
+        try {
+          prefault_block(chunk, size);
+        } catch (...) {
+          error = std::current_exception();
+        }
+      });
+    }
+  }
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& error : errors) {
+    if (error != nullptr) MSL_UNLIKELY {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+auto msl::virtual_memory::decommit(std::size_t first,
+                                   uquantity<page> count,
+                                   decommit_policy policy)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Decommitting pages out of range");
+
+  const auto p = m_data + pages_to_bytes(first);
+
+  // Pages that are shared with clones must stay shared with later clones,
+  // and so are decommitted by the copy-on-write state instead
+  if (m_cow_mapping != nullptr) {
+    m_cow_mapping->decommit(first, count.count());
+  } else {
+    m_hooks->decommit(assume_not_null(p), pages_to_bytes(count.count()), policy);
+  }
+  mark_committed(first, count.count(), false);
+  if (m_dirty_tracker != nullptr) {
+    m_dirty_tracker->on_decommit(first, count.count());
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::protect(std::size_t first,
+                                  uquantity<page> count,
+                                  page_access access)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Protecting pages out of range");
+
+  const auto p = m_data + pages_to_bytes(first);
+
+  if (m_cow_mapping != nullptr) {
+    m_cow_mapping->protect(first, count.count(), access);
+  } else {
+    virtual_memory_protect(assume_not_null(p), pages_to_bytes(count.count()), access);
+  }
+  if (m_dirty_tracker != nullptr) {
+    m_dirty_tracker->on_protect(first, count.count(), access);
+  }
 }
 
-auto msl::virtual_memory::decommit(std::size_t n)
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::lock(std::size_t first, uquantity<page> count)
   -> void
 {
-  auto p = m_data + (n * page_size());
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Locking pages out of range");
+
+  const auto p = m_data + pages_to_bytes(first);
+
+  virtual_memory_lock(assume_not_null(p), pages_to_bytes(count.count()));
+}
+
+auto msl::virtual_memory::unlock(std::size_t first, uquantity<page> count)
+  -> void
+{
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Unlocking pages out of range");
+
+  const auto p = m_data + pages_to_bytes(first);
+
+  virtual_memory_unlock(assume_not_null(p), pages_to_bytes(count.count()));
+}
+
+auto msl::virtual_memory::unlock_all()
+  noexcept -> void
+{
+  if (empty()) {
+    return;
+  }
+  try {
+    virtual_memory_unlock(assume_not_null(m_data), size_in_bytes());
+  } catch (...) {
+    // Some systems refuse to unlock pages that were never locked, in which
+    // case there is nothing to unlock
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::set_temperature(std::size_t first,
+                                          uquantity<page> count,
+                                          page_temperature temperature)
+  noexcept -> bool
+{
+  MSL_ASSERT(first + count.count() <= m_pages.count(), "Advising pages out of range");
+
+  if (count.count() == 0u) {
+    return true;
+  }
+  const auto p = m_data + pages_to_bytes(first);
+
+  return virtual_memory_advise(assume_not_null(p), pages_to_bytes(count.count()), temperature);
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::set_fork_policy(fork_policy policy)
+  -> void
+{
+  if (!empty() && m_data != nullptr) {
+    virtual_memory_set_fork_policy(assume_not_null(m_data), size_in_bytes(), policy);
+  }
+  m_fork_policy = policy;
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::grow(uquantity<page> pages, growth_policy policy)
+  -> bool
+{
+  MSL_ASSERT(m_data != nullptr, "Growing a released virtual_memory object");
+
+  const auto old_size = size_in_bytes();
+  const auto new_size = old_size + pages_to_bytes(pages.count());
+  const auto p = assume_not_null(m_data);
+
+  // Only the system knows how to extend or move its own reservations
+  if (m_hooks != &virtual_memory_hooks::system()) {
+    return false;
+  }
+
+  // The bitmap is grown first, since growing the reservation cannot be undone
+  // if this fails. The new pages are never committed, so growing it early is
+  // harmless if the reservation cannot grow.
+  m_committed.resize(bitmap_words(m_pages + pages), 0u);
+
+  if (virtual_memory_extend(p, old_size, new_size, m_mode)) {
+    const auto extension = p + old_size.count();
+
+    // The extension is not yet part of the reservation, so it would leak if
+    // the mapping cannot take it on.
+    if (m_cow_mapping != nullptr) {
+      try {
+        m_cow_mapping->on_resize(p, (m_pages + pages).count());
+      } catch (...) {
+        try {
+          virtual_memory_release(extension, new_size - old_size);
+        } catch (...) {
+          // The extension is leaked, which only costs address space
+        }
+        throw;
+      }
+    }
+    m_pages += pages;
+
+    // The extension is a new mapping, which does not inherit the fork policy
+    // of the rest of the reservation.
+    if (m_fork_policy != fork_policy::inherit) {
+      virtual_memory_set_fork_policy(extension, new_size - old_size, m_fork_policy);
+    }
+    if (m_dirty_tracker != nullptr) {
+      m_dirty_tracker->on_resize(p, m_pages.count());
+    }
+    return true;
+  }
+  if (policy == growth_policy::in_place) {
+    return false;
+  }
+
+  const auto q = virtual_memory_relocate(p, old_size, new_size, m_mode);
+  if (q == nullptr) {
+    return false;
+  }
+  // The moved mappings keep their fork policy, but the rest of the new
+  // reservation is a fresh mapping that does not.
+  if (m_fork_policy != fork_policy::inherit) {
+    const auto extension = assume_not_null(q) + old_size.count();
+
+    virtual_memory_set_fork_policy(extension, new_size - old_size, m_fork_policy);
+  }
+  m_data = q;
+  m_pages += pages;
+  if (m_cow_mapping != nullptr) {
+    m_cow_mapping->on_resize(assume_not_null(q), m_pages.count());
+  }
+  if (m_dirty_tracker != nullptr) {
+    m_dirty_tracker->on_resize(assume_not_null(q), m_pages.count());
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::release()
+  noexcept -> std::byte*
+{
+  m_dirty_tracker.reset();
+  m_cow_mapping.reset();
+  m_committed.clear();
+
+  return std::exchange(m_data, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+// Dirty Tracking
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::track_dirty_pages()
+  -> dirty_tracking
+{
+  const auto mechanism = detail::dirty_tracking_supported(dirty_tracking::soft_dirty)
+    ? dirty_tracking::soft_dirty
+    : dirty_tracking::write_protect;
+
+  track_dirty_pages(mechanism);
+  return mechanism;
+}
+
+auto msl::virtual_memory::track_dirty_pages(dirty_tracking mechanism)
+  -> void
+{
+  MSL_ASSERT(m_data != nullptr, "Tracking a released virtual_memory object");
+  MSL_ASSERT(
+    m_cow_mapping == nullptr || mechanism != dirty_tracking::write_protect,
+    "Write-protect tracking cannot be combined with copy-on-write clones"
+  );
+
+  // The previous tracker must restore access to its pages before the new
+  // tracker protects them
+  m_dirty_tracker.reset();
+
+  auto tracker = detail::make_dirty_page_tracker(
+    assume_not_null(m_data),
+    m_pages.count(),
+    page_size(),
+    mechanism
+  );
+  tracker->start(m_committed);
+
+  m_dirty_tracker = std::move(tracker);
+}
+
+auto msl::virtual_memory::stop_tracking_dirty_pages()
+  noexcept -> void
+{
+  m_dirty_tracker.reset();
+}
+
+auto msl::virtual_memory::dirty_pages()
+  const -> std::vector<memory_block>
+{
+  MSL_ASSERT(m_dirty_tracker != nullptr, "Dirty pages are not being tracked");
+
+  return bitmap_to_blocks(m_dirty_tracker->dirty_pages());
+}
+
+auto msl::virtual_memory::checkpoint()
+  -> std::vector<memory_block>
+{
+  MSL_ASSERT(m_dirty_tracker != nullptr, "Dirty pages are not being tracked");
+
+  return bitmap_to_blocks(m_dirty_tracker->checkpoint());
+}
+
+//-----------------------------------------------------------------------------
+// Cloning
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::clone_cow()
+  -> virtual_memory
+{
+  MSL_ASSERT(m_data != nullptr, "Cloning a released virtual_memory object");
+  MSL_ASSERT(
+    m_dirty_tracker == nullptr || m_dirty_tracker->mechanism() != dirty_tracking::write_protect,
+    "Write-protect tracking cannot be combined with copy-on-write clones"
+  );
+
+  // Clones are remapped over the reservation, which only the system may do
+  // to its own reservations
+  if (m_mode == page_mode::huge_2mib || m_mode == page_mode::huge_1gib ||
+      m_hooks != &virtual_memory_hooks::system()) MSL_UNLIKELY {
+    throw std::system_error{std::make_error_code(std::errc::not_supported)};
+  }
+
+  if (m_cow_mapping == nullptr || !m_cow_mapping->is_source()) {
+    // A clone must stop sharing pages with its own source before it can
+    // become a source itself
+    if (m_cow_mapping != nullptr) {
+      m_cow_mapping->privatize();
+    }
+    auto source = detail::make_cow_source(
+      assume_not_null(m_data),
+      m_pages.count(),
+      page_size(),
+      m_committed
+    );
+    m_cow_mapping = std::move(source);
+
+    // The pages are new mappings, which do not inherit the fork policy
+    if (m_fork_policy != fork_policy::inherit) {
+      virtual_memory_set_fork_policy(assume_not_null(m_data), size_in_bytes(), m_fork_policy);
+    }
+  }
+
+  auto [data, mapping] = m_cow_mapping->clone(m_committed);
+
+  auto result = virtual_memory{
+    data.get(),
+    m_pages,
+    m_mode,
+    m_committed,
+    virtual_memory_hooks::system()
+  };
+  result.m_cow_mapping = std::move(mapping);
+
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Helpers
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory::mark_committed(std::size_t first,
+                                         std::size_t count,
+                                         bool committed)
+  noexcept -> void
+{
+  detail::set_bits(m_committed, first, count, committed);
+}
+
+auto msl::virtual_memory::bitmap_to_blocks(const std::vector<std::uint64_t>& bitmap)
+  const -> std::vector<memory_block>
+{
+  auto result = std::vector<memory_block>{};
+
+  detail::for_each_run(bitmap, [&](std::size_t first, std::size_t count) {
+    const auto p = assume_not_null(m_data) + pages_to_bytes(first).count();
+
+    result.push_back(memory_block::from_pointer_and_length(p, pages_to_bytes(count)));
+  });
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Constructors
+//-----------------------------------------------------------------------------
+
+msl::virtual_memory::virtual_memory(std::byte* data,
+                                    uquantity<page> pages,
+                                    page_mode mode,
+                                    std::vector<std::uint64_t> committed,
+                                    virtual_memory_hooks& hooks)
+  noexcept
+  : m_data{data},
+    m_pages{pages},
+    m_page_shift{static_cast<std::size_t>(std::countr_zero(page_size(mode).count()))},
+    m_mode{mode},
+    m_fork_policy{fork_policy::inherit},
+    m_hooks{&hooks},
+    m_committed{std::move(committed)},
+    m_dirty_tracker{},
+    m_cow_mapping{}
+{
 
-  virtual_memory_decommit(assume_not_null(p), 1u);
 }
@@ -0,0 +1,218 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/virtual_memory_cache.hpp"
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include <utility> // std::move
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::virtual_memory_cache::virtual_memory_cache()
+  : virtual_memory_cache{limits{}}
+{
+
+}
+
+msl::virtual_memory_cache::virtual_memory_cache(limits cache_limits)
+  : m_mutex{},
+    m_buckets{},
+    m_limits{cache_limits},
+    m_cached_size{bytes::zero()},
+    m_cached_reservations{0u}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Cache
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory_cache::acquire(uquantity<page> pages, page_mode mode)
+  -> virtual_memory
+{
+  {
+    const auto lock = std::lock_guard{m_mutex};
+    const auto it = m_buckets.find(key_type{pages.count(), mode});
+
+    if (it != m_buckets.end() && !it->second.empty()) MSL_LIKELY {
+      auto memory = std::move(it->second.back());
+      it->second.pop_back();
+
+      m_cached_size -= memory.size_in_bytes();
+      --m_cached_reservations;
+
+      return memory;
+    }
+  }
+  return virtual_memory::reserve(pages, mode);
+}
+
+auto msl::virtual_memory_cache::recycle(virtual_memory memory)
+  -> void
+{
+  if (memory.empty()) MSL_UNLIKELY {
+    return;
+  }
+
+  // Reservations are handed out by 'acquire' as if they were newly reserved,
+  // so those backed by other hooks, or whose pages are shared with clones,
+  // are never cached.
+  if (&memory.hooks() != &virtual_memory_hooks::system() || memory.is_copy_on_write()) {
+    return; // 'memory' is released on exit
+  }
+
+  const auto key = key_type{memory.pages().count(), memory.mode()};
+  const auto size = memory.size_in_bytes();
+
+  // The limits are checked before decommitting, so that a reservation that
+  // is about to be released does not pay for the system calls
+  const auto fits = [&] {
+    if (m_cached_size + size > m_limits.total_size) {
+      return false;
+    }
+    const auto it = m_buckets.find(key);
+    return it == m_buckets.end() || it->second.size() < m_limits.reservations_per_size.count();
+  };
+  {
+    const auto lock = std::lock_guard{m_mutex};
+    if (!fits()) {
+      return; // 'memory' is released on exit
+    }
+  }
+
+  // Restoring the reservation happens outside of the lock, since it requires
+  // system calls. The pages are reclaimed immediately, since lazily freed
+  // pages remain resident until the system is under memory pressure; locked
+  // pages cannot be reclaimed at all, so they are unlocked first.
+  memory.stop_tracking_dirty_pages();
+  memory.unlock_all();
+  if (memory.get_fork_policy() != virtual_memory::fork_policy::inherit) {
+    memory.set_fork_policy(virtual_memory::fork_policy::inherit);
+  }
+  memory.decommit(0u, memory.pages(), virtual_memory::decommit_policy::immediate);
+
+  // The cache may have been filled while the lock was not held
+  const auto lock = std::lock_guard{m_mutex};
+  if (!fits()) {
+    return; // 'memory' is released on exit
+  }
+
+  m_buckets[key].push_back(std::move(memory));
+  m_cached_size += size;
+  ++m_cached_reservations;
+}
+
+auto msl::virtual_memory_cache::trim()
+  -> void
+{
+  trim(bytes::zero());
+}
+
+auto msl::virtual_memory_cache::trim(bytes size)
+  -> void
+{
+  auto released = std::vector<virtual_memory>{};
+  {
+    const auto lock = std::lock_guard{m_mutex};
+    released = trim_locked(size, m_limits.reservations_per_size);
+  }
+  // 'released' is destroyed outside of the lock, releasing the reservations
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory_cache::get_limits()
+  const -> limits
+{
+  const auto lock = std::lock_guard{m_mutex};
+
+  return m_limits;
+}
+
+auto msl::virtual_memory_cache::set_limits(limits cache_limits)
+  -> void
+{
+  auto released = std::vector<virtual_memory>{};
+  {
+    const auto lock = std::lock_guard{m_mutex};
+    m_limits = cache_limits;
+    released = trim_locked(cache_limits.total_size, cache_limits.reservations_per_size);
+  }
+}
+
+auto msl::virtual_memory_cache::cached_size()
+  const -> bytes
+{
+  const auto lock = std::lock_guard{m_mutex};
+
+  return m_cached_size;
+}
+
+auto msl::virtual_memory_cache::cached_reservations()
+  const -> uquantity<virtual_memory>
+{
+  const auto lock = std::lock_guard{m_mutex};
+
+  return m_cached_reservations;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory_cache::trim_locked(bytes size,
+                                            uquantity<virtual_memory> reservations_per_size)
+  -> std::vector<virtual_memory>
+{
+  auto result = std::vector<virtual_memory>{};
+
+  const auto evict = [&](bucket_type& bucket) {
+    auto memory = std::move(bucket.back());
+    bucket.pop_back();
+
+    m_cached_size -= memory.size_in_bytes();
+    --m_cached_reservations;
+    result.push_back(std::move(memory));
+  };
+
+  for (auto& [key, bucket] : m_buckets) {
+    while (bucket.size() > reservations_per_size.count()) {
+      evict(bucket);
+    }
+  }
+
+  // Reservations with the most pages are evicted first, since they are the
+  // most likely to bring the cache back under the limit quickly.
+  for (auto it = m_buckets.rbegin(); it != m_buckets.rend(); ++it) {
+    while (m_cached_size > size && !it->second.empty()) {
+      evict(it->second);
+    }
+  }
+  return result;
+}
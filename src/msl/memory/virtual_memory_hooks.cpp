@@ -0,0 +1,71 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include "src/msl/memory/virtual_memory_impl.hpp"
+
+//-----------------------------------------------------------------------------
+// Static Functions
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory_hooks::system()
+  noexcept -> virtual_memory_hooks&
+{
+  static auto s_hooks = virtual_memory_hooks{};
+
+  return s_hooks;
+}
+
+//-----------------------------------------------------------------------------
+// Hooks
+//-----------------------------------------------------------------------------
+
+auto msl::virtual_memory_hooks::reserve(bytes size,
+                                        bytes align,
+                                        virtual_memory::page_mode mode)
+  -> not_null<std::byte*>
+{
+  return virtual_memory_reserve(size, align, mode);
+}
+
+auto msl::virtual_memory_hooks::commit(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  virtual_memory_commit(memory, size);
+}
+
+auto msl::virtual_memory_hooks::decommit(not_null<std::byte*> memory,
+                                         bytes size,
+                                         virtual_memory::decommit_policy policy)
+  -> void
+{
+  virtual_memory_decommit(memory, size, policy);
+}
+
+auto msl::virtual_memory_hooks::release(not_null<std::byte*> memory, bytes size)
+  noexcept -> void
+{
+  virtual_memory_release(memory, size);
+}
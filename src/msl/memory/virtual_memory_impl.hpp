@@ -28,6 +28,7 @@
 # pragma once
 #endif
 
+#include "msl/memory/virtual_memory.hpp"
 #include "msl/quantities/digital_quantity.hpp"
 #include "msl/pointers/not_null.hpp"
 
@@ -42,46 +43,208 @@ namespace msl {
 
   //--------------------------------------------------------------------------
 
-  /// \brief Reserves \p n pages of virtual memory.
+  /// \brief Reserves \p size bytes of virtual memory.
   ///
-  /// Each page is \ref virtual_memory_page_size in size. The memory may not
-  /// be used until after it has first been commited with a call to
-  /// \ref virtual_memory_commit
+  /// The memory may not be used until after it has first been commited with a
+  /// call to \ref virtual_memory_commit. The returned memory is aligned to
+  /// \p align, and must be committed in multiples of the page size of
+  /// \p mode.
   ///
   /// \throw std::system_error with the error code on failure
   /// \throw std::runtime_error if not available for target system
   ///
-  /// \param n the number of pages to reserve
+  /// \param size the number of bytes to reserve; a multiple of the page size
+  /// \param align the boundary to align to; a power-of-two multiple of the
+  ///        page size
+  /// \param mode the kind of pages that back the reservation
   /// \return pointer to the reserved memory
-  auto virtual_memory_reserve(std::size_t n) -> not_null<std::byte*>;
+  auto virtual_memory_reserve(bytes size,
+                              bytes align,
+                              virtual_memory::page_mode mode) -> not_null<std::byte*>;
 
-  /// \brief Commits \p n pages of memory to virtual memory
+  /// \brief Commits \p size bytes of memory to virtual memory
   ///
   /// \throw std::system_error with the error code on failure
   /// \throw std::runtime_error if not available for target system
   ///
   /// \param memory Memory pointing to a page to commit
-  /// \param n The number of pages to commit
+  /// \param size The number of bytes to commit; a multiple of the page size
   /// \return pointer to the committed memory
-  auto virtual_memory_commit(not_null<std::byte*> memory, std::size_t n) -> not_null<std::byte*>;
+  auto virtual_memory_commit(not_null<std::byte*> memory, bytes size) -> not_null<std::byte*>;
 
-  /// \brief Decommits \p n pages of memory to virtual memory
+  /// \brief Populates \p size bytes of committed memory with physical pages
+  ///
+  /// If the system is not able to populate the memory directly, this returns
+  /// `false` and the caller is responsible for touching the pages. Any other
+  /// failure -- such as running out of memory -- is reported, since touching
+  /// the pages would then only fail less gracefully.
+  ///
+  /// \throw std::system_error with the error code on failure
+  ///
+  /// \param memory Memory pointing to a committed page
+  /// \param size The number of bytes to populate; a multiple of the page size
+  /// \return `true` if the memory was populated
+  auto virtual_memory_populate(not_null<std::byte*> memory, bytes size) -> bool;
+
+  /// \brief Decommits \p size bytes of memory to virtual memory
   ///
   /// \throw std::system_error with the error code on failure
   /// \throw std::runtime_error if not available for target system
   ///
   /// \param memory Memory pointing to a page to decommit
-  /// \param n The number of pages to decommit
-  auto virtual_memory_decommit(not_null<std::byte*> memory, std::size_t n) -> void;
+  /// \param size The number of bytes to decommit; a multiple of the page size
+  /// \param policy The policy for returning the physical memory
+  auto virtual_memory_decommit(not_null<std::byte*> memory,
+                               bytes size,
+                               virtual_memory::decommit_policy policy) -> void;
+
+  /// \brief Changes the access permitted to \p size bytes of committed
+  ///        memory
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a committed page
+  /// \param size The number of bytes to protect; a multiple of the page size
+  /// \param access The access to permit
+  auto virtual_memory_protect(not_null<std::byte*> memory,
+                              bytes size,
+                              virtual_memory::page_access access) -> void;
+
+  /// \brief Locks \p size bytes of committed memory into physical memory
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a committed page
+  /// \param size The number of bytes to lock; a multiple of the page size
+  auto virtual_memory_lock(not_null<std::byte*> memory, bytes size) -> void;
+
+  /// \brief Unlocks \p size bytes of locked memory
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory Memory pointing to a locked page
+  /// \param size The number of bytes to unlock; a multiple of the page size
+  auto virtual_memory_unlock(not_null<std::byte*> memory, bytes size) -> void;
+
+  /// \brief Hints how soon \p size bytes of committed memory will next be
+  ///        accessed
+  ///
+  /// This is a best-effort request; the contents of the memory are always
+  /// preserved.
+  ///
+  /// \param memory Memory pointing to a committed page
+  /// \param size The number of bytes to advise; a multiple of the page size
+  /// \param temperature How soon the memory will be accessed
+  /// \return `true` if the system accepted the hint
+  auto virtual_memory_advise(not_null<std::byte*> memory,
+                             bytes size,
+                             virtual_memory::page_temperature temperature) noexcept -> bool;
+
+  /// \brief Sets how \p size bytes of reserved memory are inherited by child
+  ///        processes
+  ///
+  /// \throw std::system_error with the error code on failure
+  ///
+  /// \param memory Memory pointing to a reserved page
+  /// \param size The number of bytes to apply the policy to
+  /// \param policy The fork policy
+  auto virtual_memory_set_fork_policy(not_null<std::byte*> memory,
+                                      bytes size,
+                                      virtual_memory::fork_policy policy) -> void;
+
+  /// \brief Extends the reservation at \p memory from \p old_size bytes to
+  ///        \p new_size bytes, without moving it
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory The memory originally returned from virtual_memory_reserve
+  /// \param old_size The current size of the reservation
+  /// \param new_size The requested size of the reservation
+  /// \param mode the kind of pages that back the reservation
+  /// \return `true` if the reservation was extended, `false` if the adjacent
+  ///         address space is unavailable
+  auto virtual_memory_extend(not_null<std::byte*> memory,
+                             bytes old_size,
+                             bytes new_size,
+                             virtual_memory::page_mode mode) -> bool;
+
+  /// \brief Moves the reservation at \p memory into a new reservation of
+  ///        \p new_size bytes, without copying the contents
+  ///
+  /// On success, the original reservation no longer exists. On failure, the
+  /// original reservation is left intact, with its contents in place.
+  ///
+  /// The original reservation stays mapped while its contents are moved on
+  /// Linux 5.13 or later. Older kernels leave holes in its place until the
+  /// move completes, which another thread's mapping could claim before a
+  /// failed move puts the contents back.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory The memory originally returned from virtual_memory_reserve
+  /// \param old_size The current size of the reservation
+  /// \param new_size The requested size of the reservation
+  /// \param mode the kind of pages that back the reservation
+  /// \return the relocated memory, or `nullptr` if the system cannot relocate
+  ///         reservations
+  auto virtual_memory_relocate(not_null<std::byte*> memory,
+                               bytes old_size,
+                               bytes new_size,
+                               virtual_memory::page_mode mode) -> std::byte*;
+
+  /// \brief Maps the same \p size bytes of shared memory twice, back to back,
+  ///        over the reservation at \p memory
+  ///
+  /// The first mapping spans `[memory, memory + size)` and the second spans
+  /// `[memory + size, memory + 2 * size)`; writes to either are visible in
+  /// both. The memory is readable and writable.
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory The memory originally returned from virtual_memory_reserve,
+  ///        which must span at least `2 * size` bytes
+  /// \param size The number of bytes to mirror; a multiple of the page size
+  auto virtual_memory_map_mirrored(not_null<std::byte*> memory, bytes size) -> void;
+
+  /// \brief Counts the pages of \p page_size bytes in the range
+  ///        `[memory, memory + size)` that are at least partially resident
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory The memory originally returned from virtual_memory_reserve
+  /// \param size The number of bytes to query; a multiple of \p page_size
+  /// \param page_size The size of each page
+  /// \return the number of resident pages
+  auto virtual_memory_resident(not_null<std::byte*> memory,
+                               bytes size,
+                               bytes page_size) -> std::size_t;
+
+  /// \brief Reports the huge pages backing the range `[memory, memory + size)`
+  ///
+  /// \throw std::system_error with the error code on failure
+  /// \throw std::runtime_error if not available for target system
+  ///
+  /// \param memory The memory originally returned from virtual_memory_reserve
+  /// \param size The number of bytes to report on
+  /// \return the report
+  auto virtual_memory_huge_pages(not_null<std::byte*> memory, bytes size)
+    -> virtual_memory::huge_page_report;
 
-  /// \brief Releases \p n pages of virtual memory
+  /// \brief Releases \p size bytes of virtual memory
   ///
   /// \throw std::system_error with the error code on failure
   /// \throw std::runtime_error if not available for target system
   ///
   /// \param memory The memory originally returned from virtual_memory_reserve
-  /// \param n The number of pages to release
-  auto virtual_memory_release(not_null<std::byte*> memory, std::size_t n) -> void;
+  /// \param size The number of bytes to release
+  auto virtual_memory_release(not_null<std::byte*> memory, bytes size) -> void;
 
 } // namespace msl
 
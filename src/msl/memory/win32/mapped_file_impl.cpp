@@ -0,0 +1,130 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+#include "src/msl/memory/mapped_file_impl.hpp"
+
+#include "src/msl/memory/win32/windows.hpp"
+#include "msl/utilities/intrinsics.hpp"
+
+#include <system_error>
+
+// Files can only be mapped into existing reservations with placeholders,
+// which are unavailable for the targeted version of Windows. Without them,
+// the mapping cannot be grown at a stable address.
+
+namespace msl {
+  namespace {
+
+    [[noreturn]]
+    auto throw_not_supported() -> void {
+      const auto code = std::error_code{ERROR_NOT_SUPPORTED, std::system_category()};
+      throw std::system_error{code};
+    }
+
+  } // namespace <anonymous>
+} // namespace msl
+
+//--------------------------------------------------------------------------
+// Free Functions
+//--------------------------------------------------------------------------
+
+auto msl::mapped_file_open(const std::filesystem::path& path,
+                           mapped_file::sharing_mode mode)
+  -> std::intptr_t
+{
+  intrinsics::suppress_unused(path, mode);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_close(std::intptr_t file)
+  noexcept -> void
+{
+  intrinsics::suppress_unused(file);
+}
+
+auto msl::mapped_file_size(std::intptr_t file)
+  -> bytes
+{
+  intrinsics::suppress_unused(file);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_resize(std::intptr_t file, bytes size)
+  -> void
+{
+  intrinsics::suppress_unused(file, size);
+
+  throw_not_supported();
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::mapped_file_map(not_null<std::byte*> memory,
+                          bytes size,
+                          std::intptr_t file,
+                          bytes offset,
+                          mapped_file::sharing_mode mode)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size, file, offset, mode);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_map_anonymous(not_null<std::byte*> memory,
+                                    bytes size,
+                                    mapped_file::sharing_mode mode)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size, mode);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_unmap(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_sync(not_null<std::byte*> memory,
+                           bytes size,
+                           mapped_file::sync_mode mode)
+  -> void
+{
+  intrinsics::suppress_unused(memory, size, mode);
+
+  throw_not_supported();
+}
+
+auto msl::mapped_file_advise(not_null<std::byte*> memory,
+                             bytes size,
+                             mapped_file::access_pattern pattern)
+  noexcept -> void
+{
+  intrinsics::suppress_unused(memory, size, pattern);
+}
@@ -26,6 +26,7 @@
 #include "src/msl/memory/win32/windows.hpp"
 #include "msl/utilities/intrinsics.hpp"
 
+#include <cstdint> // std::uintptr_t
 #include <string>
 #include <system_error>
 
@@ -47,6 +48,18 @@ namespace msl {
       return bytes{static_cast<std::size_t>(system_info.dwPageSize)};
     }
 
+    /// \brief Determines the granularity that reservations are aligned to
+    ///
+    /// \return the allocation granularity
+    auto allocation_granularity()
+      noexcept -> bytes
+    {
+      ::SYSTEM_INFO system_info;
+      ::GetSystemInfo(&system_info);
+
+      return bytes{static_cast<std::size_t>(system_info.dwAllocationGranularity)};
+    }
+
     class windows_error_category : public std::error_category
     {
     public:
@@ -83,6 +96,67 @@ namespace msl {
       throw std::system_error{code};
     }
 
+    /// \brief Reserves \p size bytes of inaccessible memory at the address
+    ///        \p hint
+    ///
+    /// \param hint the address to reserve at, or nullptr for any address
+    /// \param size the number of bytes to reserve
+    /// \return the reserved memory
+    auto reserve_inaccessible(void* hint, bytes size)
+      -> not_null<std::byte*>
+    {
+      const auto p = ::VirtualAlloc(
+        hint,
+        size.count(),
+        MEM_RESERVE,
+        PAGE_NOACCESS
+      );
+
+      if (p == nullptr) MSL_UNLIKELY {
+        throw_system_error();
+      }
+
+      return assume_not_null(static_cast<std::byte*>(p));
+    }
+
+    /// \brief Reserves \p size bytes of inaccessible memory, aligned to an
+    ///        \p align boundary
+    ///
+    /// Windows cannot partially release a reservation, so this over-reserves
+    /// to discover an aligned address, releases it, and then reserves again at
+    /// the aligned address. Since another thread may claim the address in
+    /// between, this retries a bounded number of times.
+    ///
+    /// \param size the number of bytes to reserve
+    /// \param align the boundary to align the reservation to
+    /// \return the aligned memory
+    auto reserve_inaccessible_aligned(bytes size, bytes align)
+      -> not_null<std::byte*>
+    {
+      constexpr auto max_attempts = 8;
+
+      const auto mask = static_cast<std::uintptr_t>(align.count() - 1u);
+
+      for (auto i = 0; i < max_attempts; ++i) {
+        const auto p = reserve_inaccessible(nullptr, size + align);
+        const auto address = reinterpret_cast<std::uintptr_t>(p.get());
+        const auto aligned = (address + mask) & ~mask;
+
+        ::VirtualFree(p.get(), 0u, MEM_RELEASE);
+
+        const auto q = ::VirtualAlloc(
+          reinterpret_cast<void*>(aligned),
+          size.count(),
+          MEM_RESERVE,
+          PAGE_NOACCESS
+        );
+        if (q != nullptr) MSL_LIKELY {
+          return assume_not_null(static_cast<std::byte*>(q));
+        }
+      }
+      throw_system_error();
+    }
+
   } // namespace <anonymous>
 } // namespace msl
 
@@ -101,30 +175,43 @@ auto msl::virtual_memory_page_size()
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_reserve(std::size_t n)
+auto msl::virtual_memory_reserve(bytes size,
+                                 bytes align,
+                                 virtual_memory::page_mode mode)
   -> not_null<std::byte*>
 {
-  const auto size = n * virtual_memory_page_size();
-  const auto p = ::VirtualAlloc(
-    nullptr,
-    size.count(),
-    MEM_RESERVE,
-    PAGE_NOACCESS
-  );
+  switch (mode) {
+    case virtual_memory::page_mode::standard: {
+      // Reservations are always aligned to the allocation granularity, which
+      // is at least as large as a page.
+      if (align <= allocation_granularity()) {
+        return reserve_inaccessible(nullptr, size);
+      }
+      return reserve_inaccessible_aligned(size, align);
+    }
+    case virtual_memory::page_mode::transparent_huge: {
+      // Windows has no transparent huge pages; the best that can be done is
+      // to honor the alignment of the reservation.
+      const auto natural = virtual_memory::page_size(mode);
 
-  if (p == nullptr) MSL_UNLIKELY {
-    throw_system_error();
+      return reserve_inaccessible_aligned(size, (align < natural) ? natural : align);
+    }
+    case virtual_memory::page_mode::huge_2mib:
+    case virtual_memory::page_mode::huge_1gib: {
+      // Large pages on Windows must be committed at reservation time, and
+      // require the 'SeLockMemoryPrivilege'; this cannot model a reservation.
+      ::SetLastError(ERROR_NOT_SUPPORTED);
+      throw_system_error();
+    }
   }
-
-  return assume_not_null(static_cast<std::byte*>(p));
+  intrinsics::unreachable();
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_commit(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_commit(not_null<std::byte*> memory, bytes size)
   -> not_null<std::byte*>
 {
-  const auto size = n * virtual_memory_page_size();
   const auto region = ::VirtualAlloc(
     memory.get(),
     size.count(),
@@ -136,15 +223,31 @@ auto msl::virtual_memory_commit(not_null<std::byte*> memory, std::size_t n)
     throw_system_error();
   }
 
-  return assume_not_null(region);
+  return assume_not_null(static_cast<std::byte*>(region));
 }
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_decommit(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_populate(not_null<std::byte*> memory, bytes size)
+  -> bool
+{
+  // Windows has no way to populate demand-zero pages without touching them
+  intrinsics::suppress_unused(memory, size);
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_decommit(not_null<std::byte*> memory,
+                                  bytes size,
+                                  virtual_memory::decommit_policy policy)
   -> void
 {
-  const auto size = n * virtual_memory_page_size();
+  // MEM_DECOMMIT always returns the memory immediately. MEM_RESET could model
+  // lazy reclamation, but it leaves the pages accessible.
+  intrinsics::suppress_unused(policy);
+
   const auto result = ::VirtualFree(memory.get(), size.count(), MEM_DECOMMIT);
 
   if (result == 0) MSL_UNLIKELY {
@@ -154,9 +257,169 @@ auto msl::virtual_memory_decommit(not_null<std::byte*> memory, std::size_t n)
 
 //--------------------------------------------------------------------------
 
-auto msl::virtual_memory_release(not_null<std::byte*> memory, std::size_t n)
+auto msl::virtual_memory_protect(not_null<std::byte*> memory,
+                                 bytes size,
+                                 virtual_memory::page_access access)
+  -> void
+{
+  const auto protection = [&]() -> ::DWORD {
+    switch (access) {
+      case virtual_memory::page_access::none: {
+        return PAGE_NOACCESS;
+      }
+      case virtual_memory::page_access::read: {
+        return PAGE_READONLY;
+      }
+      case virtual_memory::page_access::read_write: {
+        return PAGE_READWRITE;
+      }
+    }
+    intrinsics::unreachable();
+  }();
+
+  auto old_protection = ::DWORD{};
+  const auto result = ::VirtualProtect(
+    memory.get(),
+    size.count(),
+    protection,
+    &old_protection
+  );
+
+  if (result == 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_lock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  if (::VirtualLock(memory.get(), size.count()) == 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+auto msl::virtual_memory_unlock(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  if (::VirtualUnlock(memory.get(), size.count()) == 0) MSL_UNLIKELY {
+    throw_system_error();
+  }
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_advise(not_null<std::byte*> memory,
+                                bytes size,
+                                virtual_memory::page_temperature temperature)
+  noexcept -> bool
+{
+  // PrefetchVirtualMemory is not available on every supported version of
+  // Windows, so warm pages are left to be faulted back in on access.
+  if (temperature == virtual_memory::page_temperature::warm) {
+    intrinsics::suppress_unused(memory, size);
+
+    return false;
+  }
+
+  // Unlocking pages that are not locked removes them from the working set,
+  // which is the closest equivalent to reclaiming them. This reports
+  // ERROR_NOT_LOCKED even though the pages were removed.
+  if (::VirtualUnlock(memory.get(), size.count()) == 0) {
+    return ::GetLastError() == ERROR_NOT_LOCKED;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_set_fork_policy(not_null<std::byte*> memory,
+                                         bytes size,
+                                         virtual_memory::fork_policy policy)
+  -> void
+{
+  // Windows has no 'fork', so there are no children to inherit anything
+  intrinsics::suppress_unused(memory, size, policy);
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_extend(not_null<std::byte*> memory,
+                                bytes old_size,
+                                bytes new_size,
+                                virtual_memory::page_mode mode)
+  -> bool
+{
+  // Each VirtualAlloc reservation must be released individually, so a
+  // reservation cannot be extended by reserving the adjacent address space.
+  intrinsics::suppress_unused(memory, old_size, new_size, mode);
+
+  return false;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_relocate(not_null<std::byte*> memory,
+                                  bytes old_size,
+                                  bytes new_size,
+                                  virtual_memory::page_mode mode)
+  -> std::byte*
+{
+  // Windows offers no way to move pages between reservations without copying
+  intrinsics::suppress_unused(memory, old_size, new_size, mode);
+
+  return nullptr;
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_map_mirrored(not_null<std::byte*> memory, bytes size)
+  -> void
+{
+  // Mapping views into an existing reservation requires placeholders, which
+  // are unavailable for the targeted version of Windows
+  intrinsics::suppress_unused(memory, size);
+
+  ::SetLastError(ERROR_NOT_SUPPORTED);
+  throw_system_error();
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_resident(not_null<std::byte*> memory,
+                                  bytes size,
+                                  bytes page_size)
+  -> std::size_t
+{
+  // QueryWorkingSetEx is unavailable for the targeted version of Windows
+  intrinsics::suppress_unused(memory, size, page_size);
+
+  ::SetLastError(ERROR_NOT_SUPPORTED);
+  throw_system_error();
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_huge_pages(not_null<std::byte*> memory, bytes size)
+  -> virtual_memory::huge_page_report
+{
+  // Reservations are never backed by large pages on Windows, but residency
+  // cannot be determined without QueryWorkingSetEx either
+  intrinsics::suppress_unused(memory, size);
+
+  ::SetLastError(ERROR_NOT_SUPPORTED);
+  throw_system_error();
+}
+
+//--------------------------------------------------------------------------
+
+auto msl::virtual_memory_release(not_null<std::byte*> memory, bytes size)
   -> void
 {
+  // MEM_RELEASE requires a size of 0, and frees the entire reservation
+  intrinsics::suppress_unused(size);
+
   const auto result = ::VirtualFree(memory.get(), 0u, MEM_RELEASE);
 
   if (result == 0) MSL_UNLIKELY {
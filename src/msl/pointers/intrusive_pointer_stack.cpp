@@ -23,6 +23,73 @@
 */
 #include "msl/pointers/intrusive_pointer_stack.hpp"
 
+//-----------------------------------------------------------------------------
+// Modifiers
+//-----------------------------------------------------------------------------
+
+auto msl::intrusive_pointer_stack::splice(intrusive_pointer_stack& other)
+  noexcept -> void
+{
+  if (other.m_head == nullptr) {
+    return;
+  }
+  if (m_head != nullptr) {
+    // Find the last entry of 'other', and link it to the top of this stack
+    auto last = other.m_head;
+    auto next = static_cast<std::byte*>(nullptr);
+    std::memcpy(&next, last, sizeof(std::byte*));
+    while (next != nullptr) {
+      last = next;
+      std::memcpy(&next, last, sizeof(std::byte*));
+    }
+    std::memcpy(last, &m_head, sizeof(std::byte*));
+  }
+  m_head = std::exchange(other.m_head, nullptr);
+}
+
+auto msl::intrusive_pointer_stack::splice(intrusive_pointer_stack& other,
+                                          not_null<std::byte*> last)
+  noexcept -> void
+{
+  MSL_ASSERT(other.m_head != nullptr);
+
+  std::memcpy(last.as_nullable(), &m_head, sizeof(std::byte*));
+  m_head = std::exchange(other.m_head, nullptr);
+}
+
+auto msl::intrusive_pointer_stack::split(uquantity<std::byte*> n)
+  noexcept -> intrusive_pointer_stack
+{
+  auto last = static_cast<std::byte*>(nullptr);
+  return split(n, last);
+}
+
+auto msl::intrusive_pointer_stack::split(uquantity<std::byte*> n,
+                                         std::byte*& last)
+  noexcept -> intrusive_pointer_stack
+{
+  auto result = intrusive_pointer_stack{};
+  last = nullptr;
+  if (n == 0u || m_head == nullptr) {
+    return result;
+  }
+
+  // Find the n'th entry, which becomes the last entry of the result
+  last = m_head;
+  auto next = static_cast<std::byte*>(nullptr);
+  std::memcpy(&next, last, sizeof(std::byte*));
+  for (auto i = std::size_t{1u}; i < n.count() && next != nullptr; ++i) {
+    last = next;
+    std::memcpy(&next, last, sizeof(std::byte*));
+  }
+
+  const auto null = static_cast<std::byte*>(nullptr);
+  std::memcpy(last, &null, sizeof(std::byte*));
+
+  result.m_head = std::exchange(m_head, next);
+  return result;
+}
+
 //-----------------------------------------------------------------------------
 // Lookup
 //-----------------------------------------------------------------------------
@@ -33,12 +100,12 @@ auto msl::intrusive_pointer_stack::contains(const std::byte* p)
   auto q = m_head;
 
   while (q != nullptr) {
-    auto next = static_cast<std::byte**>(nullptr);
-    std::memcpy(&next, q, sizeof(std::byte**));
     if (p == q) {
       return true;
     }
-    q = *next;
+    auto next = static_cast<std::byte*>(nullptr);
+    std::memcpy(&next, q, sizeof(std::byte*));
+    q = next;
   }
   return false;
 }
@@ -56,9 +123,9 @@ auto msl::intrusive_pointer_stack::size()
 
   // Count each non-null pointer
   while (p != nullptr) {
-    auto next = static_cast<std::byte**>(nullptr);
-    std::memcpy(&next, p, sizeof(std::byte**));
-    p = *next;
+    auto next = static_cast<std::byte*>(nullptr);
+    std::memcpy(&next, p, sizeof(std::byte*));
+    p = next;
     ++result;
   }
   return result;
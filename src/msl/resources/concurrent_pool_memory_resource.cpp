@@ -0,0 +1,250 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/concurrent_pool_memory_resource.hpp"
+
+#include <algorithm> // std::max
+#include <bit>       // std::bit_ceil
+#include <cstring>   // std::memcpy
+#include <new>       // placement-new
+#include <utility>   // std::move
+
+thread_local msl::detail::owned_slab_pool::current_entry
+  msl::detail::owned_slab_pool::s_current = {0u, nullptr};
+
+namespace msl::detail {
+namespace {
+
+  auto slab_pages_for(std::size_t block_size,
+                      std::size_t first_block,
+                      uquantity<virtual_memory::page> slab_pages)
+    noexcept -> uquantity<virtual_memory::page>
+  {
+    // Every slab must hold its header and at least one block, and must be a
+    // power of two in size so that it can be aligned to its own size
+    const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+    const auto min_bytes = first_block + block_size;
+    const auto min_pages = (min_bytes + page_size.count() - 1u) / page_size.count();
+
+    return uquantity<virtual_memory::page>{
+      std::bit_ceil(std::max(slab_pages.count(), min_pages))
+    };
+  }
+
+} // namespace <anonymous>
+} // namespace msl::detail
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::detail::owned_slab_pool::owned_slab_pool(std::size_t block_size,
+                                              alignment block_align,
+                                              uquantity<virtual_memory::page> slab_pages)
+  : m_id{thread_registry::register_owner()},
+    m_block_size{block_size},
+    m_block_align{block_align},
+    m_slab_pages{},
+    m_slab_align{alignment::at_boundary<1u>()},
+    m_first_block{},
+    m_mutex{},
+    m_heaps{},
+    m_idle_heaps{},
+    m_slabs{}
+{
+  MSL_ASSERT(block_size >= sizeof(std::byte*));
+  MSL_ASSERT(block_size % block_align.value().count() == 0u);
+
+  const auto align = block_align.value().count();
+  m_first_block = (sizeof(slab_header) + align - 1u) & ~(align - 1u);
+  m_slab_pages = slab_pages_for(block_size, m_first_block, slab_pages);
+
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+  m_slab_align = alignment::at_boundary(page_size * m_slab_pages.count());
+}
+
+msl::detail::owned_slab_pool::~owned_slab_pool()
+{
+  thread_registry::unregister_owner(m_id);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::detail::owned_slab_pool::slabs()
+  const -> std::size_t
+{
+  auto lock = std::lock_guard{m_mutex};
+
+  return m_slabs.size();
+}
+
+auto msl::detail::owned_slab_pool::blocks_per_slab()
+  const noexcept -> std::size_t
+{
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+  const auto slab_size = (page_size * m_slab_pages.count()).count();
+
+  return (slab_size - m_first_block) / m_block_size;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::detail::owned_slab_pool::find_local()
+  -> heap&
+{
+  auto* result = static_cast<heap*>(thread_registry::find(m_id));
+  if (result == nullptr) {
+    {
+      auto lock = std::lock_guard{m_mutex};
+      if (!m_idle_heaps.empty()) {
+        result = m_idle_heaps.back();
+        m_idle_heaps.pop_back();
+      } else {
+        // Every heap may become idle at once, so there is always room for
+        // retire to push it without allocating
+        m_idle_heaps.reserve(m_heaps.size() + 1u);
+
+        auto h = std::make_unique<heap>();
+        result = h.get();
+        m_heaps.push_back(std::move(h));
+      }
+    }
+    result->thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    try {
+      thread_registry::add(m_id, *this, result);
+    } catch (...) {
+      // The heap would never be retired, so it is made idle again rather
+      // than being lost along with its slabs
+      retire(result);
+      throw;
+    }
+  }
+  s_current = {m_id, result};
+  return *result;
+}
+
+auto msl::detail::owned_slab_pool::allocate_slow(heap& h)
+  -> not_null<std::byte*>
+{
+  // Only reclaim once the local stack is empty, so that the remote-free
+  // lists are taken in bulk rather than once per block
+  if (h.pending.load(std::memory_order_relaxed) != nullptr) {
+    reclaim(h);
+    if (!h.free.empty()) {
+      const auto p = h.free.peek();
+      h.free.pop();
+      return assume_not_null(p);
+    }
+  }
+  if (h.cursor == h.end) {
+    add_slab(h);
+  }
+  const auto p = h.cursor;
+  h.cursor += m_block_size;
+  return assume_not_null(p);
+}
+
+auto msl::detail::owned_slab_pool::deallocate_remote(slab_header* slab, std::byte* p)
+  noexcept -> void
+{
+  auto head = slab->remote_free.load(std::memory_order_relaxed);
+  do {
+    std::memcpy(p, &head, sizeof(std::byte*));
+  } while (!slab->remote_free.compare_exchange_weak(head, p,
+                                                    std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed));
+
+  // Only the first block freed since the owner last reclaimed the slab
+  // queues it; later blocks are taken along with the first
+  if (slab->queued.exchange(true, std::memory_order_seq_cst)) {
+    return;
+  }
+  auto& pending = slab->owner->pending;
+  auto next = pending.load(std::memory_order_relaxed);
+  do {
+    slab->next = next;
+  } while (!pending.compare_exchange_weak(next, slab,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
+
+auto msl::detail::owned_slab_pool::reclaim(heap& h)
+  noexcept -> void
+{
+  auto slab = h.pending.exchange(nullptr, std::memory_order_acquire);
+  while (slab != nullptr) {
+    const auto next_slab = slab->next;
+
+    // The slab is unqueued before its list is taken, so that a block pushed
+    // after the list is taken always queues the slab again
+    slab->queued.store(false, std::memory_order_seq_cst);
+    auto p = slab->remote_free.exchange(nullptr, std::memory_order_seq_cst);
+    while (p != nullptr) {
+      auto next = static_cast<std::byte*>(nullptr);
+      std::memcpy(&next, p, sizeof(std::byte*));
+
+      h.free.push(assume_not_null(p));
+      p = next;
+    }
+    slab = next_slab;
+  }
+}
+
+auto msl::detail::owned_slab_pool::add_slab(heap& h)
+  -> void
+{
+  auto* slab = static_cast<slab_header*>(nullptr);
+  {
+    auto lock = std::lock_guard{m_mutex};
+
+    auto memory = virtual_memory::reserve(m_slab_pages, m_slab_align);
+    memory.commit(0u, m_slab_pages);
+    slab = ::new (static_cast<void*>(memory.data())) slab_header{{nullptr}, {false}, nullptr, &h};
+    m_slabs.push_back(std::move(memory));
+  }
+
+  const auto base = reinterpret_cast<std::byte*>(slab);
+  h.cursor = base + m_first_block;
+  h.end = h.cursor + blocks_per_slab() * m_block_size;
+}
+
+auto msl::detail::owned_slab_pool::retire(void* state)
+  noexcept -> void
+{
+  const auto h = static_cast<heap*>(state);
+  if (s_current.owner == h) {
+    s_current = {0u, nullptr};
+  }
+
+  // The heap keeps its slabs and free blocks; blocks freed while it is idle
+  // are pushed onto the remote-free lists, since no thread owns it
+  h->thread.store(std::thread::id{}, std::memory_order_relaxed);
+
+  auto lock = std::lock_guard{m_mutex};
+  m_idle_heaps.push_back(h);
+}
@@ -0,0 +1,158 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/monotonic_memory_resource.hpp"
+
+#include <algorithm> // std::max, std::min
+#include <cstdint>   // std::uintptr_t
+#include <utility>   // std::move
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::monotonic_memory_resource::monotonic_memory_resource(memory_block block)
+  noexcept
+  : m_memory{std::nullopt},
+    m_begin{block.start_address().get()},
+    m_end{block.end_address().get()},
+    m_current{m_begin},
+    m_last{nullptr},
+    m_committed{m_end}
+{
+
+}
+
+msl::monotonic_memory_resource::monotonic_memory_resource(virtual_memory memory)
+  noexcept
+  : m_memory{std::move(memory)},
+    m_begin{m_memory->data()},
+    m_end{m_begin + m_memory->size_in_bytes().count()},
+    m_current{m_begin},
+    m_last{nullptr},
+    m_committed{m_begin}
+{
+  MSL_ASSERT(!m_memory->empty());
+
+  // Pages committed up front are treated as part of the committed prefix.
+  auto n = std::size_t{0u};
+  while (n < m_memory->pages().count() && m_memory->is_committed(n)) {
+    ++n;
+  }
+  m_committed = m_begin + (m_memory->page_size() * n).count();
+}
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+auto msl::monotonic_memory_resource::release()
+  noexcept -> void
+{
+  m_current = m_begin;
+  m_last = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::monotonic_memory_resource::allocate_bytes(std::size_t size,
+                                                    alignment align)
+  -> std::byte*
+{
+  const auto address = reinterpret_cast<std::uintptr_t>(m_current);
+  const auto mask    = static_cast<std::uintptr_t>(align.value().count() - 1u);
+  const auto padding = static_cast<std::size_t>(((address + mask) & ~mask) - address);
+  const auto remaining = static_cast<std::size_t>(m_end - m_current);
+
+  if (padding > remaining || size > remaining - padding) MSL_UNLIKELY {
+    return nullptr;
+  }
+
+  const auto result = m_current + padding;
+  ensure_committed(result + size);
+
+  m_last = result;
+  m_current = result + size;
+  return result;
+}
+
+auto msl::monotonic_memory_resource::resize_bytes(std::byte* p,
+                                                  std::size_t old_size,
+                                                  std::size_t new_size)
+  -> bool
+{
+  MSL_ASSERT(m_begin <= p && p + old_size <= m_current);
+
+  const auto is_last = (p == m_last && p + old_size == m_current);
+
+  if (new_size <= old_size) {
+    if (is_last) {
+      m_current = p + new_size;
+    }
+    return true;
+  }
+  if (!is_last) {
+    return false;
+  }
+  if (new_size > static_cast<std::size_t>(m_end - p)) MSL_UNLIKELY {
+    return false;
+  }
+
+  ensure_committed(p + new_size);
+  m_current = p + new_size;
+  return true;
+}
+
+auto msl::monotonic_memory_resource::deallocate_bytes(std::byte* p,
+                                                      std::size_t size)
+  noexcept -> void
+{
+  if (p == m_last && p + size == m_current) {
+    m_current = p;
+    m_last = nullptr;
+  }
+}
+
+auto msl::monotonic_memory_resource::ensure_committed(std::byte* end)
+  -> void
+{
+  if (end <= m_committed) {
+    return;
+  }
+  MSL_ASSERT(m_memory.has_value());
+
+  const auto page_size = m_memory->page_size().count();
+  const auto total     = m_memory->pages().count();
+  const auto committed = static_cast<std::size_t>(m_committed - m_begin) / page_size;
+  const auto needed    = (static_cast<std::size_t>(end - m_begin) + page_size - 1u) / page_size;
+
+  // Committing at least as much as is already committed doubles the committed
+  // region each time, which amortizes the cost of the system calls.
+  const auto count = std::min(std::max(needed, committed * 2u), total) - committed;
+
+  m_memory->commit(committed, uquantity<virtual_memory::page>{count});
+  m_committed += page_size * count;
+}
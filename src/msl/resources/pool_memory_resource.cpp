@@ -0,0 +1,115 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/pool_memory_resource.hpp"
+
+#include <algorithm> // std::max
+#include <utility>   // std::move, std::exchange
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::detail::pool_resource_base::pool_resource_base(std::size_t block_size,
+                                                    alignment block_align,
+                                                    uquantity<virtual_memory::page> slab_pages)
+  noexcept
+  : m_free{},
+    m_cursor{nullptr},
+    m_end{nullptr},
+    m_slabs{},
+    m_next_slab{0u},
+    m_block_size{block_size},
+    m_block_align{block_align},
+    m_slab_pages{slab_pages}
+{
+  MSL_ASSERT(block_size >= sizeof(std::byte*));
+  MSL_ASSERT(block_size % block_align.value().count() == 0u);
+
+  // Every slab must hold at least one block
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+  const auto min_pages = (block_size + page_size.count() - 1u) / page_size.count();
+  m_slab_pages = uquantity<virtual_memory::page>{
+    std::max(slab_pages.count(), min_pages)
+  };
+}
+
+msl::detail::pool_resource_base::pool_resource_base(pool_resource_base&& other)
+  noexcept
+  : m_free{std::move(other.m_free)},
+    m_cursor{std::exchange(other.m_cursor, nullptr)},
+    m_end{std::exchange(other.m_end, nullptr)},
+    m_slabs{std::move(other.m_slabs)},
+    m_next_slab{std::exchange(other.m_next_slab, 0u)},
+    m_block_size{other.m_block_size},
+    m_block_align{other.m_block_align},
+    m_slab_pages{other.m_slab_pages}
+{
+
+}
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+auto msl::detail::pool_resource_base::release()
+  noexcept -> void
+{
+  m_free.reset();
+  m_cursor = nullptr;
+  m_end = nullptr;
+  m_next_slab = 0u;
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::detail::pool_resource_base::blocks_per_slab()
+  const noexcept -> std::size_t
+{
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+
+  return (page_size * m_slab_pages.count()).count() / m_block_size;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::detail::pool_resource_base::carve_from_next_slab()
+  -> not_null<std::byte*>
+{
+  if (m_next_slab == m_slabs.size()) {
+    auto memory = virtual_memory::reserve(m_slab_pages, m_block_align);
+    memory.commit(0u, m_slab_pages);
+    m_slabs.push_back(std::move(memory));
+  }
+  const auto& slab = m_slabs[m_next_slab++];
+
+  m_cursor = slab.data();
+  m_end = m_cursor + blocks_per_slab() * m_block_size;
+
+  return assume_not_null(std::exchange(m_cursor, m_cursor + m_block_size));
+}
@@ -0,0 +1,92 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/slab_memory_resource.hpp"
+
+#include <utility> // std::move
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::slab_memory_resource::slab_memory_resource()
+  : slab_memory_resource{options{}}
+{
+
+}
+
+msl::slab_memory_resource::slab_memory_resource(options resource_options)
+  : m_classes{},
+    m_large{}
+{
+  m_classes.reserve(size_classes.size());
+  for (auto i = std::size_t{0u}; i < size_classes.size(); ++i) {
+    m_classes.emplace_back(
+      size_classes[i].count(),
+      size_classes.alignment_of(i),
+      resource_options.slab_pages
+    );
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::slab_memory_resource::slabs()
+  const noexcept -> std::size_t
+{
+  auto result = std::size_t{0u};
+  for (const auto& c : m_classes) {
+    result += c.slabs();
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::slab_memory_resource::allocate_large(bytes size, alignment align)
+  -> not_null<std::byte*>
+{
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+  const auto pages = (size.count() + page_size.count() - 1u) / page_size.count();
+
+  auto memory = virtual_memory::reserve(uquantity<page>{pages}, align);
+  memory.commit(0u, uquantity<page>{pages});
+
+  const auto p = memory.data();
+  m_large.emplace(p, std::move(memory));
+  return assume_not_null(p);
+}
+
+auto msl::slab_memory_resource::deallocate_large(std::byte* p)
+  noexcept -> void
+{
+  const auto it = m_large.find(p);
+  MSL_ASSERT(it != m_large.end(), "Deallocating memory not from this resource");
+
+  m_large.erase(it);
+}
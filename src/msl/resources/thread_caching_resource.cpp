@@ -0,0 +1,185 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/thread_caching_resource.hpp"
+
+#include <algorithm> // std::min, std::erase_if
+
+thread_local msl::detail::thread_cache::current_entry
+  msl::detail::thread_cache::s_current = {0u, nullptr};
+
+//-----------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//-----------------------------------------------------------------------------
+
+msl::detail::thread_cache::local_cache::local_cache(std::size_t size_classes)
+  : bins{std::make_unique<local_bin[]>(size_classes)}
+{
+
+}
+
+msl::detail::thread_cache::thread_cache(block_source& source,
+                                        std::size_t size_classes,
+                                        std::size_t batch_size)
+  : m_source{&source},
+    m_id{thread_registry::register_owner()},
+    m_size_classes{size_classes},
+    m_batch_size{batch_size},
+    m_central{std::make_unique<central_bin[]>(size_classes)},
+    m_source_mutex{},
+    m_locals_mutex{},
+    m_locals{}
+{
+  MSL_ASSERT(batch_size > 0u);
+}
+
+msl::detail::thread_cache::~thread_cache()
+{
+  thread_registry::unregister_owner(m_id);
+}
+
+//-----------------------------------------------------------------------------
+// Observers
+//-----------------------------------------------------------------------------
+
+auto msl::detail::thread_cache::central_blocks(std::size_t size_class)
+  const -> std::size_t
+{
+  MSL_ASSERT(size_class < m_size_classes);
+
+  const auto& central = m_central[size_class];
+  auto lock = std::lock_guard{central.mutex};
+
+  return central.count;
+}
+
+//-----------------------------------------------------------------------------
+// Private Functions
+//-----------------------------------------------------------------------------
+
+auto msl::detail::thread_cache::find_local()
+  -> local_cache&
+{
+  if (auto* const existing = find_existing_local(); existing != nullptr) {
+    return *existing;
+  }
+  auto cache = std::make_unique<local_cache>(m_size_classes);
+  auto* const result = cache.get();
+  {
+    auto lock = std::lock_guard{m_locals_mutex};
+    m_locals.push_back(std::move(cache));
+  }
+  thread_registry::add(m_id, *this, result);
+  s_current = {m_id, result};
+  return *result;
+}
+
+auto msl::detail::thread_cache::find_existing_local()
+  noexcept -> local_cache*
+{
+  auto* const result = static_cast<local_cache*>(thread_registry::find(m_id));
+  if (result != nullptr) {
+    s_current = {m_id, result};
+  }
+  return result;
+}
+
+auto msl::detail::thread_cache::refill(std::size_t size_class, local_bin& bin)
+  -> void
+{
+  auto& central = m_central[size_class];
+  {
+    auto lock = std::lock_guard{central.mutex};
+
+    if (central.count > 0u) {
+      const auto count = std::min(central.count, m_batch_size);
+      auto batch = central.blocks.split(uquantity<std::byte*>{count});
+      central.count -= count;
+
+      // The bin is empty, so this only relinks the head
+      bin.blocks.splice(batch);
+      bin.count += count;
+      return;
+    }
+  }
+
+  auto lock = std::lock_guard{m_source_mutex};
+  for (auto i = std::size_t{0u}; i < m_batch_size; ++i) {
+    bin.blocks.push(m_source->allocate_block(size_class));
+    ++bin.count;
+  }
+}
+
+auto msl::detail::thread_cache::flush(std::size_t size_class, local_bin& bin)
+  noexcept -> void
+{
+  // The batch is walked before the lock is taken, so that splicing it under
+  // the lock is constant-time
+  auto last = static_cast<std::byte*>(nullptr);
+  auto batch = bin.blocks.split(uquantity<std::byte*>{m_batch_size}, last);
+  bin.count -= m_batch_size;
+
+  auto& central = m_central[size_class];
+  auto lock = std::lock_guard{central.mutex};
+  central.blocks.splice(batch, assume_not_null(last));
+  central.count += m_batch_size;
+}
+
+auto msl::detail::thread_cache::release(std::size_t size_class,
+                                        not_null<std::byte*> p)
+  noexcept -> void
+{
+  auto& central = m_central[size_class];
+  auto lock = std::lock_guard{central.mutex};
+  central.blocks.push(p);
+  ++central.count;
+}
+
+auto msl::detail::thread_cache::retire(void* state)
+  noexcept -> void
+{
+  const auto cache = static_cast<local_cache*>(state);
+  if (s_current.cache == cache) {
+    s_current = {0u, nullptr};
+  }
+
+  for (auto i = std::size_t{0u}; i < m_size_classes; ++i) {
+    auto& bin = cache->bins[i];
+    if (bin.count == 0u) {
+      continue;
+    }
+    auto last = static_cast<std::byte*>(nullptr);
+    auto blocks = bin.blocks.split(uquantity<std::byte*>{bin.count}, last);
+
+    auto& central = m_central[i];
+    auto lock = std::lock_guard{central.mutex};
+    central.blocks.splice(blocks, assume_not_null(last));
+    central.count += std::exchange(bin.count, 0u);
+  }
+
+  auto lock = std::lock_guard{m_locals_mutex};
+  std::erase_if(m_locals, [&](const std::unique_ptr<local_cache>& p) {
+    return p.get() == cache;
+  });
+}
@@ -0,0 +1,152 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) 2022 Matthew Rodusek All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+*/
+
+#include "msl/resources/thread_registry.hpp"
+
+#include <algorithm>     // std::find_if, std::erase_if
+#include <atomic>        // std::atomic
+#include <mutex>         // std::mutex, std::lock_guard
+#include <unordered_set> // std::unordered_set
+#include <vector>        // std::vector
+
+namespace {
+
+  // The ids of every live owner. Threads that exit only retire the state of
+  // owners that are still live.
+  struct live_owners
+  {
+    std::mutex mutex;
+    std::unordered_set<std::uint64_t> ids;
+  };
+
+  auto get_live_owners() -> live_owners&
+  {
+    static auto s_live_owners = live_owners{};
+
+    return s_live_owners;
+  }
+
+  std::atomic<std::uint64_t> g_next_id{1u};
+
+  /////////////////////////////////////////////////////////////////////////////
+  /// \brief The state of every owner used by a single thread, which is
+  ///        retired when the thread exits
+  /////////////////////////////////////////////////////////////////////////////
+  class thread_states
+  {
+  public:
+
+    struct entry
+    {
+      std::uint64_t id;
+      msl::detail::thread_state_owner* owner;
+      void* state;
+    };
+
+    thread_states() = default;
+    thread_states(const thread_states&) = delete;
+
+    ~thread_states()
+    {
+      auto& live = get_live_owners();
+      auto lock = std::lock_guard{live.mutex};
+
+      // Holding the lock prevents any owner from being destroyed mid-retirement
+      for (const auto& e : entries) {
+        if (live.ids.contains(e.id)) {
+          e.owner->retire(e.state);
+        }
+      }
+    }
+
+    auto operator=(const thread_states&) -> thread_states& = delete;
+
+    std::vector<entry> entries;
+  };
+
+  auto get_thread_states() -> thread_states&
+  {
+    static thread_local auto s_thread_states = thread_states{};
+
+    return s_thread_states;
+  }
+
+} // namespace <anonymous>
+
+//-----------------------------------------------------------------------------
+// Owners
+//-----------------------------------------------------------------------------
+
+auto msl::detail::thread_registry::register_owner()
+  -> std::uint64_t
+{
+  const auto id = g_next_id.fetch_add(1u, std::memory_order_relaxed);
+
+  auto& live = get_live_owners();
+  auto lock = std::lock_guard{live.mutex};
+  live.ids.insert(id);
+
+  return id;
+}
+
+auto msl::detail::thread_registry::unregister_owner(std::uint64_t id)
+  noexcept -> void
+{
+  auto& live = get_live_owners();
+  auto lock = std::lock_guard{live.mutex};
+  live.ids.erase(id);
+}
+
+//-----------------------------------------------------------------------------
+// Thread State
+//-----------------------------------------------------------------------------
+
+auto msl::detail::thread_registry::find(std::uint64_t id)
+  noexcept -> void*
+{
+  const auto& entries = get_thread_states().entries;
+
+  const auto it = std::find_if(entries.begin(), entries.end(), [&](const auto& e) {
+    return e.id == id;
+  });
+  return (it == entries.end()) ? nullptr : it->state;
+}
+
+auto msl::detail::thread_registry::add(std::uint64_t id,
+                                       thread_state_owner& owner,
+                                       void* state)
+  -> void
+{
+  auto& entries = get_thread_states().entries;
+  {
+    // Forget the state of owners that have since been destroyed
+    auto& live = get_live_owners();
+    auto lock = std::lock_guard{live.mutex};
+
+    std::erase_if(entries, [&](const auto& e) {
+      return !live.ids.contains(e.id);
+    });
+  }
+  entries.push_back({id, &owner, state});
+}
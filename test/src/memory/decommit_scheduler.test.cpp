@@ -0,0 +1,225 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/decommit_scheduler.hpp"
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <system_error>
+
+namespace msl::test {
+
+//==============================================================================
+// class : decommit_scheduler
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+  using clock = decommit_scheduler::clock;
+
+  const auto decay = std::chrono::seconds{10};
+
+  auto make_options() -> decommit_scheduler::options
+  {
+    return decommit_scheduler::options{
+      .decay = decay,
+      .pressure_threshold = gibibytes{1u},
+      .policy = virtual_memory::decommit_policy::lazy,
+    };
+  }
+
+  /// \brief Hooks that fail to decommit once told to
+  class failing_hooks : public virtual_memory_hooks
+  {
+  public:
+
+    auto decommit(not_null<std::byte*> memory,
+                  bytes size,
+                  virtual_memory::decommit_policy policy)
+      -> void override
+    {
+      if (fail) {
+        throw std::system_error{std::make_error_code(std::errc::not_enough_memory)};
+      }
+      virtual_memory_hooks::decommit(memory, size, policy);
+    }
+
+    bool fail = false;
+  };
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Scheduling
+//------------------------------------------------------------------------------
+
+TEST_CASE("decommit_scheduler::schedule(std::size_t, uquantity<page>, time_point)", "[scheduling]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{8u});
+  const auto now = clock::time_point{};
+
+  SECTION("Pages are not yet scheduled") {
+    auto sut = decommit_scheduler{memory, make_options()};
+
+    sut.schedule(2u, pages{3u}, now);
+
+    SECTION("Schedules the pages") {
+      REQUIRE(sut.scheduled_pages() == 3u);
+      REQUIRE_FALSE(sut.is_scheduled(1u));
+      REQUIRE(sut.is_scheduled(2u));
+      REQUIRE(sut.is_scheduled(4u));
+      REQUIRE_FALSE(sut.is_scheduled(5u));
+    }
+  }
+  SECTION("Pages are already scheduled") {
+    auto sut = decommit_scheduler{memory, make_options()};
+    sut.schedule(2u, pages{3u}, now);
+
+    sut.schedule(3u, pages{4u}, now + decay);
+
+    SECTION("Does not count pages twice") {
+      REQUIRE(sut.scheduled_pages() == 5u);
+    }
+    SECTION("Reschedules the overlapping pages") {
+      REQUIRE(sut.purge(now + decay) == 1u);
+      REQUIRE(sut.scheduled_pages() == 4u);
+    }
+  }
+  SECTION("Pages exceed the pressure threshold") {
+    auto options = make_options();
+    options.pressure_threshold = memory.page_size() * 4u;
+    auto sut = decommit_scheduler{memory, options};
+    sut.schedule(0u, pages{4u}, now);
+
+    sut.schedule(4u, pages{1u}, now);
+
+    SECTION("Decommits all scheduled pages") {
+      REQUIRE(sut.scheduled_pages() == 0u);
+    }
+  }
+}
+
+TEST_CASE("decommit_scheduler::cancel(std::size_t, uquantity<page>)", "[scheduling]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{8u});
+  auto sut = decommit_scheduler{memory, make_options()};
+  sut.schedule(0u, pages{8u}, clock::time_point{});
+
+  SECTION("Pages are in the middle of a scheduled run") {
+    sut.cancel(3u, pages{2u});
+
+    SECTION("Splits the scheduled run") {
+      REQUIRE(sut.scheduled_pages() == 6u);
+      REQUIRE(sut.is_scheduled(2u));
+      REQUIRE_FALSE(sut.is_scheduled(3u));
+      REQUIRE_FALSE(sut.is_scheduled(4u));
+      REQUIRE(sut.is_scheduled(5u));
+    }
+    SECTION("Keeps cancelled pages committed") {
+      sut.purge_all();
+      *memory[3u].data() = std::byte{42};
+
+      REQUIRE(*memory[3u].data() == std::byte{42});
+    }
+  }
+  SECTION("Pages are not scheduled") {
+    sut.cancel(0u, pages{8u});
+    sut.cancel(0u, pages{8u});
+
+    SECTION("Does nothing") {
+      REQUIRE(sut.scheduled_pages() == 0u);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Purging
+//------------------------------------------------------------------------------
+
+TEST_CASE("decommit_scheduler::purge(time_point)", "[purging]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{8u});
+  auto sut = decommit_scheduler{memory, make_options()};
+  const auto now = clock::time_point{};
+
+  sut.schedule(0u, pages{2u}, now);
+  sut.schedule(2u, pages{2u}, now + std::chrono::seconds{1});
+  sut.schedule(6u, pages{2u}, now + decay);
+
+  SECTION("No pages have decayed") {
+    const auto result = sut.purge(now + decay - std::chrono::seconds{1});
+
+    SECTION("Decommits nothing") {
+      REQUIRE(result == 0u);
+      REQUIRE(sut.scheduled_pages() == 6u);
+    }
+  }
+  SECTION("Some pages have decayed") {
+    const auto result = sut.purge(now + decay + std::chrono::seconds{1});
+
+    SECTION("Decommits the decayed pages") {
+      REQUIRE(result == 4u);
+      REQUIRE_FALSE(sut.is_scheduled(0u));
+      REQUIRE_FALSE(sut.is_scheduled(3u));
+    }
+    SECTION("Keeps the remaining pages scheduled") {
+      REQUIRE(sut.scheduled_pages() == 2u);
+      REQUIRE(sut.is_scheduled(6u));
+    }
+  }
+}
+
+TEST_CASE("decommit_scheduler::purge_all()", "[purging]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{8u});
+  auto sut = decommit_scheduler{memory, make_options()};
+  sut.schedule(0u, pages{2u}, clock::time_point{});
+  sut.schedule(4u, pages{2u}, clock::now());
+
+  const auto result = sut.purge_all();
+
+  SECTION("Decommits all scheduled pages") {
+    REQUIRE(result == 4u);
+    REQUIRE(sut.scheduled_pages() == 0u);
+  }
+}
+
+TEST_CASE("decommit_scheduler::purge_all() fails to decommit", "[purging]") {
+  auto hooks = failing_hooks{};
+  auto memory = virtual_memory::reserve(pages{8u}, hooks);
+  memory.commit(0u, pages{8u});
+  auto sut = decommit_scheduler{memory, make_options()};
+  sut.schedule(0u, pages{2u}, clock::time_point{});
+  sut.schedule(4u, pages{2u}, clock::time_point{});
+
+  hooks.fail = true;
+
+  SECTION("Throws") {
+    REQUIRE_THROWS_AS(sut.purge_all(), std::system_error);
+  }
+  SECTION("Keeps the pages scheduled") {
+    try {
+      sut.purge_all();
+    } catch (const std::system_error&) {}
+
+    REQUIRE(sut.scheduled_pages() == 4u);
+    REQUIRE(sut.is_scheduled(0u));
+    REQUIRE(sut.is_scheduled(5u));
+  }
+  SECTION("Decommits the pages once decommitting succeeds") {
+    try {
+      sut.purge_all();
+    } catch (const std::system_error&) {}
+    hooks.fail = false;
+
+    REQUIRE(sut.purge_all() == 4u);
+    REQUIRE(sut.scheduled_pages() == 0u);
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,264 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/mapped_file.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace msl::test {
+
+//==============================================================================
+// class : mapped_file
+//==============================================================================
+
+namespace {
+
+  /// \brief A uniquely named file in the temporary directory that is removed
+  ///        on destruction
+  ///
+  /// Names are unique so that concurrent runs of the tests do not collide.
+  class temporary_file
+  {
+  public:
+    explicit temporary_file(const char* name)
+      : m_path{std::filesystem::temp_directory_path() / unique_name(name)}
+    {
+      std::filesystem::remove(m_path);
+    }
+
+    ~temporary_file()
+    {
+      std::filesystem::remove(m_path);
+    }
+
+    auto path() const -> const std::filesystem::path& { return m_path; }
+
+  private:
+    static auto unique_name(const char* name) -> std::string
+    {
+      static auto s_counter = std::atomic<unsigned>{0u};
+
+      auto device = std::random_device{};
+      const auto id = (std::uint64_t{device()} << 32u) | device();
+
+      return "msl.mapped_file." + std::string{name} + "." + std::to_string(id)
+        + "." + std::to_string(s_counter++) + ".test";
+    }
+
+    std::filesystem::path m_path;
+  };
+
+  auto read_byte(const std::filesystem::path& path, std::size_t offset) -> char
+  {
+    auto file = std::ifstream{path, std::ios::binary};
+    file.seekg(static_cast<std::streamoff>(offset));
+
+    return static_cast<char>(file.get());
+  }
+
+  const auto capacity = uquantity<mapped_file::page>{16u};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Static Functions
+//------------------------------------------------------------------------------
+
+TEST_CASE("mapped_file::open(const path&, uquantity<page>, sharing_mode)", "[factory]") {
+  const auto file = temporary_file{"open"};
+
+  SECTION("File does not exist") {
+    const auto sut = mapped_file::open(file.path(), capacity);
+
+    SECTION("Creates an empty file") {
+      REQUIRE(std::filesystem::exists(file.path()));
+      REQUIRE(sut.size() == bytes::zero());
+      REQUIRE(sut.pages() == 0u);
+    }
+    SECTION("Reserves the capacity") {
+      REQUIRE(sut.capacity() == capacity);
+    }
+  }
+  SECTION("File has existing contents") {
+    {
+      auto out = std::ofstream{file.path(), std::ios::binary};
+      out << "hello world";
+    }
+    const auto sut = mapped_file::open(file.path(), capacity);
+
+    SECTION("Maps the contents") {
+      REQUIRE(sut.size() == bytes{11u});
+      REQUIRE(sut.pages() == 1u);
+      REQUIRE(*sut.data() == std::byte{'h'});
+    }
+  }
+  SECTION("Mode is read_only") {
+    SECTION("File does not exist") {
+      SECTION("Throws system_error") {
+        REQUIRE_THROWS_AS(
+          mapped_file::open(file.path(), capacity, mapped_file::sharing_mode::read_only),
+          std::system_error
+        );
+        REQUIRE_FALSE(std::filesystem::exists(file.path()));
+      }
+    }
+    SECTION("File has existing contents") {
+      {
+        auto out = std::ofstream{file.path(), std::ios::binary};
+        out << "hello world";
+      }
+      std::filesystem::permissions(file.path(), std::filesystem::perms::owner_read);
+      const auto sut = mapped_file::open(file.path(), capacity, mapped_file::sharing_mode::read_only);
+
+      SECTION("Maps the contents") {
+        REQUIRE(sut.size() == bytes{11u});
+        REQUIRE(*sut.data() == std::byte{'h'});
+      }
+    }
+  }
+  SECTION("File is larger than the capacity") {
+    const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+    {
+      auto out = std::ofstream{file.path(), std::ios::binary};
+    }
+    std::filesystem::resize_file(file.path(), (page_size * 17u).count());
+
+    SECTION("Throws length_error") {
+      REQUIRE_THROWS_AS(mapped_file::open(file.path(), capacity), std::length_error);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Modifiers
+//------------------------------------------------------------------------------
+
+TEST_CASE("mapped_file::resize(bytes)", "[modifiers]") {
+  const auto file = temporary_file{"resize"};
+  auto sut = mapped_file::open(file.path(), capacity);
+  const auto data = sut.data();
+
+  SECTION("File is grown") {
+    sut.resize(sut.page_size() * 2u);
+    sut[1u].fill(std::byte{'x'});
+
+    SECTION("Mapping does not move") {
+      REQUIRE(sut.data() == data);
+    }
+    SECTION("Grows the file") {
+      REQUIRE(std::filesystem::file_size(file.path()) == (sut.page_size() * 2u).count());
+      REQUIRE(sut.pages() == 2u);
+    }
+    SECTION("Writes are carried through to the file") {
+      sut.sync();
+
+      REQUIRE(read_byte(file.path(), sut.page_size().count()) == 'x');
+    }
+  }
+  SECTION("File is shrunk") {
+    sut.resize(sut.page_size() * 4u);
+    sut.resize(bytes{10u});
+
+    SECTION("Shrinks the file") {
+      REQUIRE(std::filesystem::file_size(file.path()) == 10u);
+      REQUIRE(sut.pages() == 1u);
+    }
+  }
+  SECTION("Size exceeds the capacity") {
+    SECTION("Throws length_error") {
+      REQUIRE_THROWS_AS(sut.resize(sut.page_size() * 17u), std::length_error);
+    }
+  }
+}
+
+TEST_CASE("mapped_file::resize(bytes) with sharing_mode::private_copy", "[modifiers]") {
+  const auto file = temporary_file{"resize.private"};
+  {
+    auto out = std::ofstream{file.path(), std::ios::binary};
+    out << "original";
+  }
+  auto sut = mapped_file::open(file.path(), capacity, mapped_file::sharing_mode::private_copy);
+  const auto data = sut.data();
+
+  SECTION("Mapping is grown") {
+    sut.resize(sut.page_size() * 2u);
+    sut[1u].fill(std::byte{'x'});
+
+    SECTION("Mapping does not move") {
+      REQUIRE(sut.data() == data);
+    }
+    SECTION("File is not extended") {
+      REQUIRE(std::filesystem::file_size(file.path()) == 8u);
+      REQUIRE(sut.pages() == 2u);
+    }
+    SECTION("Existing contents are still mapped") {
+      REQUIRE(*sut.data() == std::byte{'o'});
+      REQUIRE(sut.data()[8u] == std::byte{0u});
+    }
+  }
+  SECTION("Mapping is shrunk") {
+    sut.resize(bytes{4u});
+
+    SECTION("File is not truncated") {
+      REQUIRE(std::filesystem::file_size(file.path()) == 8u);
+      REQUIRE(read_byte(file.path(), 7u) == 'l');
+    }
+    SECTION("Bytes past the end read as zero") {
+      REQUIRE(sut.data()[4u] == std::byte{0u});
+    }
+  }
+}
+
+TEST_CASE("mapped_file::sync(memory_block, sync_mode)", "[modifiers]") {
+  const auto file = temporary_file{"sync"};
+
+  SECTION("Mode is shared") {
+    auto sut = mapped_file::open(file.path(), capacity);
+    sut.resize(sut.page_size() * 2u);
+    sut[1u].fill(std::byte{'s'});
+
+    sut.sync(sut[1u], mapped_file::sync_mode::synchronous);
+
+    SECTION("Writes the block to the file") {
+      REQUIRE(read_byte(file.path(), sut.page_size().count()) == 's');
+    }
+  }
+  SECTION("Mode is private_copy") {
+    {
+      auto out = std::ofstream{file.path(), std::ios::binary};
+      out << "original";
+    }
+    auto sut = mapped_file::open(file.path(), capacity, mapped_file::sharing_mode::private_copy);
+    sut[0u].fill(std::byte{'p'});
+
+    sut.sync(sut[0u]);
+
+    SECTION("Writes are never carried through to the file") {
+      REQUIRE(read_byte(file.path(), 0u) == 'o');
+    }
+  }
+}
+
+TEST_CASE("mapped_file::advise(access_pattern)", "[modifiers]") {
+  const auto file = temporary_file{"advise"};
+  auto sut = mapped_file::open(file.path(), capacity);
+  sut.resize(sut.page_size() * 4u);
+  sut[0u].fill(std::byte{'a'});
+
+  sut.advise(mapped_file::access_pattern::sequential);
+
+  SECTION("Contents are unaffected") {
+    REQUIRE(*sut.data() == std::byte{'a'});
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,210 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/memory_pressure_monitor.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace msl::test {
+
+//==============================================================================
+// class : memory_pressure_monitor
+//==============================================================================
+
+namespace {
+
+  /// \brief A fake cgroup directory that is removed on destruction
+  class fake_cgroup
+  {
+  public:
+    explicit fake_cgroup(const char* name)
+      : m_path{std::filesystem::temp_directory_path() / name}
+    {
+      std::filesystem::remove_all(m_path);
+      std::filesystem::create_directories(m_path);
+    }
+
+    ~fake_cgroup()
+    {
+      std::filesystem::remove_all(m_path);
+    }
+
+    auto write(const char* file, std::string_view contents) const -> void
+    {
+      auto out = std::ofstream{m_path / file, std::ios::trunc};
+      out << contents;
+    }
+
+    auto path() const -> const std::filesystem::path& { return m_path; }
+    auto psi() const -> std::filesystem::path { return m_path / "pressure"; }
+
+  private:
+    std::filesystem::path m_path;
+  };
+
+  auto write_psi(const fake_cgroup& cgroup, std::string_view some, std::string_view full)
+    -> void
+  {
+    auto out = std::ofstream{cgroup.psi(), std::ios::trunc};
+    out << "some avg10=" << some << " avg60=0.00 avg300=0.00 total=0\n"
+        << "full avg10=" << full << " avg60=0.00 avg300=0.00 total=0\n";
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Monitoring
+//------------------------------------------------------------------------------
+
+TEST_CASE("memory_pressure_monitor::read()", "[monitoring]") {
+  const auto cgroup = fake_cgroup{"msl.memory_pressure_monitor.read.test"};
+
+  SECTION("Files do not exist") {
+    const auto sut = memory_pressure_monitor{cgroup.path(), cgroup.psi()};
+
+    const auto result = sut.read();
+
+    SECTION("Reports everything as unknown") {
+      REQUIRE_FALSE(result.current.has_value());
+      REQUIRE_FALSE(result.limit().has_value());
+      REQUIRE_FALSE(result.usage_ratio().has_value());
+      REQUIRE_FALSE(result.some_avg10.has_value());
+      REQUIRE_FALSE(result.full_avg10.has_value());
+    }
+  }
+
+  SECTION("Limits are 'max'") {
+    cgroup.write("memory.current", "4096\n");
+    cgroup.write("memory.high", "max\n");
+    cgroup.write("memory.max", "max\n");
+    const auto sut = memory_pressure_monitor{cgroup.path(), cgroup.psi()};
+
+    const auto result = sut.read();
+
+    SECTION("Reads the current usage") {
+      REQUIRE(result.current == bytes{4096u});
+    }
+    SECTION("Reports no limit") {
+      REQUIRE_FALSE(result.limit().has_value());
+      REQUIRE_FALSE(result.usage_ratio().has_value());
+    }
+  }
+
+  SECTION("Limits are set") {
+    cgroup.write("memory.current", "1024\n");
+    cgroup.write("memory.high", "2048\n");
+    cgroup.write("memory.max", "4096\n");
+    write_psi(cgroup, "12.50", "3.25");
+    const auto sut = memory_pressure_monitor{cgroup.path(), cgroup.psi()};
+
+    const auto result = sut.read();
+
+    SECTION("Limit is the lower of high and max") {
+      REQUIRE(result.limit() == bytes{2048u});
+    }
+    SECTION("Usage ratio is relative to the limit") {
+      REQUIRE(result.usage_ratio() == Approx(0.5));
+    }
+    SECTION("Reads the pressure stall information") {
+      REQUIRE(result.some_avg10 == Approx(12.5));
+      REQUIRE(result.full_avg10 == Approx(3.25));
+    }
+  }
+
+  SECTION("Pressure stall information is disabled") {
+    write_psi(cgroup, "12.50", "3.25");
+    const auto sut = memory_pressure_monitor{cgroup.path(), {}};
+
+    const auto result = sut.read();
+
+    SECTION("Reports no pressure") {
+      REQUIRE_FALSE(result.some_avg10.has_value());
+      REQUIRE_FALSE(result.full_avg10.has_value());
+    }
+  }
+}
+
+TEST_CASE("memory_pressure_monitor::poll()", "[monitoring]") {
+  const auto cgroup = fake_cgroup{"msl.memory_pressure_monitor.poll.test"};
+  cgroup.write("memory.current", "1024\n");
+  cgroup.write("memory.high", "max\n");
+  cgroup.write("memory.max", "4096\n");
+  write_psi(cgroup, "0.00", "0.00");
+
+  auto sut = memory_pressure_monitor{cgroup.path(), cgroup.psi()};
+  auto calls = 0;
+  const auto id = sut.add_callback(
+    memory_pressure_monitor::threshold{.usage_ratio = 0.75},
+    [&](const memory_pressure_monitor::snapshot&) { ++calls; }
+  );
+
+  SECTION("Threshold is not crossed") {
+    sut.poll();
+
+    SECTION("Does not notify the callback") {
+      REQUIRE(calls == 0);
+    }
+  }
+
+  SECTION("Threshold is crossed") {
+    cgroup.write("memory.current", "3584\n");
+    sut.poll();
+
+    SECTION("Notifies the callback") {
+      REQUIRE(calls == 1);
+    }
+    SECTION("Pressure remains above the threshold") {
+      sut.poll();
+
+      SECTION("Does not notify the callback again") {
+        REQUIRE(calls == 1);
+      }
+    }
+    SECTION("Pressure falls and crosses the threshold again") {
+      cgroup.write("memory.current", "1024\n");
+      sut.poll();
+      cgroup.write("memory.current", "4096\n");
+      sut.poll();
+
+      SECTION("Notifies the callback again") {
+        REQUIRE(calls == 2);
+      }
+    }
+  }
+
+  SECTION("Stall threshold is crossed") {
+    auto stalls = 0;
+    sut.add_callback(
+      memory_pressure_monitor::threshold{.some_avg10 = 10.0},
+      [&](const memory_pressure_monitor::snapshot& s) {
+        REQUIRE(s.some_avg10 == Approx(25.0));
+        ++stalls;
+      }
+    );
+    write_psi(cgroup, "25.00", "0.00");
+    sut.poll();
+
+    SECTION("Notifies only the stall callback") {
+      REQUIRE(stalls == 1);
+      REQUIRE(calls == 0);
+    }
+  }
+
+  SECTION("Callback is removed") {
+    sut.remove_callback(id);
+    cgroup.write("memory.current", "4096\n");
+    sut.poll();
+
+    SECTION("Does not notify the callback") {
+      REQUIRE(calls == 0);
+    }
+  }
+}
+
+} // namespace msl::test
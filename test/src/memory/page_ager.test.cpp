@@ -0,0 +1,181 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/page_ager.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+namespace msl::test {
+
+//==============================================================================
+// class : page_ager
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+  using clock = page_ager::clock;
+  using page_temperature = virtual_memory::page_temperature;
+
+  const auto cold_after = std::chrono::seconds{10};
+  const auto page_out_after = std::chrono::seconds{60};
+
+  auto make_options() -> page_ager::options
+  {
+    return page_ager::options{
+      .cold_after = cold_after,
+      .page_out_after = page_out_after,
+    };
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Access Tracking
+//------------------------------------------------------------------------------
+
+TEST_CASE("page_ager::touch(std::size_t, uquantity<page>, time_point)", "[access tracking]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{8u});
+  const auto now = clock::time_point{};
+  auto sut = page_ager{memory, make_options(), now};
+
+  sut.touch(2u, pages{3u}, now + cold_after);
+
+  SECTION("Records the access") {
+    REQUIRE(sut.last_access(1u) == now);
+    REQUIRE(sut.last_access(2u) == now + cold_after);
+    REQUIRE(sut.last_access(4u) == now + cold_after);
+    REQUIRE(sut.last_access(5u) == now);
+  }
+  SECTION("Touched pages are not cooled") {
+    const auto result = sut.age(now + cold_after);
+
+    REQUIRE(result.cooled == 5u);
+    REQUIRE(sut.temperature(1u) == page_temperature::cold);
+    REQUIRE(sut.temperature(2u) == page_temperature::warm);
+    REQUIRE(sut.temperature(4u) == page_temperature::warm);
+    REQUIRE(sut.temperature(5u) == page_temperature::cold);
+  }
+  SECTION("Cooled pages are touched") {
+    sut.age(now + page_out_after);
+    sut.touch(0u, pages{1u}, now + page_out_after);
+
+    SECTION("Pages are warm again") {
+      REQUIRE(sut.temperature(0u) == page_temperature::warm);
+      REQUIRE(sut.temperature(1u) == page_temperature::paged_out);
+    }
+  }
+}
+
+TEST_CASE("page_ager::warm(std::size_t, uquantity<page>, time_point)", "[access tracking]") {
+  auto memory = virtual_memory::reserve(pages{4u});
+  memory.commit(0u, pages{4u});
+  memory[1u].fill(std::byte{0x42});
+  const auto now = clock::time_point{};
+  auto sut = page_ager{memory, make_options(), now};
+  sut.age(now + page_out_after);
+
+  sut.warm(0u, pages{2u}, now + page_out_after);
+
+  SECTION("Pages are warm again") {
+    REQUIRE(sut.temperature(0u) == page_temperature::warm);
+    REQUIRE(sut.temperature(1u) == page_temperature::warm);
+    REQUIRE(sut.temperature(2u) == page_temperature::paged_out);
+  }
+  SECTION("Preserves the contents of the pages") {
+    REQUIRE(*memory[1u].data() == std::byte{0x42});
+  }
+}
+
+//------------------------------------------------------------------------------
+// Aging
+//------------------------------------------------------------------------------
+
+TEST_CASE("page_ager::age(time_point)", "[aging]") {
+  auto memory = virtual_memory::reserve(pages{8u});
+  memory.commit(0u, pages{6u});
+  memory[0u].fill(std::byte{0x42});
+  const auto now = clock::time_point{};
+  auto sut = page_ager{memory, make_options(), now};
+
+  SECTION("Pages have not been unused long enough") {
+    const auto result = sut.age(now + cold_after / 2);
+
+    SECTION("Cools no pages") {
+      REQUIRE(result.cooled == 0u);
+      REQUIRE(result.paged_out == 0u);
+      REQUIRE(sut.temperature(0u) == page_temperature::warm);
+    }
+  }
+  SECTION("Pages have been unused long enough to be cold") {
+    const auto result = sut.age(now + cold_after);
+
+    SECTION("Cools only committed pages") {
+      REQUIRE(result.cooled == 6u);
+      REQUIRE(result.paged_out == 0u);
+      REQUIRE(sut.temperature(5u) == page_temperature::cold);
+      REQUIRE(sut.temperature(6u) == page_temperature::warm);
+    }
+    SECTION("Does not cool pages twice") {
+      REQUIRE(sut.age(now + cold_after).cooled == 0u);
+    }
+    SECTION("Preserves the contents of the pages") {
+      REQUIRE(*memory[0u].data() == std::byte{0x42});
+    }
+  }
+  SECTION("Pages have been unused long enough to be paged out") {
+    sut.age(now + cold_after);
+    const auto result = sut.age(now + page_out_after);
+
+    SECTION("Pages out the pages") {
+      REQUIRE(result.cooled == 0u);
+      REQUIRE(result.paged_out == 6u);
+      REQUIRE(sut.temperature(0u) == page_temperature::paged_out);
+    }
+    SECTION("Preserves the contents of the pages") {
+      REQUIRE(*memory[0u].data() == std::byte{0x42});
+    }
+  }
+  SECTION("Pages are locked") {
+    memory.lock(0u, pages{6u});
+    const auto result = sut.age(now + cold_after);
+
+    SECTION("Rejected pages are not reported") {
+      REQUIRE(result.cooled == 0u);
+      REQUIRE(sut.temperature(0u) == page_temperature::warm);
+    }
+    SECTION("Rejected pages are cooled again once unlocked") {
+      memory.unlock(0u, pages{6u});
+
+      REQUIRE(sut.age(now + cold_after).cooled == 6u);
+    }
+  }
+  SECTION("Pages are decommitted") {
+    sut.age(now + cold_after);
+    memory.decommit(0u, pages{2u});
+    sut.age(now + cold_after);
+
+    SECTION("Decommitted pages are warm") {
+      REQUIRE(sut.temperature(0u) == page_temperature::warm);
+      REQUIRE(sut.temperature(2u) == page_temperature::cold);
+    }
+  }
+  SECTION("Memory is grown") {
+    memory.grow(pages{4u}, virtual_memory::growth_policy::may_move);
+    memory.commit(8u, pages{4u});
+    const auto result = sut.age(now + cold_after);
+
+    SECTION("New pages are considered accessed when first aged") {
+      REQUIRE(result.cooled == 6u);
+      REQUIRE(sut.temperature(8u) == page_temperature::warm);
+      REQUIRE(sut.last_access(8u) == now + cold_after);
+    }
+  }
+}
+
+} // namespace msl::test
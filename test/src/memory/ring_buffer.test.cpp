@@ -0,0 +1,138 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/ring_buffer.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm> // std::min
+#include <thread>    // std::jthread
+
+namespace msl::test {
+
+//==============================================================================
+// class : ring_buffer
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Constructors
+//------------------------------------------------------------------------------
+
+TEST_CASE("ring_buffer::ring_buffer(uquantity<page>)", "[ctor]") {
+  const auto sut = ring_buffer{uquantity<ring_buffer::page>{2u}};
+
+  SECTION("Capacity spans all pages") {
+    REQUIRE(sut.capacity() == virtual_memory::page_size(virtual_memory::page_mode::standard) * 2u);
+  }
+  SECTION("Buffer is empty") {
+    REQUIRE(sut.readable() == bytes::zero());
+    REQUIRE(sut.writable() == sut.capacity());
+  }
+}
+
+//------------------------------------------------------------------------------
+// Producer / Consumer
+//------------------------------------------------------------------------------
+
+TEST_CASE("ring_buffer::acquire_write(bytes)", "[producer]") {
+  auto sut = ring_buffer{uquantity<ring_buffer::page>{1u}};
+  const auto capacity = sut.capacity();
+  const auto half = bytes{capacity.count() / 2u};
+
+  SECTION("Write does not wrap") {
+    auto block = sut.acquire_write(half);
+    block.fill(std::byte{0x42});
+    sut.release_write(half);
+
+    SECTION("Written bytes become readable") {
+      REQUIRE(sut.readable() == half);
+      REQUIRE(sut.write_cursor() == half.count());
+    }
+  }
+  SECTION("Write wraps around the end") {
+    // Move both cursors three quarters of the way through the buffer
+    const auto offset = half + bytes{capacity.count() / 4u};
+    sut.release_write(offset);
+    sut.release_read(offset);
+
+    auto block = sut.acquire_write(half);
+    block.fill(std::byte{0x42});
+    sut.release_write(half);
+
+    SECTION("Block is contiguous") {
+      REQUIRE(block.size() == half);
+    }
+    SECTION("Wrapped bytes are visible at the start of the buffer") {
+      const auto start = sut.acquire_read(half).start_address() - offset.count();
+
+      REQUIRE(*start == std::byte{0x42});
+      REQUIRE(*(start + (half.count() / 2u - 1u)) == std::byte{0x42});
+    }
+    SECTION("Read view mirrors the written bytes") {
+      const auto read = sut.acquire_read(half);
+
+      REQUIRE(read.start_address() == block.start_address());
+      REQUIRE(*(read.end_address() - 1) == std::byte{0x42});
+    }
+  }
+}
+
+TEST_CASE("ring_buffer::release_read(bytes)", "[consumer]") {
+  auto sut = ring_buffer{uquantity<ring_buffer::page>{1u}};
+  sut.release_write(bytes{16u});
+
+  sut.release_read(bytes{10u});
+
+  SECTION("Consumed bytes are no longer readable") {
+    REQUIRE(sut.readable() == bytes{6u});
+    REQUIRE(sut.read_cursor() == 10u);
+  }
+  SECTION("Consumed bytes become writable") {
+    REQUIRE(sut.writable() == sut.capacity() - bytes{6u});
+  }
+}
+
+TEST_CASE("ring_buffer::acquire_read(bytes)", "[consumer]") {
+  auto sut = ring_buffer{uquantity<ring_buffer::page>{1u}};
+  const auto total = sut.capacity().count() * 16u;
+  const auto chunk = bytes{sut.capacity().count() / 3u};
+
+  SECTION("Producer writes concurrently") {
+    auto producer = std::jthread{[&] {
+      auto written = std::size_t{0u};
+      while (written < total) {
+        const auto n = std::min(chunk, bytes{total - written});
+        if (sut.writable() < n) {
+          continue;
+        }
+        auto block = sut.acquire_write(n);
+        for (auto i = 0u; i < n.count(); ++i) {
+          block.data().get()[i] = static_cast<std::byte>((written + i) % 251u);
+        }
+        sut.release_write(n);
+        written += n.count();
+      }
+    }};
+
+    auto mismatches = std::size_t{0u};
+    auto read = std::size_t{0u};
+    while (read < total) {
+      const auto n = sut.readable();
+      if (n == bytes::zero()) {
+        continue;
+      }
+      const auto block = sut.acquire_read(n);
+      for (auto i = 0u; i < n.count(); ++i) {
+        mismatches += (block.data().get()[i] != static_cast<std::byte>((read + i) % 251u)) ? 1u : 0u;
+      }
+      sut.release_read(n);
+      read += n.count();
+    }
+
+    REQUIRE(mismatches == 0u);
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,188 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/stack_pool.hpp"
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <system_error>
+#include <vector>
+
+namespace msl::test {
+
+//==============================================================================
+// class : stack_pool
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<stack_pool::page>;
+  using clock = stack_pool::clock;
+
+  auto make_options() -> stack_pool::options
+  {
+    auto options = stack_pool::options{};
+    options.stack_pages = pages{4u};
+    options.guard_pages = pages{1u};
+    options.stacks_per_slab = 4u;
+    options.decommit.decay = std::chrono::seconds{10};
+    options.decommit.pressure_threshold = gibibytes{1u};
+
+    return options;
+  }
+
+  /// \brief Hooks that fail to decommit once told to
+  class failing_hooks : public virtual_memory_hooks
+  {
+  public:
+
+    auto decommit(not_null<std::byte*> memory,
+                  bytes size,
+                  virtual_memory::decommit_policy policy)
+      -> void override
+    {
+      if (fail) {
+        throw std::system_error{std::make_error_code(std::errc::not_enough_memory)};
+      }
+      virtual_memory_hooks::decommit(memory, size, policy);
+    }
+
+    bool fail = false;
+  };
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Stacks
+//------------------------------------------------------------------------------
+
+TEST_CASE("stack_pool::acquire()", "[stacks]") {
+  auto sut = stack_pool{make_options()};
+
+  SECTION("Pool is empty") {
+    auto stack = sut.acquire();
+
+    SECTION("Stack spans the usable pages") {
+      REQUIRE(stack.size() == sut.stack_size());
+    }
+    SECTION("Stack is writable") {
+      stack.fill(std::byte{0x42});
+
+      REQUIRE(*(stack.end_address() - 1) == std::byte{0x42});
+    }
+    SECTION("Remaining stacks of the slab are cached") {
+      REQUIRE(sut.acquired_stacks() == 1u);
+      REQUIRE(sut.cached_stacks() == 3u);
+    }
+  }
+  SECTION("Slab is exhausted") {
+    auto stacks = std::vector<memory_block>{};
+    for (auto i = 0; i < 5; ++i) {
+      stacks.push_back(sut.acquire());
+    }
+
+    SECTION("Stacks do not overlap") {
+      for (auto i = 0u; i < stacks.size() - 1u; ++i) {
+        const auto& a = stacks[i];
+        const auto& b = stacks.back();
+
+        REQUIRE((a.end_address() <= b.start_address() || b.end_address() <= a.start_address()));
+      }
+    }
+    SECTION("Another slab is reserved") {
+      REQUIRE(sut.acquired_stacks() == 5u);
+      REQUIRE(sut.cached_stacks() == 3u);
+    }
+  }
+  SECTION("Stacks are separated by guard pages") {
+    const auto first = sut.acquire();
+    const auto second = sut.acquire();
+
+    REQUIRE(second.start_address() - first.end_address() > 0);
+  }
+}
+
+TEST_CASE("stack_pool::release(memory_block, time_point)", "[stacks]") {
+  auto sut = stack_pool{make_options()};
+  const auto now = clock::time_point{};
+  auto stack = sut.acquire();
+  stack.fill(std::byte{0x42});
+
+  sut.release(stack, now);
+
+  SECTION("Stack is cached for reuse") {
+    REQUIRE(sut.acquired_stacks() == 0u);
+    REQUIRE(sut.cached_stacks() == 4u);
+  }
+  SECTION("Stack is reacquired before decaying") {
+    const auto reacquired = sut.acquire();
+
+    SECTION("Reuses the most recently released stack") {
+      REQUIRE(reacquired.start_address() == stack.start_address());
+    }
+    SECTION("Stack is no longer purged") {
+      REQUIRE(sut.purge(now + std::chrono::seconds{10}) == 0u);
+    }
+  }
+}
+
+TEST_CASE("stack_pool::release(memory_block, time_point) fails to purge", "[stacks]") {
+  auto hooks = failing_hooks{};
+  auto options = make_options();
+  options.hooks = &hooks;
+  // Releasing a second stack purges under pressure
+  options.decommit.pressure_threshold = virtual_memory::page_size(virtual_memory::page_mode::standard)
+                                      * options.stack_pages.count();
+  auto sut = stack_pool{options};
+  const auto first = sut.acquire();
+  const auto second = sut.acquire();
+  sut.release(first, clock::time_point{});
+
+  hooks.fail = true;
+
+  SECTION("Does not throw") {
+    REQUIRE_NOTHROW(sut.release(second, clock::time_point{}));
+  }
+  SECTION("Stack is still released") {
+    sut.release(second, clock::time_point{});
+
+    REQUIRE(sut.acquired_stacks() == 0u);
+    REQUIRE(sut.cached_stacks() == 4u);
+  }
+  SECTION("Stacks are decommitted once decommitting succeeds") {
+    sut.release(second, clock::time_point{});
+    hooks.fail = false;
+
+    REQUIRE(sut.purge_all() == options.stack_pages.count() * 2u);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Purging
+//------------------------------------------------------------------------------
+
+TEST_CASE("stack_pool::purge(time_point)", "[purging]") {
+  auto sut = stack_pool{make_options()};
+  const auto now = clock::time_point{};
+  auto first = sut.acquire();
+  auto second = sut.acquire();
+  sut.release(first, now);
+  sut.release(second, now + std::chrono::seconds{5});
+
+  SECTION("Purges only the decayed stacks") {
+    REQUIRE(sut.purge(now + std::chrono::seconds{10}) == 4u);
+  }
+  SECTION("Purged stacks can be reacquired") {
+    sut.purge_all();
+    auto stack = sut.acquire();
+    stack.fill(std::byte{0x42});
+
+    REQUIRE(*stack.data() == std::byte{0x42});
+  }
+}
+
+} // namespace msl::test
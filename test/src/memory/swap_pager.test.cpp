@@ -0,0 +1,323 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/swap_pager.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace msl::test {
+
+#if defined(__unix__) || defined(__APPLE__)
+
+//==============================================================================
+// class : swap_pager
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+
+  /// \brief Makes a pager of 16 pages that may only keep \p budget of them
+  ///        resident
+  auto make_pager(std::size_t budget = 4u) -> swap_pager
+  {
+    return swap_pager{pages{16u}, swap_pager::options{
+      .resident_budget = virtual_memory::page_size(virtual_memory::page_mode::standard) * budget,
+      .directory = {},
+    }};
+  }
+
+  /// \brief Commits each of the first \p count pages of \p pager in turn,
+  ///        filling each with its page number
+  auto commit_and_fill(swap_pager& pager, std::size_t count) -> void
+  {
+    for (auto n = std::size_t{0u}; n < count; ++n) {
+      pager.commit(n, pages{1u}).fill(static_cast<std::byte>(n + 1u));
+    }
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Constructors / Destructor / Assignment
+//------------------------------------------------------------------------------
+
+TEST_CASE("swap_pager::swap_pager(uquantity<page>, options)", "[ctor]") {
+  const auto sut = make_pager();
+
+  SECTION("Reserves the pages") {
+    REQUIRE(sut.data() != nullptr);
+    REQUIRE(sut.pages() == 16u);
+  }
+  SECTION("Commits no pages") {
+    REQUIRE(sut.resident_pages() == 0u);
+    REQUIRE(sut.swapped_pages() == 0u);
+    REQUIRE_FALSE(sut.is_committed(0u));
+  }
+  SECTION("Rounds the budget to pages") {
+    REQUIRE(sut.resident_budget() == virtual_memory::page_size(virtual_memory::page_mode::standard) * 4u);
+  }
+}
+
+TEST_CASE("swap_pager::swap_pager(uquantity<page>, options) with a small budget", "[ctor]") {
+  const auto sut = make_pager(1u);
+
+  SECTION("Keeps four pages resident") {
+    REQUIRE(sut.resident_budget() == virtual_memory::page_size(virtual_memory::page_mode::standard) * 4u);
+  }
+}
+
+#if defined(__linux__)
+TEST_CASE("swap_pager::swap_pager(uquantity<page>, options) with a directory in memory", "[ctor]") {
+  // /dev/shm is a tmpfs wherever it exists
+  const auto directory = std::filesystem::path{"/dev/shm"};
+  if (!std::filesystem::is_directory(directory)) {
+    return;
+  }
+
+  const auto make = [&]{
+    return swap_pager{pages{8u}, swap_pager::options{
+      .resident_budget = virtual_memory::page_size(virtual_memory::page_mode::standard) * 2u,
+      .directory = directory,
+    }};
+  };
+
+  SECTION("Throws") {
+    REQUIRE_THROWS_AS(make(), std::system_error);
+  }
+}
+#endif
+
+TEST_CASE("swap_pager::swap_pager(uquantity<page>, options) many times", "[ctor]") {
+  // More pagers than fit in a single block of fault ranges
+  auto pagers = std::vector<swap_pager>{};
+  for (auto i = 0u; i < 100u; ++i) {
+    commit_and_fill(pagers.emplace_back(make_pager()), 8u);
+  }
+
+  SECTION("Swapped out pages of every pager can be accessed") {
+    REQUIRE(*pagers.front()[0u].data() == std::byte{1u});
+    REQUIRE(*pagers.back()[0u].data() == std::byte{1u});
+  }
+}
+
+TEST_CASE("swap_pager::swap_pager(swap_pager&&)", "[ctor]") {
+  auto original = make_pager();
+  commit_and_fill(original, 8u);
+  const auto data = original.data();
+
+  const auto sut = std::move(original);
+
+  SECTION("Takes ownership of the pages") {
+    REQUIRE(sut.data() == data);
+    REQUIRE(sut.swapped_pages() == 4u);
+  }
+  SECTION("Swapped out pages can be accessed") {
+    REQUIRE(*sut[0u].data() == std::byte{1u});
+  }
+}
+
+//------------------------------------------------------------------------------
+// Element Access
+//------------------------------------------------------------------------------
+
+TEST_CASE("swap_pager::operator[](std::size_t)", "[element access]") {
+  auto sut = make_pager();
+  commit_and_fill(sut, 16u);
+
+  // Each thread repeatedly writes and reads back its own pages, which
+  // constantly swaps out the pages of the other threads
+  constexpr auto threads = std::size_t{4u};
+  auto mismatches = std::vector<int>(threads, 0);
+  {
+    auto workers = std::vector<std::jthread>{};
+    for (auto t = std::size_t{0u}; t < threads; ++t) {
+      workers.emplace_back([&sut, &mismatches, t] {
+        for (auto i = 0; i < 200; ++i) {
+          for (auto n = t; n < sut.pages().count(); n += threads) {
+            const auto value = static_cast<std::byte>(i);
+            sut[n].data().get()[i] = value;
+            if (sut[n].data().get()[i] != value) {
+              ++mismatches[t];
+            }
+          }
+        }
+      });
+    }
+  }
+
+  SECTION("Concurrent accesses see their own writes") {
+    REQUIRE(mismatches == std::vector<int>(threads, 0));
+    REQUIRE(sut.resident_pages() <= 4u);
+    REQUIRE(sut.resident_pages() + sut.swapped_pages() == 16u);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Residency
+//------------------------------------------------------------------------------
+
+TEST_CASE("swap_pager::set_resident_budget(bytes)", "[residency]") {
+  auto sut = make_pager(8u);
+  commit_and_fill(sut, 8u);
+
+  SECTION("Budget is reduced below the resident pages") {
+    sut.set_resident_budget(sut.page_size() * 4u);
+
+    SECTION("Swaps out the least recently used pages") {
+      REQUIRE(sut.resident_pages() == 4u);
+      REQUIRE_FALSE(sut.is_resident(3u));
+      REQUIRE(sut.is_resident(4u));
+    }
+  }
+  SECTION("Budget is smaller than four pages") {
+    sut.set_resident_budget(bytes{1u});
+
+    SECTION("Keeps four pages resident") {
+      REQUIRE(sut.resident_budget() == sut.page_size() * 4u);
+      REQUIRE(sut.resident_pages() == 4u);
+    }
+    SECTION("Accesses that span two swapped out pages complete") {
+      const auto boundary = sut[1u].data().get();
+      auto value = std::array<std::byte, 8u>{};
+      std::memcpy(value.data(), boundary - 4, value.size());
+
+      REQUIRE(value.front() == std::byte{1u});
+      REQUIRE(value.back() == std::byte{2u});
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Modifiers
+//------------------------------------------------------------------------------
+
+TEST_CASE("swap_pager::commit(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = make_pager();
+
+  SECTION("Pages fit in the budget") {
+    const auto block = sut.commit(0u, pages{4u});
+
+    SECTION("Pages are resident") {
+      REQUIRE(sut.resident_pages() == 4u);
+      REQUIRE(sut.is_resident(3u));
+    }
+    SECTION("Pages are zeroed") {
+      REQUIRE(*block.data() == std::byte{0u});
+    }
+    SECTION("Returns the pages") {
+      REQUIRE(block.start_address() == sut.data());
+      REQUIRE(block.size() == sut.page_size() * 4u);
+    }
+  }
+  SECTION("Pages exceed the budget") {
+    commit_and_fill(sut, 8u);
+
+    SECTION("Swaps out the least recently used pages") {
+      REQUIRE(sut.resident_pages() == 4u);
+      REQUIRE(sut.swapped_pages() == 4u);
+      REQUIRE_FALSE(sut.is_resident(0u));
+      REQUIRE_FALSE(sut.is_resident(3u));
+      REQUIRE(sut.is_committed(0u));
+    }
+    SECTION("Swapped out pages keep their contents") {
+      for (auto n = std::size_t{0u}; n < 8u; ++n) {
+        REQUIRE(*sut[n].data() == static_cast<std::byte>(n + 1u));
+      }
+    }
+    SECTION("Accessing a swapped out page swaps it back in") {
+      const auto value = *sut[0u].data();
+
+      REQUIRE(value == std::byte{1u});
+      REQUIRE(sut.is_resident(0u));
+      REQUIRE(sut.resident_pages() == 4u);
+      REQUIRE_FALSE(sut.is_resident(4u));
+    }
+    SECTION("Writing a swapped out page swaps it back in") {
+      sut[1u].fill(std::byte{0x42});
+      sut.evict(1u, pages{1u});
+
+      REQUIRE(*sut[1u].data() == std::byte{0x42});
+    }
+  }
+}
+
+TEST_CASE("swap_pager::decommit(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = make_pager();
+  commit_and_fill(sut, 8u);
+
+  sut.decommit(2u, pages{4u});
+
+  SECTION("Pages are no longer committed") {
+    REQUIRE_FALSE(sut.is_committed(2u));
+    REQUIRE_FALSE(sut.is_committed(5u));
+    REQUIRE(sut.resident_pages() == 2u);
+    REQUIRE(sut.swapped_pages() == 2u);
+  }
+  SECTION("Committing the pages again zeroes them") {
+    sut.commit(2u, pages{4u});
+
+    REQUIRE(*sut[2u].data() == std::byte{0u});
+    REQUIRE(*sut[5u].data() == std::byte{0u});
+  }
+}
+
+TEST_CASE("swap_pager::touch(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = make_pager();
+  commit_and_fill(sut, 4u);
+
+  sut.touch(0u, pages{1u});
+  sut.commit(4u, pages{1u});
+
+  SECTION("Touched pages are swapped out last") {
+    REQUIRE(sut.is_resident(0u));
+    REQUIRE_FALSE(sut.is_resident(1u));
+  }
+}
+
+TEST_CASE("swap_pager::fetch(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = make_pager();
+  commit_and_fill(sut, 8u);
+
+  sut.fetch(0u, pages{2u});
+
+  SECTION("Pages are swapped back in") {
+    REQUIRE(sut.is_resident(0u));
+    REQUIRE(sut.is_resident(1u));
+    REQUIRE(sut.swapped_pages() == 4u);
+  }
+  SECTION("Pages keep their contents") {
+    REQUIRE(*sut[0u].data() == std::byte{1u});
+    REQUIRE(*sut[1u].data() == std::byte{2u});
+  }
+}
+
+TEST_CASE("swap_pager::evict(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = make_pager();
+  commit_and_fill(sut, 2u);
+
+  sut.evict(sut[1u]);
+
+  SECTION("Pages are swapped out") {
+    REQUIRE_FALSE(sut.is_resident(1u));
+    REQUIRE(sut.resident_pages() == 1u);
+    REQUIRE(sut.swapped_pages() == 1u);
+  }
+  SECTION("Pages keep their contents") {
+    REQUIRE(*sut[1u].data() == std::byte{2u});
+  }
+}
+
+#endif
+
+} // namespace msl::test
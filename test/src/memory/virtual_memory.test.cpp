@@ -0,0 +1,881 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/virtual_memory.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <bit>     // std::has_single_bit
+#include <cstdint> // std::uintptr_t
+#include <vector>  // std::vector
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/wait.h> // ::waitpid
+# include <unistd.h>   // ::fork, ::_exit
+#endif
+
+#if defined(__linux__)
+# include <sys/mman.h>   // ::mmap, ::munmap
+# include <cerrno>       // errno, ENOMEM
+# include <system_error> // std::system_error
+# include <utility>      // std::exchange
+#endif
+
+namespace msl::test {
+
+//==============================================================================
+// class : virtual_memory
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Static Functions
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory::page_shift", "[constants]") {
+  const auto page_size = virtual_memory::page_size(virtual_memory::page_mode::standard);
+
+  if constexpr (virtual_memory::is_page_size_fixed) {
+    SECTION("Page size is fixed at compile time") {
+      REQUIRE((std::size_t{1u} << virtual_memory::page_shift) == page_size.count());
+    }
+  } else {
+    SECTION("Page size is detected at runtime") {
+      REQUIRE(virtual_memory::page_shift == 0u);
+    }
+  }
+  SECTION("Page size is a power of two") {
+    REQUIRE(std::has_single_bit(page_size.count()));
+  }
+}
+
+TEST_CASE("virtual_memory::reserve(uquantity<page>)", "[factory]") {
+  const auto pages = uquantity<virtual_memory::page>{4u};
+  const auto sut = virtual_memory::reserve(pages);
+
+  SECTION("Reserves the requested number of pages") {
+    REQUIRE(sut.pages() == pages);
+  }
+  SECTION("Reserves non-null memory") {
+    REQUIRE(sut.data() != nullptr);
+  }
+  SECTION("Reserved memory spans all pages") {
+    REQUIRE(sut.size_in_bytes() == sut.page_size() * 4u);
+  }
+}
+
+TEST_CASE("virtual_memory::reserve(uquantity<page>, page_mode)", "[factory]") {
+  SECTION("Mode is transparent_huge") {
+    const auto mode = virtual_memory::page_mode::transparent_huge;
+    const auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{2u}, mode);
+
+    SECTION("Page size is the huge page size") {
+      REQUIRE(sut.page_size() == virtual_memory::page_size(mode));
+    }
+    SECTION("Reservation is aligned to the huge page size") {
+      const auto address = reinterpret_cast<std::uintptr_t>(sut.data());
+
+      REQUIRE((address % sut.page_size().count()) == 0u);
+    }
+    SECTION("Pages are addressed by the huge page size") {
+      REQUIRE(sut[1u].start_address() == sut.data() + sut.page_size().count());
+    }
+  }
+}
+
+TEST_CASE("virtual_memory::reserve(uquantity<page>, alignment, page_mode)", "[factory]") {
+  const auto align = alignment::at_boundary(mebibytes{4u});
+  const auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{3u}, align);
+
+  SECTION("Reserves the requested number of pages") {
+    REQUIRE(sut.pages() == 3u);
+  }
+  SECTION("Base address is aligned to the requested boundary") {
+    const auto address = reinterpret_cast<std::uintptr_t>(sut.data());
+
+    REQUIRE((address % align.value().count()) == 0u);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Commit State
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory::is_committed(std::size_t)", "[commit state]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{130u});
+
+  SECTION("Pages have not been committed") {
+    SECTION("Reports no committed pages") {
+      REQUIRE_FALSE(sut.is_committed(0u));
+      REQUIRE(sut.committed_pages() == 0u);
+    }
+  }
+  SECTION("Pages have been committed across bitmap words") {
+    sut.commit(60u, uquantity<virtual_memory::page>{70u});
+
+    SECTION("Reports the committed pages") {
+      REQUIRE_FALSE(sut.is_committed(59u));
+      REQUIRE(sut.is_committed(60u));
+      REQUIRE(sut.is_committed(64u));
+      REQUIRE(sut.is_committed(129u));
+      REQUIRE(sut.committed_pages() == 70u);
+    }
+  }
+  SECTION("Pages have been decommitted") {
+    sut.commit(0u, uquantity<virtual_memory::page>{130u});
+    sut.decommit(1u, uquantity<virtual_memory::page>{128u});
+
+    SECTION("Reports the remaining committed pages") {
+      REQUIRE(sut.is_committed(0u));
+      REQUIRE_FALSE(sut.is_committed(1u));
+      REQUIRE_FALSE(sut.is_committed(128u));
+      REQUIRE(sut.is_committed(129u));
+      REQUIRE(sut.committed_pages() == 2u);
+    }
+  }
+}
+
+TEST_CASE("virtual_memory::resident_pages()", "[commit state]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{8u});
+
+  SECTION("Pages have not been touched") {
+    sut.commit(0u, uquantity<virtual_memory::page>{8u});
+
+    SECTION("Reports no resident pages") {
+      REQUIRE(sut.resident_pages() == 0u);
+    }
+  }
+  SECTION("Pages have been prefaulted") {
+    sut.commit(0u, uquantity<virtual_memory::page>{3u}, virtual_memory::commit_policy::prefault);
+
+    SECTION("Reports the prefaulted pages") {
+      REQUIRE(sut.resident_pages() == 3u);
+    }
+  }
+}
+
+TEST_CASE("virtual_memory::huge_pages()", "[commit state]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{8u});
+  sut.commit(0u, uquantity<virtual_memory::page>{2u}, virtual_memory::commit_policy::prefault);
+
+  const auto report = sut.huge_pages();
+
+  SECTION("Reports the resident memory") {
+    REQUIRE(report.resident >= sut.page_size() * 2u);
+  }
+  SECTION("Standard pages are not backed by explicit huge pages") {
+    REQUIRE(report.explicit_huge == bytes::zero());
+  }
+}
+
+//------------------------------------------------------------------------------
+// Modifiers
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory::commit(std::size_t)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+
+  auto page = sut.commit(1u);
+
+  SECTION("Returns the page at the requested index") {
+    REQUIRE(page == sut[1u]);
+  }
+  SECTION("Page is writeable") {
+    page.fill(std::byte{0xff});
+
+    REQUIRE(*page.data() == std::byte{0xff});
+  }
+}
+
+TEST_CASE("virtual_memory::commit(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{8u});
+
+  auto block = sut.commit(2u, uquantity<virtual_memory::page>{4u});
+
+  SECTION("Block starts at the first page") {
+    REQUIRE(block.start_address() == sut[2u].start_address());
+  }
+  SECTION("Block spans all committed pages") {
+    REQUIRE(block.size() == sut.page_size() * 4u);
+  }
+  SECTION("Block is writeable") {
+    block.fill(std::byte{0x7f});
+
+    REQUIRE(*(block.end_address() - 1) == std::byte{0x7f});
+  }
+}
+
+TEST_CASE("virtual_memory::commit(std::size_t, uquantity<page>, commit_policy)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+
+  auto block = sut.commit(
+    0u,
+    uquantity<virtual_memory::page>{4u},
+    virtual_memory::commit_policy::prefault
+  );
+
+  SECTION("Prefaulted pages are resident") {
+    REQUIRE(sut.resident_pages() == 4u);
+  }
+  SECTION("Prefaulted pages are zero-initialized") {
+    REQUIRE(*(block.end_address() - 1) == std::byte{0});
+  }
+  SECTION("Prefaulted pages are writeable") {
+    block.fill(std::byte{0x7f});
+
+    REQUIRE(*(block.end_address() - 1) == std::byte{0x7f});
+  }
+}
+
+TEST_CASE("virtual_memory::commit(memory_block)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{8u});
+  const auto input = memory_block::from_pointer_and_length(
+    sut[1u].start_address(),
+    sut.page_size() * 3u
+  );
+
+  auto block = sut.commit(input);
+
+  SECTION("Returns the input block") {
+    REQUIRE(block == input);
+  }
+  SECTION("Block is writeable") {
+    block.fill(std::byte{0x7f});
+
+    REQUIRE(*(block.end_address() - 1) == std::byte{0x7f});
+  }
+}
+
+TEST_CASE("virtual_memory::prefault(memory_block, std::size_t)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{9u});
+  auto block = sut.commit(0u, uquantity<virtual_memory::page>{9u});
+
+  SECTION("Pages have not been touched") {
+    SECTION("Prefaulting makes the pages resident") {
+      sut.prefault(block);
+
+      REQUIRE(sut.resident_pages() == 9u);
+    }
+    SECTION("Prefaulting with multiple threads makes the pages resident") {
+      sut.prefault(block, 4u);
+
+      REQUIRE(sut.resident_pages() == 9u);
+    }
+  }
+
+  block.fill(std::byte{0x5a});
+
+  SECTION("Prefaulting with multiple threads preserves contents") {
+    sut.prefault(block, 4u);
+
+    REQUIRE(*block.data() == std::byte{0x5a});
+    REQUIRE(*(block.end_address() - 1) == std::byte{0x5a});
+  }
+  SECTION("Prefaulting with more threads than pages preserves contents") {
+    sut.prefault(block, 32u);
+
+    REQUIRE(*(block.end_address() - 1) == std::byte{0x5a});
+  }
+}
+
+TEST_CASE("virtual_memory::decommit(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{8u});
+  auto block = sut.commit(0u, uquantity<virtual_memory::page>{8u});
+  block.fill(std::byte{0x7f});
+
+  SECTION("Pages can be committed again after being decommitted") {
+    sut.decommit(0u, uquantity<virtual_memory::page>{8u});
+    auto recommitted = sut.commit(block);
+    recommitted.fill(std::byte{0x01});
+
+    REQUIRE(*recommitted.data() == std::byte{0x01});
+  }
+}
+
+TEST_CASE("virtual_memory::protect(std::size_t, uquantity<page>, page_access)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  auto block = sut.commit(0u, uquantity<virtual_memory::page>{4u});
+  block.fill(std::byte{0x42});
+
+  SECTION("Access is read") {
+    sut.protect(0u, uquantity<virtual_memory::page>{2u}, virtual_memory::page_access::read);
+
+    SECTION("Contents are preserved") {
+      REQUIRE(*sut[1u].data() == std::byte{0x42});
+    }
+    SECTION("Pages remain committed") {
+      REQUIRE(sut.committed_pages() == 4u);
+    }
+    SECTION("Other pages remain writable") {
+      auto page = sut[2u];
+      page.fill(std::byte{0x24});
+
+      REQUIRE(*page.data() == std::byte{0x24});
+    }
+  }
+  SECTION("Access is restored to read_write") {
+    sut.protect(0u, uquantity<virtual_memory::page>{2u}, virtual_memory::page_access::none);
+    sut.protect(sut[0u], virtual_memory::page_access::read_write);
+
+    auto page = sut[0u];
+    page.fill(std::byte{0x24});
+
+    SECTION("Pages are writable again") {
+      REQUIRE(*page.data() == std::byte{0x24});
+    }
+  }
+}
+
+TEST_CASE("virtual_memory::guard(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  sut.commit(0u, uquantity<virtual_memory::page>{4u});
+
+  sut.guard(3u);
+
+  SECTION("Guard page is decommitted") {
+    REQUIRE_FALSE(sut.is_committed(3u));
+  }
+  SECTION("Other pages remain committed") {
+    REQUIRE(sut.committed_pages() == 3u);
+  }
+}
+
+TEST_CASE("virtual_memory::lock(std::size_t, uquantity<page>)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  sut.commit(0u, uquantity<virtual_memory::page>{4u});
+
+  sut.lock(0u, uquantity<virtual_memory::page>{1u});
+
+  SECTION("Locked pages are resident") {
+    REQUIRE(sut.resident_pages() == 1u);
+  }
+  SECTION("Locked pages can be unlocked") {
+    REQUIRE_NOTHROW(sut.unlock(sut[0u]));
+  }
+}
+
+TEST_CASE("virtual_memory::unlock_all()", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  sut.commit(0u, uquantity<virtual_memory::page>{2u});
+
+  SECTION("Pages are locked") {
+    sut.lock(0u, uquantity<virtual_memory::page>{1u});
+    sut.unlock_all();
+
+    SECTION("Pages are no longer locked") {
+      // Cooling is rejected for locked pages
+      REQUIRE(sut.set_temperature(0u, uquantity<virtual_memory::page>{1u},
+                                  virtual_memory::page_temperature::cold));
+    }
+  }
+  SECTION("No pages are locked") {
+    REQUIRE_NOTHROW(sut.unlock_all());
+  }
+}
+
+TEST_CASE("virtual_memory::set_temperature(std::size_t, uquantity<page>, page_temperature)", "[modifiers]") {
+  using page_temperature = virtual_memory::page_temperature;
+
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  sut.commit(0u, uquantity<virtual_memory::page>{4u});
+  sut[0u].fill(std::byte{0x42});
+
+  const auto temperature = GENERATE(
+    page_temperature::warm,
+    page_temperature::cold,
+    page_temperature::paged_out
+  );
+  sut.set_temperature(0u, uquantity<virtual_memory::page>{4u}, temperature);
+
+  SECTION("Pages remain committed") {
+    REQUIRE(sut.committed_pages() == 4u);
+  }
+  SECTION("Preserves the contents of the pages") {
+    REQUIRE(*sut[0u].data() == std::byte{0x42});
+    REQUIRE(*sut[1u].data() == std::byte{0x00});
+  }
+  SECTION("Cooled pages can be warmed again") {
+    sut.set_temperature(sut[0u], page_temperature::warm);
+
+    REQUIRE(*sut[0u].data() == std::byte{0x42});
+  }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("virtual_memory::set_fork_policy(fork_policy)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  auto page = sut.commit(0u);
+  page.fill(std::byte{0x42});
+
+  // Reports the first byte of the page as seen by a forked child process
+  const auto byte_in_child = [&] {
+    const auto pid = ::fork();
+    if (pid == 0) {
+      ::_exit(static_cast<int>(*page.data()));
+    }
+    auto status = 0;
+    ::waitpid(pid, &status, 0);
+
+    return std::byte{static_cast<unsigned char>(WEXITSTATUS(status))};
+  };
+
+  SECTION("Policy is inherit") {
+    sut.set_fork_policy(virtual_memory::fork_policy::inherit);
+
+    SECTION("Child sees the contents") {
+      REQUIRE(byte_in_child() == std::byte{0x42});
+    }
+  }
+  SECTION("Policy is wipe") {
+    sut.set_fork_policy(virtual_memory::fork_policy::wipe);
+
+    SECTION("Child sees zeroed pages") {
+      REQUIRE(byte_in_child() == std::byte{0});
+    }
+    SECTION("Parent keeps the contents") {
+      REQUIRE(*page.data() == std::byte{0x42});
+    }
+  }
+  SECTION("Policy is exclude") {
+    sut.set_fork_policy(virtual_memory::fork_policy::exclude);
+
+    SECTION("Policy is recorded") {
+      REQUIRE(sut.get_fork_policy() == virtual_memory::fork_policy::exclude);
+    }
+  }
+}
+#endif
+
+TEST_CASE("virtual_memory::grow(uquantity<page>, growth_policy)", "[modifiers]") {
+  auto sut = virtual_memory::reserve(uquantity<virtual_memory::page>{4u});
+  auto block = sut.commit(0u, uquantity<virtual_memory::page>{2u});
+  block.fill(std::byte{0x42});
+
+  SECTION("Policy is may_move") {
+    const auto result = sut.grow(
+      uquantity<virtual_memory::page>{4u},
+      virtual_memory::growth_policy::may_move
+    );
+
+    SECTION("Reservation is grown") {
+      REQUIRE(result);
+      REQUIRE(sut.pages() == 8u);
+    }
+    SECTION("Committed contents are preserved") {
+      REQUIRE(*sut[1u].data() == std::byte{0x42});
+    }
+    SECTION("Commit state is preserved") {
+      REQUIRE(sut.committed_pages() == 2u);
+      REQUIRE_FALSE(sut.is_committed(7u));
+    }
+    SECTION("New pages can be committed") {
+      auto page = sut.commit(7u);
+      page.fill(std::byte{0x24});
+
+      REQUIRE(*page.data() == std::byte{0x24});
+    }
+  }
+  SECTION("Policy is in_place") {
+    const auto data = sut.data();
+    const auto result = sut.grow(uquantity<virtual_memory::page>{4u});
+
+    SECTION("Reservation is never moved") {
+      REQUIRE(sut.data() == data);
+    }
+    SECTION("Page count reflects whether the reservation grew") {
+      REQUIRE(sut.pages() == (result ? 8u : 4u));
+    }
+  }
+}
+
+#if defined(__linux__)
+TEST_CASE("virtual_memory::grow(uquantity<page>, growth_policy) fails to relocate", "[modifiers]") {
+  using pages = uquantity<virtual_memory::page>;
+
+  // Committing part of the reservation splits it into two mappings, which
+  // are moved individually
+  auto sut = virtual_memory::reserve(pages{4u});
+  sut.commit(0u, pages{2u}).fill(std::byte{0x42});
+  const auto data = sut.data();
+
+  // Blocking the adjacent address space, if nothing occupies it already,
+  // forces the reservation to move
+  const auto end = data + sut.size_in_bytes().count();
+  const auto blocker = ::mmap(end, sut.page_size().count(), PROT_NONE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  REQUIRE((blocker == end || (blocker == MAP_FAILED && errno == EEXIST)));
+
+  // The first mapping is moved, and then moving the second fails
+  static auto moves = 0;
+  moves = 0;
+  const auto remap_pages = std::exchange(
+    detail::remap_pages,
+    [](void* from, std::size_t size, void* to, int flags) noexcept -> void* {
+      if (++moves == 2) {
+        errno = ENOMEM;
+        return MAP_FAILED;
+      }
+      return ::mremap(from, size, size, flags, to);
+    }
+  );
+  const auto grow = [&] {
+    return sut.grow(pages{4u}, virtual_memory::growth_policy::may_move);
+  };
+  CHECK_THROWS_AS(grow(), std::system_error);
+  detail::remap_pages = remap_pages;
+
+  SECTION("Reservation is not moved") {
+    REQUIRE(sut.data() == data);
+    REQUIRE(sut.pages() == 4u);
+  }
+  SECTION("Committed contents are preserved") {
+    REQUIRE(*sut[0u].data() == std::byte{0x42});
+    REQUIRE(*sut[1u].data() == std::byte{0x42});
+  }
+  SECTION("Uncommitted pages can still be committed") {
+    sut.commit(3u).fill(std::byte{0x24});
+
+    REQUIRE(*sut[3u].data() == std::byte{0x24});
+  }
+
+  if (blocker == end) {
+    ::munmap(blocker, sut.page_size().count());
+  }
+}
+
+TEST_CASE("virtual_memory::grow(uquantity<page>, growth_policy) with a fork_policy", "[modifiers]") {
+  using pages = uquantity<virtual_memory::page>;
+
+  // Releasing a reservation just above the next one leaves the address space
+  // after it free, so that it can be extended
+  auto above = virtual_memory::reserve(pages{8u});
+  auto sut = virtual_memory::reserve(pages{4u});
+  above = virtual_memory::reserve(pages{1u});
+
+  sut.set_fork_policy(virtual_memory::fork_policy::wipe);
+
+  // Reports the first byte of the page at \p n as seen by a forked child
+  const auto byte_in_child = [&](std::size_t n) {
+    const auto pid = ::fork();
+    if (pid == 0) {
+      ::_exit(static_cast<int>(*sut[n].data()));
+    }
+    auto status = 0;
+    ::waitpid(pid, &status, 0);
+
+    return std::byte{static_cast<unsigned char>(WEXITSTATUS(status))};
+  };
+
+  SECTION("Reservation is extended") {
+    REQUIRE(sut.grow(pages{4u}, virtual_memory::growth_policy::in_place));
+    sut.commit(6u).fill(std::byte{0x42});
+
+    SECTION("New pages follow the policy") {
+      REQUIRE(byte_in_child(6u) == std::byte{0});
+    }
+  }
+  SECTION("Reservation is relocated") {
+    // Blocking the adjacent address space forces the reservation to move
+    const auto end = sut.data() + sut.size_in_bytes().count();
+    const auto blocker = ::mmap(end, sut.page_size().count(), PROT_NONE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    REQUIRE(blocker == end);
+
+    const auto data = sut.data();
+    REQUIRE(sut.grow(pages{4u}, virtual_memory::growth_policy::may_move));
+    sut.commit(6u).fill(std::byte{0x42});
+    ::munmap(blocker, sut.page_size().count());
+
+    SECTION("Reservation is moved") {
+      REQUIRE(sut.data() != data);
+    }
+    SECTION("New pages follow the policy") {
+      REQUIRE(byte_in_child(6u) == std::byte{0});
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Dirty Tracking
+//------------------------------------------------------------------------------
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("virtual_memory::checkpoint()", "[dirty tracking]") {
+  using pages = uquantity<virtual_memory::page>;
+
+  auto sut = virtual_memory::reserve(pages{8u});
+  sut.commit(0u, pages{6u});
+
+  // The automatically selected mechanism is tested alongside the fallback,
+  // which is available on every POSIX system
+  const auto automatic = GENERATE(true, false);
+  if (automatic) {
+    sut.track_dirty_pages();
+  } else {
+    sut.track_dirty_pages(virtual_memory::dirty_tracking::write_protect);
+  }
+  REQUIRE(sut.is_tracking_dirty_pages());
+
+  SECTION("Nothing is written") {
+    SECTION("Reports no dirty pages") {
+      REQUIRE(sut.checkpoint().empty());
+    }
+  }
+
+  SECTION("Pages are written") {
+    sut[1u].fill(std::byte{0x42});
+    sut[2u].fill(std::byte{0x42});
+    *sut[4u].data() = std::byte{0x24};
+
+    SECTION("Reports the written pages, coalesced") {
+      const auto result = sut.dirty_pages();
+
+      REQUIRE(result.size() == 2u);
+      REQUIRE(result[0] == memory_block::from_pointer_and_length(
+        sut[1u].start_address(), sut.page_size() * 2u
+      ));
+      REQUIRE(result[1] == sut[4u]);
+    }
+    SECTION("Contents are preserved") {
+      REQUIRE(*sut[1u].data() == std::byte{0x42});
+      REQUIRE(*sut[4u].data() == std::byte{0x24});
+    }
+    SECTION("Checkpoint resets the dirty pages") {
+      REQUIRE(sut.checkpoint().size() == 2u);
+
+      *sut[5u].data() = std::byte{0x01};
+      const auto result = sut.checkpoint();
+
+      REQUIRE(result.size() == 1u);
+      REQUIRE(result[0] == sut[5u]);
+    }
+  }
+
+  SECTION("Page is committed after the checkpoint") {
+    sut.commit(6u);
+
+    SECTION("Reports the page as dirty") {
+      const auto result = sut.checkpoint();
+
+      REQUIRE(result.size() == 1u);
+      REQUIRE(result[0] == sut[6u]);
+    }
+    SECTION("Writes to the page are tracked after the next checkpoint") {
+      sut.checkpoint();
+      *sut[6u].data() = std::byte{0x01};
+
+      REQUIRE(sut.checkpoint().size() == 1u);
+    }
+  }
+
+  SECTION("Page is written and decommitted") {
+    sut[3u].fill(std::byte{0x42});
+    sut.decommit(3u);
+
+    SECTION("Does not report the page") {
+      REQUIRE(sut.checkpoint().empty());
+    }
+  }
+
+  SECTION("Reservation is grown") {
+    sut.grow(pages{8u}, virtual_memory::growth_policy::may_move);
+    sut.checkpoint();
+    *sut[0u].data() = std::byte{0x01};
+
+    SECTION("Writes are still tracked") {
+      const auto result = sut.checkpoint();
+
+      REQUIRE(result.size() == 1u);
+      REQUIRE(result[0] == sut[0u]);
+    }
+  }
+
+  SECTION("Tracking is stopped") {
+    sut.stop_tracking_dirty_pages();
+
+    SECTION("Pages remain writable") {
+      sut[0u].fill(std::byte{0x42});
+
+      REQUIRE(*sut[0u].data() == std::byte{0x42});
+      REQUIRE_FALSE(sut.is_tracking_dirty_pages());
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Cloning
+//------------------------------------------------------------------------------
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("virtual_memory::clone_cow()", "[cloning]") {
+  using pages = uquantity<virtual_memory::page>;
+
+  auto sut = virtual_memory::reserve(pages{4u});
+  sut.commit(0u, pages{3u});
+  sut[0u].fill(std::byte{0x01});
+  sut[1u].fill(std::byte{0x02});
+
+  auto clone = sut.clone_cow();
+
+  SECTION("Clone has the same contents and commit state") {
+    REQUIRE(clone.pages() == sut.pages());
+    REQUIRE(clone.committed_pages() == 3u);
+    REQUIRE_FALSE(clone.is_committed(3u));
+    REQUIRE(*clone[0u].data() == std::byte{0x01});
+    REQUIRE(*clone[1u].data() == std::byte{0x02});
+    REQUIRE(*clone[2u].data() == std::byte{0x00});
+  }
+
+  SECTION("Source is written") {
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+    }
+    SECTION("Source sees the write") {
+      REQUIRE(*sut[0u].data() == std::byte{0x10});
+    }
+    SECTION("Later clone sees the write") {
+      const auto later = sut.clone_cow();
+      sut[0u].fill(std::byte{0x20});
+
+      REQUIRE(*later[0u].data() == std::byte{0x10});
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+      REQUIRE(*sut[0u].data() == std::byte{0x20});
+    }
+  }
+
+  SECTION("Clone is written") {
+    clone[1u].fill(std::byte{0x20});
+
+    SECTION("Source keeps its contents") {
+      REQUIRE(*sut[1u].data() == std::byte{0x02});
+    }
+    SECTION("Source writes do not overwrite the clone") {
+      sut[1u].fill(std::byte{0x30});
+
+      REQUIRE(*clone[1u].data() == std::byte{0x20});
+    }
+  }
+
+  SECTION("Source is decommitted and committed again") {
+    sut.decommit(1u);
+    sut.commit(1u);
+
+    SECTION("Source reads as zero") {
+      REQUIRE(*sut[1u].data() == std::byte{0x00});
+    }
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(*clone[1u].data() == std::byte{0x02});
+    }
+  }
+
+  SECTION("Source is committed again and written") {
+    sut.commit(0u, pages{1u});
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+    }
+    SECTION("Source sees the write") {
+      REQUIRE(*sut[0u].data() == std::byte{0x10});
+    }
+  }
+
+  SECTION("Clone is committed again and written") {
+    clone.commit(1u, pages{1u});
+    clone[1u].fill(std::byte{0x20});
+
+    SECTION("Source keeps its contents") {
+      REQUIRE(*sut[1u].data() == std::byte{0x02});
+    }
+  }
+
+  SECTION("Clone is decommitted and committed again") {
+    clone.decommit(0u);
+    clone.commit(0u);
+
+    SECTION("Clone reads as zero") {
+      REQUIRE(*clone[0u].data() == std::byte{0x00});
+    }
+  }
+
+  SECTION("Source is protected and written") {
+    sut.protect(0u, pages{1u}, virtual_memory::page_access::read);
+    sut.protect(0u, pages{1u}, virtual_memory::page_access::read_write);
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+    }
+  }
+
+  SECTION("Source is grown") {
+    sut.grow(pages{4u}, virtual_memory::growth_policy::may_move);
+    sut.commit(6u).fill(std::byte{0x06});
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(clone.pages() == 4u);
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+    }
+    SECTION("Later clone sees the new pages") {
+      const auto later = sut.clone_cow();
+
+      REQUIRE(later.pages() == 8u);
+      REQUIRE(*later[6u].data() == std::byte{0x06});
+    }
+  }
+
+  SECTION("Source is destroyed") {
+    sut = virtual_memory::reserve(pages{1u});
+
+    SECTION("Clone keeps the original contents") {
+      REQUIRE(*clone[0u].data() == std::byte{0x01});
+      REQUIRE(*clone[1u].data() == std::byte{0x02});
+    }
+  }
+
+  SECTION("Clone is destroyed") {
+    clone = virtual_memory::reserve(pages{1u});
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Source can still be written") {
+      REQUIRE(*sut[0u].data() == std::byte{0x10});
+    }
+  }
+
+  SECTION("Source has as many clones as it may") {
+    auto clones = std::vector<virtual_memory>{};
+    for (auto i = 1u; i < 64u; ++i) {
+      clones.push_back(sut.clone_cow());
+    }
+
+    SECTION("Cloning again throws") {
+      REQUIRE_THROWS_AS(sut.clone_cow(), std::system_error);
+    }
+    SECTION("Cloning after destroying a clone succeeds") {
+      clones.pop_back();
+
+      REQUIRE_NOTHROW(sut.clone_cow());
+    }
+  }
+
+  SECTION("Clone is cloned") {
+    auto nested = clone.clone_cow();
+    clone[0u].fill(std::byte{0x30});
+    sut[0u].fill(std::byte{0x10});
+
+    SECTION("Each keeps its own contents") {
+      REQUIRE(*nested[0u].data() == std::byte{0x01});
+      REQUIRE(*clone[0u].data() == std::byte{0x30});
+      REQUIRE(*sut[0u].data() == std::byte{0x10});
+    }
+  }
+}
+#endif
+
+} // namespace msl::test
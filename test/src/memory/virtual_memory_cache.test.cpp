@@ -0,0 +1,176 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/virtual_memory_cache.hpp"
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include <catch2/catch.hpp>
+
+namespace msl::test {
+
+//==============================================================================
+// class : virtual_memory_cache
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Cache
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory_cache::acquire(uquantity<page>, page_mode)", "[cache]") {
+  auto sut = virtual_memory_cache{};
+  const auto pages = uquantity<virtual_memory::page>{4u};
+
+  SECTION("Cache is empty") {
+    const auto memory = sut.acquire(pages);
+
+    SECTION("Reserves new memory") {
+      REQUIRE(memory.pages() == pages);
+    }
+  }
+  SECTION("Cache contains a reservation of the same size") {
+    auto recycled = sut.acquire(pages);
+    const auto data = recycled.data();
+    sut.recycle(std::move(recycled));
+
+    const auto memory = sut.acquire(pages);
+
+    SECTION("Reuses the cached reservation") {
+      REQUIRE(memory.data() == data);
+    }
+    SECTION("Removes the reservation from the cache") {
+      REQUIRE(sut.cached_reservations() == 0u);
+    }
+  }
+  SECTION("Cache contains a reservation of a different size") {
+    auto recycled = sut.acquire(pages);
+    const auto data = recycled.data();
+    sut.recycle(std::move(recycled));
+
+    const auto memory = sut.acquire(uquantity<virtual_memory::page>{2u});
+
+    SECTION("Reserves new memory") {
+      REQUIRE(memory.data() != data);
+    }
+    SECTION("Keeps the cached reservation") {
+      REQUIRE(sut.cached_reservations() == 1u);
+    }
+  }
+}
+
+TEST_CASE("virtual_memory_cache::recycle(virtual_memory)", "[cache]") {
+  const auto pages = uquantity<virtual_memory::page>{4u};
+
+  SECTION("Reservation fits within the limits") {
+    auto sut = virtual_memory_cache{};
+    auto memory = sut.acquire(pages);
+    const auto size = memory.size_in_bytes();
+
+    sut.recycle(std::move(memory));
+
+    SECTION("Caches the reservation") {
+      REQUIRE(sut.cached_reservations() == 1u);
+      REQUIRE(sut.cached_size() == size);
+    }
+  }
+  SECTION("Reservation exceeds the reservations per size") {
+    auto sut = virtual_memory_cache{virtual_memory_cache::limits{
+      .reservations_per_size = uquantity<virtual_memory>{1u},
+      .total_size = gibibytes{1u},
+    }};
+    auto first = sut.acquire(pages);
+    auto second = sut.acquire(pages);
+
+    sut.recycle(std::move(first));
+    sut.recycle(std::move(second));
+
+    SECTION("Releases the reservation") {
+      REQUIRE(sut.cached_reservations() == 1u);
+    }
+  }
+  SECTION("Reservation has been modified") {
+    auto sut = virtual_memory_cache{};
+    auto memory = sut.acquire(pages);
+    memory.commit(0u, pages).fill(std::byte{0x42});
+    memory.track_dirty_pages();
+    memory.set_fork_policy(virtual_memory::fork_policy::exclude);
+
+    sut.recycle(std::move(memory));
+    const auto result = sut.acquire(pages);
+
+    SECTION("Restores the reservation") {
+      REQUIRE(sut.cached_reservations() == 0u);
+      REQUIRE(result.committed_pages() == 0u);
+      REQUIRE(result.resident_pages() == 0u);
+      REQUIRE_FALSE(result.is_tracking_dirty_pages());
+      REQUIRE(result.get_fork_policy() == virtual_memory::fork_policy::inherit);
+    }
+  }
+  SECTION("Reservation has locked pages") {
+    auto sut = virtual_memory_cache{};
+    auto memory = sut.acquire(pages);
+    memory.commit(0u, pages).fill(std::byte{0x42});
+    memory.lock(0u, pages);
+
+    sut.recycle(std::move(memory));
+    const auto result = sut.acquire(pages);
+
+    SECTION("Reclaims the locked pages") {
+      REQUIRE(result.committed_pages() == 0u);
+      REQUIRE(result.resident_pages() == 0u);
+    }
+  }
+  SECTION("Reservation is backed by other hooks") {
+    auto sut = virtual_memory_cache{};
+    auto hooks = virtual_memory_hooks{};
+
+    sut.recycle(virtual_memory::reserve(pages, hooks));
+
+    SECTION("Releases the reservation") {
+      REQUIRE(sut.cached_reservations() == 0u);
+    }
+  }
+#if defined(__unix__) || defined(__APPLE__)
+  SECTION("Reservation is copy-on-write") {
+    auto sut = virtual_memory_cache{};
+    auto memory = sut.acquire(pages);
+    memory.commit(0u).fill(std::byte{0x42});
+    auto clone = memory.clone_cow();
+
+    sut.recycle(std::move(memory));
+    sut.recycle(std::move(clone));
+
+    SECTION("Releases the reservations") {
+      REQUIRE(sut.cached_reservations() == 0u);
+    }
+  }
+#endif
+  SECTION("Reservation exceeds the total size") {
+    auto sut = virtual_memory_cache{virtual_memory_cache::limits{
+      .reservations_per_size = uquantity<virtual_memory>{16u},
+      .total_size = bytes::zero(),
+    }};
+
+    sut.recycle(sut.acquire(pages));
+
+    SECTION("Releases the reservation") {
+      REQUIRE(sut.cached_reservations() == 0u);
+    }
+  }
+}
+
+TEST_CASE("virtual_memory_cache::trim()", "[cache]") {
+  auto sut = virtual_memory_cache{};
+  sut.recycle(sut.acquire(uquantity<virtual_memory::page>{4u}));
+  sut.recycle(sut.acquire(uquantity<virtual_memory::page>{2u}));
+
+  sut.trim();
+
+  SECTION("Releases all cached reservations") {
+    REQUIRE(sut.cached_reservations() == 0u);
+    REQUIRE(sut.cached_size() == bytes::zero());
+  }
+}
+
+} // namespace msl::test
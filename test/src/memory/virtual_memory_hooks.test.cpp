@@ -0,0 +1,154 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/memory/virtual_memory_hooks.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+namespace msl::test {
+
+//==============================================================================
+// class : virtual_memory_hooks
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+
+  /// \brief Hooks that count the requests made of them, forwarding each to
+  ///        the system
+  class counting_hooks : public virtual_memory_hooks
+  {
+  public:
+
+    auto reserve(bytes size, bytes align, virtual_memory::page_mode mode)
+      -> not_null<std::byte*> override
+    {
+      ++reserves;
+      return virtual_memory_hooks::reserve(size, align, mode);
+    }
+
+    auto commit(not_null<std::byte*> memory, bytes size)
+      -> void override
+    {
+      ++commits;
+      committed += size;
+      virtual_memory_hooks::commit(memory, size);
+    }
+
+    auto decommit(not_null<std::byte*> memory,
+                  bytes size,
+                  virtual_memory::decommit_policy policy)
+      -> void override
+    {
+      ++decommits;
+      virtual_memory_hooks::decommit(memory, size, policy);
+    }
+
+    auto release(not_null<std::byte*> memory, bytes size)
+      noexcept -> void override
+    {
+      ++releases;
+      released += size;
+      virtual_memory_hooks::release(memory, size);
+    }
+
+    int reserves = 0;
+    int commits = 0;
+    int decommits = 0;
+    int releases = 0;
+    bytes committed = bytes{0u};
+    bytes released = bytes{0u};
+  };
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Static Functions
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory_hooks::system()", "[static functions]") {
+  SECTION("Backs reservations without hooks") {
+    const auto memory = virtual_memory::reserve(pages{1u});
+
+    REQUIRE(&memory.hooks() == &virtual_memory_hooks::system());
+  }
+}
+
+//------------------------------------------------------------------------------
+// Hooks
+//------------------------------------------------------------------------------
+
+TEST_CASE("virtual_memory::reserve(uquantity<page>, virtual_memory_hooks&)", "[hooks]") {
+  auto hooks = counting_hooks{};
+
+  SECTION("Memory is reserved") {
+    auto memory = virtual_memory::reserve(pages{4u}, hooks);
+
+    SECTION("Reserves through the hooks") {
+      REQUIRE(hooks.reserves == 1);
+      REQUIRE(&memory.hooks() == &hooks);
+    }
+    SECTION("Commits through the hooks") {
+      memory.commit(0u, pages{2u}).fill(std::byte{0x42});
+
+      REQUIRE(hooks.commits == 1);
+      REQUIRE(hooks.committed == memory.page_size() * 2u);
+      REQUIRE(*memory[1u].data() == std::byte{0x42});
+    }
+    SECTION("Decommits through the hooks") {
+      memory.commit(0u, pages{2u});
+      memory.decommit(0u, pages{2u});
+
+      REQUIRE(hooks.decommits == 1);
+      REQUIRE(memory.committed_pages() == 0u);
+    }
+    SECTION("Memory cannot be grown") {
+      REQUIRE_FALSE(memory.grow(pages{1u}, virtual_memory::growth_policy::may_move));
+      REQUIRE(memory.pages() == 4u);
+    }
+  }
+  SECTION("Memory is destroyed") {
+    {
+      const auto memory = virtual_memory::reserve(pages{4u}, hooks);
+      intrinsics::suppress_unused(memory);
+    }
+
+    SECTION("Releases through the hooks") {
+      REQUIRE(hooks.releases == 1);
+      REQUIRE(hooks.released == virtual_memory::page_size(virtual_memory::page_mode::standard) * 4u);
+    }
+  }
+  SECTION("Memory is moved") {
+    auto memory = virtual_memory::reserve(pages{4u}, hooks);
+    auto other = virtual_memory::reserve(pages{1u});
+
+    other = std::move(memory);
+
+    SECTION("Keeps the hooks") {
+      REQUIRE(&other.hooks() == &hooks);
+    }
+  }
+}
+
+TEST_CASE("virtual_memory::reserve(uquantity<page>, alignment, virtual_memory_hooks&)", "[hooks]") {
+  auto hooks = counting_hooks{};
+  const auto align = alignment::at_boundary(mebibytes{2u});
+
+  const auto memory = virtual_memory::reserve(pages{4u}, align, hooks);
+
+  SECTION("Reserves through the hooks") {
+    REQUIRE(hooks.reserves == 1);
+  }
+  SECTION("Base address is aligned to the requested boundary") {
+    const auto address = reinterpret_cast<std::uintptr_t>(memory.data());
+
+    REQUIRE((address % align.value().count()) == 0u);
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,228 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/pointers/intrusive_pointer_stack.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+
+namespace msl::test {
+
+//==============================================================================
+// class : intrusive_pointer_stack
+//==============================================================================
+
+namespace {
+
+  struct alignas(std::byte*) node
+  {
+    std::array<std::byte, sizeof(std::byte*)> storage;
+  };
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Modifiers
+//------------------------------------------------------------------------------
+
+TEST_CASE("intrusive_pointer_stack::push(not_null<std::byte*>)", "[modifiers]") {
+  auto nodes = std::array<node, 3u>{};
+  auto sut = intrusive_pointer_stack{};
+
+  sut.push(assume_not_null(nodes[0].storage.data()));
+  sut.push(assume_not_null(nodes[1].storage.data()));
+
+  SECTION("Pushed pointer is on top") {
+    REQUIRE(sut.peek() == nodes[1].storage.data());
+  }
+  SECTION("Stack is not empty") {
+    REQUIRE_FALSE(sut.empty());
+  }
+  SECTION("Size increases") {
+    REQUIRE(sut.size() == 2u);
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::pop()", "[modifiers]") {
+  auto nodes = std::array<node, 3u>{};
+  auto sut = intrusive_pointer_stack{};
+
+  for (auto& n : nodes) {
+    sut.push(assume_not_null(n.storage.data()));
+  }
+
+  SECTION("Pointers are popped in LIFO order") {
+    REQUIRE(sut.peek() == nodes[2].storage.data());
+    sut.pop();
+    REQUIRE(sut.peek() == nodes[1].storage.data());
+    sut.pop();
+    REQUIRE(sut.peek() == nodes[0].storage.data());
+    sut.pop();
+    REQUIRE(sut.empty());
+  }
+  SECTION("Size decreases") {
+    sut.pop();
+
+    REQUIRE(sut.size() == 2u);
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::reset()", "[modifiers]") {
+  auto nodes = std::array<node, 2u>{};
+  auto sut = intrusive_pointer_stack{};
+  sut.push(assume_not_null(nodes[0].storage.data()));
+  sut.push(assume_not_null(nodes[1].storage.data()));
+
+  sut.reset();
+
+  SECTION("Stack is empty") {
+    REQUIRE(sut.empty());
+    REQUIRE(sut.size() == 0u);
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::splice(intrusive_pointer_stack&)", "[modifiers]") {
+  auto nodes = std::array<node, 4u>{};
+  auto sut = intrusive_pointer_stack{};
+  auto other = intrusive_pointer_stack{};
+  other.push(assume_not_null(nodes[0].storage.data()));
+  other.push(assume_not_null(nodes[1].storage.data()));
+
+  SECTION("Stack is empty") {
+    sut.splice(other);
+
+    SECTION("Entries are moved") {
+      REQUIRE(other.empty());
+      REQUIRE(sut.size() == 2u);
+      REQUIRE(sut.peek() == nodes[1].storage.data());
+    }
+  }
+  SECTION("Stack is not empty") {
+    sut.push(assume_not_null(nodes[2].storage.data()));
+    sut.push(assume_not_null(nodes[3].storage.data()));
+
+    sut.splice(other);
+
+    SECTION("Entries are moved on top") {
+      REQUIRE(other.empty());
+      REQUIRE(sut.peek() == nodes[1].storage.data());
+      sut.pop();
+      REQUIRE(sut.peek() == nodes[0].storage.data());
+      sut.pop();
+      REQUIRE(sut.peek() == nodes[3].storage.data());
+      sut.pop();
+      REQUIRE(sut.peek() == nodes[2].storage.data());
+    }
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::splice(intrusive_pointer_stack&, not_null<std::byte*>)", "[modifiers]") {
+  auto nodes = std::array<node, 4u>{};
+  auto sut = intrusive_pointer_stack{};
+  auto other = intrusive_pointer_stack{};
+  other.push(assume_not_null(nodes[0].storage.data()));
+  other.push(assume_not_null(nodes[1].storage.data()));
+  sut.push(assume_not_null(nodes[2].storage.data()));
+  sut.push(assume_not_null(nodes[3].storage.data()));
+
+  sut.splice(other, assume_not_null(nodes[0].storage.data()));
+
+  SECTION("Entries are moved on top") {
+    REQUIRE(other.empty());
+    REQUIRE(sut.peek() == nodes[1].storage.data());
+    sut.pop();
+    REQUIRE(sut.peek() == nodes[0].storage.data());
+    sut.pop();
+    REQUIRE(sut.peek() == nodes[3].storage.data());
+    sut.pop();
+    REQUIRE(sut.peek() == nodes[2].storage.data());
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::split(uquantity<std::byte*>)", "[modifiers]") {
+  auto nodes = std::array<node, 4u>{};
+  auto sut = intrusive_pointer_stack{};
+  for (auto& n : nodes) {
+    sut.push(assume_not_null(n.storage.data()));
+  }
+
+  SECTION("Splits the top entries") {
+    auto result = sut.split(uquantity<std::byte*>{3u});
+
+    REQUIRE(result.size() == 3u);
+    REQUIRE(result.peek() == nodes[3].storage.data());
+    REQUIRE(sut.size() == 1u);
+    REQUIRE(sut.peek() == nodes[0].storage.data());
+  }
+  SECTION("Splits more entries than exist") {
+    auto result = sut.split(uquantity<std::byte*>{8u});
+
+    REQUIRE(result.size() == 4u);
+    REQUIRE(sut.empty());
+  }
+  SECTION("Splits no entries") {
+    auto result = sut.split(uquantity<std::byte*>{0u});
+
+    REQUIRE(result.empty());
+    REQUIRE(sut.size() == 4u);
+  }
+}
+
+TEST_CASE("intrusive_pointer_stack::split(uquantity<std::byte*>, std::byte*&)", "[modifiers]") {
+  auto nodes = std::array<node, 4u>{};
+  auto sut = intrusive_pointer_stack{};
+  for (auto& n : nodes) {
+    sut.push(assume_not_null(n.storage.data()));
+  }
+  auto last = static_cast<std::byte*>(nullptr);
+
+  SECTION("Splits the top entries") {
+    auto result = sut.split(uquantity<std::byte*>{3u}, last);
+
+    SECTION("Stores the last detached entry") {
+      REQUIRE(result.size() == 3u);
+      REQUIRE(last == nodes[1].storage.data());
+    }
+  }
+  SECTION("Splits more entries than exist") {
+    auto result = sut.split(uquantity<std::byte*>{8u}, last);
+
+    SECTION("Stores the last entry") {
+      REQUIRE(result.size() == 4u);
+      REQUIRE(last == nodes[0].storage.data());
+    }
+  }
+  SECTION("Splits no entries") {
+    last = nodes[0].storage.data();
+    auto result = sut.split(uquantity<std::byte*>{0u}, last);
+
+    SECTION("Stores null") {
+      REQUIRE(result.empty());
+      REQUIRE(last == nullptr);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Observers
+//------------------------------------------------------------------------------
+
+TEST_CASE("intrusive_pointer_stack::contains(const std::byte*)", "[observers]") {
+  auto nodes = std::array<node, 3u>{};
+  auto sut = intrusive_pointer_stack{};
+  sut.push(assume_not_null(nodes[0].storage.data()));
+  sut.push(assume_not_null(nodes[1].storage.data()));
+
+  SECTION("Pointer is in the stack") {
+    REQUIRE(sut.contains(nodes[0].storage.data()));
+    REQUIRE(sut.contains(nodes[1].storage.data()));
+  }
+  SECTION("Pointer is not in the stack") {
+    REQUIRE_FALSE(sut.contains(nodes[2].storage.data()));
+  }
+}
+
+} // namespace msl::test
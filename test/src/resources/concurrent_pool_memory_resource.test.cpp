@@ -0,0 +1,250 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/concurrent_pool_memory_resource.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace msl::test {
+
+//==============================================================================
+// class : concurrent_pool_memory_resource
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+
+  struct message
+  {
+    std::uint64_t sequence;
+    std::uint64_t payload;
+  };
+
+  using sut_type = concurrent_pool_memory_resource<sizeof(message), alignof(message)>;
+
+  auto make_options() -> sut_type::options
+  {
+    return sut_type::options{
+      .slab_pages = pages{1u},
+    };
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Allocation
+//------------------------------------------------------------------------------
+
+TEST_CASE("concurrent_pool_memory_resource::allocate<T>()", "[allocation]") {
+  auto sut = sut_type{make_options()};
+
+  SECTION("Blocks are writeable and aligned") {
+    const auto c = sut.allocate<message>();
+
+    *c.data().get() = message{1u, 2u};
+
+    REQUIRE(c.data().get()->payload == 2u);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(c.data().get()) % alignof(message) == 0u);
+  }
+  SECTION("Slab is exhausted") {
+    auto addresses = std::set<message*>{};
+    for (auto i = 0u; i <= sut.blocks_per_slab(); ++i) {
+      addresses.insert(sut.allocate<message>().data().get());
+    }
+
+    SECTION("A new slab is reserved") {
+      REQUIRE(sut.slabs() == 2u);
+    }
+    SECTION("No block is distributed twice") {
+      REQUIRE(addresses.size() == sut.blocks_per_slab() + 1u);
+    }
+  }
+  SECTION("Each thread allocates from its own slab") {
+    static_cast<void>(sut.allocate<message>());
+
+    auto thread = std::thread{[&] {
+      static_cast<void>(sut.allocate<message>());
+    }};
+    thread.join();
+
+    REQUIRE(sut.slabs() == 2u);
+  }
+}
+
+TEST_CASE("concurrent_pool_memory_resource::deallocate(const cell<T,Align>&)", "[allocation]") {
+  auto sut = sut_type{make_options()};
+
+  SECTION("Block is freed by the owning thread") {
+    const auto c = sut.allocate<message>();
+    sut.deallocate(c);
+
+    SECTION("Block is reused immediately") {
+      REQUIRE(sut.allocate<message>().data() == c.data());
+    }
+  }
+  SECTION("Block is freed by another thread") {
+    auto cells = std::vector<cell<message,alignof(message)>>{};
+    for (auto i = 1u; i < sut.blocks_per_slab(); ++i) {
+      cells.push_back(sut.allocate<message>());
+    }
+    const auto kept = sut.allocate<message>();
+
+    auto thread = std::thread{[&] {
+      for (const auto& c : cells) {
+        sut.deallocate(c);
+      }
+    }};
+    thread.join();
+
+    SECTION("Owner reclaims the blocks without reserving a new slab") {
+      auto addresses = std::set<message*>{};
+      for (auto i = 0u; i < cells.size(); ++i) {
+        addresses.insert(sut.allocate<message>().data().get());
+      }
+
+      REQUIRE(sut.slabs() == 1u);
+      REQUIRE(addresses.size() == cells.size());
+    }
+    SECTION("Owner reuses its local blocks before reclaiming") {
+      sut.deallocate(kept);
+
+      REQUIRE(sut.allocate<message>().data() == kept.data());
+    }
+  }
+  SECTION("Blocks of several slabs are freed by another thread, repeatedly") {
+    auto cells = std::vector<cell<message,alignof(message)>>{};
+    for (auto i = 0u; i < sut.blocks_per_slab() * 2u; ++i) {
+      cells.push_back(sut.allocate<message>());
+    }
+    const auto free_remotely = [&] {
+      auto thread = std::thread{[&] {
+        for (const auto& c : cells) {
+          sut.deallocate(c);
+        }
+      }};
+      thread.join();
+    };
+
+    free_remotely();
+    for (auto& c : cells) {
+      c = sut.allocate<message>();
+    }
+    free_remotely();
+    for (auto& c : cells) {
+      c = sut.allocate<message>();
+    }
+
+    SECTION("Owner reclaims the blocks of every slab each time") {
+      REQUIRE(sut.slabs() == 2u);
+    }
+  }
+  SECTION("Owning thread has exited") {
+    auto cells = std::vector<cell<message,alignof(message)>>{};
+    auto thread = std::thread{[&] {
+      for (auto i = 0u; i < 4u; ++i) {
+        cells.push_back(sut.allocate<message>());
+      }
+    }};
+    thread.join();
+
+    for (const auto& c : cells) {
+      sut.deallocate(c);
+    }
+
+    SECTION("Its heap and blocks are adopted by the next thread") {
+      auto addresses = std::set<message*>{};
+      for (auto i = 0u; i < cells.size(); ++i) {
+        addresses.insert(sut.allocate<message>().data().get());
+      }
+
+      REQUIRE(sut.slabs() == 1u);
+      for (const auto& c : cells) {
+        REQUIRE(addresses.contains(c.data().get()));
+      }
+    }
+  }
+}
+
+TEST_CASE("concurrent_pool_memory_resource is thread-safe", "[allocation]") {
+  constexpr auto producers = 4u;
+  constexpr auto messages = 5000u;
+
+  auto sut = sut_type{make_options()};
+
+  auto mutex = std::mutex{};
+  auto queue = std::vector<cell<message,alignof(message)>>{};
+  auto done = std::atomic<unsigned>{0u};
+  auto consumed = std::atomic<unsigned>{0u};
+  auto corrupted = std::atomic<bool>{false};
+
+  auto workers = std::vector<std::thread>{};
+  for (auto t = 0u; t < producers; ++t) {
+    workers.emplace_back([&, t] {
+      for (auto i = 0u; i < messages; ++i) {
+        const auto c = sut.allocate<message>();
+        *c.data().get() = message{i, t};
+
+        auto lock = std::lock_guard{mutex};
+        queue.push_back(c);
+      }
+      done.fetch_add(1u);
+    });
+  }
+  for (auto t = 0u; t < producers; ++t) {
+    workers.emplace_back([&] {
+      auto batch = std::vector<cell<message,alignof(message)>>{};
+      while (true) {
+        {
+          auto lock = std::lock_guard{mutex};
+          batch.swap(queue);
+        }
+        if (batch.empty()) {
+          if (done.load() == producers && consumed.load() == producers * messages) {
+            break;
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        for (const auto& c : batch) {
+          if (c.data().get()->payload >= producers) {
+            corrupted = true;
+          }
+          sut.deallocate(c);
+        }
+        consumed.fetch_add(static_cast<unsigned>(batch.size()));
+        batch.clear();
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  SECTION("Every message is consumed intact") {
+    REQUIRE(consumed.load() == producers * messages);
+    REQUIRE_FALSE(corrupted.load());
+  }
+  SECTION("Freed blocks are reused by their owners") {
+    // Each producer was retired and its heap holds its reclaimed blocks, so
+    // allocating a full slab's worth requires no new slab
+    const auto before = sut.slabs();
+    for (auto i = 0u; i < sut.blocks_per_slab(); ++i) {
+      static_cast<void>(sut.allocate<message>());
+    }
+
+    REQUIRE(sut.slabs() == before);
+  }
+}
+
+} // namespace msl::test
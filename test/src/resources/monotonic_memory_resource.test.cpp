@@ -0,0 +1,215 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/monotonic_memory_resource.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace msl::test {
+
+//==============================================================================
+// class : monotonic_memory_resource
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+  using ints = uquantity<int>;
+
+  auto page_size() -> bytes
+  {
+    return virtual_memory::page_size(virtual_memory::page_mode::standard);
+  }
+
+  auto is_aligned(const void* p, std::size_t align) -> bool
+  {
+    return (reinterpret_cast<std::uintptr_t>(p) % align) == 0u;
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Constructors
+//------------------------------------------------------------------------------
+
+TEST_CASE("monotonic_memory_resource::monotonic_memory_resource(virtual_memory)", "[ctor]") {
+  auto memory = virtual_memory::reserve(pages{4u});
+
+  SECTION("No pages are committed") {
+    const auto sut = monotonic_memory_resource{std::move(memory)};
+
+    REQUIRE(sut.used() == bytes{0u});
+    REQUIRE(sut.committed() == bytes{0u});
+    REQUIRE(sut.capacity() == page_size() * 4u);
+  }
+  SECTION("Pages are committed up front") {
+    memory.commit(0u, pages{2u});
+    const auto sut = monotonic_memory_resource{std::move(memory)};
+
+    SECTION("Committed pages are used as-is") {
+      REQUIRE(sut.committed() == page_size() * 2u);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Allocation
+//------------------------------------------------------------------------------
+
+TEST_CASE("monotonic_memory_resource::allocate<T,Align>(uquantity<T>)", "[allocation]") {
+  alignas(64) auto storage = std::array<std::byte, 256u>{};
+  auto sut = monotonic_memory_resource{
+    memory_block::from_pointer_and_length(assume_not_null(storage.data()), bytes{storage.size()})
+  };
+
+  SECTION("Allocations are contiguous") {
+    const auto first = sut.allocate<int>(ints{4u});
+    const auto second = sut.allocate<int>(ints{4u});
+
+    REQUIRE(first.size() == 4u);
+    REQUIRE(second.data().get() == first.data().get() + 4u);
+    REQUIRE(sut.used() == size_of<int>() * 8u);
+  }
+  SECTION("Allocations are aligned") {
+    const auto first = sut.allocate<char>(uquantity<char>{1u});
+    const auto second = sut.allocate<int, 32u>(ints{1u});
+
+    REQUIRE(is_aligned(second.data().get(), 32u));
+    REQUIRE(reinterpret_cast<std::byte*>(second.data().get()) > reinterpret_cast<std::byte*>(first.data().get()));
+  }
+  SECTION("Resource is exhausted") {
+    static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{200u}));
+
+    REQUIRE_THROWS_AS(sut.allocate<std::byte>(uquantity<std::byte>{57u}), std::bad_alloc);
+  }
+  SECTION("Allocation overflows") {
+    const auto n = ints{std::numeric_limits<std::size_t>::max() / 2u};
+
+    REQUIRE_THROWS_AS(sut.allocate<int>(n), std::bad_alloc);
+  }
+}
+
+TEST_CASE("monotonic_memory_resource::allocate<T,Align>(uquantity<T>) with virtual_memory", "[allocation]") {
+  auto sut = monotonic_memory_resource{virtual_memory::reserve(pages{16u})};
+  const auto page = page_size().count();
+
+  SECTION("Allocating commits the touched pages") {
+    const auto c = sut.allocate<std::byte>(uquantity<std::byte>{page + 1u});
+    c.data().get()[page] = std::byte{0x42};
+
+    REQUIRE(sut.committed() == page_size() * 2u);
+  }
+  SECTION("Committing grows geometrically") {
+    static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{page * 2u}));
+    static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{1u}));
+
+    REQUIRE(sut.committed() == page_size() * 4u);
+  }
+  SECTION("Committing is capped by the capacity") {
+    static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{page * 10u}));
+    static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{page}));
+
+    REQUIRE(sut.committed() == sut.capacity());
+  }
+}
+
+TEST_CASE("monotonic_memory_resource::resize_allocation(const cell<T[],Align>&, uquantity<T>)", "[allocation]") {
+  auto sut = monotonic_memory_resource{virtual_memory::reserve(pages{4u})};
+  const auto capacity = sut.capacity().count() / sizeof(int);
+
+  SECTION("Cell is the most recent allocation") {
+    const auto c = sut.allocate<int>(ints{4u});
+
+    SECTION("Grows in place") {
+      const auto result = sut.resize_allocation(c, ints{capacity});
+
+      REQUIRE(result.has_value());
+      REQUIRE(result->data() == c.data());
+      REQUIRE(result->size() == capacity);
+      REQUIRE(sut.used() == sut.capacity());
+    }
+    SECTION("Shrinks in place, reclaiming memory") {
+      const auto result = sut.resize_allocation(c, ints{1u});
+
+      REQUIRE(result.has_value());
+      REQUIRE(result->size() == 1u);
+      REQUIRE(sut.used() == size_of<int>());
+    }
+    SECTION("Growing past the capacity fails") {
+      const auto result = sut.resize_allocation(c, ints{capacity + 1u});
+
+      REQUIRE_FALSE(result.has_value());
+      REQUIRE(sut.used() == size_of<int>() * 4u);
+    }
+  }
+  SECTION("Cell is not the most recent allocation") {
+    const auto c = sut.allocate<int>(ints{4u});
+    static_cast<void>(sut.allocate<int>(ints{1u}));
+
+    SECTION("Growing fails") {
+      REQUIRE_FALSE(sut.resize_allocation(c, ints{5u}).has_value());
+    }
+    SECTION("Shrinking succeeds without reclaiming memory") {
+      const auto result = sut.resize_allocation(c, ints{2u});
+
+      REQUIRE(result.has_value());
+      REQUIRE(result->size() == 2u);
+      REQUIRE(sut.used() == size_of<int>() * 5u);
+    }
+  }
+}
+
+TEST_CASE("monotonic_memory_resource::deallocate(const cell<T[],Align>&)", "[allocation]") {
+  auto sut = monotonic_memory_resource{virtual_memory::reserve(pages{1u})};
+
+  SECTION("Cell is the most recent allocation") {
+    static_cast<void>(sut.allocate<int>(ints{1u}));
+    const auto c = sut.allocate<int>(ints{4u});
+
+    sut.deallocate(c);
+
+    SECTION("Memory is reclaimed") {
+      REQUIRE(sut.used() == size_of<int>());
+    }
+  }
+  SECTION("Cell is not the most recent allocation") {
+    const auto c = sut.allocate<int>(ints{4u});
+    static_cast<void>(sut.allocate<int>(ints{1u}));
+
+    sut.deallocate(c);
+
+    SECTION("Memory is not reclaimed") {
+      REQUIRE(sut.used() == size_of<int>() * 5u);
+    }
+  }
+}
+
+TEST_CASE("monotonic_memory_resource::release()", "[allocation]") {
+  auto sut = monotonic_memory_resource{virtual_memory::reserve(pages{4u})};
+  const auto first = sut.allocate<int>(ints{16u});
+  static_cast<void>(sut.allocate<std::byte>(uquantity<std::byte>{page_size().count() * 2u}));
+  const auto committed = sut.committed();
+
+  sut.release();
+
+  SECTION("All memory is available") {
+    REQUIRE(sut.used() == bytes{0u});
+  }
+  SECTION("Pages remain committed") {
+    REQUIRE(sut.committed() == committed);
+  }
+  SECTION("Memory is reused") {
+    const auto c = sut.allocate<int>(ints{1u});
+
+    REQUIRE(c.data() == first.data());
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,160 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/pool_memory_resource.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace msl::test {
+
+//==============================================================================
+// class : pool_memory_resource
+//==============================================================================
+
+namespace {
+
+  using pages = uquantity<virtual_memory::page>;
+
+  struct order
+  {
+    std::uint64_t id;
+    std::uint32_t quantity;
+    std::uint32_t price;
+  };
+
+  using sut_type = pool_memory_resource<sizeof(order), alignof(order)>;
+
+  auto make_options() -> sut_type::options
+  {
+    return sut_type::options{
+      .slab_pages = pages{1u},
+    };
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Allocation
+//------------------------------------------------------------------------------
+
+TEST_CASE("pool_memory_resource::allocate<T>()", "[allocation]") {
+  auto sut = sut_type{make_options()};
+
+  SECTION("Blocks are distinct and aligned") {
+    const auto first = sut.allocate<order>();
+    const auto second = sut.allocate<order>();
+
+    const auto distance = reinterpret_cast<std::byte*>(second.data().get())
+                        - reinterpret_cast<std::byte*>(first.data().get());
+    REQUIRE(static_cast<std::size_t>(distance) == sut_type::block_size().count());
+    REQUIRE(reinterpret_cast<std::uintptr_t>(second.data().get()) % alignof(order) == 0u);
+  }
+  SECTION("Blocks are writeable") {
+    const auto c = sut.allocate<order>();
+
+    *c.data().get() = order{1u, 2u, 3u};
+
+    REQUIRE(c.data().get()->price == 3u);
+  }
+  SECTION("Slab is exhausted") {
+    auto addresses = std::set<order*>{};
+    for (auto i = 0u; i <= sut.blocks_per_slab(); ++i) {
+      addresses.insert(sut.allocate<order>().data().get());
+    }
+
+    SECTION("A new slab is reserved") {
+      REQUIRE(sut.slabs() == 2u);
+    }
+    SECTION("No block is distributed twice") {
+      REQUIRE(addresses.size() == sut.blocks_per_slab() + 1u);
+    }
+  }
+  SECTION("Smaller types share the block size") {
+    const auto c = sut.allocate<std::uint32_t>();
+
+    REQUIRE(reinterpret_cast<std::uintptr_t>(c.data().get()) % alignof(order) == 0u);
+  }
+}
+
+TEST_CASE("pool_memory_resource::deallocate(const cell<T,Align>&)", "[allocation]") {
+  auto sut = sut_type{make_options()};
+  const auto first = sut.allocate<order>();
+  const auto second = sut.allocate<order>();
+
+  sut.deallocate(first);
+  sut.deallocate(second);
+
+  SECTION("Blocks are reused in LIFO order") {
+    REQUIRE(sut.allocate<order>().data() == second.data());
+    REQUIRE(sut.allocate<order>().data() == first.data());
+  }
+  SECTION("No new slab is reserved") {
+    for (auto i = 0u; i < sut.blocks_per_slab(); ++i) {
+      static_cast<void>(sut.allocate<order>());
+    }
+
+    REQUIRE(sut.slabs() == 1u);
+  }
+}
+
+TEST_CASE("pool_memory_resource::release()", "[allocation]") {
+  auto sut = sut_type{make_options()};
+  const auto blocks = sut.blocks_per_slab() * 2u;
+
+  auto before = std::vector<order*>{};
+  for (auto i = 0u; i < blocks; ++i) {
+    before.push_back(sut.allocate<order>().data().get());
+  }
+
+  sut.release();
+
+  SECTION("Slabs are reused") {
+    auto after = std::vector<order*>{};
+    for (auto i = 0u; i < blocks; ++i) {
+      after.push_back(sut.allocate<order>().data().get());
+    }
+
+    REQUIRE(after == before);
+    REQUIRE(sut.slabs() == 2u);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Observers
+//------------------------------------------------------------------------------
+
+TEST_CASE("pool_memory_resource::block_size()", "[observers]") {
+  SECTION("Block is rounded up to the alignment") {
+    STATIC_REQUIRE(pool_memory_resource<12u, 8u>::block_size() == bytes{16u});
+  }
+  SECTION("Block holds at least a pointer") {
+    STATIC_REQUIRE(pool_memory_resource<1u, 1u>::block_size() == bytes{sizeof(std::byte*)});
+  }
+}
+
+TEST_CASE("pool_memory_resource::blocks_per_slab()", "[observers]") {
+  using large_type = pool_memory_resource<16384u, 64u>;
+
+  SECTION("Block is larger than a slab") {
+    auto sut = large_type{large_type::options{.slab_pages = pages{1u}}};
+
+    SECTION("Slab grows to fit a block") {
+      REQUIRE(sut.blocks_per_slab() >= 1u);
+    }
+    SECTION("Block is allocated") {
+      const auto c = sut.allocate<std::byte>();
+
+      c.data().get()[16383] = std::byte{0x42};
+
+      REQUIRE(sut.slabs() == 1u);
+    }
+  }
+}
+
+} // namespace msl::test
@@ -0,0 +1,85 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/size_class_table.hpp"
+
+#include <catch2/catch.hpp>
+
+namespace msl::test {
+
+//==============================================================================
+// class : size_class_table
+//==============================================================================
+
+namespace {
+
+  constexpr auto table = size_class_table{bytes{16u}, kibibytes{1u}};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Constructors
+//------------------------------------------------------------------------------
+
+TEST_CASE("size_class_table::size_class_table(bytes, bytes, std::size_t)", "[ctor]") {
+  SECTION("Small classes are spaced by the granularity") {
+    STATIC_REQUIRE(table[0u] == bytes{16u});
+    STATIC_REQUIRE(table[1u] == bytes{32u});
+    STATIC_REQUIRE(table[7u] == bytes{128u});
+  }
+  SECTION("Each doubling is split into steps") {
+    STATIC_REQUIRE(table[8u] == bytes{160u});
+    STATIC_REQUIRE(table[9u] == bytes{192u});
+    STATIC_REQUIRE(table[10u] == bytes{224u});
+    STATIC_REQUIRE(table[11u] == bytes{256u});
+    STATIC_REQUIRE(table[12u] == bytes{320u});
+  }
+  SECTION("Largest class is the max size") {
+    STATIC_REQUIRE(table.max_size() == kibibytes{1u});
+    STATIC_REQUIRE(table.size() == 20u);
+  }
+  SECTION("Single step per doubling") {
+    constexpr auto sut = size_class_table{bytes{8u}, bytes{64u}, 1u};
+
+    STATIC_REQUIRE(sut.size() == 4u);
+    STATIC_REQUIRE(sut[3u] == bytes{64u});
+  }
+}
+
+//------------------------------------------------------------------------------
+// Element Access
+//------------------------------------------------------------------------------
+
+TEST_CASE("size_class_table::alignment_of(std::size_t)", "[element access]") {
+  STATIC_REQUIRE(table.alignment_of(0u) == alignment::at_boundary<16u>());
+  STATIC_REQUIRE(table.alignment_of(2u) == alignment::at_boundary<16u>());
+  STATIC_REQUIRE(table.alignment_of(3u) == alignment::at_boundary<64u>());
+  STATIC_REQUIRE(table.alignment_of(8u) == alignment::at_boundary<32u>());
+}
+
+//------------------------------------------------------------------------------
+// Lookup
+//------------------------------------------------------------------------------
+
+TEST_CASE("size_class_table::index_of(bytes, alignment)", "[lookup]") {
+  SECTION("Size is rounded up to the nearest class") {
+    STATIC_REQUIRE(table.index_of(bytes{0u}) == 0u);
+    STATIC_REQUIRE(table.index_of(bytes{1u}) == 0u);
+    STATIC_REQUIRE(table.index_of(bytes{16u}) == 0u);
+    STATIC_REQUIRE(table.index_of(bytes{17u}) == 1u);
+    STATIC_REQUIRE(table[table.index_of(bytes{100u})] == bytes{112u});
+    STATIC_REQUIRE(table[table.index_of(bytes{257u})] == bytes{320u});
+  }
+  SECTION("Class is a multiple of the alignment") {
+    STATIC_REQUIRE(table[table.index_of(bytes{40u}, alignment::at_boundary<64u>())] == bytes{64u});
+    STATIC_REQUIRE(table[table.index_of(bytes{130u}, alignment::at_boundary<128u>())] == bytes{256u});
+  }
+  SECTION("Request is too large") {
+    STATIC_REQUIRE(table.index_of(bytes{1025u}) == table.size());
+    STATIC_REQUIRE(table.index_of(bytes{16u}, alignment::at_boundary<2048u>()) == table.size());
+  }
+}
+
+} // namespace msl::test
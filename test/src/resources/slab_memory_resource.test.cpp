@@ -0,0 +1,119 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/slab_memory_resource.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+namespace msl::test {
+
+//==============================================================================
+// class : slab_memory_resource
+//==============================================================================
+
+namespace {
+
+  auto is_aligned(const void* p, std::size_t align) -> bool
+  {
+    return (reinterpret_cast<std::uintptr_t>(p) % align) == 0u;
+  }
+
+  auto distance(const void* lhs, const void* rhs) -> std::ptrdiff_t
+  {
+    return static_cast<const std::byte*>(rhs) - static_cast<const std::byte*>(lhs);
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Allocation
+//------------------------------------------------------------------------------
+
+TEST_CASE("slab_memory_resource::allocate<T,Align>()", "[allocation]") {
+  auto sut = slab_memory_resource{};
+
+  SECTION("Blocks are spaced by the size class") {
+    const auto first = sut.allocate<int[25]>();
+    const auto second = sut.allocate<int[25]>();
+
+    REQUIRE(distance(first.data().get(), second.data().get()) == 112);
+  }
+  SECTION("Blocks are writeable") {
+    const auto c = sut.allocate<int[4]>();
+
+    std::memset(c.data().get(), 0x42, sizeof(int[4]));
+
+    REQUIRE(c.size() == 4u);
+  }
+  SECTION("Over-aligned blocks are aligned") {
+    const auto c = sut.allocate<int, 256u>();
+
+    REQUIRE(is_aligned(c.data().get(), 256u));
+  }
+  SECTION("Large request") {
+    const auto c = sut.allocate<std::byte[65536]>();
+
+    REQUIRE(sut.large_allocations() == 1u);
+
+    sut.deallocate(c);
+
+    REQUIRE(sut.large_allocations() == 0u);
+  }
+}
+
+TEST_CASE("slab_memory_resource::allocate<T,Align>(uquantity<T>)", "[allocation]") {
+  auto sut = slab_memory_resource{};
+
+  SECTION("Shares the size class of the static size") {
+    const auto c = sut.allocate<int>(uquantity<int>{25u});
+    sut.deallocate(c);
+
+    const auto result = sut.allocate<int[25]>();
+
+    REQUIRE(static_cast<void*>(result.data().get()) == static_cast<void*>(c.data().get()));
+  }
+  SECTION("Different size classes use different slabs") {
+    const auto small = sut.allocate<int>(uquantity<int>{1u});
+    const auto large = sut.allocate<int>(uquantity<int>{1000u});
+
+    REQUIRE(sut.slabs() == 2u);
+    REQUIRE(is_aligned(large.data().get(), alignof(int)));
+    intrinsics::suppress_unused(small);
+  }
+  SECTION("Large request") {
+    const auto c = sut.allocate<std::byte>(uquantity<std::byte>{65536u});
+
+    REQUIRE(sut.large_allocations() == 1u);
+
+    sut.deallocate(c);
+
+    REQUIRE(sut.large_allocations() == 0u);
+  }
+  SECTION("Request overflows") {
+    const auto n = uquantity<int>{std::numeric_limits<std::size_t>::max() / 2u};
+
+    REQUIRE_THROWS_AS(sut.allocate<int>(n), std::bad_alloc);
+  }
+}
+
+TEST_CASE("slab_memory_resource::deallocate(const cell<T,Align>&)", "[allocation]") {
+  auto sut = slab_memory_resource{};
+  const auto first = sut.allocate<double>();
+  const auto second = sut.allocate<double>();
+
+  sut.deallocate(first);
+  sut.deallocate(second);
+
+  SECTION("Blocks are reused") {
+    REQUIRE(sut.allocate<double>().data() == second.data());
+    REQUIRE(sut.allocate<double>().data() == first.data());
+    REQUIRE(sut.slabs() == 1u);
+  }
+}
+
+} // namespace msl::test
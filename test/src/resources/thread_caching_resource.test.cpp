@@ -0,0 +1,189 @@
+/*
+ Any copyright is dedicated to the Public Domain.
+ https://creativecommons.org/publicdomain/zero/1.0/
+*/
+
+#include "msl/resources/thread_caching_resource.hpp"
+#include "msl/resources/pool_memory_resource.hpp"
+#include "msl/resources/slab_memory_resource.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace msl::test {
+
+//==============================================================================
+// class : thread_caching_resource
+//==============================================================================
+
+namespace {
+
+  using pool_type = pool_memory_resource<sizeof(std::uint64_t), alignof(std::uint64_t)>;
+  using sut_type = thread_caching_resource<pool_type>;
+
+  constexpr auto batch_size = std::size_t{4u};
+
+  auto make_options() -> sut_type::options
+  {
+    return sut_type::options{
+      .batch_size = batch_size,
+    };
+  }
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Allocation
+//------------------------------------------------------------------------------
+
+TEST_CASE("thread_caching_resource::allocate<T,Align>()", "[allocation]") {
+  auto sut = sut_type{make_options()};
+
+  SECTION("Blocks are distinct") {
+    auto blocks = std::vector<std::uint64_t*>{};
+    for (auto i = 0u; i < batch_size * 3u; ++i) {
+      blocks.push_back(sut.allocate<std::uint64_t>().data().get());
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    REQUIRE(std::adjacent_find(blocks.begin(), blocks.end()) == blocks.end());
+  }
+  SECTION("Freed blocks are reused by the same thread") {
+    const auto c = sut.allocate<std::uint64_t>();
+    sut.deallocate(c);
+
+    REQUIRE(sut.allocate<std::uint64_t>().data() == c.data());
+  }
+}
+
+TEST_CASE("thread_caching_resource::deallocate(const cell<T,Align>&)", "[allocation]") {
+  auto sut = sut_type{make_options()};
+
+  auto cells = std::vector<cell<std::uint64_t>>{};
+  for (auto i = 0u; i < batch_size * 3u; ++i) {
+    cells.push_back(sut.allocate<std::uint64_t>());
+  }
+
+  SECTION("Cache does not overflow") {
+    for (auto i = 0u; i < batch_size * 2u; ++i) {
+      sut.deallocate(cells[i]);
+    }
+
+    REQUIRE(sut.central_blocks(0u) == 0u);
+  }
+  SECTION("Cache overflows") {
+    for (const auto& c : cells) {
+      sut.deallocate(c);
+    }
+
+    SECTION("A batch is moved to the central stack") {
+      REQUIRE(sut.central_blocks(0u) == batch_size);
+    }
+  }
+  SECTION("Thread exits") {
+    auto thread = std::thread{[&] {
+      for (const auto& c : cells) {
+        sut.deallocate(c);
+      }
+    }};
+    thread.join();
+
+    SECTION("All of its blocks are moved to the central stack") {
+      REQUIRE(sut.central_blocks(0u) == cells.size());
+    }
+    SECTION("Other threads reuse its blocks") {
+      static_cast<void>(sut.allocate<std::uint64_t>());
+
+      REQUIRE(sut.central_blocks(0u) == cells.size() - batch_size);
+    }
+  }
+  SECTION("Thread that never allocated deallocates") {
+    auto thread = std::thread{[&] {
+      sut.deallocate(cells.front());
+    }};
+    thread.join();
+
+    SECTION("The block is returned directly to the central stack") {
+      REQUIRE(sut.central_blocks(0u) == 1u);
+    }
+  }
+}
+
+TEST_CASE("thread_caching_resource::allocate<T,Align>(uquantity<T>)", "[allocation]") {
+  auto sut = thread_caching_resource<slab_memory_resource>{};
+
+  SECTION("Small request is cached") {
+    const auto c = sut.allocate<int>(uquantity<int>{25u});
+    sut.deallocate(c);
+
+    SECTION("Static size shares the size class") {
+      const auto result = sut.allocate<int[25]>();
+
+      REQUIRE(static_cast<void*>(result.data().get()) == static_cast<void*>(c.data().get()));
+    }
+  }
+  SECTION("Large request is forwarded") {
+    const auto c = sut.allocate<std::byte>(uquantity<std::byte>{65536u});
+
+    c.data().get()[65535] = std::byte{0x42};
+
+    sut.deallocate(c);
+  }
+}
+
+TEST_CASE("thread_caching_resource is thread-safe", "[allocation]") {
+  constexpr auto threads = 8u;
+  constexpr auto iterations = 2000u;
+
+  auto sut = sut_type{make_options()};
+  auto results = std::vector<std::vector<std::uint64_t*>>(threads);
+  auto corrupted = std::atomic<bool>{false};
+
+  auto workers = std::vector<std::thread>{};
+  for (auto t = 0u; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      auto live = std::vector<cell<std::uint64_t>>{};
+      for (auto i = 0u; i < iterations; ++i) {
+        const auto c = sut.allocate<std::uint64_t>();
+        *c.data().get() = t;
+        live.push_back(c);
+        if (i % 3u == 0u) {
+          if (*live.front().data().get() != t) {
+            corrupted = true;
+          }
+          sut.deallocate(live.front());
+          live.erase(live.begin());
+        }
+      }
+      for (const auto& c : live) {
+        results[t].push_back(c.data().get());
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  SECTION("No block is overwritten by another thread") {
+    REQUIRE_FALSE(corrupted);
+  }
+  SECTION("No block is held by two threads") {
+    auto all = std::vector<std::uint64_t*>{};
+    for (auto t = 0u; t < threads; ++t) {
+      for (auto* p : results[t]) {
+        REQUIRE(*p == t);
+        all.push_back(p);
+      }
+    }
+    std::sort(all.begin(), all.end());
+
+    REQUIRE(std::adjacent_find(all.begin(), all.end()) == all.end());
+  }
+}
+
+} // namespace msl::test